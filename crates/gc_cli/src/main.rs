@@ -4,9 +4,13 @@ use clap::{Parser, Subcommand};
 use gc_core::bootstrap::{
     build_default_schedule as core_build_default_schedule, build_standard_world, WorldOptions,
 };
+use gc_core::metrics::archetype_counts;
 use gc_core::prelude::*;
+use gc_core::replay::apply_input;
 use gc_core::{designations, save};
 use std::io::{self, Write};
+use std::path::Path;
+use std::time::Instant;
 
 #[derive(Subcommand, Debug, Clone)]
 enum Demo {
@@ -22,8 +26,12 @@ enum Demo {
     Jobs,
     /// Save/Load snapshot demo
     SaveLoad,
-    /// Batched pathfinding with LRU cache
+    /// Batched pathfinding with LRU cache and parallel speedup report
     PathBatch,
+    /// Headless fast-forward of an input journal with checkpointed seeking
+    Replay,
+    /// Headless run with the tick profiler, optionally exported to CSV/JSON
+    Profile,
     /// TUI Prototype
     Tui,
 }
@@ -50,10 +58,25 @@ struct Args {
     #[arg(long, default_value_t = false)]
     show_vis: bool,
 
-    /// Codec for save/load demo: json|ron|cbor (default: json)
+    /// Largest worker-thread count tried by the path-batch demo (0 = all cores)
+    #[arg(long, default_value_t = 0)]
+    path_threads: usize,
+
+    /// Codec for save/load demo: json|ron|cbor|binary (default: json)
     #[arg(long, default_value = "json")]
     codec: String,
 
+    /// Input journal for the replay demo; recorded to this path if missing
+    #[arg(long)]
+    journal: Option<String>,
+    /// Ticks between replay checkpoints
+    #[arg(long, default_value_t = 50)]
+    checkpoint_every: u64,
+
+    /// Export path for the profile demo's metrics (`.csv`, otherwise JSON)
+    #[arg(long)]
+    metrics: Option<String>,
+
     /// Choose a demo to run. If omitted or set to `menu`, an interactive picker is shown.
     #[command(subcommand)]
     demo: Option<Demo>,
@@ -130,7 +153,7 @@ fn run_demo_fov(args: &Args) -> Result<()> {
     // Compute visibility
     let mut schedule = Schedule::default();
     schedule.add_systems((gc_core::fov::compute_visibility_system,));
-    schedule.run(&mut world);
+    run_tick(&mut world, &mut schedule);
 
     // Print result
     let map = world.resource::<GameMap>();
@@ -138,15 +161,11 @@ fn run_demo_fov(args: &Args) -> Result<()> {
         if args.show_vis {
             let vis = world.resource::<gc_core::fov::Visibility>();
             // Show union of all visible tiles for simplicity
-            use std::collections::HashSet;
-            let mut all: HashSet<(i32, i32)> = HashSet::new();
-            for s in vis.per_entity.values() {
-                all.extend(s.iter().copied());
-            }
+            let all = &vis.visible;
             for y in 0..map.height as i32 {
                 let mut line = String::with_capacity(map.width as usize);
                 for x in 0..map.width as i32 {
-                    let ch = if all.contains(&(x, y)) {
+                    let ch = if all.contains(x, y) {
                         '*'
                     } else {
                         match map.get_tile(x, y).unwrap_or(TileKind::Wall) {
@@ -205,12 +224,13 @@ fn run_demo_path_batch(args: &Args) -> Result<()> {
     }
 
     let results = svc.batch(map, &reqs);
-    let (hits, misses) = svc.stats();
+    let stats = svc.stats();
     println!(
-        "Batched {} requests. Cache hits={}, misses={}",
+        "Batched {} requests. Cache hits={}, misses={}, invalidations={}",
         results.len(),
-        hits,
-        misses
+        stats.hits,
+        stats.misses,
+        stats.invalidations
     );
 
     if args.ascii_map {
@@ -218,6 +238,77 @@ fn run_demo_path_batch(args: &Args) -> Result<()> {
             print_ascii_map_with_path(map, path);
         }
     }
+
+    report_parallel_batch_speedup(map, args.path_threads)
+}
+
+/// Time a cold-cache batch at doubling thread counts and print the speedup
+fn report_parallel_batch_speedup(map: &GameMap, max_threads: usize) -> Result<()> {
+    use gc_core::path::{PathRequest, PathService};
+    use std::time::Instant;
+
+    let walkable: Vec<(i32, i32)> = (0..map.height as i32)
+        .flat_map(|y| (0..map.width as i32).map(move |x| (x, y)))
+        .filter(|&(x, y)| map.is_walkable(x, y))
+        .collect();
+    if walkable.len() < 2 {
+        println!("Not enough walkable tiles for the parallel batch");
+        return Ok(());
+    }
+
+    // Designation-sweep sized batch: far-apart pairs, every fourth one repeated
+    let n = walkable.len();
+    let mut reqs: Vec<PathRequest> = (0..256)
+        .map(|i| PathRequest {
+            start: walkable[(i * 7919) % n],
+            goal: walkable[(i * 104_729 + n / 2) % n],
+        })
+        .collect();
+    let repeats: Vec<PathRequest> = reqs.iter().step_by(4).copied().collect();
+    let repeated = repeats.len();
+    reqs.extend(repeats);
+
+    let max_threads = match max_threads {
+        0 => std::thread::available_parallelism().map_or(1, |n| n.get()),
+        n => n,
+    };
+    let mut counts = Vec::new();
+    let mut t = 1;
+    while t < max_threads {
+        counts.push(t);
+        t *= 2;
+    }
+    counts.push(max_threads);
+
+    println!(
+        "Parallel batch: {} requests ({} repeated) on {}x{}",
+        reqs.len(),
+        repeated,
+        map.width,
+        map.height
+    );
+    let mut baseline = None;
+    let mut expected = None;
+    for threads in counts {
+        let mut svc = PathService::new(reqs.len());
+        svc.set_threads(threads);
+        let t0 = Instant::now();
+        let results = svc.batch(map, &reqs);
+        let elapsed = t0.elapsed().as_secs_f64() * 1000.0;
+        let base = *baseline.get_or_insert(elapsed);
+        let expected = expected.get_or_insert_with(|| results.clone());
+        anyhow::ensure!(
+            *expected == results,
+            "parallel batch with {} threads diverged from the single-threaded result",
+            threads
+        );
+        println!(
+            "  threads={:<3} {:>8.2} ms  speedup {:.2}x",
+            threads,
+            elapsed,
+            base / elapsed.max(f64::EPSILON)
+        );
+    }
     Ok(())
 }
 
@@ -251,7 +342,7 @@ fn run_demo_jobs(args: &Args) -> Result<()> {
     // Run simulation for the specified steps
     let mut schedule = build_default_schedule();
     for _step in 0..args.steps {
-        schedule.run(&mut world);
+        run_tick(&mut world, &mut schedule);
     }
 
     // Print assignments and results
@@ -305,11 +396,7 @@ fn run_demo_jobs(args: &Args) -> Result<()> {
 
     // Print haul jobs created
     let job_board = world.resource::<JobBoard>();
-    let haul_jobs = job_board
-        .0
-        .iter()
-        .filter(|j| matches!(j.kind, JobKind::Haul { .. }))
-        .count();
+    let haul_jobs = job_board.count(JobCategory::Haul);
     println!("Haul jobs queued: {}", haul_jobs);
 
     // Check if mined tile is now floor
@@ -372,14 +459,138 @@ fn run_demo_save(args: &Args) -> Result<()> {
                 world2.resource::<GameMap>().height
             );
         }
+        "binary" => {
+            let bytes = save::encode_binary(&save);
+            println!("Serialized (binary) length: {} bytes", bytes.len());
+            let parsed: save::SaveGame = save::decode_binary(&bytes)?;
+            let mut world2 = World::new();
+            load_world(parsed, &mut world2);
+            println!(
+                "Reloaded world with {}x{} map.",
+                world2.resource::<GameMap>().width,
+                world2.resource::<GameMap>().height
+            );
+        }
         other => {
             println!("Unknown codec '{}'", other);
-            println!("Use one of: json|ron|cbor (default json)");
+            println!("Use one of: json|ron|cbor|binary (default json)");
         }
     }
     Ok(())
 }
 
+/// Scripted journal: one mine designation on the next wall every 5 ticks
+fn sample_journal(world: &World, ticks: u64) -> InputJournal {
+    let map = world.resource::<GameMap>();
+    let walls = (0..map.height as i32)
+        .flat_map(|y| (0..map.width as i32).map(move |x| (x, y)))
+        .filter(|&(x, y)| map.get_tile(x, y) == Some(TileKind::Wall));
+    let mut journal = InputJournal::new();
+    for (tick, (x, y)) in (0..ticks).step_by(5).zip(walls) {
+        journal.record(tick, InputEvent::Designate { x, y });
+    }
+    journal
+}
+
+fn run_demo_replay(args: &Args) -> Result<()> {
+    let start = build_world(args);
+    let ticks = args.steps as u64;
+    let journal = match args.journal.as_deref() {
+        Some(path) if Path::new(path).exists() => InputJournal::decode(&std::fs::read(path)?)?,
+        Some(path) => {
+            let journal = sample_journal(&start, ticks);
+            let bytes = journal.encode();
+            std::fs::write(path, &bytes)?;
+            println!(
+                "Recorded {} inputs ({} bytes) to {path}",
+                journal.len(),
+                bytes.len()
+            );
+            journal
+        }
+        None => sample_journal(&start, ticks),
+    };
+
+    let mut runner = ReplayRunner::new(&start, journal, args.checkpoint_every);
+    let started = Instant::now();
+    runner.seek(ticks);
+    let end_hash = runner.state_hash();
+    println!(
+        "Fast-forwarded {ticks} ticks ({} inputs) in {:?}, {} checkpoints",
+        runner.journal().len(),
+        started.elapsed(),
+        runner.checkpoints()
+    );
+
+    let mid = ticks / 2;
+    let started = Instant::now();
+    let simulated = runner.seek(mid);
+    println!(
+        "Seek to tick {mid}: {simulated} ticks from the nearest checkpoint in {:?}",
+        started.elapsed()
+    );
+    runner.seek(ticks);
+    let again = runner.state_hash();
+    println!(
+        "State hash at tick {ticks}: {end_hash:016x} ({})",
+        if again == end_hash {
+            "reproduced after seeking"
+        } else {
+            "MISMATCH after seeking"
+        }
+    );
+    Ok(())
+}
+
+fn run_demo_profile(args: &Args) -> Result<()> {
+    let mut world = build_world(args);
+    world.insert_resource(TickMetrics::default());
+    // Some mining and hauling to measure: the sample journal's 20 walls, up front
+    let journal = sample_journal(&world, 100);
+    for &(_, input) in journal.entries() {
+        apply_input(&mut world, input);
+    }
+    let mut schedule = build_default_schedule();
+    for _ in 0..args.steps {
+        run_tick(&mut world, &mut schedule);
+    }
+
+    let metrics = world.resource::<TickMetrics>();
+    println!(
+        "{:<14}{:>8}{:>10}{:>10}{:>10}{:>10}",
+        "phase", "ticks", "mean us", "p50 us", "p95 us", "max us"
+    );
+    for row in metrics.summary() {
+        println!(
+            "{:<14}{:>8}{:>10.1}{:>10}{:>10}{:>10}",
+            row.name, row.count, row.mean_us, row.p50_us, row.p95_us, row.max_us
+        );
+    }
+    if let Some(s) = metrics.latest() {
+        let hit_rate = s
+            .path_hit_rate()
+            .map_or("n/a".to_string(), |r| format!("{:.0}%", r * 100.0));
+        println!(
+            "Tick {}: {} entities in {} archetypes, {} jobs waiting, {} active, path cache hit rate {hit_rate}",
+            s.tick, s.entities, s.archetypes, s.job_board, s.active_jobs
+        );
+    }
+    if let Some(path) = args.metrics.as_deref() {
+        let out = if path.ends_with(".csv") {
+            metrics.to_csv()
+        } else {
+            metrics.to_json()?
+        };
+        std::fs::write(path, out)?;
+        println!("Wrote {} samples to {path}", metrics.history().count());
+    }
+    println!("Largest archetypes:");
+    for (name, count) in archetype_counts(&world).into_iter().take(5) {
+        println!("  {count:>6}  {name}");
+    }
+    Ok(())
+}
+
 fn interactive_pick() -> Demo {
     println!("Goblin Camp — Demo Menu");
     println!("1) Mapgen");
@@ -389,7 +600,9 @@ fn interactive_pick() -> Demo {
     println!("5) Save/Load");
     println!("6) Path Batch + Cache");
     println!("7) TUI Prototype");
-    print!("Select [1-7]: ");
+    println!("8) Replay fast-forward");
+    println!("9) Tick profiler");
+    print!("Select [1-9]: ");
     let _ = io::stdout().flush();
 
     let mut buf = String::new();
@@ -402,6 +615,8 @@ fn interactive_pick() -> Demo {
             "5" => Demo::SaveLoad,
             "6" => Demo::PathBatch,
             "7" => Demo::Tui,
+            "8" => Demo::Replay,
+            "9" => Demo::Profile,
             _ => Demo::Mapgen,
         }
     } else {
@@ -424,6 +639,8 @@ fn main() -> Result<()> {
         Demo::Jobs => run_demo_jobs(&args),
         Demo::SaveLoad => run_demo_save(&args),
         Demo::PathBatch => run_demo_path_batch(&args),
+        Demo::Replay => run_demo_replay(&args),
+        Demo::Profile => run_demo_profile(&args),
         Demo::Tui => gc_tui::run(args.width, args.height, args.seed),
         Demo::Menu => Ok(()),
     }
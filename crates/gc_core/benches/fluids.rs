@@ -0,0 +1,109 @@
+//! One `FluidGrid` step on a 1024x1024 map
+//!
+//! - `awake`: every chunk stepped, the worst case and the raw kernel speed
+//! - `flood`: a few springs and a lava vent spreading over walled rooms
+//! - `settled`: still lakes with nothing changing, which should cost
+//!   almost nothing
+//! - `flood_every_4`: the flood stepped from the schedule every 4th tick
+//!
+//! Each prints the tiles it stepped so the active-region savings show up
+//! next to the timings.
+
+use bevy_ecs::prelude::*;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use gc_core::fluids::{fluid_system, FluidGrid, FluidKind, FluidSource, FULL};
+use gc_core::prelude::*;
+
+const SIZE: u32 = 1024;
+
+/// Floor with a wall grid of 64x64 rooms, each with a door
+fn rooms() -> GameMap {
+    let mut map = GameMap::new(SIZE, SIZE);
+    for i in 0..SIZE as i32 {
+        for line in (64..SIZE as i32).step_by(64) {
+            if i % 64 != 32 {
+                map.set_tile(line, i, TileKind::Wall);
+                map.set_tile(i, line, TileKind::Wall);
+            }
+        }
+    }
+    map
+}
+
+fn flood(map: &GameMap) -> FluidGrid {
+    let mut grid = FluidGrid::from_map(map);
+    for (x, y) in [(100, 100), (500, 300), (900, 800)] {
+        grid.add_source(FluidSource {
+            x,
+            y,
+            kind: FluidKind::Water,
+            rate: 40,
+        });
+    }
+    grid.add_source(FluidSource {
+        x: 300,
+        y: 700,
+        kind: FluidKind::Lava,
+        rate: 20,
+    });
+    grid
+}
+
+/// Lakes filled and left to settle until no chunk changes
+fn settled(map: &GameMap) -> FluidGrid {
+    let mut grid = FluidGrid::from_map(map);
+    for (cx, cy) in [(3, 3), (8, 2), (12, 10)] {
+        for y in cy * 64 + 10..cy * 64 + 40 {
+            for x in cx * 64 + 10..cx * 64 + 40 {
+                grid.add(x, y, FluidKind::Water, FULL / 2);
+            }
+        }
+    }
+    while grid.changed_chunks() > 0 {
+        grid.step(map);
+    }
+    grid
+}
+
+fn bench_fluids(c: &mut Criterion) {
+    let map = rooms();
+    let mut group = c.benchmark_group("fluids");
+    group.sample_size(20);
+    group.throughput(Throughput::Elements(1));
+
+    let id = |name: &str| BenchmarkId::new(name, format!("{SIZE}x{SIZE}"));
+    let mut awake = flood(&map);
+    group.bench_function(id("awake"), |b| {
+        b.iter(|| {
+            awake.wake_all();
+            awake.step(&map);
+        })
+    });
+    println!("fluids/awake: {:?}", awake.stats());
+
+    let mut spreading = flood(&map);
+    // Past the first step, which wakes every chunk
+    for _ in 0..50 {
+        spreading.step(&map);
+    }
+    group.bench_function(id("flood"), |b| b.iter(|| spreading.step(&map)));
+    println!("fluids/flood: {:?}", spreading.stats());
+
+    let mut still = settled(&map);
+    group.bench_function(id("settled"), |b| b.iter(|| still.step(&map)));
+    println!("fluids/settled: {:?}", still.stats());
+
+    let mut world = World::new();
+    world.insert_resource(map.clone());
+    world.insert_resource(Time::new(16));
+    world.insert_resource(flood(&map).with_interval(4));
+    let mut schedule = Schedule::default();
+    schedule.add_systems((fluid_system, advance_time).chain());
+    group.bench_function(id("flood_every_4"), |b| {
+        b.iter(|| run_tick(&mut world, &mut schedule))
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_fluids);
+criterion_main!(benches);
@@ -1,16 +1,12 @@
 use bevy_ecs::prelude::*;
 use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use gc_core::bootstrap::run_tick;
 use gc_core::components::VisionRadius;
-use gc_core::fov::{compute_visibility_system, los_visible, Visibility};
+use gc_core::fov::{
+    compute_visibility_system, los_visible, visible_tiles, FovAlgorithm, FovConfig, Visibility,
+};
 use gc_core::mapgen::MapGenerator;
-use gc_core::world::{GameMap, Position, TileKind};
-
-// Helper function to clone a GameMap
-fn clone_map(map: &GameMap) -> GameMap {
-    let mut new_map = GameMap::new(map.width, map.height);
-    new_map.tiles = map.tiles.clone();
-    new_map
-}
+use gc_core::world::{GameMap, Position, TileKind, TileLayout};
 
 fn bench_los_visible(c: &mut Criterion) {
     let mut group = c.benchmark_group("los_visible");
@@ -124,7 +120,7 @@ fn bench_compute_visibility_system(c: &mut Criterion) {
                     let mut world = setup_world_with_map(100, 100, 1, radius);
                     let mut schedule = Schedule::default();
                     schedule.add_systems(compute_visibility_system);
-                    schedule.run(black_box(&mut world));
+                    run_tick(black_box(&mut world), &mut schedule);
                 })
             },
         );
@@ -144,7 +140,7 @@ fn bench_compute_visibility_system(c: &mut Criterion) {
                         let mut world = setup_world_with_map(*width, *height, num_entities, 8);
                         let mut schedule = Schedule::default();
                         schedule.add_systems(compute_visibility_system);
-                        schedule.run(black_box(&mut world));
+                        run_tick(black_box(&mut world), &mut schedule);
                     })
                 },
             );
@@ -182,7 +178,7 @@ fn bench_fov_patterns(c: &mut Criterion) {
             b.iter_batched(
                 || {
                     let mut world = World::new();
-                    world.insert_resource(clone_map(map));
+                    world.insert_resource(map.clone());
                     world.insert_resource(Visibility::default());
 
                     // Single entity in center with large vision radius
@@ -193,7 +189,7 @@ fn bench_fov_patterns(c: &mut Criterion) {
                     (world, schedule)
                 },
                 |(mut world, mut schedule)| {
-                    schedule.run(black_box(&mut world));
+                    run_tick(black_box(&mut world), &mut schedule);
                 },
                 criterion::BatchSize::SmallInput,
             );
@@ -203,10 +199,103 @@ fn bench_fov_patterns(c: &mut Criterion) {
     group.finish();
 }
 
+fn bench_fov_algorithms(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fov_algorithms");
+
+    let gen = MapGenerator::new();
+    let maps = [
+        ("open", GameMap::new(128, 128)),
+        ("generated", gen.generate(128, 128, 42)),
+    ];
+    let algorithms = [
+        ("bresenham", FovAlgorithm::Bresenham),
+        ("shadowcast", FovAlgorithm::Shadowcast),
+    ];
+
+    // Single viewer in the middle of the map
+    for (map_name, map) in &maps {
+        for radius in [8, 16, 32] {
+            for (alg_name, algorithm) in algorithms {
+                group.bench_with_input(
+                    BenchmarkId::new(format!("{}_{}", alg_name, map_name), radius),
+                    &radius,
+                    |b, &radius| {
+                        b.iter(|| {
+                            let mut count = 0usize;
+                            visible_tiles(map, (64, 64), radius, algorithm, |_, _| count += 1);
+                            black_box(count)
+                        })
+                    },
+                );
+            }
+        }
+    }
+
+    // Whole system: a 100-goblin colony at radius 16, every window recomputed
+    for (alg_name, algorithm) in algorithms {
+        let (_, map) = &maps[1];
+        let mut world = World::new();
+        world.insert_resource(map.clone());
+        world.insert_resource(Visibility::default());
+        world.insert_resource(FovConfig { algorithm });
+        for i in 0..100 {
+            world.spawn((
+                Position(8 + (i % 10) * 12, 8 + (i / 10) * 12),
+                VisionRadius(16),
+            ));
+        }
+        let mut schedule = Schedule::default();
+        schedule.add_systems(compute_visibility_system);
+        group.bench_function(BenchmarkId::new(format!("system_{}", alg_name), 100), |b| {
+            b.iter(|| {
+                world.resource_mut::<Visibility>().invalidate();
+                run_tick(black_box(&mut world), &mut schedule)
+            })
+        });
+
+        // Same colony standing still: incremental updates skip every viewer
+        run_tick(&mut world, &mut schedule);
+        group.bench_function(
+            BenchmarkId::new(format!("system_idle_{}", alg_name), 100),
+            |b| b.iter(|| run_tick(black_box(&mut world), &mut schedule)),
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_fov_layouts(c: &mut Criterion) {
+    let mut group = c.benchmark_group("fov_layouts");
+
+    let map = MapGenerator::new().generate(256, 256, 42);
+    for layout in [TileLayout::RowMajor, TileLayout::Chunked] {
+        let map = map.to_layout(layout);
+        for (alg_name, algorithm) in [
+            ("bresenham", FovAlgorithm::Bresenham),
+            ("shadowcast", FovAlgorithm::Shadowcast),
+        ] {
+            group.bench_function(
+                BenchmarkId::new(format!("{}_r32", alg_name), format!("{:?}", layout)),
+                |b| {
+                    b.iter(|| {
+                        let mut count = 0usize;
+                        visible_tiles(&map, (128, 128), 32, algorithm, |_, _| count += 1);
+                        black_box(count)
+                    })
+                },
+            );
+        }
+    }
+
+    group.finish();
+}
+
 criterion_group!(
     benches,
     bench_los_visible,
     bench_compute_visibility_system,
-    bench_fov_patterns
+    bench_fov_patterns,
+    bench_fov_algorithms,
+    bench_fov_layouts
 );
 criterion_main!(benches);
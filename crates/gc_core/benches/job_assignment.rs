@@ -0,0 +1,125 @@
+use bevy_ecs::prelude::*;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion};
+use gc_core::assignment::{AssignmentConfig, AssignmentStrategy};
+use gc_core::bootstrap::run_tick;
+use gc_core::components::{AssignedJob, Carrier};
+use gc_core::jobs::{job_assignment_system, ActiveJobs, Job, JobBoard, JobId, JobKind};
+use gc_core::mapgen::MapGenerator;
+use gc_core::path::astar_path;
+use gc_core::world::{GameMap, Position};
+use rand::rngs::StdRng;
+use rand::{Rng, SeedableRng};
+use std::time::{Duration, Instant};
+
+const JOBS: usize = 1000;
+const WORKERS: usize = 200;
+
+const STRATEGIES: [AssignmentStrategy; 3] = [
+    AssignmentStrategy::Greedy,
+    AssignmentStrategy::Nearest,
+    AssignmentStrategy::WalkDistance,
+];
+
+/// Random walkable tile of `map`
+fn floor_tile(map: &GameMap, rng: &mut StdRng) -> (i32, i32) {
+    loop {
+        let x = rng.gen_range(0..map.width as i32);
+        let y = rng.gen_range(0..map.height as i32);
+        if map.is_walkable(x, y) {
+            return (x, y);
+        }
+    }
+}
+
+/// World with `JOBS` haul jobs and `WORKERS` idle carriers on random floor tiles
+fn build_world(map: &GameMap, strategy: AssignmentStrategy) -> World {
+    let mut rng = StdRng::seed_from_u64(7);
+    let mut world = World::new();
+    let mut board = JobBoard::default();
+    for n in 0..JOBS {
+        let from = floor_tile(map, &mut rng);
+        board.push(Job {
+            id: JobId(uuid::Uuid::from_u128(n as u128)),
+            kind: JobKind::Haul { from, to: from },
+        });
+    }
+    for _ in 0..WORKERS {
+        let (x, y) = floor_tile(map, &mut rng);
+        world.spawn((Carrier, Position(x, y), AssignedJob::default()));
+    }
+    world.insert_resource(map.clone());
+    world.insert_resource(board);
+    world.insert_resource(ActiveJobs::default());
+    world.insert_resource(AssignmentConfig { strategy });
+    world
+}
+
+/// Sum of A* path lengths from each assigned worker to its job's pickup tile
+fn travel_distance(world: &mut World) -> (usize, i64) {
+    let mut q = world.query::<(&Position, &AssignedJob)>();
+    let map = world.resource::<GameMap>();
+    let active = world.resource::<ActiveJobs>();
+    let (mut assigned, mut total) = (0, 0i64);
+    for (pos, job) in q.iter(world) {
+        let Some(job) = job.0.and_then(|id| active.jobs.get(&id)) else {
+            continue;
+        };
+        assigned += 1;
+        if let Some((_, cost)) = astar_path(map, (pos.0, pos.1), job.kind.location()) {
+            total += cost as i64;
+        }
+    }
+    (assigned, total)
+}
+
+/// Fresh world for `strategy` with an initialised assignment schedule
+fn prepared(map: &GameMap, strategy: AssignmentStrategy) -> (World, Schedule) {
+    let mut world = build_world(map, strategy);
+    let mut schedule = Schedule::default();
+    schedule.add_systems(job_assignment_system);
+    schedule.initialize(&mut world).expect("schedule builds");
+    (world, schedule)
+}
+
+/// One-shot report of assignment time and resulting travel per strategy
+fn report_travel(map: &GameMap) {
+    println!("job assignment: {JOBS} haul jobs, {WORKERS} carriers");
+    for strategy in STRATEGIES {
+        let (mut world, mut schedule) = prepared(map, strategy);
+        let t0 = Instant::now();
+        run_tick(&mut world, &mut schedule);
+        let elapsed = t0.elapsed();
+        let (assigned, total) = travel_distance(&mut world);
+        println!(
+            "  {strategy:?}: assigned {assigned}, total travel {total} tiles, mean {:.1}, {elapsed:?}",
+            total as f64 / assigned.max(1) as f64
+        );
+    }
+}
+
+fn bench_assignment_strategies(c: &mut Criterion) {
+    let map = MapGenerator::new().generate(128, 128, 42);
+    report_travel(&map);
+
+    let mut group = c.benchmark_group("job_assignment");
+    for strategy in STRATEGIES {
+        let id = BenchmarkId::new("1k_jobs_200_workers", format!("{strategy:?}"));
+        group.bench_function(id, |b| {
+            // Each run consumes the idle workers, so time it on a fresh world
+            b.iter_custom(|iters| {
+                let mut elapsed = Duration::ZERO;
+                for _ in 0..iters {
+                    let (mut world, mut schedule) = prepared(&map, strategy);
+                    let t0 = Instant::now();
+                    run_tick(&mut world, &mut schedule);
+                    elapsed += t0.elapsed();
+                }
+                elapsed
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_assignment_strategies);
+criterion_main!(benches);
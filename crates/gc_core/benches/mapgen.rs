@@ -0,0 +1,32 @@
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use gc_core::mapgen::MapGenerator;
+
+/// 1, 2, 4, ... up to and including the available core count
+fn thread_counts() -> Vec<usize> {
+    let max = std::thread::available_parallelism().map_or(1, |n| n.get());
+    let mut counts: Vec<usize> = (0..).map(|p| 1 << p).take_while(|&t| t < max).collect();
+    counts.push(max);
+    counts
+}
+
+fn bench_generate(c: &mut Criterion) {
+    let mut group = c.benchmark_group("mapgen");
+    // Large maps take a noticeable fraction of a second per run
+    group.sample_size(10);
+
+    for size in [256u32, 1024, 2048] {
+        for threads in thread_counts() {
+            let gen = MapGenerator::with_threads(threads);
+            group.bench_with_input(
+                BenchmarkId::new(format!("{}x{}", size, size), threads),
+                &size,
+                |b, &size| b.iter(|| black_box(gen.generate(size, size, 42))),
+            );
+        }
+    }
+
+    group.finish();
+}
+
+criterion_group!(benches, bench_generate);
+criterion_main!(benches);
@@ -1,9 +1,50 @@
 use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion};
+use gc_core::flow::FlowField;
+use gc_core::hpa::{Hierarchy, DEFAULT_CLUSTER_SIZE};
 use gc_core::mapgen::MapGenerator;
-use gc_core::path::{astar_path, PathRequest, PathService};
-use gc_core::world::{GameMap, TileKind};
+use gc_core::path::{astar_path, AstarScratch, PathMode, PathRequest, PathService};
+use gc_core::world::{GameMap, TileKind, TileLayout};
 use rand::rngs::StdRng;
 use rand::{Rng, SeedableRng};
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+
+/// System allocator wrapper that counts allocations, so benches can show
+/// how many heap allocations a search performs
+struct CountingAlloc;
+
+static ALLOCATIONS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.alloc(layout)
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout)
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        ALLOCATIONS.fetch_add(1, Ordering::Relaxed);
+        System.realloc(ptr, layout, new_size)
+    }
+}
+
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
+
+/// Run `f` `iters` times, returning elapsed time and allocations performed
+fn timed_allocs(iters: u64, mut f: impl FnMut()) -> (Duration, usize) {
+    let before = ALLOCATIONS.load(Ordering::Relaxed);
+    let t0 = Instant::now();
+    for _ in 0..iters {
+        f();
+    }
+    let elapsed = t0.elapsed();
+    (elapsed, ALLOCATIONS.load(Ordering::Relaxed) - before)
+}
 
 fn create_random_map(width: u32, height: u32, seed: u32) -> GameMap {
     let generator = MapGenerator::new();
@@ -209,11 +250,259 @@ fn bench_path_service_cache(c: &mut Criterion) {
     group.finish();
 }
 
+fn bench_flat_vs_hierarchical(c: &mut Criterion) {
+    let mut group = c.benchmark_group("flat_vs_hierarchical");
+    group.sample_size(20);
+
+    for &size in &[128u32, 256, 512] {
+        let map = create_mostly_floor_map(size, size, 0.25, 42);
+        let hierarchy = Hierarchy::build(&map, DEFAULT_CLUSTER_SIZE);
+
+        // Cross-map haul: opposite corners, nudged onto walkable tiles
+        let corner = |x0: i32, y0: i32| {
+            let mut p = (x0, y0);
+            while map.in_bounds(p.0, p.1) && !map.is_walkable(p.0, p.1) {
+                p = (p.0 + 1, p.1 + 1);
+            }
+            p
+        };
+        let start = corner(1, 1);
+        let goal = corner(size as i32 - size as i32 / 8, size as i32 - size as i32 / 8);
+        let label = format!("{}x{}", size, size);
+
+        group.bench_with_input(
+            BenchmarkId::new("flat", &label),
+            &(start, goal),
+            |b, &(start, goal)| b.iter(|| black_box(astar_path(&map, start, goal))),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("hierarchical", &label),
+            &(start, goal),
+            |b, &(start, goal)| b.iter(|| black_box(hierarchy.find_path(&map, start, goal))),
+        );
+        group.bench_with_input(
+            BenchmarkId::new("build_hierarchy", &label),
+            &map,
+            |b, map| b.iter(|| black_box(Hierarchy::build(map, DEFAULT_CLUSTER_SIZE))),
+        );
+
+        // Many carriers missing the cache at once, through PathService
+        let positions = find_valid_positions(&map, 32, 321);
+        let requests: Vec<PathRequest> = positions
+            .windows(2)
+            .map(|w| PathRequest {
+                start: w[0],
+                goal: w[1],
+            })
+            .collect();
+        for (name, mode) in [
+            ("service_flat", PathMode::Flat),
+            ("service_hierarchical", PathMode::Hierarchical),
+        ] {
+            group.bench_with_input(BenchmarkId::new(name, &label), &requests, |b, reqs| {
+                let mut service = PathService::with_mode(1, mode);
+                // Warm up once so the hierarchy build is not part of the measurement
+                service.batch(&map, reqs);
+                b.iter(|| black_box(service.batch(&map, reqs)))
+            });
+        }
+    }
+
+    group.finish();
+}
+
+fn bench_astar_allocations(c: &mut Criterion) {
+    let mut group = c.benchmark_group("astar_allocations");
+
+    for &size in &[64u32, 256] {
+        let map = create_mostly_floor_map(size, size, 0.2, 7);
+        let positions = find_valid_positions(&map, 16, 99);
+        let pairs: Vec<((i32, i32), (i32, i32))> =
+            positions.windows(2).map(|w| (w[0], w[1])).collect();
+        let label = format!("{}x{}", size, size);
+
+        // Warm reusable scratch: buffers and output path are already grown
+        let mut scratch = AstarScratch::for_map(&map);
+        let mut path = Vec::new();
+        for &(start, goal) in &pairs {
+            scratch.search_into(&map, start, goal, None, &mut path);
+        }
+        let (_, warm) = timed_allocs(1, || {
+            for &(start, goal) in &pairs {
+                black_box(scratch.search_into(&map, start, goal, None, &mut path));
+            }
+        });
+        let (_, fresh) = timed_allocs(1, || {
+            for &(start, goal) in &pairs {
+                black_box(astar_path(&map, start, goal));
+            }
+        });
+        println!(
+            "astar_allocations/{}: {} searches, scratch.search_into = {} allocations, astar_path = {}",
+            label,
+            pairs.len(),
+            warm,
+            fresh
+        );
+        assert_eq!(warm, 0, "steady-state search_into must not allocate");
+
+        group.bench_with_input(
+            BenchmarkId::new("scratch_search_into", &label),
+            &pairs,
+            |b, pairs| {
+                b.iter_custom(|iters| {
+                    let (elapsed, allocs) = timed_allocs(iters, || {
+                        for &(start, goal) in pairs {
+                            black_box(scratch.search_into(&map, start, goal, None, &mut path));
+                        }
+                    });
+                    assert_eq!(allocs, 0, "steady-state search_into must not allocate");
+                    elapsed
+                })
+            },
+        );
+        group.bench_with_input(
+            BenchmarkId::new("astar_path", &label),
+            &pairs,
+            |b, pairs| {
+                b.iter(|| {
+                    for &(start, goal) in pairs {
+                        black_box(astar_path(&map, start, goal));
+                    }
+                })
+            },
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_map_layouts(c: &mut Criterion) {
+    let mut group = c.benchmark_group("map_layouts");
+
+    let map = create_mostly_floor_map(256, 256, 0.2, 7);
+    let positions = find_valid_positions(&map, 16, 99);
+    let pairs: Vec<((i32, i32), (i32, i32))> = positions.windows(2).map(|w| (w[0], w[1])).collect();
+    for layout in [TileLayout::RowMajor, TileLayout::Chunked] {
+        let map = map.to_layout(layout);
+        let mut scratch = AstarScratch::for_map(&map);
+        group.bench_with_input(
+            BenchmarkId::new("astar_256x256", format!("{:?}", layout)),
+            &pairs,
+            |b, pairs| {
+                b.iter(|| {
+                    for &(start, goal) in pairs {
+                        black_box(scratch.search(&map, start, goal, None));
+                    }
+                })
+            },
+        );
+    }
+
+    group.finish();
+}
+
+fn bench_tile_queries(c: &mut Criterion) {
+    let mut group = c.benchmark_group("tile_queries");
+
+    // Four-neighbour walkability over a whole 256x256 map, as A* expands it
+    let map = create_mostly_floor_map(256, 256, 0.2, 3);
+    let (w, h) = (map.width as i32, map.height as i32);
+    let scan = |walkable: &dyn Fn(i32, i32) -> bool| {
+        let mut n = 0u32;
+        for y in 0..h {
+            for x in 0..w {
+                for (dx, dy) in [(1, 0), (-1, 0), (0, 1), (0, -1)] {
+                    n += walkable(black_box(x + dx), y + dy) as u32;
+                }
+            }
+        }
+        n
+    };
+    group.bench_function("is_walkable_bit_plane", |b| {
+        b.iter(|| black_box(scan(&|x, y| map.is_walkable(x, y))))
+    });
+    group.bench_function("get_tile_match", |b| {
+        b.iter(|| {
+            black_box(scan(&|x, y| {
+                matches!(map.get_tile(x, y), Some(TileKind::Floor))
+            }))
+        })
+    });
+
+    group.finish();
+}
+
+fn bench_flow_field(c: &mut Criterion) {
+    let mut group = c.benchmark_group("flow_field");
+
+    let map = create_mostly_floor_map(256, 256, 0.2, 11);
+    let positions = find_valid_positions(&map, 201, 5);
+    let (goal, carriers) = (positions[0], &positions[1..]);
+    let label = format!("{}_carriers", carriers.len());
+
+    // Every carrier plans its own path vs. all of them reading one field
+    group.bench_with_input(
+        BenchmarkId::new("astar_per_carrier", &label),
+        carriers,
+        |b, carriers| {
+            b.iter(|| {
+                for &start in carriers {
+                    black_box(astar_path(&map, start, goal));
+                }
+            })
+        },
+    );
+    let field = FlowField::new(&map, (goal.0, goal.1, goal.0, goal.1));
+    group.bench_with_input(
+        BenchmarkId::new("field_lookups", &label),
+        carriers,
+        |b, carriers| {
+            b.iter(|| {
+                for &(x, y) in carriers {
+                    black_box(field.distance(&map, x, y));
+                    black_box(field.next_step(&map, x, y));
+                }
+            })
+        },
+    );
+    group.bench_function("full_build_256x256", |b| {
+        b.iter(|| black_box(FlowField::new(&map, (goal.0, goal.1, goal.0, goal.1))))
+    });
+
+    // Mining one wall only relaxes the tiles whose distance drops
+    let wall = (0..map.height as i32)
+        .flat_map(|y| (0..map.width as i32).map(move |x| (x, y)))
+        .find(|&(x, y)| !map.is_walkable(x, y) && field.distance(&map, x, y).is_some())
+        .expect("a reachable wall");
+    group.bench_function("repair_after_mining", |b| {
+        b.iter_custom(|iters| {
+            let mut elapsed = Duration::ZERO;
+            for _ in 0..iters {
+                let mut mined = map.clone();
+                let mut field = field.clone();
+                mined.set_tile(wall.0, wall.1, TileKind::Floor);
+                let t0 = Instant::now();
+                black_box(field.apply_changes(&mined, &[wall], &[]));
+                elapsed += t0.elapsed();
+            }
+            elapsed
+        })
+    });
+
+    group.finish();
+}
+
 criterion_group!(
     benches,
     bench_astar_single_path,
     bench_astar_different_densities,
     bench_astar_path_lengths,
-    bench_path_service_cache
+    bench_path_service_cache,
+    bench_flat_vs_hierarchical,
+    bench_astar_allocations,
+    bench_map_layouts,
+    bench_tile_queries,
+    bench_flow_field
 );
 criterion_main!(benches);
@@ -0,0 +1,102 @@
+use bevy_ecs::prelude::*;
+use criterion::{black_box, criterion_group, criterion_main, Criterion};
+use gc_core::autosave::AutosaveTracker;
+use gc_core::prelude::*;
+
+/// Generated `size` x `size` map with `entities` named, item and moving
+/// entities
+fn sample_world(size: u32, entities: i32) -> World {
+    let mut world = World::new();
+    world.insert_resource(MapGenerator::new().generate(size, size, 42));
+    for i in 0..entities {
+        let pos = Position(i % 256, i * 7 % 256);
+        match i % 3 {
+            0 => world.spawn((Name(format!("Goblin {i}")), pos, Velocity(1, 0))),
+            1 => world.spawn((Name("Stone".into()), pos, Item::stone(), Carriable)),
+            _ => world.spawn((pos,)),
+        };
+    }
+    world
+}
+
+fn sample_save() -> SaveGame {
+    save_world(&mut sample_world(256, 300))
+}
+
+fn bench_save_codecs(c: &mut Criterion) {
+    let save = sample_save();
+    let json = encode_json(&save).unwrap();
+    let ron = encode_ron(&save).unwrap();
+    let cbor = encode_cbor(&save).unwrap();
+    let binary = encode_binary(&save);
+    println!(
+        "save sizes (bytes): json={} ron={} cbor={} binary={}",
+        json.len(),
+        ron.len(),
+        cbor.len(),
+        binary.len()
+    );
+
+    let mut group = c.benchmark_group("save_encode");
+    group.bench_function("json", |b| {
+        b.iter(|| black_box(encode_json(&save).unwrap()))
+    });
+    group.bench_function("ron", |b| b.iter(|| black_box(encode_ron(&save).unwrap())));
+    group.bench_function("cbor", |b| {
+        b.iter(|| black_box(encode_cbor(&save).unwrap()))
+    });
+    group.bench_function("binary", |b| b.iter(|| black_box(encode_binary(&save))));
+    group.finish();
+
+    let mut group = c.benchmark_group("save_decode");
+    group.bench_function("json", |b| {
+        b.iter(|| black_box(decode_json(&json).unwrap()))
+    });
+    group.bench_function("ron", |b| b.iter(|| black_box(decode_ron(&ron).unwrap())));
+    group.bench_function("cbor", |b| {
+        b.iter(|| black_box(decode_cbor(&cbor).unwrap()))
+    });
+    group.bench_function("binary", |b| {
+        b.iter(|| black_box(decode_binary(&binary).unwrap()))
+    });
+    // Validation alone, without expanding tiles or copying names
+    group.bench_function("binary_view", |b| {
+        b.iter(|| black_box(gc_core::binsave::BinarySave::parse(&binary).unwrap()))
+    });
+    group.finish();
+}
+
+/// Full save versus a delta after a handful of edits on a large colony
+fn bench_autosave(c: &mut Criterion) {
+    let mut world = sample_world(1024, 5000);
+    let mut group = c.benchmark_group("autosave");
+    group.sample_size(20);
+
+    group.bench_function("full_cbor", |b| {
+        b.iter(|| black_box(encode_cbor(&save_world(&mut world)).unwrap()))
+    });
+
+    let mut tracker = AutosaveTracker::new(usize::MAX);
+    tracker.capture(&mut world);
+    let mut step = 0;
+    group.bench_function("delta_capture", |b| {
+        b.iter(|| {
+            step += 1;
+            let kind = if step % 2 == 0 {
+                TileKind::Wall
+            } else {
+                TileKind::Floor
+            };
+            for i in 0..8 {
+                world
+                    .resource_mut::<GameMap>()
+                    .set_tile(i * 100, i * 90, kind);
+            }
+            black_box(tracker.capture(&mut world))
+        })
+    });
+    group.finish();
+}
+
+criterion_group!(benches, bench_save_codecs, bench_autosave);
+criterion_main!(benches);
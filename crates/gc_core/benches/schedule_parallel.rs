@@ -0,0 +1,139 @@
+//! Tick time of the default schedule (plus FOV) by executor and thread count
+//!
+//! The multi-threaded executor uses every core by default; set
+//! `GC_BENCH_THREADS=<n>` to pin its pool size, e.g.
+//! `for n in 1 2 4 8; do GC_BENCH_THREADS=$n cargo bench --bench schedule_parallel; done`
+
+use bevy_ecs::prelude::*;
+use bevy_ecs::schedule::ExecutorKind;
+use bevy_tasks::{ComputeTaskPool, TaskPoolBuilder};
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion};
+use gc_core::fov::{compute_visibility_system, Visibility};
+use gc_core::hash::WorldHash;
+use gc_core::prelude::*;
+
+const SIZE: u32 = 256;
+const WORKERS: i32 = 300;
+const WANDERERS: i32 = 300;
+const STONES: i32 = 2000;
+const DESIGNATIONS: usize = 400;
+
+/// Turn wanderers around at the map edge so they keep moving (and keep
+/// their FOV dirty) however many ticks the bench runs
+fn patrol(map: Res<GameMap>, mut q: Query<(&Position, &mut Velocity), With<Goblin>>) {
+    let max_x = map.width as i32 - 1;
+    for (pos, mut vel) in q.iter_mut() {
+        if (pos.0 == 0 && vel.0 < 0) || (pos.0 == max_x && vel.0 > 0) {
+            vel.0 = -vel.0;
+        }
+    }
+}
+
+fn colony() -> World {
+    let opts = WorldOptions {
+        populate_demo_scene: true,
+        ..Default::default()
+    };
+    let mut world = build_standard_world(SIZE, SIZE, 11, opts);
+    world.insert_resource(Visibility::default());
+    let side = SIZE as i32;
+    for i in 0..WORKERS {
+        let (x, y) = ((i * 37) % side, (i * 53) % side);
+        world.spawn((
+            Miner,
+            Position(x, y),
+            AssignedJob::default(),
+            VisionRadius(8),
+        ));
+        world.spawn((
+            Carrier,
+            Position(y, x),
+            Inventory::default(),
+            AssignedJob::default(),
+            VisionRadius(8),
+        ));
+    }
+    for i in 0..WANDERERS {
+        let vx = if i % 2 == 0 { 1 } else { -1 };
+        let pos = Position((i * 17) % side, (i * 29) % side);
+        world.spawn((Goblin, pos, Velocity(vx, 0), VisionRadius(8)));
+    }
+    for i in 0..STONES {
+        let pos = Position((i * 71) % side, (i * 43) % side);
+        world.spawn((Item::stone(), Stone, pos, Carriable));
+    }
+    let walls: Vec<(i32, i32)> = {
+        let map = world.resource::<GameMap>();
+        (0..side)
+            .flat_map(|y| (0..side).map(move |x| (x, y)))
+            .filter(|&(x, y)| map.get_tile(x, y) == Some(TileKind::Wall))
+            .step_by(7)
+            .take(DESIGNATIONS)
+            .collect()
+    };
+    for (x, y) in walls {
+        world.spawn(DesignationBundle {
+            pos: Position(x, y),
+            ..Default::default()
+        });
+    }
+    world
+}
+
+fn schedule(kind: ExecutorKind) -> Schedule {
+    let mut schedule = build_default_schedule();
+    schedule.add_systems((
+        patrol.in_set(SimSet::Input),
+        compute_visibility_system.in_set(SimSet::Perception),
+    ));
+    schedule.set_executor_kind(kind);
+    schedule
+}
+
+fn bench_schedule_parallel(c: &mut Criterion) {
+    let threads = std::env::var("GC_BENCH_THREADS")
+        .ok()
+        .and_then(|n| n.parse::<usize>().ok());
+    let pool = ComputeTaskPool::get_or_init(|| match threads {
+        Some(n) => TaskPoolBuilder::new().num_threads(n).build(),
+        None => TaskPoolBuilder::new().build(),
+    });
+    let threads = pool.thread_num();
+
+    let executors = [
+        ("single_threaded", ExecutorKind::SingleThreaded),
+        ("multi_threaded", ExecutorKind::MultiThreaded),
+    ];
+
+    // Both executors must produce the same world
+    let hashes: Vec<u64> = executors
+        .iter()
+        .map(|&(_, kind)| {
+            let mut world = colony();
+            world.insert_resource(WorldHash::default());
+            let mut schedule = schedule(kind);
+            for _ in 0..40 {
+                run_tick(&mut world, &mut schedule);
+            }
+            world.resource::<WorldHash>().current()
+        })
+        .collect();
+    assert_eq!(hashes[0], hashes[1], "executors diverged");
+
+    let mut group = c.benchmark_group("schedule_parallel");
+    group.sample_size(30);
+    for (name, kind) in executors {
+        let mut world = colony();
+        let mut schedule = schedule(kind);
+        // Past the first tick, which indexes and sees everything
+        for _ in 0..5 {
+            run_tick(&mut world, &mut schedule);
+        }
+        let id = BenchmarkId::new(name, format!("{threads}_threads"));
+        group.bench_function(id, |b| b.iter(|| run_tick(&mut world, &mut schedule)));
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_schedule_parallel);
+criterion_main!(benches);
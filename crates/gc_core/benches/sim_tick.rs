@@ -0,0 +1,206 @@
+//! Full default-schedule ticks at colony scale
+//!
+//! Each scenario is a `build_standard_world` demo colony grown to the given
+//! map size, worker count, loose item count and mine designation sweep.
+//! Before timing, two fresh copies run side by side under `WorldHash` and
+//! must agree on every tick, and the incremental hash must match a full
+//! rehash. The measured world carries a `WorldHash` too, so its ticks
+//! include the incremental hash update, and after timing its hash is
+//! checked against a full rehash as well. Criterion reports ticks/second; a
+//! second pass prints per-tick latency percentiles.
+//!
+//! Run one scenario with e.g. `cargo bench --bench sim_tick -- medium`.
+
+use bevy_ecs::prelude::*;
+use criterion::{criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use gc_core::hash::{full_world_hash, WorldHash};
+use gc_core::prelude::*;
+use rand::rngs::StdRng;
+use rand::seq::SliceRandom;
+use rand::SeedableRng;
+use std::time::{Duration, Instant};
+
+/// Ticks both copies run during verification
+const VERIFY_TICKS: usize = 30;
+/// Ticks run before measuring, past the first tick's full index and haul
+/// job posting
+const WARMUP_TICKS: usize = 5;
+/// Ticks timed one by one for the latency percentiles
+const LATENCY_TICKS: usize = 200;
+
+struct Scenario {
+    name: &'static str,
+    size: u32,
+    /// Half miners, half carriers
+    workers: usize,
+    items: usize,
+    designations: usize,
+}
+
+const SCENARIOS: [Scenario; 4] = [
+    Scenario {
+        name: "small",
+        size: 128,
+        workers: 10,
+        items: 100,
+        designations: 200,
+    },
+    Scenario {
+        name: "medium",
+        size: 512,
+        workers: 100,
+        items: 5_000,
+        designations: 2_000,
+    },
+    Scenario {
+        name: "sweep",
+        size: 512,
+        workers: 100,
+        items: 500,
+        designations: 20_000,
+    },
+    Scenario {
+        name: "large",
+        size: 2048,
+        workers: 1_000,
+        items: 50_000,
+        designations: 20_000,
+    },
+];
+
+fn colony(s: &Scenario) -> World {
+    let opts = WorldOptions {
+        populate_demo_scene: true,
+        ..Default::default()
+    };
+    let mut world = build_standard_world(s.size, s.size, 17, opts);
+    let (mut floors, walls) = {
+        let map = world.resource::<GameMap>();
+        let tiles = (0..s.size as i32).flat_map(|y| (0..s.size as i32).map(move |x| (x, y)));
+        let (floors, walls): (Vec<_>, Vec<_>) = tiles.partition(|&(x, y)| map.is_walkable(x, y));
+        (floors, walls)
+    };
+    let mut rng = StdRng::seed_from_u64(s.size as u64);
+    floors.shuffle(&mut rng);
+    let mut spots = floors.into_iter().cycle();
+    for i in 0..s.workers {
+        let (x, y) = spots.next().unwrap();
+        if i % 2 == 0 {
+            world.spawn((Goblin, Miner, Position(x, y), AssignedJob::default()));
+        } else {
+            world.spawn((
+                Goblin,
+                Carrier,
+                Position(x, y),
+                Inventory::default(),
+                AssignedJob::default(),
+            ));
+        }
+    }
+    for _ in 0..s.items {
+        let (x, y) = spots.next().unwrap();
+        world.spawn((Item::stone(), Stone, Position(x, y), Carriable));
+    }
+    // Spread the sweep over the whole map rather than the first rows
+    let step = (walls.len() / s.designations.max(1)).max(1);
+    for &(x, y) in walls.iter().step_by(step).take(s.designations) {
+        world.spawn(DesignationBundle {
+            pos: Position(x, y),
+            ..Default::default()
+        });
+    }
+    world
+}
+
+/// Run two copies in lockstep and check they never diverge
+fn verify(s: &Scenario) {
+    let mut runs: Vec<(World, Schedule)> = (0..2)
+        .map(|_| {
+            let mut world = colony(s);
+            world.insert_resource(WorldHash::default());
+            (world, build_default_schedule())
+        })
+        .collect();
+    for _ in 0..VERIFY_TICKS {
+        for (world, schedule) in &mut runs {
+            run_tick(world, schedule);
+        }
+    }
+    let (a, b) = (&runs[0].0, &runs[1].0);
+    let divergence = a
+        .resource::<WorldHash>()
+        .first_divergence(b.resource::<WorldHash>());
+    assert_eq!(divergence, None, "{}: runs diverged", s.name);
+    check_hash(s, &mut runs[0].0);
+}
+
+/// The incremental hash must match a full rehash of `world`
+fn check_hash(s: &Scenario, world: &mut World) {
+    let incremental = world.resource::<WorldHash>().current();
+    assert_eq!(
+        incremental,
+        full_world_hash(world),
+        "{}: incremental hash drifted",
+        s.name
+    );
+}
+
+fn percentile(sorted: &[Duration], q: f64) -> Duration {
+    let i = ((sorted.len() as f64 * q).ceil() as usize).clamp(1, sorted.len());
+    sorted[i - 1]
+}
+
+fn report_latency(s: &Scenario, world: &mut World, schedule: &mut Schedule) {
+    let mut ticks: Vec<Duration> = (0..LATENCY_TICKS)
+        .map(|_| {
+            let started = Instant::now();
+            run_tick(world, schedule);
+            started.elapsed()
+        })
+        .collect();
+    let total: Duration = ticks.iter().sum();
+    ticks.sort_unstable();
+    println!(
+        "sim_tick/{}: {:.0} ticks/s, p50 {:?}, p95 {:?}, p99 {:?}, max {:?} over {} ticks",
+        s.name,
+        LATENCY_TICKS as f64 / total.as_secs_f64(),
+        percentile(&ticks, 0.50),
+        percentile(&ticks, 0.95),
+        percentile(&ticks, 0.99),
+        ticks[ticks.len() - 1],
+        LATENCY_TICKS
+    );
+}
+
+fn bench_sim_tick(c: &mut Criterion) {
+    let mut group = c.benchmark_group("sim_tick");
+    group.sample_size(20);
+    group.throughput(Throughput::Elements(1));
+    for s in &SCENARIOS {
+        let id = BenchmarkId::new(s.name, format!("{}x{}", s.size, s.size));
+        // Built on first use so a filtered-out scenario costs nothing
+        let mut run: Option<(World, Schedule)> = None;
+        group.bench_function(id, |b| {
+            let (world, schedule) = run.get_or_insert_with(|| {
+                verify(s);
+                let mut world = colony(s);
+                world.insert_resource(WorldHash::default());
+                let mut schedule = build_default_schedule();
+                for _ in 0..WARMUP_TICKS {
+                    run_tick(&mut world, &mut schedule);
+                }
+                (world, schedule)
+            });
+            b.iter(|| run_tick(world, schedule));
+        });
+        if let Some((mut world, mut schedule)) = run {
+            check_hash(s, &mut world);
+            report_latency(s, &mut world, &mut schedule);
+            check_hash(s, &mut world);
+        }
+    }
+    group.finish();
+}
+
+criterion_group!(benches, bench_sim_tick);
+criterion_main!(benches);
@@ -0,0 +1,352 @@
+//! Typed, bounded action log
+//!
+//! Systems record what they did as small `Copy` records (tick, entities,
+//! job id, coordinates) into a fixed-capacity ring buffer, so logging
+//! allocates nothing per event and a long run keeps only the newest
+//! `capacity` records. Text is produced only when the log is read, through
+//! `Display`. An optional sink streams every record to a binary file of
+//! fixed-size records:
+//!
+//! | Field      | Encoding                                          |
+//! |------------|---------------------------------------------------|
+//! | magic      | `GCAL`                                            |
+//! | version    | `u8`                                              |
+//! | per record | tick `u64`, tag `u8`, worker and item entity bits `u64` (0 = none), job `u128`, x and y `i32`; all little-endian |
+
+use crate::jobs::JobId;
+use bevy_ecs::prelude::*;
+use std::collections::VecDeque;
+use std::fmt;
+use std::io::{self, Write};
+use uuid::Uuid;
+
+/// File signature of a streamed action log
+pub const MAGIC: [u8; 4] = *b"GCAL";
+/// Action log encoding version written by the sink
+pub const VERSION: u8 = 1;
+/// Records kept by `ActionLog::default`
+pub const DEFAULT_CAPACITY: usize = 4096;
+/// Encoded size of one record
+pub const RECORD_BYTES: usize = 8 + 1 + 8 + 8 + 16 + 4 + 4;
+
+const TAG_MINED: u8 = 0;
+const TAG_PICKED_UP: u8 = 1;
+const TAG_DELIVERED: u8 = 2;
+
+/// Reasons a byte buffer is not a valid action log file
+#[derive(Debug, Clone, PartialEq, Eq, thiserror::Error)]
+pub enum ActionLogError {
+    #[error("not an action log (bad magic)")]
+    BadMagic,
+    #[error("unsupported action log version {0}")]
+    UnsupportedVersion(u8),
+    #[error("action log truncated")]
+    Truncated,
+    #[error("corrupt action log: {0}")]
+    Corrupt(&'static str),
+}
+
+/// Something a system did
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Action {
+    /// A miner finished the mine job at `(x, y)`
+    Mined {
+        worker: Entity,
+        job: JobId,
+        x: i32,
+        y: i32,
+    },
+    /// A carrier picked up `item` for a haul job
+    PickedUp {
+        worker: Entity,
+        item: Entity,
+        job: JobId,
+    },
+    /// A carrier finished a haul job by dropping at `(x, y)`
+    Delivered {
+        worker: Entity,
+        job: JobId,
+        x: i32,
+        y: i32,
+    },
+}
+
+/// One logged action and the tick it happened on
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ActionRecord {
+    pub tick: u64,
+    pub action: Action,
+}
+
+impl fmt::Display for ActionRecord {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "[{}] ", self.tick)?;
+        match self.action {
+            Action::Mined { worker, job, x, y } => {
+                write!(f, "{worker} mined ({x}, {y}) for job {}", job.0)
+            }
+            Action::PickedUp { worker, item, job } => {
+                write!(f, "{worker} picked up {item} for job {}", job.0)
+            }
+            Action::Delivered { worker, job, x, y } => {
+                write!(f, "{worker} delivered to ({x}, {y}) for job {}", job.0)
+            }
+        }
+    }
+}
+
+impl ActionRecord {
+    /// Fixed-size little-endian encoding; see the module docs
+    pub fn encode(&self) -> [u8; RECORD_BYTES] {
+        let (tag, worker, item, job, (x, y)) = match self.action {
+            Action::Mined { worker, job, x, y } => (TAG_MINED, worker, None, job, (x, y)),
+            Action::PickedUp { worker, item, job } => {
+                (TAG_PICKED_UP, worker, Some(item), job, (0, 0))
+            }
+            Action::Delivered { worker, job, x, y } => (TAG_DELIVERED, worker, None, job, (x, y)),
+        };
+        let mut out = [0u8; RECORD_BYTES];
+        let mut at = 0;
+        let mut put = |bytes: &[u8]| {
+            out[at..at + bytes.len()].copy_from_slice(bytes);
+            at += bytes.len();
+        };
+        put(&self.tick.to_le_bytes());
+        put(&[tag]);
+        put(&worker.to_bits().to_le_bytes());
+        put(&item.map_or(0, Entity::to_bits).to_le_bytes());
+        put(&job.0.as_u128().to_le_bytes());
+        put(&x.to_le_bytes());
+        put(&y.to_le_bytes());
+        out
+    }
+
+    /// Inverse of `encode`
+    pub fn decode(bytes: &[u8; RECORD_BYTES]) -> Result<Self, ActionLogError> {
+        let tick = u64::from_le_bytes(bytes[0..8].try_into().unwrap());
+        let tag = bytes[8];
+        let entity = |range: std::ops::Range<usize>| {
+            let bits = u64::from_le_bytes(bytes[range].try_into().unwrap());
+            Entity::try_from_bits(bits).map_err(|_| ActionLogError::Corrupt("bad entity"))
+        };
+        let worker = entity(9..17)?;
+        let job = JobId(Uuid::from_u128(u128::from_le_bytes(
+            bytes[25..41].try_into().unwrap(),
+        )));
+        let x = i32::from_le_bytes(bytes[41..45].try_into().unwrap());
+        let y = i32::from_le_bytes(bytes[45..49].try_into().unwrap());
+        let action = match tag {
+            TAG_MINED => Action::Mined { worker, job, x, y },
+            TAG_PICKED_UP => Action::PickedUp {
+                worker,
+                item: entity(17..25)?,
+                job,
+            },
+            TAG_DELIVERED => Action::Delivered { worker, job, x, y },
+            _ => return Err(ActionLogError::Corrupt("unknown action tag")),
+        };
+        Ok(Self { tick, action })
+    }
+}
+
+/// Bounded log of recent actions, with an optional streaming sink
+#[derive(Resource)]
+pub struct ActionLog {
+    records: VecDeque<ActionRecord>,
+    capacity: usize,
+    /// Records pushed out of the ring buffer so far
+    dropped: u64,
+    sink: Option<Box<dyn Write + Send + Sync>>,
+    sink_error: Option<io::Error>,
+}
+
+impl Default for ActionLog {
+    fn default() -> Self {
+        Self::new(DEFAULT_CAPACITY)
+    }
+}
+
+impl fmt::Debug for ActionLog {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("ActionLog")
+            .field("len", &self.records.len())
+            .field("capacity", &self.capacity)
+            .field("dropped", &self.dropped)
+            .field("streaming", &self.sink.is_some())
+            .finish()
+    }
+}
+
+impl ActionLog {
+    /// Keep the newest `capacity` records (at least 1); the buffer is
+    /// allocated up front
+    pub fn new(capacity: usize) -> Self {
+        let capacity = capacity.max(1);
+        Self {
+            records: VecDeque::with_capacity(capacity),
+            capacity,
+            dropped: 0,
+            sink: None,
+            sink_error: None,
+        }
+    }
+
+    /// Record `action` at `tick`, evicting the oldest record when full
+    pub fn log(&mut self, tick: u64, action: Action) {
+        let record = ActionRecord { tick, action };
+        if self.records.len() == self.capacity {
+            self.records.pop_front();
+            self.dropped += 1;
+        }
+        self.records.push_back(record);
+        if let Some(sink) = self.sink.as_mut() {
+            if let Err(e) = sink.write_all(&record.encode()) {
+                self.sink = None;
+                self.sink_error = Some(e);
+            }
+        }
+    }
+
+    /// Records in the ring buffer, oldest first
+    pub fn iter(&self) -> impl DoubleEndedIterator<Item = &ActionRecord> + '_ {
+        self.records.iter()
+    }
+
+    /// `i`th oldest record still buffered
+    pub fn get(&self, i: usize) -> Option<&ActionRecord> {
+        self.records.get(i)
+    }
+
+    pub fn len(&self) -> usize {
+        self.records.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.records.is_empty()
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.capacity
+    }
+
+    /// Records evicted from the ring buffer (the sink still saw them)
+    pub fn dropped(&self) -> u64 {
+        self.dropped
+    }
+
+    /// Buffered records as text, oldest first
+    pub fn lines(&self) -> impl Iterator<Item = String> + '_ {
+        self.records.iter().map(ToString::to_string)
+    }
+
+    /// Clear the buffered records (the sink is kept)
+    /// Useful for resetting between simulation runs or tests
+    pub fn clear(&mut self) {
+        self.records.clear();
+        self.dropped = 0;
+    }
+
+    /// Stream every record logged from now on to `writer`, after writing
+    /// the file header; pass a `BufWriter` for files
+    pub fn stream_to(&mut self, mut writer: impl Write + Send + Sync + 'static) -> io::Result<()> {
+        writer.write_all(&MAGIC)?;
+        writer.write_all(&[VERSION])?;
+        self.sink = Some(Box::new(writer));
+        self.sink_error = None;
+        Ok(())
+    }
+
+    /// Flush and detach the sink, reporting the first write error if
+    /// streaming stopped because of one
+    pub fn finish_stream(&mut self) -> io::Result<()> {
+        if let Some(e) = self.sink_error.take() {
+            return Err(e);
+        }
+        match self.sink.take() {
+            Some(mut sink) => sink.flush(),
+            None => Ok(()),
+        }
+    }
+}
+
+/// Decode a file written by an `ActionLog` sink
+pub fn read_action_file(bytes: &[u8]) -> Result<Vec<ActionRecord>, ActionLogError> {
+    let body = bytes.strip_prefix(&MAGIC).ok_or(ActionLogError::BadMagic)?;
+    let (&version, body) = body.split_first().ok_or(ActionLogError::Truncated)?;
+    if version != VERSION {
+        return Err(ActionLogError::UnsupportedVersion(version));
+    }
+    if body.len() % RECORD_BYTES != 0 {
+        return Err(ActionLogError::Truncated);
+    }
+    body.chunks_exact(RECORD_BYTES)
+        .map(|chunk| ActionRecord::decode(chunk.try_into().unwrap()))
+        .collect()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::{Arc, Mutex};
+
+    /// `Write` into a buffer the test can still read afterwards
+    #[derive(Clone, Default)]
+    struct Shared(Arc<Mutex<Vec<u8>>>);
+
+    impl Write for Shared {
+        fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+            self.0.lock().unwrap().extend_from_slice(buf);
+            Ok(buf.len())
+        }
+
+        fn flush(&mut self) -> io::Result<()> {
+            Ok(())
+        }
+    }
+
+    fn mined(i: u32) -> Action {
+        Action::Mined {
+            worker: Entity::from_raw(i),
+            job: JobId(Uuid::from_u128(i as u128)),
+            x: i as i32,
+            y: -(i as i32),
+        }
+    }
+
+    #[test]
+    fn sink_keeps_what_the_ring_buffer_drops() {
+        let out = Shared::default();
+        let mut log = ActionLog::new(2);
+        log.stream_to(out.clone()).unwrap();
+        for i in 0..5 {
+            log.log(i as u64, mined(i));
+        }
+        log.log(
+            5,
+            Action::PickedUp {
+                worker: Entity::from_raw(1),
+                item: Entity::from_raw(9),
+                job: JobId(Uuid::from_u128(7)),
+            },
+        );
+        log.finish_stream().unwrap();
+        assert_eq!(log.len(), 2);
+        assert_eq!(log.dropped(), 4);
+
+        let bytes = out.0.lock().unwrap().clone();
+        let records = read_action_file(&bytes).unwrap();
+        assert_eq!(records.len(), 6);
+        assert_eq!(
+            records[3],
+            ActionRecord {
+                tick: 3,
+                action: mined(3)
+            }
+        );
+        assert_eq!(&records[4..], log.iter().copied().collect::<Vec<_>>());
+        assert_eq!(
+            read_action_file(&bytes[..bytes.len() - 1]),
+            Err(ActionLogError::Truncated)
+        );
+    }
+}
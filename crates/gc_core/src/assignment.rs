@@ -0,0 +1,368 @@
+//! Matching idle workers to waiting jobs
+//!
+//! The default greedy strategy hands jobs out in posting order to workers in
+//! query order. The distance-aware strategies instead pair each worker with a
+//! nearby job: by Manhattan distance through a bucketed grid over job
+//! locations, or by 4-directional walking distance over `GameMap`.
+
+use crate::world::GameMap;
+use bevy_ecs::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, VecDeque};
+
+/// How `job_assignment_system` picks a job for each idle worker
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Serialize, Deserialize)]
+pub enum AssignmentStrategy {
+    /// Oldest job first, to workers in query order; ignores positions
+    #[default]
+    Greedy,
+    /// Closest job by Manhattan distance, via a spatial index of job locations
+    Nearest,
+    /// Closest job by walking distance, via multi-source BFS over the map
+    WalkDistance,
+}
+
+/// Selects the assignment strategy; worlds without this resource use greedy
+#[derive(Resource, Debug, Clone, Copy, Default)]
+pub struct AssignmentConfig {
+    pub strategy: AssignmentStrategy,
+}
+
+/// Pair workers with jobs, returning `(worker index, job index)` pairs
+///
+/// Each worker and each job appears at most once. `Greedy` pairs them in
+/// order; `WalkDistance` falls back to `Nearest` without a map and leaves
+/// out workers that cannot reach any job.
+pub fn pair_workers(
+    strategy: AssignmentStrategy,
+    map: Option<&GameMap>,
+    workers: &[(i32, i32)],
+    jobs: &[(i32, i32)],
+) -> Vec<(usize, usize)> {
+    match (strategy, map) {
+        (AssignmentStrategy::Greedy, _) => {
+            (0..workers.len().min(jobs.len())).map(|i| (i, i)).collect()
+        }
+        (AssignmentStrategy::WalkDistance, Some(map)) => walk_pairs(map, workers, jobs),
+        _ => nearest_pairs(workers, jobs),
+    }
+}
+
+/// Greedy minimum-distance matching by Manhattan distance
+///
+/// Repeatedly commits the closest remaining (worker, job) pair, ties broken
+/// by worker then job index, so the result is deterministic.
+pub fn nearest_pairs(workers: &[(i32, i32)], jobs: &[(i32, i32)]) -> Vec<(usize, usize)> {
+    let mut grid = JobGrid::new(jobs);
+    let mut taken = vec![false; jobs.len()];
+    let mut heap: BinaryHeap<Reverse<(u32, usize, usize)>> = workers
+        .iter()
+        .enumerate()
+        .filter_map(|(w, &p)| grid.nearest(jobs, p).map(|(d, j)| Reverse((d, w, j))))
+        .collect();
+    let mut pairs = Vec::with_capacity(workers.len().min(jobs.len()));
+    while let Some(Reverse((_, w, j))) = heap.pop() {
+        if taken[j] {
+            // Someone closer got this job; look again among what is left
+            if let Some((d, j)) = grid.nearest(jobs, workers[w]) {
+                heap.push(Reverse((d, w, j)));
+            }
+            continue;
+        }
+        taken[j] = true;
+        grid.remove(j, jobs[j]);
+        pairs.push((w, j));
+    }
+    pairs
+}
+
+/// Matching by walking distance, in rounds of one multi-source BFS each
+///
+/// Every round floods the map from all unclaimed jobs, so each waiting worker
+/// learns its nearest job. Candidates are committed closest first; workers
+/// that lost their job to a closer one wait for the next round. Mine targets
+/// are walls, so a job on an unwalkable tile is reached from its neighbours.
+pub fn walk_pairs(
+    map: &GameMap,
+    workers: &[(i32, i32)],
+    jobs: &[(i32, i32)],
+) -> Vec<(usize, usize)> {
+    let mut field = WalkField::default();
+    let mut taken = vec![false; jobs.len()];
+    let mut remaining: Vec<usize> = (0..jobs.len()).collect();
+    let mut waiting: Vec<usize> = (0..workers.len()).collect();
+    let mut candidates = Vec::new();
+    let mut pairs = Vec::new();
+    while !waiting.is_empty() && !remaining.is_empty() {
+        field.flood(map, jobs, &remaining);
+        candidates.clear();
+        candidates.extend(
+            waiting
+                .iter()
+                .filter_map(|&w| field.nearest(map, workers[w]).map(|(d, j)| (d, w, j))),
+        );
+        candidates.sort_unstable();
+        // Workers with no candidate cannot reach any job; drop them
+        waiting.clear();
+        for &(_, w, j) in &candidates {
+            if taken[j] {
+                waiting.push(w);
+            } else {
+                taken[j] = true;
+                pairs.push((w, j));
+            }
+        }
+        waiting.sort_unstable();
+        remaining.retain(|&j| !taken[j]);
+    }
+    pairs
+}
+
+/// Side of a `JobGrid` bucket in tiles
+const CELL: i32 = 8;
+
+/// Bucketed grid over the bounding box of the job locations
+struct JobGrid {
+    x0: i32,
+    y0: i32,
+    cols: i32,
+    rows: i32,
+    cells: Vec<Vec<usize>>,
+    /// Jobs still in the grid
+    live: usize,
+}
+
+impl JobGrid {
+    fn new(jobs: &[(i32, i32)]) -> Self {
+        let (x0, y0) = jobs.iter().fold((i32::MAX, i32::MAX), |(x, y), &(jx, jy)| {
+            (x.min(jx), y.min(jy))
+        });
+        let (x1, y1) = jobs.iter().fold((i32::MIN, i32::MIN), |(x, y), &(jx, jy)| {
+            (x.max(jx), y.max(jy))
+        });
+        let (cols, rows) = if jobs.is_empty() {
+            (0, 0)
+        } else {
+            ((x1 - x0) / CELL + 1, (y1 - y0) / CELL + 1)
+        };
+        let mut grid = Self {
+            x0,
+            y0,
+            cols,
+            rows,
+            cells: vec![Vec::new(); (cols * rows) as usize],
+            live: jobs.len(),
+        };
+        for (j, &p) in jobs.iter().enumerate() {
+            let c = grid.cell(p);
+            grid.cells[c].push(j);
+        }
+        grid
+    }
+
+    /// Bucket coordinates of a tile, clamped to the grid
+    fn cell_xy(&self, (x, y): (i32, i32)) -> (i32, i32) {
+        let cx = (x.saturating_sub(self.x0) / CELL).clamp(0, self.cols - 1);
+        let cy = (y.saturating_sub(self.y0) / CELL).clamp(0, self.rows - 1);
+        (cx, cy)
+    }
+
+    fn cell(&self, p: (i32, i32)) -> usize {
+        let (cx, cy) = self.cell_xy(p);
+        (cy * self.cols + cx) as usize
+    }
+
+    fn remove(&mut self, job: usize, p: (i32, i32)) {
+        let c = self.cell(p);
+        if let Some(k) = self.cells[c].iter().position(|&j| j == job) {
+            self.cells[c].swap_remove(k);
+            self.live -= 1;
+        }
+    }
+
+    /// Closest job to `from` as `(distance, job index)`, lowest index on ties
+    fn nearest(&self, jobs: &[(i32, i32)], from: (i32, i32)) -> Option<(u32, usize)> {
+        if self.live == 0 {
+            return None;
+        }
+        let (cx, cy) = self.cell_xy(from);
+        let max_ring = self.cols.max(self.rows);
+        let mut best: Option<(u32, usize)> = None;
+        for r in 0..=max_ring {
+            for dy in -r..=r {
+                let step = if dy.abs() == r { 1 } else { 2 * r.max(1) };
+                let mut dx = -r;
+                while dx <= r {
+                    let (x, y) = (cx + dx, cy + dy);
+                    if x >= 0 && y >= 0 && x < self.cols && y < self.rows {
+                        for &j in &self.cells[(y * self.cols + x) as usize] {
+                            let (jx, jy) = jobs[j];
+                            let d = from.0.abs_diff(jx) + from.1.abs_diff(jy);
+                            if best.map_or(true, |b| (d, j) < b) {
+                                best = Some((d, j));
+                            }
+                        }
+                    }
+                    dx += step;
+                }
+            }
+            // Buckets beyond ring r are more than r * CELL tiles away
+            if best.is_some_and(|(d, _)| d <= (r * CELL) as u32) {
+                break;
+            }
+        }
+        best
+    }
+}
+
+/// Distance and nearest-source labels from a multi-source BFS
+#[derive(Default)]
+struct WalkField {
+    dist: Vec<u32>,
+    source: Vec<usize>,
+    queue: VecDeque<usize>,
+}
+
+const DIRS: [(i32, i32); 4] = [(1, 0), (-1, 0), (0, 1), (0, -1)];
+
+impl WalkField {
+    /// Flood from the given jobs; walls are seeded but never expanded
+    fn flood(&mut self, map: &GameMap, jobs: &[(i32, i32)], sources: &[usize]) {
+        self.dist.clear();
+        self.dist.resize(map.tiles().len(), u32::MAX);
+        self.source.resize(map.tiles().len(), 0);
+        self.queue.clear();
+        // Seed distance-0 tiles before any distance-1 neighbour of a wall
+        // target so the FIFO stays ordered by distance
+        for &j in sources {
+            let (x, y) = jobs[j];
+            if let Some(i) = map.idx(x, y) {
+                if self.dist[i] == u32::MAX {
+                    self.dist[i] = 0;
+                    self.source[i] = j;
+                    if map.is_walkable(x, y) {
+                        self.queue.push_back(i);
+                    }
+                }
+            }
+        }
+        for &j in sources {
+            let (x, y) = jobs[j];
+            if map.idx(x, y).is_some() && !map.is_walkable(x, y) {
+                self.visit_neighbours(map, x, y, 1, j);
+            }
+        }
+        while let Some(i) = self.queue.pop_front() {
+            let (x, y) = map.pos_of(i);
+            self.visit_neighbours(map, x, y, self.dist[i] + 1, self.source[i]);
+        }
+    }
+
+    fn visit_neighbours(&mut self, map: &GameMap, x: i32, y: i32, dist: u32, source: usize) {
+        for (dx, dy) in DIRS {
+            let (nx, ny) = (x + dx, y + dy);
+            if !map.is_walkable(nx, ny) {
+                continue;
+            }
+            let Some(n) = map.idx(nx, ny) else { continue };
+            if self.dist[n] == u32::MAX {
+                self.dist[n] = dist;
+                self.source[n] = source;
+                self.queue.push_back(n);
+            }
+        }
+    }
+
+    /// Nearest job to a worker as `(distance, job index)`
+    ///
+    /// A worker off the walkable area (e.g. standing in a wall) steps out
+    /// through its walkable neighbours, matching what A* allows.
+    fn nearest(&self, map: &GameMap, (x, y): (i32, i32)) -> Option<(u32, usize)> {
+        if let Some(i) = map.idx(x, y) {
+            if self.dist[i] != u32::MAX {
+                return Some((self.dist[i], self.source[i]));
+            }
+        }
+        DIRS.iter()
+            .filter(|&&(dx, dy)| map.is_walkable(x + dx, y + dy))
+            .filter_map(|&(dx, dy)| map.idx(x + dx, y + dy))
+            .filter(|&n| self.dist[n] != u32::MAX)
+            .map(|n| (self.dist[n] + 1, self.source[n]))
+            .min()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::world::TileKind;
+
+    fn total(workers: &[(i32, i32)], jobs: &[(i32, i32)], pairs: &[(usize, usize)]) -> u32 {
+        pairs
+            .iter()
+            .map(|&(w, j)| workers[w].0.abs_diff(jobs[j].0) + workers[w].1.abs_diff(jobs[j].1))
+            .sum()
+    }
+
+    #[test]
+    fn nearest_pairs_prefers_close_jobs() {
+        let workers = [(0, 0), (50, 50), (100, 0)];
+        let jobs = [(99, 1), (1, 1), (52, 49), (200, 200)];
+        let mut pairs = nearest_pairs(&workers, &jobs);
+        pairs.sort_unstable();
+        assert_eq!(pairs, [(0, 1), (1, 2), (2, 0)]);
+
+        let greedy = pair_workers(AssignmentStrategy::Greedy, None, &workers, &jobs);
+        assert!(total(&workers, &jobs, &pairs) < total(&workers, &jobs, &greedy));
+    }
+
+    #[test]
+    fn nearest_pairs_matches_brute_force_greedy() {
+        // Deterministic pseudo-random scatter, including off-grid workers
+        let mut s = 12345u32;
+        let mut next = |m: u32| {
+            s = s.wrapping_mul(1_103_515_245).wrapping_add(12345);
+            ((s >> 16) % m) as i32
+        };
+        let jobs: Vec<_> = (0..300).map(|_| (next(100), next(60))).collect();
+        let workers: Vec<_> = (0..80).map(|_| (next(140) - 20, next(100) - 20)).collect();
+
+        let mut expected = Vec::new();
+        let (mut free_w, mut free_j) = (vec![true; workers.len()], vec![true; jobs.len()]);
+        loop {
+            let best = (0..workers.len())
+                .filter(|&w| free_w[w])
+                .flat_map(|w| (0..jobs.len()).filter(|&j| free_j[j]).map(move |j| (w, j)))
+                .map(|(w, j)| (total(&workers, &jobs, &[(w, j)]), w, j))
+                .min();
+            let Some((_, w, j)) = best else { break };
+            free_w[w] = false;
+            free_j[j] = false;
+            expected.push((w, j));
+        }
+        assert_eq!(nearest_pairs(&workers, &jobs), expected);
+    }
+
+    #[test]
+    fn walk_pairs_follow_corridors_and_skip_unreachable() {
+        // A wall splits the map; the gap is at the bottom
+        let mut map = GameMap::new(10, 10);
+        for y in 0..9 {
+            map.set_tile(5, y, TileKind::Wall);
+        }
+        // Sealed-off pocket around (9, 0)
+        map.set_tile(8, 0, TileKind::Wall);
+        map.set_tile(9, 1, TileKind::Wall);
+
+        let workers = [(4, 0), (9, 0)];
+        // Job 0 is straight-line closer to worker 0 but lies behind the wall
+        let jobs = [(6, 0), (0, 5)];
+        let pairs = walk_pairs(&map, &workers, &jobs);
+        assert_eq!(pairs, [(0, 1)]);
+
+        // A wall target (mine job) is reached from an adjacent floor tile
+        let pairs = walk_pairs(&map, &[(4, 2)], &[(5, 2)]);
+        assert_eq!(pairs, [(0, 0)]);
+    }
+}
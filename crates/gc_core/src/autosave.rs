@@ -0,0 +1,510 @@
+//! Incremental autosave: a base snapshot followed by append-only deltas
+//!
+//! `AutosaveTracker::capture` remembers what the last record saved and
+//! emits only the map chunks changed since then (from the `GameMap` chunk
+//! versions) plus entity add/modify/remove records. Entities are found
+//! through change detection: `Changed` filters on the saved components
+//! pick up new and modified entities, and `RemovedComponents` picks up
+//! despawns and removals, so only those entities are read and copied.
+//! Every `compact_every` deltas it marks the delta as a compaction point;
+//! `AutosaveWriter` keeps its own replay of the log on its background
+//! thread, builds the new base there and rewrites the file with it, so
+//! compacting costs the sim thread no more than any other delta. Only the
+//! first capture and a replaced map (another `GameMap::epoch`) copy every
+//! tile and entity into a base on the calling thread.
+//! `read_autosave` replays a log back into a `SaveGame`.
+//!
+//! Entities with none of the saved components are not autosaved.
+//!
+//! `run_tick` keeps removal events for two ticks only. A world captured
+//! less often than that needs an `AutosaveRemovals` resource, which the
+//! default schedule fills every tick for the next capture to drain.
+//!
+//! Log file format: a sequence of frames, each a little-endian `u32` byte
+//! length followed by one CBOR-encoded `AutosaveRecord`. A base record
+//! rewrites the file (via a temporary file and rename), which compacts it.
+
+use crate::components::{Carriable, Item, ItemStack};
+use crate::save::{
+    entity_data, sort_entities_deterministically, EntityData, SaveGame, SavedComponents,
+};
+use crate::systems;
+use crate::world::{GameMap, Name, Position, TileKind, Velocity, CHUNK_SIZE};
+use bevy_ecs::prelude::*;
+use bevy_ecs::query::QueryItem;
+use bevy_ecs::system::SystemState;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::fmt;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, Write};
+use std::path::{Path, PathBuf};
+use std::sync::mpsc;
+use std::thread;
+
+/// Deltas written between two base snapshots by default
+pub const DEFAULT_COMPACT_EVERY: usize = 16;
+
+/// Errors from writing or replaying an autosave log
+#[derive(Debug, thiserror::Error)]
+pub enum AutosaveError {
+    #[error("autosave I/O failed: {0}")]
+    Io(#[from] io::Error),
+    #[error("autosave record could not be encoded: {0}")]
+    Encode(String),
+    #[error("autosave record could not be decoded: {0}")]
+    Decode(String),
+    #[error("autosave log does not start with a base snapshot")]
+    MissingBase,
+    #[error("autosave writer thread has stopped")]
+    WriterStopped,
+}
+
+/// Tiles of one chunk clipped to the map, row-major within the chunk
+#[derive(Serialize, Deserialize, Debug, Clone, PartialEq, Eq)]
+pub struct ChunkTiles {
+    pub cx: i32,
+    pub cy: i32,
+    pub tiles: Vec<TileKind>,
+}
+
+/// Complete state that later deltas build on
+/// Entities are keyed by the `Entity` bits they had when captured
+#[derive(Serialize, Deserialize, Debug, Clone, PartialEq, Eq)]
+pub struct BaseSnapshot {
+    pub width: u32,
+    pub height: u32,
+    /// Row-major, like `SaveGame::tiles`
+    pub tiles: Vec<TileKind>,
+    pub entities: Vec<(u64, EntityData)>,
+    pub tick_ms: u64,
+    pub ticks: u64,
+    pub master_seed: u64,
+}
+
+/// Changes since the previous record
+#[derive(Serialize, Deserialize, Debug, Clone, PartialEq, Eq)]
+pub struct SaveDelta {
+    pub chunks: Vec<ChunkTiles>,
+    /// Entities that are new or whose saved components changed
+    pub upserted: Vec<(u64, EntityData)>,
+    pub removed: Vec<u64>,
+    pub tick_ms: u64,
+    pub ticks: u64,
+    pub master_seed: u64,
+    /// Compaction point: `AutosaveWriter` writes a base of the state after
+    /// this delta in its place
+    #[serde(default)]
+    pub compact: bool,
+}
+
+impl SaveDelta {
+    /// True if nothing but the clock moved
+    pub fn is_empty(&self) -> bool {
+        self.chunks.is_empty() && self.upserted.is_empty() && self.removed.is_empty()
+    }
+}
+
+/// One entry of an autosave log
+#[derive(Serialize, Deserialize, Debug, Clone, PartialEq, Eq)]
+pub enum AutosaveRecord {
+    Base(BaseSnapshot),
+    Delta(SaveDelta),
+}
+
+/// Entities whose saved components were added or written
+type SavedChanged = Or<(
+    Changed<Name>,
+    Changed<Position>,
+    Changed<Velocity>,
+    Changed<Item>,
+    Changed<Carriable>,
+    Changed<ItemStack>,
+)>;
+
+/// Removals of the saved components
+type SavedRemovals<'w, 's> = (
+    RemovedComponents<'w, 's, Name>,
+    RemovedComponents<'w, 's, Position>,
+    RemovedComponents<'w, 's, Velocity>,
+    RemovedComponents<'w, 's, Item>,
+    RemovedComponents<'w, 's, Carriable>,
+    RemovedComponents<'w, 's, ItemStack>,
+);
+
+fn read_removals(removed: &mut SavedRemovals<'_, '_>) -> Vec<Entity> {
+    removed
+        .0
+        .read()
+        .chain(removed.1.read())
+        .chain(removed.2.read())
+        .chain(removed.3.read())
+        .chain(removed.4.read())
+        .chain(removed.5.read())
+        .collect()
+}
+
+/// What `capture` reads; kept in a `SystemState` so change detection and
+/// removal cursors carry over from one capture to the next
+type CaptureParams = (
+    Res<'static, GameMap>,
+    Option<Res<'static, systems::Time>>,
+    Option<Res<'static, systems::DeterministicRng>>,
+    Query<'static, 'static, (Entity, SavedComponents)>,
+    Query<'static, 'static, Entity, SavedChanged>,
+    SavedRemovals<'static, 'static>,
+    Option<ResMut<'static, AutosaveRemovals>>,
+);
+
+/// Entities that lost a saved component since the last capture
+/// Only needed when captures are more than a tick apart; grows until the
+/// next capture drains it
+#[derive(Resource, Debug, Default)]
+pub struct AutosaveRemovals(pub Vec<Entity>);
+
+/// Queue this tick's removals of saved components for the next capture
+pub fn autosave_removals_system(mut pending: ResMut<AutosaveRemovals>, mut removed: SavedRemovals) {
+    let mut entities = read_removals(&mut removed);
+    pending.0.append(&mut entities);
+}
+
+/// Whether an entity has any component that is saved
+fn is_saved(saved: &QueryItem<'_, SavedComponents>) -> bool {
+    let (name, pos, vel, item, carriable, stack) = saved;
+    name.is_some()
+        || pos.is_some()
+        || vel.is_some()
+        || item.is_some()
+        || carriable.is_some()
+        || stack.is_some()
+}
+
+/// Remembers the last saved state of a world so the next capture can be
+/// a delta
+pub struct AutosaveTracker {
+    /// Every this many deltas, one is marked as a compaction point
+    pub compact_every: usize,
+    /// Map epoch and version covered by the last record; None before the
+    /// first base
+    map: Option<(u64, u64)>,
+    entities: HashMap<u64, EntityData>,
+    deltas: usize,
+    /// Created on the first capture, for the world it is used with
+    state: Option<SystemState<CaptureParams>>,
+}
+
+impl fmt::Debug for AutosaveTracker {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("AutosaveTracker")
+            .field("compact_every", &self.compact_every)
+            .field("map", &self.map)
+            .field("entities", &self.entities.len())
+            .field("deltas", &self.deltas)
+            .finish()
+    }
+}
+
+impl Default for AutosaveTracker {
+    fn default() -> Self {
+        Self::new(DEFAULT_COMPACT_EVERY)
+    }
+}
+
+impl AutosaveTracker {
+    pub fn new(compact_every: usize) -> Self {
+        Self {
+            compact_every,
+            map: None,
+            entities: HashMap::new(),
+            deltas: 0,
+            state: None,
+        }
+    }
+
+    /// Deltas captured since the last base snapshot
+    pub fn deltas_since_base(&self) -> usize {
+        self.deltas
+    }
+
+    /// Make the next capture a base snapshot
+    pub fn force_base(&mut self) {
+        self.map = None;
+    }
+
+    /// Record the world's current state as a base or a delta against the
+    /// previous capture
+    ///
+    /// The world must contain a `GameMap`, and every capture of one tracker
+    /// must be of the same world.
+    pub fn capture(&mut self, world: &mut World) -> AutosaveRecord {
+        let state = self.state.get_or_insert_with(|| SystemState::new(world));
+        let (map, time, rng, all, changed, mut removed, pending) = state.get_mut(world);
+        let (tick_ms, ticks) = time.map_or((100, 0), |t| (t.tick_ms, t.ticks));
+        let master_seed = rng.map_or(0, |rng| rng.master_seed);
+        // Always drained, so a base does not leave stale removals behind
+        let mut touched = read_removals(&mut removed);
+        if let Some(mut pending) = pending {
+            touched.append(&mut pending.0);
+        }
+
+        // Another epoch means the map was replaced
+        let since = match self.map {
+            Some((epoch, version)) if epoch == map.epoch() => Some(version),
+            _ => None,
+        };
+        self.map = Some((map.epoch(), map.version()));
+
+        let Some(since) = since else {
+            self.deltas = 0;
+            let entities: Vec<(u64, EntityData)> = all
+                .iter()
+                .filter(|(_, saved)| is_saved(saved))
+                .map(|(e, saved)| (e.to_bits(), entity_data(saved)))
+                .collect();
+            self.entities = entities.iter().cloned().collect();
+            return AutosaveRecord::Base(BaseSnapshot {
+                width: map.width,
+                height: map.height,
+                tiles: map.row_major_tiles(),
+                entities,
+                tick_ms,
+                ticks,
+                master_seed,
+            });
+        };
+
+        let compact = self.deltas >= self.compact_every;
+        self.deltas = if compact { 0 } else { self.deltas + 1 };
+        let chunks = map
+            .changed_chunks_since(since)
+            .map(|(cx, cy)| chunk_tiles(&map, cx, cy))
+            .collect();
+        touched.extend(changed.iter());
+        touched.sort_unstable();
+        touched.dedup();
+        let mut upserted = Vec::new();
+        let mut gone = Vec::new();
+        for entity in touched {
+            let id = entity.to_bits();
+            match all.get(entity).ok().filter(|(_, saved)| is_saved(saved)) {
+                Some((_, saved)) => {
+                    // A component can be written without its value changing
+                    let data = entity_data(saved);
+                    if self.entities.get(&id) != Some(&data) {
+                        self.entities.insert(id, data.clone());
+                        upserted.push((id, data));
+                    }
+                }
+                None => {
+                    if self.entities.remove(&id).is_some() {
+                        gone.push(id);
+                    }
+                }
+            }
+        }
+        AutosaveRecord::Delta(SaveDelta {
+            chunks,
+            upserted,
+            removed: gone,
+            tick_ms,
+            ticks,
+            master_seed,
+            compact,
+        })
+    }
+}
+
+fn chunk_tiles(map: &GameMap, cx: i32, cy: i32) -> ChunkTiles {
+    let (x0, y0) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+    let x1 = (x0 + CHUNK_SIZE).min(map.width as i32);
+    let y1 = (y0 + CHUNK_SIZE).min(map.height as i32);
+    let tiles = (y0..y1)
+        .flat_map(|y| (x0..x1).map(move |x| (x, y)))
+        .map(|(x, y)| map.get_tile(x, y).expect("chunk tile in bounds"))
+        .collect();
+    ChunkTiles { cx, cy, tiles }
+}
+
+/// World state rebuilt by applying autosave records in order
+#[derive(Debug, Clone, Default)]
+pub struct AutosaveReplay {
+    base: Option<BaseSnapshot>,
+    entities: HashMap<u64, EntityData>,
+}
+
+impl AutosaveReplay {
+    /// Apply the next record; a base replaces everything seen so far
+    pub fn apply(&mut self, record: AutosaveRecord) -> Result<(), AutosaveError> {
+        match record {
+            AutosaveRecord::Base(mut base) => {
+                self.entities = std::mem::take(&mut base.entities).into_iter().collect();
+                self.base = Some(base);
+            }
+            AutosaveRecord::Delta(delta) => {
+                let base = self.base.as_mut().ok_or(AutosaveError::MissingBase)?;
+                let width = base.width as i32;
+                for chunk in delta.chunks {
+                    let (x0, y0) = (chunk.cx * CHUNK_SIZE, chunk.cy * CHUNK_SIZE);
+                    let run = CHUNK_SIZE.min(width - x0);
+                    if x0 < 0 || run <= 0 {
+                        return Err(AutosaveError::Decode("chunk outside the map".into()));
+                    }
+                    for (row, src) in chunk.tiles.chunks(run as usize).enumerate() {
+                        let start = ((y0 + row as i32) * width + x0) as usize;
+                        let dst = base
+                            .tiles
+                            .get_mut(start..start + src.len())
+                            .ok_or_else(|| AutosaveError::Decode("chunk outside the map".into()))?;
+                        dst.copy_from_slice(src);
+                    }
+                }
+                for id in delta.removed {
+                    self.entities.remove(&id);
+                }
+                self.entities.extend(delta.upserted);
+                base.tick_ms = delta.tick_ms;
+                base.ticks = delta.ticks;
+                base.master_seed = delta.master_seed;
+            }
+        }
+        Ok(())
+    }
+
+    /// Base snapshot of the replayed state, entities in id order
+    pub fn to_base(&self) -> Result<BaseSnapshot, AutosaveError> {
+        let base = self.base.as_ref().ok_or(AutosaveError::MissingBase)?;
+        let mut entities: Vec<(u64, EntityData)> = self
+            .entities
+            .iter()
+            .map(|(id, data)| (*id, data.clone()))
+            .collect();
+        entities.sort_unstable_by_key(|(id, _)| *id);
+        Ok(BaseSnapshot {
+            entities,
+            ..base.clone()
+        })
+    }
+
+    /// Snapshot of the replayed state, entities in save order
+    pub fn to_save_game(&self) -> Result<SaveGame, AutosaveError> {
+        let base = self.base.as_ref().ok_or(AutosaveError::MissingBase)?;
+        let mut entities: Vec<EntityData> = self.entities.values().cloned().collect();
+        sort_entities_deterministically(&mut entities);
+        Ok(SaveGame {
+            width: base.width,
+            height: base.height,
+            tiles: base.tiles.clone(),
+            entities,
+            tick_ms: base.tick_ms,
+            ticks: base.ticks,
+            master_seed: base.master_seed,
+        })
+    }
+}
+
+/// Append `record` to the log at `path`; a base record replaces the file
+pub fn write_record(path: &Path, record: &AutosaveRecord) -> Result<(), AutosaveError> {
+    let mut frame = vec![0; 4];
+    ciborium::ser::into_writer(record, &mut frame)
+        .map_err(|e| AutosaveError::Encode(e.to_string()))?;
+    let len = (frame.len() - 4) as u32;
+    frame[..4].copy_from_slice(&len.to_le_bytes());
+    match record {
+        AutosaveRecord::Base(_) => {
+            let tmp = path.with_extension("tmp");
+            let mut file = File::create(&tmp)?;
+            file.write_all(&frame)?;
+            file.sync_all()?;
+            fs::rename(&tmp, path)?;
+        }
+        AutosaveRecord::Delta(_) => {
+            let mut file = OpenOptions::new().append(true).open(path)?;
+            file.write_all(&frame)?;
+        }
+    }
+    Ok(())
+}
+
+/// Replay the log at `path` into a `SaveGame`
+/// A final frame cut short (e.g. by a crash mid-write) is ignored
+pub fn read_autosave(path: &Path) -> Result<SaveGame, AutosaveError> {
+    let bytes = fs::read(path)?;
+    let mut replay = AutosaveReplay::default();
+    let mut at = 0;
+    while let Some(len) = bytes.get(at..at + 4) {
+        let len = u32::from_le_bytes(len.try_into().expect("4 bytes")) as usize;
+        let Some(body) = bytes.get(at + 4..at + 4 + len) else {
+            break;
+        };
+        let record: AutosaveRecord =
+            ciborium::de::from_reader(body).map_err(|e| AutosaveError::Decode(e.to_string()))?;
+        replay.apply(record)?;
+        at += 4 + len;
+    }
+    replay.to_save_game()
+}
+
+/// Writes autosave records to one log file on a background thread
+/// The thread replays what it writes, so a compacting delta is written as
+/// the base it produces. Dropping the writer waits for queued records to
+/// be written
+pub struct AutosaveWriter {
+    tx: Option<mpsc::Sender<AutosaveRecord>>,
+    handle: Option<thread::JoinHandle<Result<(), AutosaveError>>>,
+}
+
+impl AutosaveWriter {
+    /// Start the writer thread for the log at `path`
+    /// The first record submitted should be a base snapshot
+    pub fn spawn(path: impl Into<PathBuf>) -> Self {
+        let path = path.into();
+        let (tx, rx) = mpsc::channel::<AutosaveRecord>();
+        let handle = thread::spawn(move || {
+            let mut replay = AutosaveReplay::default();
+            for record in rx {
+                match record {
+                    AutosaveRecord::Delta(delta) if delta.compact => {
+                        replay.apply(AutosaveRecord::Delta(delta))?;
+                        write_record(&path, &AutosaveRecord::Base(replay.to_base()?))?;
+                    }
+                    record => {
+                        write_record(&path, &record)?;
+                        replay.apply(record)?;
+                    }
+                }
+            }
+            Ok(())
+        });
+        Self {
+            tx: Some(tx),
+            handle: Some(handle),
+        }
+    }
+
+    /// Queue a record without waiting for it to be written
+    /// Fails once the writer thread has stopped, e.g. after an I/O error
+    /// that `finish` will report
+    pub fn submit(&self, record: AutosaveRecord) -> Result<(), AutosaveError> {
+        let tx = self.tx.as_ref().ok_or(AutosaveError::WriterStopped)?;
+        tx.send(record).map_err(|_| AutosaveError::WriterStopped)
+    }
+
+    /// Write all queued records and stop the thread
+    pub fn finish(mut self) -> Result<(), AutosaveError> {
+        self.join()
+    }
+
+    fn join(&mut self) -> Result<(), AutosaveError> {
+        self.tx.take();
+        match self.handle.take() {
+            Some(handle) => handle.join().map_err(|_| AutosaveError::WriterStopped)?,
+            None => Ok(()),
+        }
+    }
+}
+
+impl Drop for AutosaveWriter {
+    fn drop(&mut self) {
+        let _ = self.join();
+    }
+}
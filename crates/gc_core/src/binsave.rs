@@ -0,0 +1,396 @@
+//! Versioned binary save layout with run-length-encoded tiles
+//!
+//! All integers are little-endian and every section is 4-byte aligned, so
+//! a file can be memory-mapped and read in place:
+//!
+//! | Offset | Size          | Contents                                         |
+//! |--------|---------------|--------------------------------------------------|
+//! | 0      | 64            | Header (magic, version, map size, time, counts)  |
+//! | 64     | 4 per run     | Tile runs: kind `u8`, run length `u24`, row-major |
+//! | ...    | 28 per entity | Entity records, fixed size                       |
+//! | ...    | variable      | UTF-8 names referenced by the entity records     |
+//!
+//! `BinarySave::parse` checks magic, version, checksum and every section
+//! without building a `SaveGame`; `to_save_game` converts when needed.
+
+use crate::components::ItemType;
+use crate::save::{EntityData, SaveGame};
+use crate::world::TileKind;
+
+/// File signature at offset 0
+pub const MAGIC: [u8; 8] = *b"GCBSAVE\0";
+/// Layout version written by `encode`; `parse` rejects any other
+pub const VERSION: u16 = 1;
+
+const HEADER_LEN: usize = 64;
+const RUN_LEN: usize = 4;
+const ENTITY_LEN: usize = 28;
+/// Longest run one record can hold (24-bit length)
+const MAX_RUN: u32 = (1 << 24) - 1;
+
+// Entity record flags
+const HAS_NAME: u8 = 1;
+const HAS_POS: u8 = 2;
+const HAS_VEL: u8 = 4;
+const HAS_ITEM: u8 = 8;
+const CARRIABLE: u8 = 16;
+/// Bytes 2..4 hold an `ItemStack` count
+const HAS_STACK: u8 = 32;
+
+/// Reasons a byte buffer is not a valid binary save
+#[derive(Debug, Clone, PartialEq, Eq, thiserror::Error)]
+pub enum BinarySaveError {
+    #[error("not a binary save (bad magic)")]
+    BadMagic,
+    #[error("unsupported binary save version {0}")]
+    UnsupportedVersion(u16),
+    #[error("binary save truncated or section sizes inconsistent")]
+    Truncated,
+    #[error("binary save checksum mismatch")]
+    Checksum,
+    #[error("corrupt binary save: {0}")]
+    Corrupt(&'static str),
+}
+
+/// Fixed header fields
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct Header {
+    width: u32,
+    height: u32,
+    tick_ms: u64,
+    ticks: u64,
+    master_seed: u64,
+    runs: u32,
+    entities: u32,
+    names_len: u32,
+}
+
+// Header field offsets (after magic: version u16 and reserved u16 at 8..12)
+const OFF_WIDTH: usize = 12;
+const OFF_HEIGHT: usize = 16;
+const OFF_TICK_MS: usize = 20;
+const OFF_TICKS: usize = 28;
+const OFF_SEED: usize = 36;
+const OFF_RUNS: usize = 44;
+const OFF_ENTITIES: usize = 48;
+const OFF_NAMES: usize = 52;
+// 56..60 reserved
+const OFF_CHECKSUM: usize = 60;
+
+pub(crate) fn tile_code(kind: TileKind) -> u8 {
+    kind as u8
+}
+
+pub(crate) fn tile_from_code(code: u8) -> Option<TileKind> {
+    Some(match code {
+        0 => TileKind::Floor,
+        1 => TileKind::Wall,
+        2 => TileKind::Water,
+        3 => TileKind::Lava,
+        _ => return None,
+    })
+}
+
+pub(crate) fn item_code(item: ItemType) -> u8 {
+    match item {
+        ItemType::Stone => 0,
+    }
+}
+
+pub(crate) fn item_from_code(code: u8) -> Option<ItemType> {
+    match code {
+        0 => Some(ItemType::Stone),
+        _ => None,
+    }
+}
+
+/// FNV-1a over the file with the checksum field skipped
+fn checksum(bytes: &[u8]) -> u32 {
+    let mut hash: u32 = 0x811c_9dc5;
+    let data = bytes[..OFF_CHECKSUM]
+        .iter()
+        .chain(&bytes[OFF_CHECKSUM + 4..]);
+    for &b in data {
+        hash ^= b as u32;
+        hash = hash.wrapping_mul(0x0100_0193);
+    }
+    hash
+}
+
+fn read_u32(bytes: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(bytes[at..at + 4].try_into().expect("4 bytes"))
+}
+
+fn read_u64(bytes: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(bytes[at..at + 8].try_into().expect("8 bytes"))
+}
+
+fn read_i32(bytes: &[u8], at: usize) -> i32 {
+    read_u32(bytes, at) as i32
+}
+
+/// Encode a `SaveGame` into the binary layout
+pub fn encode(save: &SaveGame) -> Vec<u8> {
+    let mut runs: Vec<(TileKind, u32)> = Vec::new();
+    for &kind in &save.tiles {
+        match runs.last_mut() {
+            Some((k, n)) if *k == kind && *n < MAX_RUN => *n += 1,
+            _ => runs.push((kind, 1)),
+        }
+    }
+    let names: usize = save
+        .entities
+        .iter()
+        .filter_map(|e| e.name.as_ref())
+        .map(String::len)
+        .sum();
+
+    let mut out = Vec::with_capacity(
+        HEADER_LEN + runs.len() * RUN_LEN + save.entities.len() * ENTITY_LEN + names,
+    );
+    out.extend_from_slice(&MAGIC);
+    out.extend_from_slice(&VERSION.to_le_bytes());
+    out.extend_from_slice(&0u16.to_le_bytes());
+    out.extend_from_slice(&save.width.to_le_bytes());
+    out.extend_from_slice(&save.height.to_le_bytes());
+    out.extend_from_slice(&save.tick_ms.to_le_bytes());
+    out.extend_from_slice(&save.ticks.to_le_bytes());
+    out.extend_from_slice(&save.master_seed.to_le_bytes());
+    out.extend_from_slice(&(runs.len() as u32).to_le_bytes());
+    out.extend_from_slice(&(save.entities.len() as u32).to_le_bytes());
+    out.extend_from_slice(&(names as u32).to_le_bytes());
+    out.extend_from_slice(&[0; 8]); // reserved, then checksum
+    debug_assert_eq!(out.len(), HEADER_LEN);
+
+    for &(kind, n) in &runs {
+        out.push(tile_code(kind));
+        out.extend_from_slice(&n.to_le_bytes()[..3]);
+    }
+
+    let mut name_offset = 0u32;
+    for e in &save.entities {
+        let mut flags = 0;
+        let name_len = e.name.as_ref().map_or(0, |n| n.len() as u32);
+        flags |= if e.name.is_some() { HAS_NAME } else { 0 };
+        flags |= if e.pos.is_some() { HAS_POS } else { 0 };
+        flags |= if e.vel.is_some() { HAS_VEL } else { 0 };
+        flags |= if e.item_type.is_some() { HAS_ITEM } else { 0 };
+        flags |= if e.carriable { CARRIABLE } else { 0 };
+        flags |= if e.stack.is_some() { HAS_STACK } else { 0 };
+        let (px, py) = e.pos.unwrap_or_default();
+        let (vx, vy) = e.vel.unwrap_or_default();
+        out.push(flags);
+        out.push(e.item_type.map_or(0, item_code));
+        out.extend_from_slice(&e.stack.unwrap_or(0).to_le_bytes());
+        for v in [px, py, vx, vy] {
+            out.extend_from_slice(&v.to_le_bytes());
+        }
+        out.extend_from_slice(&name_offset.to_le_bytes());
+        out.extend_from_slice(&name_len.to_le_bytes());
+        name_offset += name_len;
+    }
+    for name in save.entities.iter().filter_map(|e| e.name.as_ref()) {
+        out.extend_from_slice(name.as_bytes());
+    }
+
+    let sum = checksum(&out);
+    out[OFF_CHECKSUM..OFF_CHECKSUM + 4].copy_from_slice(&sum.to_le_bytes());
+    out
+}
+
+/// Decode the binary layout back into a `SaveGame`
+pub fn decode(bytes: &[u8]) -> Result<SaveGame, BinarySaveError> {
+    Ok(BinarySave::parse(bytes)?.to_save_game())
+}
+
+/// Validated, borrowed view of a binary save
+#[derive(Debug, Clone, Copy)]
+pub struct BinarySave<'a> {
+    header: Header,
+    runs: &'a [u8],
+    entities: &'a [u8],
+    names: &'a [u8],
+}
+
+/// One entity record read in place
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct EntityRecord<'a> {
+    pub name: Option<&'a str>,
+    pub pos: Option<(i32, i32)>,
+    pub vel: Option<(i32, i32)>,
+    pub item_type: Option<ItemType>,
+    pub carriable: bool,
+    pub stack: Option<u16>,
+}
+
+impl<'a> BinarySave<'a> {
+    /// Check `bytes` and borrow its sections; nothing is copied
+    pub fn parse(bytes: &'a [u8]) -> Result<Self, BinarySaveError> {
+        if bytes.len() < MAGIC.len() || bytes[..MAGIC.len()] != MAGIC {
+            return Err(BinarySaveError::BadMagic);
+        }
+        if bytes.len() < HEADER_LEN {
+            return Err(BinarySaveError::Truncated);
+        }
+        let version = u16::from_le_bytes([bytes[8], bytes[9]]);
+        if version != VERSION {
+            return Err(BinarySaveError::UnsupportedVersion(version));
+        }
+        let header = Header {
+            width: read_u32(bytes, OFF_WIDTH),
+            height: read_u32(bytes, OFF_HEIGHT),
+            tick_ms: read_u64(bytes, OFF_TICK_MS),
+            ticks: read_u64(bytes, OFF_TICKS),
+            master_seed: read_u64(bytes, OFF_SEED),
+            runs: read_u32(bytes, OFF_RUNS),
+            entities: read_u32(bytes, OFF_ENTITIES),
+            names_len: read_u32(bytes, OFF_NAMES),
+        };
+
+        let runs_end = (header.runs as usize)
+            .checked_mul(RUN_LEN)
+            .and_then(|n| n.checked_add(HEADER_LEN));
+        let entities_end = (header.entities as usize)
+            .checked_mul(ENTITY_LEN)
+            .zip(runs_end)
+            .and_then(|(n, start)| n.checked_add(start));
+        let end = entities_end.and_then(|start| start.checked_add(header.names_len as usize));
+        let (Some(runs_end), Some(entities_end), Some(end)) = (runs_end, entities_end, end) else {
+            return Err(BinarySaveError::Truncated);
+        };
+        if end != bytes.len() {
+            return Err(BinarySaveError::Truncated);
+        }
+        if read_u32(bytes, OFF_CHECKSUM) != checksum(bytes) {
+            return Err(BinarySaveError::Checksum);
+        }
+
+        let save = Self {
+            header,
+            runs: &bytes[HEADER_LEN..runs_end],
+            entities: &bytes[runs_end..entities_end],
+            names: &bytes[entities_end..end],
+        };
+        save.validate()?;
+        Ok(save)
+    }
+
+    /// Section contents beyond what the checksum covers
+    fn validate(&self) -> Result<(), BinarySaveError> {
+        let mut total: u64 = 0;
+        for (kind, n) in self.raw_runs() {
+            if tile_from_code(kind).is_none() {
+                return Err(BinarySaveError::Corrupt("unknown tile kind"));
+            }
+            if n == 0 {
+                return Err(BinarySaveError::Corrupt("empty tile run"));
+            }
+            total += n as u64;
+        }
+        if total != self.header.width as u64 * self.header.height as u64 {
+            return Err(BinarySaveError::Corrupt("tile runs do not cover the map"));
+        }
+        for rec in self.entities.chunks_exact(ENTITY_LEN) {
+            let (flags, item) = (rec[0], rec[1]);
+            if flags & HAS_ITEM != 0 && item_from_code(item).is_none() {
+                return Err(BinarySaveError::Corrupt("unknown item type"));
+            }
+            if flags & HAS_NAME != 0 {
+                let (at, len) = (read_u32(rec, 20) as usize, read_u32(rec, 24) as usize);
+                let name = at
+                    .checked_add(len)
+                    .and_then(|end| self.names.get(at..end))
+                    .ok_or(BinarySaveError::Corrupt("name out of range"))?;
+                std::str::from_utf8(name)
+                    .map_err(|_| BinarySaveError::Corrupt("name not UTF-8"))?;
+            }
+        }
+        Ok(())
+    }
+
+    fn raw_runs(&self) -> impl Iterator<Item = (u8, u32)> + 'a {
+        self.runs
+            .chunks_exact(RUN_LEN)
+            .map(|r| (r[0], u32::from_le_bytes([r[1], r[2], r[3], 0])))
+    }
+
+    pub fn width(&self) -> u32 {
+        self.header.width
+    }
+
+    pub fn height(&self) -> u32 {
+        self.header.height
+    }
+
+    pub fn tick_ms(&self) -> u64 {
+        self.header.tick_ms
+    }
+
+    pub fn ticks(&self) -> u64 {
+        self.header.ticks
+    }
+
+    pub fn master_seed(&self) -> u64 {
+        self.header.master_seed
+    }
+
+    /// Tile runs in row-major order as `(kind, length)`
+    pub fn tile_runs(&self) -> impl Iterator<Item = (TileKind, u32)> + 'a {
+        self.raw_runs()
+            .map(|(k, n)| (tile_from_code(k).expect("validated tile kind"), n))
+    }
+
+    /// Number of entity records
+    pub fn entity_count(&self) -> usize {
+        self.header.entities as usize
+    }
+
+    /// Entity records in saved order
+    pub fn entities(&self) -> impl Iterator<Item = EntityRecord<'a>> + 'a {
+        let names = self.names;
+        self.entities.chunks_exact(ENTITY_LEN).map(move |rec| {
+            let flags = rec[0];
+            let pair = |at| (read_i32(rec, at), read_i32(rec, at + 4));
+            EntityRecord {
+                name: (flags & HAS_NAME != 0).then(|| {
+                    let (at, len) = (read_u32(rec, 20) as usize, read_u32(rec, 24) as usize);
+                    std::str::from_utf8(&names[at..at + len]).expect("validated name")
+                }),
+                pos: (flags & HAS_POS != 0).then(|| pair(4)),
+                vel: (flags & HAS_VEL != 0).then(|| pair(12)),
+                item_type: (flags & HAS_ITEM != 0)
+                    .then(|| item_from_code(rec[1]).expect("validated item type")),
+                carriable: flags & CARRIABLE != 0,
+                stack: (flags & HAS_STACK != 0).then(|| u16::from_le_bytes([rec[2], rec[3]])),
+            }
+        })
+    }
+
+    /// Expand into an owned `SaveGame`
+    pub fn to_save_game(&self) -> SaveGame {
+        let len = self.header.width as usize * self.header.height as usize;
+        let mut tiles = Vec::with_capacity(len);
+        for (kind, n) in self.tile_runs() {
+            tiles.extend(std::iter::repeat(kind).take(n as usize));
+        }
+        SaveGame {
+            width: self.header.width,
+            height: self.header.height,
+            tiles,
+            entities: self
+                .entities()
+                .map(|e| EntityData {
+                    name: e.name.map(str::to_owned),
+                    pos: e.pos,
+                    vel: e.vel,
+                    item_type: e.item_type,
+                    carriable: e.carriable,
+                    stack: e.stack,
+                })
+                .collect(),
+            tick_ms: self.header.tick_ms,
+            ticks: self.header.ticks,
+            master_seed: self.header.master_seed,
+        }
+    }
+}
@@ -0,0 +1,306 @@
+//! Dense one-bit-per-tile grids
+//!
+//! Bits follow the row-major tile order of `GameMap` and are packed into
+//! `u64` words, so unions, copies and counts work a word (64 tiles) at a time.
+//! `BitPlane` adds a one-tile border so per-tile tests next to the map edge
+//! need no bounds checks.
+
+/// Map-sized bitset with one bit per tile
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct BitGrid {
+    width: u32,
+    height: u32,
+    words: Vec<u64>,
+}
+
+impl BitGrid {
+    /// Create an all-clear grid of the given size
+    pub fn new(width: u32, height: u32) -> Self {
+        let mut grid = Self::default();
+        grid.reset(width, height);
+        grid
+    }
+
+    /// Width in tiles
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    /// Height in tiles
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    /// True if this grid covers exactly `width` x `height` tiles
+    pub fn has_size(&self, width: u32, height: u32) -> bool {
+        self.width == width && self.height == height
+    }
+
+    /// Resize to `width` x `height` and clear every bit, reusing the allocation
+    pub fn reset(&mut self, width: u32, height: u32) {
+        self.width = width;
+        self.height = height;
+        let bits = width as usize * height as usize;
+        self.words.clear();
+        self.words.resize(bits.div_ceil(64), 0);
+    }
+
+    /// Clear every bit without changing the size
+    pub fn clear(&mut self) {
+        self.words.fill(0);
+    }
+
+    /// Bit index of a tile, or None when out of bounds
+    fn bit(&self, x: i32, y: i32) -> Option<usize> {
+        if x < 0 || y < 0 || x as u32 >= self.width || y as u32 >= self.height {
+            return None;
+        }
+        Some(y as usize * self.width as usize + x as usize)
+    }
+
+    /// Whether the tile's bit is set; false for out-of-bounds tiles
+    pub fn contains(&self, x: i32, y: i32) -> bool {
+        self.bit(x, y)
+            .is_some_and(|b| self.words[b / 64] & (1 << (b % 64)) != 0)
+    }
+
+    /// Set or clear a tile's bit; out-of-bounds tiles are ignored
+    pub fn set(&mut self, x: i32, y: i32, value: bool) {
+        if let Some(b) = self.bit(x, y) {
+            if value {
+                self.words[b / 64] |= 1 << (b % 64);
+            } else {
+                self.words[b / 64] &= !(1 << (b % 64));
+            }
+        }
+    }
+
+    /// Number of set bits
+    pub fn count(&self) -> usize {
+        self.words.iter().map(|w| w.count_ones() as usize).sum()
+    }
+
+    /// True if no bit is set
+    pub fn is_empty(&self) -> bool {
+        self.words.iter().all(|&w| w == 0)
+    }
+
+    /// Become a copy of `other`, reusing this grid's allocation
+    pub fn copy_from(&mut self, other: &BitGrid) {
+        self.width = other.width;
+        self.height = other.height;
+        self.words.clear();
+        self.words.extend_from_slice(&other.words);
+    }
+
+    /// Word-wide OR of another grid of the same size into this one
+    pub fn union_with(&mut self, other: &BitGrid) {
+        debug_assert!(other.has_size(self.width, self.height));
+        for (dst, src) in self.words.iter_mut().zip(&other.words) {
+            *dst |= src;
+        }
+    }
+
+    /// OR the first `len` bits of `src` into this grid starting at bit `start`
+    ///
+    /// Used to merge rows of smaller bitsets whose rows are word-aligned;
+    /// `start + len` must not exceed the tile count.
+    pub(crate) fn or_bits(&mut self, start: usize, src: &[u64], len: usize) {
+        debug_assert!(start + len <= self.width as usize * self.height as usize);
+        let mut remaining = len;
+        for (k, &word) in src.iter().enumerate() {
+            if remaining == 0 {
+                break;
+            }
+            let word = if remaining < 64 {
+                word & ((1u64 << remaining) - 1)
+            } else {
+                word
+            };
+            remaining = remaining.saturating_sub(64);
+            let b = start + k * 64;
+            let (i, shift) = (b / 64, b % 64);
+            self.words[i] |= word << shift;
+            if shift != 0 && i + 1 < self.words.len() {
+                self.words[i + 1] |= word >> (64 - shift);
+            }
+        }
+    }
+
+    /// Iterate over the coordinates of all set bits in row-major order
+    pub fn iter(&self) -> impl Iterator<Item = (i32, i32)> + '_ {
+        let width = self.width.max(1) as usize;
+        self.words.iter().enumerate().flat_map(move |(i, &word)| {
+            SetBits(word).map(move |bit| {
+                let b = i * 64 + bit;
+                ((b % width) as i32, (b / width) as i32)
+            })
+        })
+    }
+
+    /// Raw words, 64 tiles each, in row-major tile order
+    pub fn words(&self) -> &[u64] {
+        &self.words
+    }
+}
+
+/// Per-tile flag with a one-tile border around the map
+///
+/// Each row, border columns included, starts on a word boundary. Border
+/// tiles read as `border`, so `get` is valid for x in `-1..=width` and
+/// y in `-1..=height`, i.e. for any neighbour of an on-map tile.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct BitPlane {
+    width: u32,
+    height: u32,
+    /// Words per padded row
+    row_words: usize,
+    border: bool,
+    words: Vec<u64>,
+}
+
+impl BitPlane {
+    /// All-clear plane of the given size whose border reads as `border`
+    pub fn new(width: u32, height: u32, border: bool) -> Self {
+        let row_words = (width as usize + 2).div_ceil(64);
+        let mut plane = Self {
+            width,
+            height,
+            row_words,
+            border,
+            words: vec![0; row_words * (height as usize + 2)],
+        };
+        if border {
+            let last = (height as usize + 1) * row_words;
+            plane.words[..row_words].fill(u64::MAX);
+            plane.words[last..].fill(u64::MAX);
+            for y in 0..height as i32 {
+                plane.write(-1, y, true);
+                plane.write(width as i32, y, true);
+            }
+        }
+        plane
+    }
+
+    /// Width of the map area in tiles
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    /// Height of the map area in tiles
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    #[inline]
+    fn bit(&self, x: i32, y: i32) -> usize {
+        (y + 1) as usize * self.row_words * 64 + (x + 1) as usize
+    }
+
+    /// Flag of a tile on the map or its border, without a bounds check
+    #[inline]
+    pub fn get(&self, x: i32, y: i32) -> bool {
+        debug_assert!(x >= -1 && y >= -1 && x <= self.width as i32 && y <= self.height as i32);
+        let b = self.bit(x, y);
+        (self.words[b / 64] >> (b % 64)) & 1 != 0
+    }
+
+    /// Flag of any tile; tiles off the map read as the border value
+    #[inline]
+    pub fn contains(&self, x: i32, y: i32) -> bool {
+        // One unsigned compare per axis covers both sides of the padded range
+        if x.wrapping_add(1) as u32 > self.width + 1 || y.wrapping_add(1) as u32 > self.height + 1 {
+            return self.border;
+        }
+        self.get(x, y)
+    }
+
+    /// Set or clear an on-map tile's flag; other tiles are ignored
+    pub fn set(&mut self, x: i32, y: i32, value: bool) {
+        if x >= 0 && y >= 0 && (x as u32) < self.width && (y as u32) < self.height {
+            self.write(x, y, value);
+        }
+    }
+
+    fn write(&mut self, x: i32, y: i32, value: bool) {
+        let b = self.bit(x, y);
+        if value {
+            self.words[b / 64] |= 1 << (b % 64);
+        } else {
+            self.words[b / 64] &= !(1 << (b % 64));
+        }
+    }
+}
+
+/// Iterator over the positions of the set bits of one word
+pub(crate) struct SetBits(pub(crate) u64);
+
+impl Iterator for SetBits {
+    type Item = usize;
+
+    fn next(&mut self) -> Option<usize> {
+        if self.0 == 0 {
+            return None;
+        }
+        let bit = self.0.trailing_zeros() as usize;
+        self.0 &= self.0 - 1;
+        Some(bit)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn set_contains_and_iterate() {
+        let mut grid = BitGrid::new(70, 3);
+        grid.set(0, 0, true);
+        grid.set(69, 0, true);
+        grid.set(5, 2, true);
+        grid.set(-1, 0, true);
+        grid.set(70, 0, true);
+        assert_eq!(grid.count(), 3);
+        assert!(grid.contains(69, 0) && !grid.contains(68, 0));
+        assert_eq!(grid.iter().collect::<Vec<_>>(), [(0, 0), (69, 0), (5, 2)]);
+
+        grid.set(69, 0, false);
+        assert_eq!(grid.count(), 2);
+        grid.reset(70, 3);
+        assert!(grid.is_empty());
+    }
+
+    #[test]
+    fn plane_border_reads_as_configured() {
+        for border in [false, true] {
+            let mut plane = BitPlane::new(70, 2, border);
+            plane.set(69, 1, true);
+            plane.set(70, 1, !border);
+            assert!(plane.get(69, 1) && !plane.get(68, 1));
+            for (x, y) in [(-1, 0), (70, 1), (0, -1), (69, 2), (-1, 2), (-40, 7)] {
+                assert_eq!(plane.contains(x, y), border, "({x}, {y})");
+            }
+            assert_eq!(plane.get(70, -1), border);
+        }
+    }
+
+    #[test]
+    fn or_bits_handles_unaligned_rows() {
+        let mut grid = BitGrid::new(100, 2);
+        // 70 set bits landing at x = 20..90 on row 1, across a word boundary
+        let row = [u64::MAX, u64::MAX];
+        grid.or_bits(100 + 20, &row, 70);
+        assert_eq!(grid.count(), 70);
+        assert!(!grid.contains(19, 1) && grid.contains(20, 1));
+        assert!(grid.contains(89, 1) && !grid.contains(90, 1));
+
+        let mut other = BitGrid::new(100, 2);
+        other.set(0, 0, true);
+        grid.union_with(&other);
+        assert_eq!(grid.count(), 71);
+
+        let mut copy = BitGrid::new(3, 3);
+        copy.copy_from(&grid);
+        assert_eq!(copy, grid);
+    }
+}
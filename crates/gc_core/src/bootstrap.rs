@@ -5,10 +5,15 @@
 use bevy_ecs::prelude::*;
 use rand::Rng;
 
+use crate::autosave;
 use crate::designations;
+use crate::flow;
+use crate::fluids;
+use crate::hash;
 use crate::jobs;
 use crate::prelude::*;
-use crate::stockpiles::StockpileBundle;
+use crate::spatial;
+use crate::stockpiles::{StockpileBundle, StockpilePlanner};
 use crate::systems;
 
 /// Options controlling what entities/resources to include when building a world.
@@ -51,7 +56,11 @@ pub fn build_standard_world(width: u32, height: u32, seed: u64, opts: WorldOptio
     world.insert_resource(jobs::ItemSpawnQueue::default());
     world.insert_resource(jobs::ActiveJobs::default());
     world.insert_resource(designations::DesignationConfig { auto_jobs: true });
+    world.insert_resource(designations::DesignationIndex::default());
     world.insert_resource(systems::Time::new(opts.tick_ms));
+    world.insert_resource(SpatialIndex::default());
+    world.insert_resource(FlowFieldService::default());
+    world.insert_resource(StockpilePlanner::default());
 
     if opts.populate_demo_scene {
         // Miner
@@ -85,23 +94,82 @@ pub fn build_standard_world(width: u32, height: u32, seed: u64, opts: WorldOptio
 }
 
 /// Build the default simulation schedule used by shells for demos/play.
+///
+/// Systems are grouped into the `SimSet` phases, which run in order. Within
+/// a phase, systems with disjoint data run in parallel: job assignment with
+/// flow field upkeep, movement with mine execution, and FOV (added by
+/// shells to `SimSet::Perception`) with haul posting. The tick result does
+/// not depend on the thread count. `world_hash_system` runs last, and only
+/// in worlds that have a `WorldHash` resource; the same goes for the
+/// `metrics` phase timers and a `TickMetrics` resource, for
+/// `fluid_system` and a `FluidGrid`, and for `autosave_removals_system` and
+/// an `AutosaveRemovals`. Drive it with `run_tick`.
 pub fn build_default_schedule() -> Schedule {
     let mut schedule = Schedule::default();
+    schedule.configure_sets(
+        (
+            SimSet::Input,
+            SimSet::Designations,
+            SimSet::Planning,
+            SimSet::Execution,
+            SimSet::Perception,
+            SimSet::Cleanup,
+        )
+            .chain(),
+    );
     schedule.add_systems((
-        systems::movement,
-        systems::confine_to_map,
+        spatial::spatial_index_system.in_set(SimSet::Input),
         (
             designations::designation_dedup_system,
             designations::designation_to_jobs_system,
-            jobs::job_assignment_system,
         )
-            .chain(),
+            .chain()
+            .in_set(SimSet::Designations),
+        (jobs::job_assignment_system, flow::flow_field_system).in_set(SimSet::Planning),
         (
+            systems::movement,
+            // Only reads the map size, which mining never changes
+            systems::confine_to_map
+                .after(systems::movement)
+                .ambiguous_with(jobs::mine_job_execution_system),
             jobs::mine_job_execution_system,
-            systems::hauling_execution_system,
+            systems::hauling_execution_system
+                .after(systems::confine_to_map)
+                .after(jobs::mine_job_execution_system),
+            // Turns this tick's mined stone into items, merging into loose
+            // items that hauling left on the ground
+            jobs::process_item_spawn_queue_system
+                .after(jobs::mine_job_execution_system)
+                .after(systems::hauling_execution_system),
+        )
+            .in_set(SimSet::Execution),
+        (
             systems::auto_haul_system,
-        ),
-        systems::advance_time,
+            fluids::fluid_system.run_if(resource_exists::<fluids::FluidGrid>),
+        )
+            .in_set(SimSet::Perception),
+        (
+            systems::advance_time,
+            hash::world_hash_system.run_if(resource_exists::<hash::WorldHash>),
+        )
+            .chain()
+            .in_set(SimSet::Cleanup),
+        autosave::autosave_removals_system
+            .run_if(resource_exists::<autosave::AutosaveRemovals>)
+            .in_set(SimSet::Cleanup),
     ));
+    #[cfg(feature = "metrics")]
+    crate::metrics::instrument(&mut schedule);
     schedule
 }
+
+/// Run one simulation tick: the schedule, then `World::clear_trackers`.
+///
+/// Clearing rotates the removal event buffers, which otherwise grow for the
+/// life of the world; removals stay readable by `RemovedComponents` for the
+/// tick they happen in and the next one. Every tick driver goes through
+/// this rather than calling `Schedule::run` itself.
+pub fn run_tick(world: &mut World, schedule: &mut Schedule) {
+    schedule.run(world);
+    world.clear_trackers();
+}
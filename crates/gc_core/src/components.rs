@@ -40,7 +40,7 @@ pub struct VisionRadius(pub i32);
 /// Represents the lifecycle state of a designation
 /// Designations go through states to prevent duplicate processing and
 /// enable proper cleanup of completed or invalid designations
-#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Hash)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default, Hash, Serialize, Deserialize)]
 pub enum DesignationState {
     /// Active designation ready to be processed
     /// This is the initial state when a designation is created
@@ -79,6 +79,16 @@ pub struct Item {
     pub item_type: ItemType,
 }
 
+impl ItemType {
+    /// Display name shared by every item of this type, so item entities
+    /// need no `Name` of their own
+    pub fn name(self) -> &'static str {
+        match self {
+            ItemType::Stone => "Stone",
+        }
+    }
+}
+
 impl Item {
     /// Creates a new stone item component
     /// This is the primary item type created by mining operations
@@ -95,6 +105,13 @@ impl Item {
 #[derive(Component, Debug)]
 pub struct Carriable;
 
+/// Number of identical items one item entity stands for
+/// Absent means a single item; items spawned with `ItemSpawnConfig::stack`
+/// carry one so later spawns on their tile can merge in. Capped at
+/// `u16::MAX`; the rest starts a new stack
+#[derive(Component, Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ItemStack(pub u16);
+
 /// Component representing a stone item
 /// This is a specific marker for stone items, used in conjunction
 /// with the more generic Item component for type-specific behavior
@@ -112,7 +129,7 @@ pub struct Inventory(pub Option<Entity>);
 /// Defines rectangular bounds for a zone
 /// Used by stockpiles and other area-based game features
 /// Coordinates are inclusive on all sides
-#[derive(Component, Debug, Clone)]
+#[derive(Component, Debug, Clone, Serialize, Deserialize)]
 pub struct ZoneBounds {
     /// Minimum X coordinate (inclusive)
     pub min_x: i32,
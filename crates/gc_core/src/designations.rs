@@ -1,8 +1,10 @@
+use crate::bitgrid::BitGrid;
 use crate::components::{DesignationLifecycle, DesignationState};
 use crate::jobs::{add_job, JobBoard, JobKind};
-use crate::systems::DeterministicRng;
+use crate::systems::{in_entity_order, DeterministicRng};
+use crate::world::GameMap;
 use bevy_ecs::prelude::*;
-use std::collections::HashMap;
+use std::collections::{HashMap, HashSet};
 
 /// Designation System for Player Input and Job Creation
 ///
@@ -51,42 +53,129 @@ pub struct DesignationConfig {
     pub auto_jobs: bool,
 }
 
-/// System that deduplicates designations by marking later ones at the same position as Ignored
-/// Prevents multiple jobs from being created for the same location
-/// Uses a two-pass approach to avoid borrowing conflicts while maintaining deterministic behavior
+/// Tiles held by an Active mine designation, kept across ticks
 ///
-/// The system preserves the first designation at each position and marks subsequent ones as Ignored.
-/// Only Active designations are considered for deduplication - Ignored and Consumed designations are left unchanged.
-pub fn designation_dedup_system(
-    mut q_designations: Query<
-        (Entity, &crate::world::Position, &mut DesignationLifecycle),
-        With<MineDesignation>,
-    >,
-) {
-    // Collect all active designations by position
-    let mut position_map: HashMap<(i32, i32), Vec<Entity>> = HashMap::new();
+/// One bit per map tile (plus a small set for tiles off the map), so dedup
+/// tests a tile in O(1) and only designations that were added, moved,
+/// changed state or removed are ever looked at. `designation_dedup_system`
+/// keeps it current; without the resource the system keeps a private one.
+#[derive(Resource, Debug, Default)]
+pub struct DesignationIndex {
+    tiles: BitGrid,
+    off_map: HashSet<(i32, i32)>,
+    /// Tile each holding designation claimed
+    holders: HashMap<Entity, (i32, i32)>,
+}
 
-    // First pass: collect entities by position, only considering Active designations
-    for (entity, pos, lifecycle) in q_designations.iter() {
-        if lifecycle.0 == DesignationState::Active {
-            let position = (pos.0, pos.1);
-            position_map.entry(position).or_default().push(entity);
+impl DesignationIndex {
+    /// Whether an Active designation holds the tile
+    pub fn is_held(&self, x: i32, y: i32) -> bool {
+        self.tiles.contains(x, y) || self.off_map.contains(&(x, y))
+    }
+
+    /// Number of held tiles
+    pub fn len(&self) -> usize {
+        self.holders.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.holders.is_empty()
+    }
+
+    /// Match the bitmap to a `width` x `height` map, re-marking every held
+    /// tile if the size changed
+    fn fit(&mut self, width: u32, height: u32) {
+        if self.tiles.has_size(width, height) {
+            return;
+        }
+        self.tiles.reset(width, height);
+        self.off_map.clear();
+        let held: Vec<(i32, i32)> = self.holders.values().copied().collect();
+        for tile in held {
+            self.mark(tile, true);
         }
     }
 
-    // Find entities to mark as ignored (all but first at each position)
-    let mut entities_to_ignore: Vec<Entity> = Vec::new();
-    for entities in position_map.values() {
-        if entities.len() > 1 {
-            // Keep the first entity at this position, mark the rest as ignored
-            // This ensures deterministic behavior regardless of query order
-            entities_to_ignore.extend(entities.iter().skip(1));
+    fn mark(&mut self, (x, y): (i32, i32), value: bool) {
+        let on_map =
+            x >= 0 && y >= 0 && (x as u32) < self.tiles.width() && (y as u32) < self.tiles.height();
+        if on_map {
+            self.tiles.set(x, y, value);
+        } else if value {
+            self.off_map.insert((x, y));
+        } else {
+            self.off_map.remove(&(x, y));
         }
     }
 
-    // Second pass: mark duplicates as ignored
-    for (entity, _pos, mut lifecycle) in q_designations.iter_mut() {
-        if entities_to_ignore.contains(&entity) {
+    /// Give `entity` the tile; false if another designation holds it
+    fn claim(&mut self, entity: Entity, tile: (i32, i32)) -> bool {
+        if self.is_held(tile.0, tile.1) {
+            return false;
+        }
+        self.mark(tile, true);
+        self.holders.insert(entity, tile);
+        true
+    }
+
+    /// Free the tile `entity` holds, if any
+    fn release(&mut self, entity: Entity) {
+        if let Some(tile) = self.holders.remove(&entity) {
+            self.mark(tile, false);
+        }
+    }
+}
+
+/// Designations to re-check: new, moved, or with a lifecycle set elsewhere
+type Touched = (
+    With<MineDesignation>,
+    Or<(
+        Added<MineDesignation>,
+        Changed<crate::world::Position>,
+        Changed<DesignationLifecycle>,
+    )>,
+);
+
+/// System that deduplicates designations by marking later ones at the same position as Ignored
+/// Prevents multiple jobs from being created for the same location
+///
+/// The first Active designation on a tile holds it in the `DesignationIndex`;
+/// an Active designation that arrives later on a held tile is marked Ignored.
+/// A tile is released when its holder stops being Active, moves or is removed.
+/// Only designations added, moved or changed since the last run are checked,
+/// releases first and then claims in `Entity` order, so a large rectangle
+/// designation settles in one pass and later ticks cost nothing.
+pub fn designation_dedup_system(
+    map: Option<Res<GameMap>>,
+    mut index: Option<ResMut<DesignationIndex>>,
+    mut local_index: Local<DesignationIndex>,
+    mut removed: RemovedComponents<MineDesignation>,
+    mut q_touched: Query<(Entity, &crate::world::Position, &mut DesignationLifecycle), Touched>,
+) {
+    let index = match index.as_deref_mut() {
+        Some(index) => index,
+        None => &mut *local_index,
+    };
+    if let Some(map) = map {
+        index.fit(map.width, map.height);
+    }
+    for entity in removed.read() {
+        index.release(entity);
+    }
+    // A holder that moved or left Active frees its tile before anyone claims
+    for (entity, pos, lifecycle) in q_touched.iter() {
+        let still_holds = lifecycle.0 == DesignationState::Active
+            && index.holders.get(&entity) == Some(&(pos.0, pos.1));
+        if !still_holds {
+            index.release(entity);
+        }
+    }
+    let touched = q_touched.iter_mut().map(|(e, pos, l)| (e, (pos, l)));
+    for (entity, (pos, mut lifecycle)) in in_entity_order(touched) {
+        if lifecycle.0 != DesignationState::Active || index.holders.contains_key(&entity) {
+            continue;
+        }
+        if !index.claim(entity, (pos.0, pos.1)) {
             lifecycle.0 = DesignationState::Ignored;
         }
     }
@@ -97,19 +186,36 @@ pub fn designation_dedup_system(
 /// Marks processed designations as Consumed to prevent duplicate job creation
 ///
 /// Only runs when auto_jobs is enabled in DesignationConfig
-/// Uses deterministic RNG to ensure reproducible job IDs
+/// Uses deterministic RNG to ensure reproducible job IDs, posting in
+/// `Entity` order
+/// Only designations added or changed since the last run are looked at, plus
+/// all of them on the run after `DesignationConfig` changes (e.g. auto_jobs
+/// being switched on with designations already waiting)
+#[allow(clippy::type_complexity)]
 pub fn designation_to_jobs_system(
     config: Res<DesignationConfig>,
     mut board: ResMut<JobBoard>,
     mut rng: ResMut<DeterministicRng>,
-    mut q: Query<(&crate::world::Position, &mut DesignationLifecycle), With<MineDesignation>>,
+    mut queries: ParamSet<(
+        Query<
+            (Entity, (&crate::world::Position, &mut DesignationLifecycle)),
+            (
+                With<MineDesignation>,
+                Or<(Added<MineDesignation>, Changed<DesignationLifecycle>)>,
+            ),
+        >,
+        Query<
+            (Entity, (&crate::world::Position, &mut DesignationLifecycle)),
+            With<MineDesignation>,
+        >,
+    )>,
 ) {
     if !config.auto_jobs {
         return;
     }
 
-    // Only process active designations and mark them consumed to prevent duplicates
-    for (pos, mut lifecycle) in q.iter_mut() {
+    let mut post = |pos: &crate::world::Position, mut lifecycle: Mut<DesignationLifecycle>| {
+        // Only process active designations and mark them consumed to prevent duplicates
         if lifecycle.0 == DesignationState::Active {
             // Create a mining job for this designation
             add_job(
@@ -120,5 +226,14 @@ pub fn designation_to_jobs_system(
             // Mark designation as consumed so it won't create another job
             lifecycle.0 = DesignationState::Consumed;
         }
+    };
+    if config.is_changed() {
+        for (_, (pos, lifecycle)) in in_entity_order(queries.p1().iter_mut()) {
+            post(pos, lifecycle);
+        }
+    } else {
+        for (_, (pos, lifecycle)) in in_entity_order(queries.p0().iter_mut()) {
+            post(pos, lifecycle);
+        }
     }
 }
@@ -0,0 +1,438 @@
+//! Flow fields (Dijkstra maps) for many agents heading to the same goal
+//!
+//! A `FlowField` stores the 4-directional walking distance from every tile
+//! to the nearest of its goal tiles, so any agent can read its distance and
+//! next step in O(1) instead of running its own A*. `FlowFieldService` keeps
+//! one field per stockpile and repairs them as the map changes: opened tiles
+//! are relaxed locally, and only a closed tile on a field's reachable area
+//! forces that field to rebuild.
+
+use crate::bitgrid::BitGrid;
+use crate::components::{Stockpile, ZoneBounds};
+use crate::path::Bounds;
+use crate::world::{GameMap, Position, CHUNK_SIZE};
+use bevy_ecs::prelude::*;
+use std::collections::{HashMap, VecDeque};
+
+/// Distance of tiles no goal can be reached from
+const UNREACHED: u32 = u32::MAX;
+
+/// 4-directional movement, same order as the A* search
+const DIRS: [(i32, i32); 4] = [(1, 0), (-1, 0), (0, 1), (0, -1)];
+
+/// Walking distance to the nearest goal tile from every tile of a map
+#[derive(Debug, Clone)]
+pub struct FlowField {
+    /// Goal rectangle; only its walkable tiles are goals
+    goal: Bounds,
+    width: u32,
+    dist: Vec<u32>,
+    queue: VecDeque<usize>,
+}
+
+impl FlowField {
+    /// Build a field toward the walkable tiles of the inclusive rectangle `goal`
+    pub fn new(map: &GameMap, goal: Bounds) -> Self {
+        let mut field = Self {
+            goal,
+            width: map.width,
+            dist: Vec::new(),
+            queue: VecDeque::new(),
+        };
+        field.rebuild(map);
+        field
+    }
+
+    /// Goal rectangle this field flows toward
+    pub fn goal(&self) -> Bounds {
+        self.goal
+    }
+
+    fn is_goal(&self, x: i32, y: i32) -> bool {
+        let (x0, y0, x1, y1) = self.goal;
+        x >= x0 && x <= x1 && y >= y0 && y <= y1
+    }
+
+    /// Recompute every distance with one multi-source BFS from the goals
+    pub fn rebuild(&mut self, map: &GameMap) {
+        self.width = map.width;
+        self.dist.clear();
+        self.dist
+            .resize(map.width as usize * map.height as usize, UNREACHED);
+        let (x0, y0, x1, y1) = self.goal;
+        for y in y0.max(0)..=y1.min(map.height as i32 - 1) {
+            for x in x0.max(0)..=x1.min(map.width as i32 - 1) {
+                if map.is_walkable(x, y) {
+                    let i = self.index(x, y);
+                    self.dist[i] = 0;
+                    self.queue.push_back(i);
+                }
+            }
+        }
+        self.relax(map);
+    }
+
+    fn index(&self, x: i32, y: i32) -> usize {
+        y as usize * self.width as usize + x as usize
+    }
+
+    /// Propagate distances from the queued tiles until nothing improves
+    fn relax(&mut self, map: &GameMap) {
+        let w = self.width as usize;
+        while let Some(i) = self.queue.pop_front() {
+            let (x, y) = ((i % w) as i32, (i / w) as i32);
+            let next = self.dist[i] + 1;
+            for (dx, dy) in DIRS {
+                let (nx, ny) = (x + dx, y + dy);
+                if map.is_walkable(nx, ny) {
+                    let n = self.index(nx, ny);
+                    if next < self.dist[n] {
+                        self.dist[n] = next;
+                        self.queue.push_back(n);
+                    }
+                }
+            }
+        }
+    }
+
+    /// Best distance a walkable tile can get from its neighbours (or as a goal)
+    fn best_from_neighbours(&self, map: &GameMap, x: i32, y: i32) -> u32 {
+        if self.is_goal(x, y) {
+            return 0;
+        }
+        DIRS.iter()
+            .filter_map(|&(dx, dy)| {
+                let (nx, ny) = (x + dx, y + dy);
+                map.is_walkable(nx, ny)
+                    .then(|| self.dist[self.index(nx, ny)])
+            })
+            .min()
+            .map_or(UNREACHED, |d| d.saturating_add(1))
+    }
+
+    /// Bring the field up to date after tiles changed walkability
+    ///
+    /// Opened tiles can only shorten distances, so they are relaxed locally.
+    /// A closed tile that was reachable may lengthen paths through it, which
+    /// needs a full rebuild. Returns true if the field was rebuilt.
+    pub fn apply_changes(
+        &mut self,
+        map: &GameMap,
+        opened: &[(i32, i32)],
+        closed: &[(i32, i32)],
+    ) -> bool {
+        if closed
+            .iter()
+            .any(|&(x, y)| self.dist[self.index(x, y)] != UNREACHED)
+        {
+            self.rebuild(map);
+            return true;
+        }
+        for &(x, y) in opened {
+            let i = self.index(x, y);
+            let d = self.best_from_neighbours(map, x, y);
+            if d < self.dist[i] {
+                self.dist[i] = d;
+                self.queue.push_back(i);
+            }
+        }
+        self.relax(map);
+        false
+    }
+
+    /// Steps from `(x, y)` to the nearest goal, or None if no goal is reachable
+    ///
+    /// Like A*, the start itself need not be walkable: an agent inside a wall
+    /// steps out through a walkable neighbour.
+    pub fn distance(&self, map: &GameMap, x: i32, y: i32) -> Option<u32> {
+        if !map.in_bounds(x, y) {
+            return None;
+        }
+        let d = if map.is_walkable(x, y) {
+            self.dist[self.index(x, y)]
+        } else {
+            DIRS.iter()
+                .filter(|&&(dx, dy)| map.is_walkable(x + dx, y + dy))
+                .map(|&(dx, dy)| self.dist[self.index(x + dx, y + dy)].saturating_add(1))
+                .min()
+                .unwrap_or(UNREACHED)
+        };
+        (d != UNREACHED).then_some(d)
+    }
+
+    /// Neighbour to move to from `(x, y)` to get one step closer to a goal
+    ///
+    /// None at a goal tile or where no goal is reachable. Ties go to the
+    /// first direction in the A* order (right, left, down, up).
+    pub fn next_step(&self, map: &GameMap, x: i32, y: i32) -> Option<(i32, i32)> {
+        let here = self.distance(map, x, y)?;
+        if here == 0 && map.is_walkable(x, y) {
+            return None;
+        }
+        DIRS.iter()
+            .map(|&(dx, dy)| (x + dx, y + dy))
+            .filter(|&(nx, ny)| map.is_walkable(nx, ny))
+            .min_by_key(|&(nx, ny)| self.dist[self.index(nx, ny)])
+            .filter(|&(nx, ny)| self.dist[self.index(nx, ny)] < here)
+    }
+}
+
+/// Counters describing how `FlowFieldService` kept its fields current
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct FlowStats {
+    /// Fields built from scratch (new goal, goal moved, map resized, or a
+    /// reachable tile closed)
+    pub rebuilt: usize,
+    /// Fields repaired in place after tiles opened
+    pub repaired: usize,
+}
+
+/// One cached flow field per stockpile, kept in step with the map
+#[derive(Resource, Debug, Default)]
+pub struct FlowFieldService {
+    fields: HashMap<Entity, FlowField>,
+    /// Walkability snapshot the fields currently reflect
+    walkable: BitGrid,
+    /// Map epoch and version of the snapshot; None before the first sync
+    synced: Option<(u64, u64)>,
+    pub stats: FlowStats,
+}
+
+impl FlowFieldService {
+    /// Apply tile changes since the last sync to every field
+    ///
+    /// Only chunks changed after the last synced map version are diffed
+    /// against the walkability snapshot. A map with another epoch was
+    /// swapped in, and every field is rebuilt.
+    pub fn sync(&mut self, map: &GameMap) {
+        let fresh = self.synced.map_or(true, |(epoch, _)| epoch != map.epoch());
+        if fresh {
+            self.walkable.reset(map.width, map.height);
+            for y in 0..map.height as i32 {
+                for x in 0..map.width as i32 {
+                    self.walkable.set(x, y, map.is_walkable(x, y));
+                }
+            }
+            for field in self.fields.values_mut() {
+                field.rebuild(map);
+            }
+            self.stats.rebuilt += self.fields.len();
+            self.synced = Some((map.epoch(), map.version()));
+            return;
+        }
+        let Some((_, version)) = self.synced.filter(|&(_, v)| v < map.version()) else {
+            return;
+        };
+
+        let (mut opened, mut closed) = (Vec::new(), Vec::new());
+        for (cx, cy) in map.changed_chunks_since(version) {
+            let (x0, y0) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+            for y in y0..(y0 + CHUNK_SIZE).min(map.height as i32) {
+                for x in x0..(x0 + CHUNK_SIZE).min(map.width as i32) {
+                    let now = map.is_walkable(x, y);
+                    if now != self.walkable.contains(x, y) {
+                        self.walkable.set(x, y, now);
+                        if now {
+                            opened.push((x, y));
+                        } else {
+                            closed.push((x, y));
+                        }
+                    }
+                }
+            }
+        }
+        if !opened.is_empty() || !closed.is_empty() {
+            for field in self.fields.values_mut() {
+                if field.apply_changes(map, &opened, &closed) {
+                    self.stats.rebuilt += 1;
+                } else {
+                    self.stats.repaired += 1;
+                }
+            }
+        }
+        self.synced = Some((map.epoch(), map.version()));
+    }
+
+    /// Field toward `goal` for `key`, built or rebuilt if the goal changed
+    ///
+    /// Call `sync` first so the field reflects the current map.
+    pub fn ensure(&mut self, map: &GameMap, key: Entity, goal: Bounds) -> &FlowField {
+        let stats = &mut self.stats;
+        let field = self
+            .fields
+            .entry(key)
+            .and_modify(|f| {
+                if f.goal != goal {
+                    f.goal = goal;
+                    f.rebuild(map);
+                    stats.rebuilt += 1;
+                }
+            })
+            .or_insert_with(|| {
+                stats.rebuilt += 1;
+                FlowField::new(map, goal)
+            });
+        field
+    }
+
+    /// Cached field for `key`, if one has been built
+    pub fn field(&self, key: Entity) -> Option<&FlowField> {
+        self.fields.get(&key)
+    }
+
+    /// Drop fields whose key fails `keep`
+    pub fn retain(&mut self, mut keep: impl FnMut(Entity) -> bool) {
+        self.fields.retain(|&k, _| keep(k));
+    }
+
+    /// Number of cached fields
+    pub fn len(&self) -> usize {
+        self.fields.len()
+    }
+
+    /// True if no field is cached
+    pub fn is_empty(&self) -> bool {
+        self.fields.is_empty()
+    }
+
+    /// Goal with the shortest walk from `(x, y)` as `(key, steps)`
+    ///
+    /// Ties go to the lowest key so the answer does not depend on hash order.
+    pub fn nearest(&self, map: &GameMap, x: i32, y: i32) -> Option<(Entity, u32)> {
+        self.fields
+            .iter()
+            .filter_map(|(&k, f)| f.distance(map, x, y).map(|d| (d, k)))
+            .min()
+            .map(|(d, k)| (k, d))
+    }
+
+    /// Next step from `(x, y)` toward the goal of `key`
+    pub fn next_step(&self, map: &GameMap, key: Entity, x: i32, y: i32) -> Option<(i32, i32)> {
+        self.fields.get(&key)?.next_step(map, x, y)
+    }
+}
+
+/// Goal rectangle of a stockpile: its zone, or just its tile without one
+fn stockpile_goal(pos: &Position, bounds: Option<&ZoneBounds>) -> Bounds {
+    match bounds {
+        Some(b) => (b.min_x, b.min_y, b.max_x, b.max_y),
+        None => (pos.0, pos.1, pos.0, pos.1),
+    }
+}
+
+/// Keep one flow field per stockpile in step with the map and the stockpiles
+pub fn flow_field_system(
+    map: Res<GameMap>,
+    mut flow: ResMut<FlowFieldService>,
+    q_stockpiles: Query<(Entity, &Position, Option<&ZoneBounds>), With<Stockpile>>,
+) {
+    flow.sync(&map);
+    flow.retain(|e| q_stockpiles.contains(e));
+    for (entity, pos, bounds) in q_stockpiles.iter() {
+        flow.ensure(&map, entity, stockpile_goal(pos, bounds));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::path::astar_path;
+    use crate::world::TileKind;
+
+    fn walled_map() -> GameMap {
+        let mut map = GameMap::new(24, 20);
+        for y in 0..18 {
+            map.set_tile(12, y, TileKind::Wall);
+        }
+        for x in 3..10 {
+            map.set_tile(x, 6, TileKind::Wall);
+        }
+        map
+    }
+
+    fn assert_matches_astar(map: &GameMap, field: &FlowField, goal: (i32, i32)) {
+        for y in 0..map.height as i32 {
+            for x in 0..map.width as i32 {
+                let expected = astar_path(map, (x, y), goal).map(|(_, c)| c as u32);
+                assert_eq!(field.distance(map, x, y), expected, "from ({x}, {y})");
+            }
+        }
+    }
+
+    #[test]
+    fn distances_match_astar_and_steps_descend() {
+        let map = walled_map();
+        let field = FlowField::new(&map, (20, 2, 20, 2));
+        assert_matches_astar(&map, &field, (20, 2));
+
+        let (mut x, mut y) = (0, 0);
+        let mut steps = 0;
+        while let Some((nx, ny)) = field.next_step(&map, x, y) {
+            assert!(map.is_walkable(nx, ny));
+            (x, y) = (nx, ny);
+            steps += 1;
+        }
+        assert_eq!((x, y), (20, 2));
+        assert_eq!(Some(steps), field.distance(&map, 0, 0));
+    }
+
+    #[test]
+    fn opened_and_closed_tiles_keep_fields_exact() {
+        let mut map = walled_map();
+        let mut service = FlowFieldService::default();
+        service.sync(&map);
+        let key = Entity::from_raw(7);
+        service.ensure(&map, key, (20, 2, 20, 2));
+
+        // Mining a hole through the long wall shortens paths in place
+        map.set_tile(12, 3, TileKind::Floor);
+        service.sync(&map);
+        assert_eq!(service.stats.repaired, 1);
+        assert_matches_astar(&map, service.field(key).unwrap(), (20, 2));
+
+        // Closing it again lengthens them, which takes a rebuild
+        map.set_tile(12, 3, TileKind::Wall);
+        service.sync(&map);
+        assert_eq!(service.stats.rebuilt, 2);
+        assert_matches_astar(&map, service.field(key).unwrap(), (20, 2));
+
+        // A wall appearing somewhere unreachable does not touch the field
+        let mut sealed = walled_map();
+        sealed.set_tile(12, 18, TileKind::Wall);
+        sealed.set_tile(12, 19, TileKind::Wall);
+        let mut service = FlowFieldService::default();
+        service.sync(&sealed);
+        service.ensure(&sealed, key, (20, 2, 20, 2));
+        sealed.set_tile(0, 0, TileKind::Wall);
+        service.sync(&sealed);
+        assert_eq!(
+            service.stats,
+            FlowStats {
+                rebuilt: 1,
+                repaired: 1
+            }
+        );
+        assert_eq!(service.nearest(&sealed, 1, 1), None);
+        assert_eq!(service.nearest(&sealed, 19, 2).map(|(_, d)| d), Some(1));
+    }
+
+    #[test]
+    fn swapped_map_rebuilds_every_field() {
+        let map = walled_map();
+        let mut service = FlowFieldService::default();
+        service.sync(&map);
+        let key = Entity::from_raw(7);
+        service.ensure(&map, key, (20, 2, 20, 2));
+
+        // Another map, edited past the first one's version
+        let mut loaded = GameMap::new(24, 20);
+        for x in 0..20 {
+            loaded.set_tile(x, 10, TileKind::Wall);
+            loaded.set_tile(x, 12, TileKind::Wall);
+        }
+        assert!(loaded.version() > map.version());
+        service.sync(&loaded);
+        assert_eq!(service.stats.rebuilt, 2);
+        assert_matches_astar(&loaded, service.field(key).unwrap(), (20, 2));
+    }
+}
@@ -0,0 +1,615 @@
+//! Cellular water, lava and temperature on the tile grid
+//!
+//! `FluidGrid` keeps dense per-tile planes next to `GameMap`: water and lava
+//! volume (`u8`, 0 empty to `FULL`) and temperature (`i16`, Celsius scaled by
+//! 10). Each plane is double-buffered; a step reads the front buffer, writes
+//! the back one and swaps, so results never depend on visiting order.
+//!
+//! The update rules are integer-only and branch-free per tile:
+//!
+//! - Fluid moves between open 4-neighbours by `(neighbour - self) / DIV`,
+//!   truncated toward zero, so every exchange is antisymmetric and volume is
+//!   conserved exactly (sources and boiling aside). With four neighbours and
+//!   `DIV >= 8` a tile never gives away more than half its volume.
+//! - Water and lava never share a tile: water treats lava tiles as walls,
+//!   and lava treats the tiles water occupies after its move as walls.
+//! - Temperature diffuses the same way across every map tile, lava pins its
+//!   tile to at least `LAVA_TEMP`, and water at `BOIL_POINT` or above loses
+//!   `BOIL_RATE` a step.
+//!
+//! Planes carry a one-tile border so neighbour reads need no bounds checks,
+//! and every rule runs over contiguous row spans the compiler can vectorize.
+//!
+//! Only awake chunks (`CHUNK_SIZE` squares) are stepped: those that changed
+//! on the previous step, their 8 neighbours, chunks with a source and chunks
+//! whose tiles changed on the map. A tile's next state depends only on its
+//! own and its neighbours' current state, so a chunk none of whose inputs
+//! changed would compute exactly what it already holds; skipping it is
+//! exact, and a settled lake costs nothing.
+
+use crate::systems::Time;
+use crate::world::{GameMap, TileKind, CHUNK_SIZE};
+use bevy_ecs::prelude::*;
+
+/// Volume of a full tile
+pub const FULL: u8 = 255;
+/// Temperature of fresh tiles, 15.0 °C
+pub const AMBIENT_TEMP: i16 = 150;
+/// Least temperature of a tile holding lava, 1200.0 °C
+pub const LAVA_TEMP: i16 = 12_000;
+/// Water at or above this boils, 100.0 °C
+pub const BOIL_POINT: i16 = 1_000;
+/// Water lost per step by a boiling tile
+pub const BOIL_RATE: u8 = 1;
+/// Least volume a tile needs to boil; above `BOIL_RATE`, so boiling never
+/// empties a tile and never changes which tiles lava may enter
+pub const EVAP_THRESH: u8 = 10;
+/// Share of a volume difference water moves per step
+const WATER_DIV: i16 = 8;
+/// Lava is viscous and moves half as fast
+const LAVA_DIV: i16 = 16;
+/// Share of a temperature difference conducted per step
+const HEAT_DIV: i32 = 8;
+
+const CHUNK: usize = CHUNK_SIZE as usize;
+
+/// Kind of fluid on a tile
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum FluidKind {
+    Water,
+    Lava,
+}
+
+/// Spring or vent adding fluid to a tile every step
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FluidSource {
+    pub x: i32,
+    pub y: i32,
+    pub kind: FluidKind,
+    /// Volume added per step, capped at `FULL`
+    pub rate: u8,
+}
+
+/// Work done by the last step
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct FluidStats {
+    /// Steps taken so far
+    pub steps: u64,
+    /// Chunks stepped by the last step
+    pub awake_chunks: usize,
+    /// Tiles stepped by the last step
+    pub tiles: usize,
+}
+
+/// Double-buffered fluid and temperature planes; see the module docs
+///
+/// Insert it to enable `fluid_system`.
+#[derive(Resource, Debug, Clone)]
+pub struct FluidGrid {
+    /// Step every this many ticks (at least 1)
+    pub interval: u32,
+    width: usize,
+    height: usize,
+    /// Padded row length, `width + 2`
+    stride: usize,
+    /// 1 where fluid may flow (map tiles that are not walls), 0 elsewhere
+    open: Vec<u8>,
+    /// 1 on map tiles, 0 on the border; temperature flows where this is 1
+    inside: Vec<u8>,
+    water: [Vec<u8>; 2],
+    lava: [Vec<u8>; 2],
+    temp: [Vec<i16>; 2],
+    /// Which buffer of each pair is current
+    front: usize,
+    chunks_x: usize,
+    chunks_y: usize,
+    /// Chunks to step next time, because they or a neighbour changed
+    changed: Vec<bool>,
+    awake: Vec<bool>,
+    sources: Vec<FluidSource>,
+    /// `GameMap` epoch and version the open mask is current for
+    map_epoch: u64,
+    map_version: u64,
+    stats: FluidStats,
+}
+
+impl FluidGrid {
+    /// Grid for `map`: walls are closed, `Water` and `Lava` tiles start full
+    /// with lava at `LAVA_TEMP`, everything else dry at `AMBIENT_TEMP`
+    pub fn from_map(map: &GameMap) -> Self {
+        let (width, height) = (map.width as usize, map.height as usize);
+        let stride = width + 2;
+        let cells = stride * (height + 2);
+        let chunks_x = width.div_ceil(CHUNK);
+        let chunks_y = height.div_ceil(CHUNK);
+        let mut grid = Self {
+            interval: 1,
+            width,
+            height,
+            stride,
+            open: vec![0; cells],
+            inside: vec![0; cells],
+            water: [vec![0; cells], vec![0; cells]],
+            lava: [vec![0; cells], vec![0; cells]],
+            temp: [vec![AMBIENT_TEMP; cells], vec![AMBIENT_TEMP; cells]],
+            front: 0,
+            chunks_x,
+            chunks_y,
+            changed: vec![true; chunks_x * chunks_y],
+            awake: vec![false; chunks_x * chunks_y],
+            sources: Vec::new(),
+            map_epoch: map.epoch(),
+            map_version: map.version(),
+            stats: FluidStats::default(),
+        };
+        for y in 0..height {
+            for x in 0..width {
+                let i = grid.cell(x, y);
+                grid.inside[i] = 1;
+                let kind = map.get_tile(x as i32, y as i32);
+                grid.open[i] = (kind != Some(TileKind::Wall)) as u8;
+                for b in 0..2 {
+                    match kind {
+                        Some(TileKind::Water) => grid.water[b][i] = FULL,
+                        Some(TileKind::Lava) => {
+                            grid.lava[b][i] = FULL;
+                            grid.temp[b][i] = LAVA_TEMP;
+                        }
+                        _ => {}
+                    }
+                }
+            }
+        }
+        grid
+    }
+
+    /// Same grid stepping every `interval` ticks
+    pub fn with_interval(mut self, interval: u32) -> Self {
+        self.interval = interval.max(1);
+        self
+    }
+
+    pub fn width(&self) -> u32 {
+        self.width as u32
+    }
+
+    pub fn height(&self) -> u32 {
+        self.height as u32
+    }
+
+    /// Padded index of an in-bounds tile
+    fn cell(&self, x: usize, y: usize) -> usize {
+        (y + 1) * self.stride + x + 1
+    }
+
+    fn cell_of(&self, x: i32, y: i32) -> Option<usize> {
+        let in_bounds = x >= 0 && y >= 0 && (x as usize) < self.width && (y as usize) < self.height;
+        in_bounds.then(|| self.cell(x as usize, y as usize))
+    }
+
+    /// Water volume on a tile; 0 off the map
+    pub fn water(&self, x: i32, y: i32) -> u8 {
+        self.cell_of(x, y).map_or(0, |i| self.water[self.front][i])
+    }
+
+    /// Lava volume on a tile; 0 off the map
+    pub fn lava(&self, x: i32, y: i32) -> u8 {
+        self.cell_of(x, y).map_or(0, |i| self.lava[self.front][i])
+    }
+
+    /// Temperature of a tile in tenths of a degree; `AMBIENT_TEMP` off the map
+    pub fn temp(&self, x: i32, y: i32) -> i16 {
+        self.cell_of(x, y)
+            .map_or(AMBIENT_TEMP, |i| self.temp[self.front][i])
+    }
+
+    /// Total volume of one fluid over the map
+    pub fn total(&self, kind: FluidKind) -> u64 {
+        let plane = match kind {
+            FluidKind::Water => &self.water[self.front],
+            FluidKind::Lava => &self.lava[self.front],
+        };
+        plane.iter().map(|&v| v as u64).sum()
+    }
+
+    /// Work done by the last step
+    pub fn stats(&self) -> FluidStats {
+        self.stats
+    }
+
+    /// Number of chunks that will be stepped next time, neighbours excluded
+    pub fn changed_chunks(&self) -> usize {
+        self.changed.iter().filter(|&&c| c).count()
+    }
+
+    /// Add `amount` of fluid to a tile, capped at `FULL`; ignored off the
+    /// map, on walls and on tiles holding the other fluid
+    pub fn add(&mut self, x: i32, y: i32, kind: FluidKind, amount: u8) {
+        let Some(i) = self.cell_of(x, y) else {
+            return;
+        };
+        let f = self.front;
+        let (plane, other) = match kind {
+            FluidKind::Water => (&mut self.water[f], &self.lava[f]),
+            FluidKind::Lava => (&mut self.lava[f], &self.water[f]),
+        };
+        if self.open[i] == 0 || other[i] != 0 {
+            return;
+        }
+        plane[i] = plane[i].saturating_add(amount);
+        if kind == FluidKind::Lava {
+            self.temp[f][i] = self.temp[f][i].max(LAVA_TEMP);
+        }
+        self.touch(x as usize, y as usize);
+    }
+
+    /// Set a tile's temperature
+    pub fn set_temp(&mut self, x: i32, y: i32, temp: i16) {
+        if let Some(i) = self.cell_of(x, y) {
+            self.temp[self.front][i] = temp;
+            self.touch(x as usize, y as usize);
+        }
+    }
+
+    /// Add a source that feeds its tile every step
+    pub fn add_source(&mut self, source: FluidSource) {
+        self.sources.push(source);
+    }
+
+    pub fn sources(&self) -> &[FluidSource] {
+        &self.sources
+    }
+
+    /// Step every chunk next time, e.g. to time the worst case
+    pub fn wake_all(&mut self) {
+        self.changed.fill(true);
+    }
+
+    fn touch(&mut self, x: usize, y: usize) {
+        self.changed[(y / CHUNK) * self.chunks_x + x / CHUNK] = true;
+    }
+
+    /// Pick up tiles that changed on the map since the last step
+    /// A map of the same size but another epoch was swapped in, so every
+    /// chunk is read again; fluid already on the grid stays
+    fn sync_map(&mut self, map: &GameMap) {
+        if (map.width as usize, map.height as usize) != (self.width, self.height) {
+            *self = Self::from_map(map).with_interval(self.interval);
+            return;
+        }
+        let swapped = map.epoch() != self.map_epoch;
+        if !swapped && map.version() == self.map_version {
+            return;
+        }
+        let chunks: Vec<(i32, i32)> = if swapped {
+            (0..map.chunks_y())
+                .flat_map(|cy| (0..map.chunks_x()).map(move |cx| (cx, cy)))
+                .collect()
+        } else {
+            map.changed_chunks_since(self.map_version).collect()
+        };
+        for (cx, cy) in chunks {
+            let (cx, cy) = (cx as usize, cy as usize);
+            for y in cy * CHUNK..((cy + 1) * CHUNK).min(self.height) {
+                for x in cx * CHUNK..((cx + 1) * CHUNK).min(self.width) {
+                    let i = self.cell(x, y);
+                    self.open[i] = (map.get_tile(x as i32, y as i32) != Some(TileKind::Wall)) as u8;
+                }
+            }
+            self.changed[cy * self.chunks_x + cx] = true;
+        }
+        self.map_epoch = map.epoch();
+        self.map_version = map.version();
+    }
+
+    /// Advance the simulation by one step
+    pub fn step(&mut self, map: &GameMap) {
+        self.sync_map(map);
+        for k in 0..self.sources.len() {
+            let s = self.sources[k];
+            self.add(s.x, s.y, s.kind, s.rate);
+        }
+        self.wake();
+
+        let (f, b) = (self.front, 1 - self.front);
+        let stride = self.stride;
+        let spans = self.awake_spans();
+        let [w0, w1] = &mut self.water;
+        let (water, water_next) = if f == 0 { (&*w0, w1) } else { (&*w1, w0) };
+        let [l0, l1] = &mut self.lava;
+        let (lava, lava_next) = if f == 0 { (&*l0, l1) } else { (&*l1, l0) };
+        let [t0, t1] = &mut self.temp;
+        let (temp, temp_next) = if f == 0 { (&*t0, t1) } else { (&*t1, t0) };
+
+        let start = |y: usize, x: usize| (y + 1) * stride + x + 1;
+        // Lava reads where water went, and heat where lava went, so each
+        // rule finishes every span before the next one starts
+        for &(y, x0, x1) in &spans {
+            let (at, len) = (start(y, x0), x1 - x0);
+            spread::<WATER_DIV>(water, water_next, &self.open, lava, stride, at, len);
+        }
+        for &(y, x0, x1) in &spans {
+            let (at, len) = (start(y, x0), x1 - x0);
+            spread::<LAVA_DIV>(lava, lava_next, &self.open, water_next, stride, at, len);
+        }
+        for &(y, x0, x1) in &spans {
+            let (at, len) = (start(y, x0), x1 - x0);
+            conduct(temp, temp_next, &self.inside, lava_next, stride, at, len);
+            boil(&mut water_next[at..at + len], &temp_next[at..at + len]);
+        }
+
+        self.changed.fill(false);
+        for &(y, x0, x1) in &spans {
+            for cx in x0 / CHUNK..x1.div_ceil(CHUNK) {
+                let a = start(y, cx * CHUNK);
+                let z = start(y, ((cx + 1) * CHUNK).min(x1));
+                let differs = water[a..z] != water_next[a..z]
+                    || lava[a..z] != lava_next[a..z]
+                    || temp[a..z] != temp_next[a..z];
+                if differs {
+                    self.changed[(y / CHUNK) * self.chunks_x + cx] = true;
+                }
+            }
+        }
+        self.front = b;
+        self.stats.steps += 1;
+        self.stats.tiles = spans.iter().map(|&(_, x0, x1)| x1 - x0).sum();
+    }
+
+    /// Awake chunks are changed chunks and their 8 neighbours
+    fn wake(&mut self) {
+        let (cw, ch) = (self.chunks_x, self.chunks_y);
+        self.awake.fill(false);
+        for cy in 0..ch {
+            for cx in 0..cw {
+                if !self.changed[cy * cw + cx] {
+                    continue;
+                }
+                for ny in cy.saturating_sub(1)..(cy + 2).min(ch) {
+                    for nx in cx.saturating_sub(1)..(cx + 2).min(cw) {
+                        self.awake[ny * cw + nx] = true;
+                    }
+                }
+            }
+        }
+        self.stats.awake_chunks = self.awake.iter().filter(|&&a| a).count();
+    }
+
+    /// `(y, x0, x1)` of each run of awake tiles in a row, with neighbouring
+    /// awake chunks merged into one run
+    fn awake_spans(&self) -> Vec<(usize, usize, usize)> {
+        let mut spans = Vec::new();
+        if self.stats.awake_chunks == 0 {
+            return spans;
+        }
+        for cy in 0..self.chunks_y {
+            let row = &self.awake[cy * self.chunks_x..][..self.chunks_x];
+            let mut cx = 0;
+            while cx < self.chunks_x {
+                if !row[cx] {
+                    cx += 1;
+                    continue;
+                }
+                let first = cx;
+                while cx < self.chunks_x && row[cx] {
+                    cx += 1;
+                }
+                let (x0, x1) = (first * CHUNK, (cx * CHUNK).min(self.width));
+                let rows = cy * CHUNK..((cy + 1) * CHUNK).min(self.height);
+                spans.extend(rows.map(|y| (y, x0, x1)));
+            }
+        }
+        spans
+    }
+}
+
+/// `len` values of `plane` from `at`; fixed-length windows let the compiler
+/// drop bounds checks and vectorize the per-tile loops
+fn window<T>(plane: &[T], at: usize, len: usize) -> &[T] {
+    &plane[at..at + len]
+}
+
+/// 1 if fluid may enter a tile: open, and free of the other fluid
+fn ok(open: u8, blocked: u8) -> i16 {
+    // `&` rather than `&&`: no branch, so the loops vectorize
+    ((open != 0) & (blocked == 0)) as i16
+}
+
+/// Move fluid between open neighbours over one row span
+fn spread<const DIV: i16>(
+    cur: &[u8],
+    next: &mut [u8],
+    open: &[u8],
+    blocked: &[u8],
+    stride: usize,
+    start: usize,
+    len: usize,
+) {
+    let offsets = [start, start - 1, start + 1, start - stride, start + stride];
+    let [c, l, r, u, d] = offsets.map(|at| window(cur, at, len));
+    let [oc, ol, or, ou, od] = offsets.map(|at| window(open, at, len));
+    let [bc, bl, br, bu, bd] = offsets.map(|at| window(blocked, at, len));
+    let next = &mut next[start..start + len];
+    for k in 0..len {
+        let here = ok(oc[k], bc[k]);
+        let cc = c[k] as i16;
+        let flow = |n: u8, on: i16| ((n as i16 - cc) / DIV) * (on & here);
+        let sum = flow(l[k], ok(ol[k], bl[k]))
+            + flow(r[k], ok(or[k], br[k]))
+            + flow(u[k], ok(ou[k], bu[k]))
+            + flow(d[k], ok(od[k], bd[k]));
+        next[k] = (cc + sum) as u8;
+    }
+}
+
+/// Conduct heat between map tiles over one row span, then pin lava tiles
+/// to at least `LAVA_TEMP`
+fn conduct(
+    cur: &[i16],
+    next: &mut [i16],
+    inside: &[u8],
+    lava: &[u8],
+    stride: usize,
+    start: usize,
+    len: usize,
+) {
+    let offsets = [start, start - 1, start + 1, start - stride, start + stride];
+    let [c, l, r, u, d] = offsets.map(|at| window(cur, at, len));
+    let [_, il, ir, iu, id] = offsets.map(|at| window(inside, at, len));
+    let lava = window(lava, start, len);
+    let next = &mut next[start..start + len];
+    for k in 0..len {
+        let tc = c[k] as i32;
+        let flow = |n: i16, on: u8| ((n as i32 - tc) / HEAT_DIV) * on as i32;
+        let sum = flow(l[k], il[k]) + flow(r[k], ir[k]) + flow(u[k], iu[k]) + flow(d[k], id[k]);
+        let t = (tc + sum) as i16;
+        next[k] = if lava[k] != 0 { t.max(LAVA_TEMP) } else { t };
+    }
+}
+
+/// Boil off water on tiles at or above `BOIL_POINT`
+fn boil(water: &mut [u8], temp: &[i16]) {
+    for (w, &t) in water.iter_mut().zip(temp) {
+        let boiling = (t >= BOIL_POINT && *w >= EVAP_THRESH) as u8;
+        *w -= BOIL_RATE * boiling;
+    }
+}
+
+/// Step the `FluidGrid` every `interval` ticks
+///
+/// Runs in the default schedule only while a `FluidGrid` resource exists.
+pub fn fluid_system(map: Res<GameMap>, time: Option<Res<Time>>, mut fluids: ResMut<FluidGrid>) {
+    let tick = time.map_or(0, |t| t.ticks);
+    if tick % fluids.interval.max(1) as u64 == 0 {
+        fluids.step(&map);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn planes(grid: &FluidGrid) -> Vec<(u8, u8, i16)> {
+        (0..grid.height() as i32)
+            .flat_map(|y| (0..grid.width() as i32).map(move |x| (x, y)))
+            .map(|(x, y)| (grid.water(x, y), grid.lava(x, y), grid.temp(x, y)))
+            .collect()
+    }
+
+    #[test]
+    fn water_spreads_without_losing_volume() {
+        let mut map = GameMap::new(40, 40);
+        for y in 0..40 {
+            map.set_tile(25, y, TileKind::Wall);
+        }
+        let mut grid = FluidGrid::from_map(&map);
+        for x in 10..13 {
+            grid.add(x, 20, FluidKind::Water, FULL);
+        }
+        let total = grid.total(FluidKind::Water);
+        for _ in 0..300 {
+            grid.step(&map);
+            assert_eq!(grid.total(FluidKind::Water), total);
+        }
+        assert!(grid.water(11, 16) > 0);
+        assert_eq!(grid.water(25, 20), 0);
+        assert_eq!(grid.water(30, 20), 0, "the wall holds");
+    }
+
+    #[test]
+    fn settled_chunks_sleep_and_skipping_them_is_exact() {
+        let mut map = GameMap::new(96, 64);
+        for x in 20..70 {
+            map.set_tile(x, 30, TileKind::Wall);
+        }
+        let mut lazy = FluidGrid::from_map(&map);
+        lazy.add(5, 5, FluidKind::Water, FULL);
+        lazy.add(80, 50, FluidKind::Lava, FULL);
+        lazy.add_source(FluidSource {
+            x: 40,
+            y: 10,
+            kind: FluidKind::Water,
+            rate: 3,
+        });
+        let mut eager = lazy.clone();
+        for step in 0..400 {
+            if step == 200 {
+                map.set_tile(40, 30, TileKind::Floor);
+            }
+            lazy.step(&map);
+            eager.wake_all();
+            eager.step(&map);
+            if step % 50 == 0 {
+                assert_eq!(planes(&lazy), planes(&eager), "step {step}");
+            }
+        }
+        assert_eq!(planes(&lazy), planes(&eager));
+        assert!(lazy.stats().awake_chunks < eager.stats().awake_chunks);
+    }
+
+    #[test]
+    fn a_swapped_map_of_the_same_size_is_read_again() {
+        let mut map = GameMap::new(40, 20);
+        for y in 0..20 {
+            map.set_tile(20, y, TileKind::Wall);
+        }
+        let mut grid = FluidGrid::from_map(&map);
+        grid.step(&map);
+
+        // Wall moved, and edited past the first map's version
+        let mut loaded = GameMap::new(40, 20);
+        for y in 0..20 {
+            loaded.set_tile(10, y, TileKind::Wall);
+        }
+        for x in 30..35 {
+            loaded.set_tile(x, 0, TileKind::Wall);
+        }
+        assert!(loaded.version() > map.version());
+        for y in 0..20 {
+            for x in 11..20 {
+                grid.add(x, y, FluidKind::Water, FULL);
+            }
+        }
+        for _ in 0..300 {
+            grid.step(&loaded);
+        }
+        assert!(grid.water(25, 10) > 0, "the old wall is gone");
+        assert_eq!(grid.water(5, 10), 0, "the new wall holds");
+    }
+
+    #[test]
+    fn a_still_pool_goes_to_sleep() {
+        let map = GameMap::new(64, 64);
+        let mut grid = FluidGrid::from_map(&map);
+        grid.add(3, 3, FluidKind::Water, 200);
+        for _ in 0..500 {
+            grid.step(&map);
+        }
+        assert_eq!(grid.changed_chunks(), 0);
+        grid.step(&map);
+        assert_eq!(grid.stats().awake_chunks, 0);
+        assert_eq!(grid.stats().tiles, 0);
+    }
+
+    #[test]
+    fn lava_heats_and_boils_water_but_never_mixes() {
+        let mut map = GameMap::new(32, 16);
+        map.set_tile(8, 8, TileKind::Lava);
+        let mut grid = FluidGrid::from_map(&map);
+        grid.add(11, 8, FluidKind::Water, FULL);
+        let total = grid.total(FluidKind::Water);
+        for _ in 0..300 {
+            grid.step(&map);
+            for y in 0..16 {
+                for x in 0..32 {
+                    assert!(grid.water(x, y) == 0 || grid.lava(x, y) == 0);
+                }
+            }
+        }
+        assert!(grid.temp(9, 8) > BOIL_POINT);
+        assert!(
+            grid.total(FluidKind::Water) < total,
+            "water next to the lava boils off"
+        );
+    }
+}
@@ -1,10 +1,13 @@
-use crate::world::{GameMap, TileKind};
+use crate::bitgrid::{BitGrid, SetBits};
+use crate::components::VisionRadius;
+use crate::world::{GameMap, Position, TileKind, CHUNK_SIZE};
 use bevy_ecs::entity::Entity;
 use bevy_ecs::prelude::*;
-use std::collections::{HashMap, HashSet};
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
 
 pub fn is_opaque(kind: TileKind) -> bool {
-    matches!(kind, TileKind::Wall)
+    kind.is_opaque()
 }
 
 // Bresenham line of sight check between two points, inclusive
@@ -16,17 +19,19 @@ pub fn los_visible(map: &GameMap, x0: i32, y0: i32, x1: i32, y1: i32) -> bool {
     let dy = -(y1 - y0).abs();
     let sy = if y0 < y1 { 1 } else { -1 };
     let mut err = dx + dy;
+    // With both ends on the map the whole line is, so the steps below can
+    // read the opacity plane without bounds checks
+    if !map.in_bounds(x0, y0) || !map.in_bounds(x1, y1) {
+        return false;
+    }
+    let opaque = map.opaque_plane();
     loop {
-        if let Some(i) = map.idx(x0, y0) {
-            if is_opaque(map.tiles[i]) && !(x0 == x1 && y0 == y1) {
-                return false;
-            }
-        } else {
-            return false;
-        }
         if x0 == x1 && y0 == y1 {
             break;
         }
+        if opaque.get(x0, y0) {
+            return false;
+        }
         let e2 = 2 * err;
         if e2 >= dy {
             err += dy;
@@ -40,39 +45,413 @@ pub fn los_visible(map: &GameMap, x0: i32, y0: i32, x1: i32, y1: i32) -> bool {
     true
 }
 
+/// Line-of-sight algorithm used by [`compute_visibility_system`]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum FovAlgorithm {
+    /// Symmetric shadowcasting: one pass per quadrant, each tile visited once
+    #[default]
+    Shadowcast,
+    /// A Bresenham ray to every tile of the `(2r+1)^2` square, O(r^3)
+    Bresenham,
+}
+
+/// Selects the FOV algorithm; worlds without this resource use the default
+#[derive(Resource, Debug, Clone, Copy, Default)]
+pub struct FovConfig {
+    pub algorithm: FovAlgorithm,
+}
+
+/// Call `reveal` for every tile within `radius` of `origin` that has a clear
+/// Bresenham line to it
+pub fn bresenham_fov(
+    map: &GameMap,
+    origin: (i32, i32),
+    radius: i32,
+    mut reveal: impl FnMut(i32, i32),
+) {
+    let (ox, oy) = origin;
+    for dy in -radius..=radius {
+        for dx in -radius..=radius {
+            let nx = ox + dx;
+            let ny = oy + dy;
+            if !map.in_bounds(nx, ny) {
+                continue;
+            }
+            if dx * dx + dy * dy <= radius * radius && los_visible(map, ox, oy, nx, ny) {
+                reveal(nx, ny);
+            }
+        }
+    }
+}
+
+// Slope as a fraction (numerator, denominator), denominator always positive
+type Slope = (i32, i32);
+
+// One row of a quadrant scan: tiles at `depth` between two slopes
+#[derive(Clone, Copy)]
+struct Row {
+    depth: i32,
+    start: Slope,
+    end: Slope,
+}
+
+impl Row {
+    // First column at or right of `start`, rounding ties towards the end
+    fn min_col(&self) -> i32 {
+        let (n, d) = self.start;
+        (2 * self.depth * n + d).div_euclid(2 * d)
+    }
+
+    // Last column at or left of `end`, rounding ties towards the start
+    fn max_col(&self) -> i32 {
+        let (n, d) = self.end;
+        -(d - 2 * self.depth * n).div_euclid(2 * d)
+    }
+
+    // A floor tile is revealed only if its centre lies inside the row's
+    // slopes, which keeps visibility symmetric between two viewers
+    fn is_symmetric(&self, col: i32) -> bool {
+        col * self.start.1 >= self.depth * self.start.0
+            && col * self.end.1 <= self.depth * self.end.0
+    }
+
+    fn next(&self) -> Row {
+        Row {
+            depth: self.depth + 1,
+            ..*self
+        }
+    }
+}
+
+// Slope to the left edge of the tile at (depth, col)
+fn slope(depth: i32, col: i32) -> Slope {
+    (2 * col - 1, 2 * depth)
+}
+
+// Map (depth, col) in quadrant `q` (north, east, south, west) to world tiles
+fn quadrant_tile(q: u8, (ox, oy): (i32, i32), depth: i32, col: i32) -> (i32, i32) {
+    match q {
+        0 => (ox + col, oy - depth),
+        1 => (ox + depth, oy + col),
+        2 => (ox + col, oy + depth),
+        _ => (ox - depth, oy + col),
+    }
+}
+
+// Symmetric shadowcasting (Albert Ford's formulation) over one quadrant
+fn scan_quadrant(
+    map: &GameMap,
+    origin: (i32, i32),
+    radius: i32,
+    q: u8,
+    mut row: Row,
+    reveal: &mut impl FnMut(i32, i32),
+) {
+    if row.depth > radius {
+        return;
+    }
+    // Previous tile in this row: None before the first, else Some(is_wall)
+    let mut prev: Option<bool> = None;
+    for col in row.min_col()..=row.max_col() {
+        let (x, y) = quadrant_tile(q, origin, row.depth, col);
+        // Tiles off the map block light; their shadows only fall off the map
+        let wall = map.is_opaque(x, y);
+        if map.in_bounds(x, y)
+            && col * col + row.depth * row.depth <= radius * radius
+            && (wall || row.is_symmetric(col))
+        {
+            reveal(x, y);
+        }
+        if prev == Some(true) && !wall {
+            row.start = slope(row.depth, col);
+        }
+        if prev == Some(false) && wall {
+            let mut next = row.next();
+            next.end = slope(row.depth, col);
+            scan_quadrant(map, origin, radius, q, next, reveal);
+        }
+        prev = Some(wall);
+    }
+    if prev == Some(false) {
+        scan_quadrant(map, origin, radius, q, row.next(), reveal);
+    }
+}
+
+/// Call `reveal` for every tile within `radius` of `origin` visible by
+/// symmetric shadowcasting. Walls are visible, like the Bresenham version, and
+/// on maps without walls both report exactly the same disk. Tiles on quadrant
+/// boundaries may be reported more than once.
+pub fn shadowcast_fov(
+    map: &GameMap,
+    origin: (i32, i32),
+    radius: i32,
+    mut reveal: impl FnMut(i32, i32),
+) {
+    if radius < 0 || !map.in_bounds(origin.0, origin.1) {
+        return;
+    }
+    reveal(origin.0, origin.1);
+    // A viewer inside a wall sees nothing else (as with `los_visible`)
+    if map.is_opaque(origin.0, origin.1) {
+        return;
+    }
+    for q in 0..4 {
+        let first = Row {
+            depth: 1,
+            start: (-1, 1),
+            end: (1, 1),
+        };
+        scan_quadrant(map, origin, radius, q, first, &mut reveal);
+    }
+}
+
+/// Run the selected FOV algorithm from `origin`
+pub fn visible_tiles(
+    map: &GameMap,
+    origin: (i32, i32),
+    radius: i32,
+    algorithm: FovAlgorithm,
+    reveal: impl FnMut(i32, i32),
+) {
+    match algorithm {
+        FovAlgorithm::Shadowcast => shadowcast_fov(map, origin, radius, reveal),
+        FovAlgorithm::Bresenham => bresenham_fov(map, origin, radius, reveal),
+    }
+}
+
+/// Visible tiles of one viewer as a bitset over its radius square
+///
+/// The window is clipped to the map and anchored at its top-left tile. Each
+/// row starts on a fresh `u64` word so rows can be OR-ed into a [`BitGrid`]
+/// a word at a time.
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct VisWindow {
+    /// Viewer position and radius the window was computed for
+    center: (i32, i32),
+    radius: i32,
+    x0: i32,
+    y0: i32,
+    width: i32,
+    height: i32,
+    /// Words per row
+    stride: usize,
+    bits: Vec<u64>,
+}
+
+impl VisWindow {
+    /// Empty window covering the radius square around `center`
+    pub fn new(map: &GameMap, center: (i32, i32), radius: i32) -> Self {
+        let mut window = Self::default();
+        window.reset(map, center, radius);
+        window
+    }
+
+    /// Re-anchor at `center` and clear every bit, reusing the allocation
+    pub fn reset(&mut self, map: &GameMap, center: (i32, i32), radius: i32) {
+        self.center = center;
+        self.radius = radius;
+        let radius = radius.max(0);
+        self.x0 = (center.0 - radius).max(0);
+        self.y0 = (center.1 - radius).max(0);
+        let x1 = (center.0 + radius).min(map.width as i32 - 1);
+        let y1 = (center.1 + radius).min(map.height as i32 - 1);
+        self.width = (x1 - self.x0 + 1).max(0);
+        self.height = (y1 - self.y0 + 1).max(0);
+        self.stride = (self.width as usize).div_ceil(64);
+        self.bits.clear();
+        self.bits.resize(self.stride * self.height as usize, 0);
+    }
+
+    /// Viewer position the window was last computed for
+    pub fn center(&self) -> (i32, i32) {
+        self.center
+    }
+
+    /// Vision radius the window was last computed for
+    pub fn radius(&self) -> i32 {
+        self.radius
+    }
+
+    /// True if any of the chunks `(cx, cy)` overlaps the window
+    fn touches_chunks(&self, chunks: &[(i32, i32)]) -> bool {
+        chunks.iter().any(|&(cx, cy)| {
+            let (cx0, cy0) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+            cx0 < self.x0 + self.width
+                && self.x0 < cx0 + CHUNK_SIZE
+                && cy0 < self.y0 + self.height
+                && self.y0 < cy0 + CHUNK_SIZE
+        })
+    }
+
+    /// Top-left tile and size `(x0, y0, width, height)` of the window
+    pub fn bounds(&self) -> (i32, i32, i32, i32) {
+        (self.x0, self.y0, self.width, self.height)
+    }
+
+    /// Word index and bit of a tile, or None outside the window
+    fn bit(&self, x: i32, y: i32) -> Option<(usize, u32)> {
+        let (dx, dy) = (x - self.x0, y - self.y0);
+        if dx < 0 || dy < 0 || dx >= self.width || dy >= self.height {
+            return None;
+        }
+        let word = dy as usize * self.stride + dx as usize / 64;
+        Some((word, (dx % 64) as u32))
+    }
+
+    /// Mark a tile visible; tiles outside the window are ignored
+    pub fn insert(&mut self, x: i32, y: i32) {
+        if let Some((w, b)) = self.bit(x, y) {
+            self.bits[w] |= 1 << b;
+        }
+    }
+
+    /// Whether `tile` is visible
+    pub fn contains(&self, tile: &(i32, i32)) -> bool {
+        self.bit(tile.0, tile.1)
+            .is_some_and(|(w, b)| self.bits[w] & (1 << b) != 0)
+    }
+
+    /// Number of visible tiles
+    pub fn len(&self) -> usize {
+        self.bits.iter().map(|w| w.count_ones() as usize).sum()
+    }
+
+    /// True if nothing is visible
+    pub fn is_empty(&self) -> bool {
+        self.bits.iter().all(|&w| w == 0)
+    }
+
+    /// Iterate over the visible tiles in row-major order
+    pub fn iter(&self) -> impl Iterator<Item = (i32, i32)> + '_ {
+        let stride = self.stride.max(1);
+        self.bits.iter().enumerate().flat_map(move |(i, &word)| {
+            let (row, col) = (i / stride, (i % stride) * 64);
+            SetBits(word).map(move |bit| (self.x0 + (col + bit) as i32, self.y0 + row as i32))
+        })
+    }
+
+    /// OR this window into a map-sized grid, one word at a time
+    pub fn merge_into(&self, grid: &mut BitGrid) {
+        // A window built for a different (smaller) map cannot be merged
+        let fits = (self.x0 + self.width) as u32 <= grid.width()
+            && (self.y0 + self.height) as u32 <= grid.height();
+        if self.width == 0 || !fits {
+            return;
+        }
+        let grid_width = grid.width() as usize;
+        for (row, words) in self.bits.chunks_exact(self.stride).enumerate() {
+            let start = (self.y0 as usize + row) * grid_width + self.x0 as usize;
+            grid.or_bits(start, words, self.width as usize);
+        }
+    }
+}
+
+/// Viewers recomputed versus reused by the last visibility update
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct FovStats {
+    /// Viewers whose window was recomputed
+    pub recomputed: usize,
+    /// Viewers whose window was still valid and kept as-is
+    pub skipped: usize,
+}
+
+/// Per-viewer visibility plus map-wide summaries, kept up to date by
+/// [`compute_visibility_system`]
 #[derive(Resource, Default, Debug, Clone)]
 pub struct Visibility {
-    pub per_entity: HashMap<Entity, HashSet<(i32, i32)>>,
+    /// Visible tiles of each viewer
+    pub per_entity: HashMap<Entity, VisWindow>,
+    /// Tiles visible to at least one viewer on the last update
+    pub visible: BitGrid,
+    /// Tiles that have ever been visible to any viewer
+    pub explored: BitGrid,
+    /// Recompute counters of the last update, for profiling
+    pub stats: FovStats,
+    /// Map epoch, version and algorithm the windows were last brought up to
+    /// date with
+    synced: Option<(u64, u64, FovAlgorithm)>,
 }
 
+impl Visibility {
+    /// Force every window to be recomputed on the next update
+    /// Needed after writing the map's tiles directly; a replaced `GameMap`
+    /// has another epoch and is noticed without it
+    pub fn invalidate(&mut self) {
+        self.synced = None;
+    }
+}
+
+/// Incrementally update [`Visibility`]
+///
+/// A viewer's window is recomputed only if its `Position` or `VisionRadius`
+/// changed, or a tile inside its window changed since the last run (via the
+/// map's chunk versions). Switching algorithm or map size recomputes all of
+/// them. Idle viewers in an unchanged area cost one check each.
 pub fn compute_visibility_system(
     map: Res<GameMap>,
     mut vis: ResMut<Visibility>,
-    q: Query<(
-        Entity,
-        &crate::world::Position,
-        Option<&crate::components::VisionRadius>,
-    )>,
+    config: Option<Res<FovConfig>>,
+    q: Query<(Entity, Ref<Position>, Option<Ref<VisionRadius>>)>,
 ) {
-    let mut per = HashMap::new();
+    let algorithm = config.map(|c| c.algorithm).unwrap_or_default();
+    let vis = &mut *vis;
+
+    let before = vis.per_entity.len();
+    vis.per_entity.retain(|e, _| q.contains(*e));
+    let mut union_stale = vis.per_entity.len() != before;
+
+    // Map swap or algorithm switch invalidates everything; otherwise only the
+    // chunks edited since the last run can affect a window
+    let resized = !vis.visible.has_size(map.width, map.height);
+    // Another epoch means a different map was swapped in
+    let full = resized
+        || !vis
+            .synced
+            .is_some_and(|(epoch, _, a)| a == algorithm && epoch == map.epoch());
+    let dirty_chunks: Vec<(i32, i32)> = match vis.synced {
+        Some((_, version, _)) if !full && version != map.version() => {
+            map.changed_chunks_since(version).collect()
+        }
+        _ => Vec::new(),
+    };
+    vis.synced = Some((map.epoch(), map.version(), algorithm));
+    if resized {
+        vis.visible.reset(map.width, map.height);
+        vis.explored.reset(map.width, map.height);
+    }
+    union_stale |= full;
+
+    let mut stats = FovStats::default();
     for (e, pos, vr) in q.iter() {
-        let mut visible = HashSet::new();
-        let r = vr.map(|v| v.0).unwrap_or(8);
-        for dy in -r..=r {
-            for dx in -r..=r {
-                let nx = pos.0 + dx;
-                let ny = pos.1 + dy;
-                if !map.in_bounds(nx, ny) {
-                    continue;
-                }
-                if (dx * dx + dy * dy) as f32 <= (r as f32 * r as f32)
-                    && los_visible(&map, pos.0, pos.1, nx, ny)
-                {
-                    visible.insert((nx, ny));
-                }
-            }
+        let r = vr.as_ref().map(|v| v.0).unwrap_or(8);
+        let (window, added) = match vis.per_entity.entry(e) {
+            Entry::Occupied(o) => (o.into_mut(), false),
+            Entry::Vacant(v) => (v.insert(VisWindow::default()), true),
+        };
+        // The radius check also catches a removed VisionRadius (default 8)
+        let stale = full
+            || added
+            || pos.is_changed()
+            || vr.as_ref().is_some_and(|v| v.is_changed())
+            || window.radius() != r
+            || window.touches_chunks(&dirty_chunks);
+        if !stale {
+            stats.skipped += 1;
+            continue;
+        }
+        stats.recomputed += 1;
+        window.reset(&map, (pos.0, pos.1), r);
+        visible_tiles(&map, (pos.0, pos.1), r, algorithm, |x, y| {
+            window.insert(x, y)
+        });
+    }
+    vis.stats = stats;
+
+    if union_stale || stats.recomputed > 0 {
+        vis.visible.clear();
+        for window in vis.per_entity.values() {
+            window.merge_into(&mut vis.visible);
         }
-        per.insert(e, visible);
+        vis.explored.union_with(&vis.visible);
     }
-    vis.per_entity = per;
 }
@@ -0,0 +1,331 @@
+//! Incremental world state hash for cheap determinism checks
+//!
+//! `WorldHash` combines a sum of per-tile hashes with a sum of per-entity
+//! hashes, so it stays current by rehashing only what changed: map chunks
+//! whose `GameMap` chunk version moved, and entities whose `Position`,
+//! `AssignedJob`, `Inventory` or `ItemStack` changed or was removed. `world_hash_system`
+//! appends the hash of every tick to a ring buffer, and `first_divergence`
+//! finds the first tick two runs disagree on by binary search.
+//!
+//! The mixing function is fixed (SplitMix64's finalizer), so equal states
+//! hash equal across builds, platforms and thread counts.
+
+use crate::components::{AssignedJob, Inventory, ItemStack};
+use crate::systems::Time;
+use crate::world::{GameMap, Position, TileKind, CHUNK_SIZE};
+use bevy_ecs::prelude::*;
+use std::collections::{HashMap, VecDeque};
+
+/// Ticks of history kept by `WorldHash::default`
+pub const DEFAULT_HISTORY: usize = 1024;
+
+/// Rolling hash of the tile map and the hashed components, with a
+/// per-tick history; insert it to enable `world_hash_system`
+#[derive(Resource, Debug, Clone)]
+pub struct WorldHash {
+    tiles: u64,
+    entities: u64,
+    /// Hash of every chunk, row-major over the chunk grid
+    chunk_hashes: Vec<u64>,
+    /// Map epoch and version the tile sum is current for; epoch 0 before
+    /// the first update
+    map: (u64, u64),
+    entity_hashes: HashMap<Entity, u64>,
+    /// `(tick, hash)` after each recorded tick, oldest first
+    history: VecDeque<(u64, u64)>,
+    capacity: usize,
+}
+
+impl Default for WorldHash {
+    fn default() -> Self {
+        Self::new(DEFAULT_HISTORY)
+    }
+}
+
+impl WorldHash {
+    /// Keep the hashes of the last `capacity` ticks (at least 1)
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            tiles: 0,
+            entities: 0,
+            chunk_hashes: Vec::new(),
+            map: (0, 0),
+            entity_hashes: HashMap::new(),
+            history: VecDeque::new(),
+            capacity: capacity.max(1),
+        }
+    }
+
+    /// Hash all of `world` now and record it for the current tick, keeping
+    /// `capacity` ticks like `new`
+    pub fn from_world(world: &mut World, capacity: usize) -> Self {
+        let mut hash = Self::new(capacity);
+        hash.update_map(world.resource::<GameMap>());
+        let mut q = world.query::<(Entity, Hashed)>();
+        for (entity, (p, j, i, s)) in q.iter(world) {
+            hash.update_entity(entity, entity_hash(entity, p, j, i, s));
+        }
+        hash.record(world.get_resource::<Time>().map_or(0, |t| t.ticks));
+        hash
+    }
+
+    /// Hash of the state as of the last update
+    pub fn current(&self) -> u64 {
+        self.tiles ^ mix(self.entities)
+    }
+
+    /// Recorded `(tick, hash)` pairs, oldest first
+    pub fn history(&self) -> impl Iterator<Item = (u64, u64)> + '_ {
+        self.history.iter().copied()
+    }
+
+    /// Hash recorded for `tick`, if it is still in the ring buffer
+    pub fn at(&self, tick: u64) -> Option<u64> {
+        let i = self.history.binary_search_by_key(&tick, |e| e.0).ok()?;
+        Some(self.history[i].1)
+    }
+
+    /// First tick held by both histories whose hashes differ
+    ///
+    /// Assumes runs never re-converge once they diverge, which holds for a
+    /// deterministic simulation, so it needs O(log n) comparisons.
+    pub fn first_divergence(&self, other: &WorldHash) -> Option<u64> {
+        let start = self.history.front()?.0.max(other.history.front()?.0);
+        let end = self.history.back()?.0.min(other.history.back()?.0);
+        let overlap: Vec<u64> = self
+            .history
+            .iter()
+            .map(|e| e.0)
+            .filter(|t| (start..=end).contains(t))
+            .collect();
+        let differs = |t: u64| self.at(t) != other.at(t);
+        let first = overlap.partition_point(|&t| !differs(t));
+        overlap.get(first).copied()
+    }
+
+    fn record(&mut self, tick: u64) {
+        if self.history.back().is_some_and(|e| e.0 >= tick) {
+            // Time went backwards (a reload); the old history no longer applies
+            self.history.clear();
+        }
+        if self.history.len() == self.capacity {
+            self.history.pop_front();
+        }
+        let hash = self.current();
+        self.history.push_back((tick, hash));
+    }
+
+    fn update_map(&mut self, map: &GameMap) {
+        let chunks_x = map.chunks_x();
+        let chunks = (chunks_x * map.chunks_y()) as usize;
+        // Another epoch means a different map was swapped in
+        let same_map = map.epoch() == self.map.0;
+        if same_map && map.version() == self.map.1 {
+            return;
+        }
+        if same_map {
+            for (cx, cy) in map.changed_chunks_since(self.map.1) {
+                let i = (cy * chunks_x + cx) as usize;
+                let new = chunk_hash(map, cx, cy);
+                self.tiles = self
+                    .tiles
+                    .wrapping_sub(self.chunk_hashes[i])
+                    .wrapping_add(new);
+                self.chunk_hashes[i] = new;
+            }
+        } else {
+            self.chunk_hashes = (0..chunks as i32)
+                .map(|i| chunk_hash(map, i % chunks_x, i / chunks_x))
+                .collect();
+            self.tiles = self
+                .chunk_hashes
+                .iter()
+                .fold(0, |sum, &h| sum.wrapping_add(h));
+        }
+        self.map = (map.epoch(), map.version());
+    }
+
+    fn update_entity(&mut self, entity: Entity, hash: u64) {
+        let old = if hash == 0 {
+            self.entity_hashes.remove(&entity)
+        } else {
+            self.entity_hashes.insert(entity, hash)
+        };
+        self.entities = self
+            .entities
+            .wrapping_sub(old.unwrap_or(0))
+            .wrapping_add(hash);
+    }
+}
+
+/// SplitMix64 finalizer
+fn mix(mut z: u64) -> u64 {
+    z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+    z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+    z ^ (z >> 31)
+}
+
+fn pack(x: i32, y: i32) -> u64 {
+    ((x as u32 as u64) << 32) | y as u32 as u64
+}
+
+fn tile_hash(x: i32, y: i32, kind: TileKind) -> u64 {
+    mix(mix(pack(x, y)) ^ kind as u64)
+}
+
+fn chunk_hash(map: &GameMap, cx: i32, cy: i32) -> u64 {
+    let (x0, y0) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+    let x1 = (x0 + CHUNK_SIZE).min(map.width as i32);
+    let y1 = (y0 + CHUNK_SIZE).min(map.height as i32);
+    let mut sum = 0u64;
+    for y in y0..y1 {
+        for x in x0..x1 {
+            if let Some(kind) = map.get_tile(x, y) {
+                sum = sum.wrapping_add(tile_hash(x, y, kind));
+            }
+        }
+    }
+    sum
+}
+
+/// Fold an optional word so that absent and present values differ
+fn fold(hash: u64, word: Option<u64>) -> u64 {
+    match word {
+        Some(w) => mix(mix(hash ^ 1) ^ w),
+        None => mix(hash),
+    }
+}
+
+/// Hash of one entity's hashed components; 0 if it has none of them
+fn entity_hash(
+    entity: Entity,
+    pos: Option<&Position>,
+    job: Option<&AssignedJob>,
+    inventory: Option<&Inventory>,
+    stack: Option<&ItemStack>,
+) -> u64 {
+    if pos.is_none() && job.is_none() && inventory.is_none() && stack.is_none() {
+        return 0;
+    }
+    let job = job.map(|j| {
+        j.0.map_or(0, |id| {
+            let v = id.0.as_u128();
+            mix(v as u64) ^ (v >> 64) as u64
+        })
+    });
+    let mut hash = mix(entity.to_bits());
+    hash = fold(hash, pos.map(|p| pack(p.0, p.1)));
+    hash = fold(hash, job);
+    hash = fold(hash, inventory.map(|i| i.0.map_or(0, Entity::to_bits)));
+    hash = fold(hash, stack.map(|s| s.0 as u64));
+    hash | 1
+}
+
+/// Query shape shared by the change scan and removal lookups
+type Hashed = (
+    Option<&'static Position>,
+    Option<&'static AssignedJob>,
+    Option<&'static Inventory>,
+    Option<&'static ItemStack>,
+);
+
+/// Bring `WorldHash` up to date and record it for the tick just finished
+///
+/// Runs last in the default schedule, and only while a `WorldHash`
+/// resource exists. The first run hashes everything.
+#[allow(clippy::too_many_arguments)]
+pub fn world_hash_system(
+    mut hash: ResMut<WorldHash>,
+    map: Res<GameMap>,
+    time: Option<Res<Time>>,
+    mut removed_positions: RemovedComponents<Position>,
+    mut removed_jobs: RemovedComponents<AssignedJob>,
+    mut removed_inventories: RemovedComponents<Inventory>,
+    mut removed_stacks: RemovedComponents<ItemStack>,
+    q_changed: Query<
+        (Entity, Hashed),
+        Or<(
+            Changed<Position>,
+            Changed<AssignedJob>,
+            Changed<Inventory>,
+            Changed<ItemStack>,
+        )>,
+    >,
+    q_all: Query<Hashed>,
+) {
+    hash.update_map(&map);
+    let removed = removed_positions
+        .read()
+        .chain(removed_jobs.read())
+        .chain(removed_inventories.read())
+        .chain(removed_stacks.read());
+    for entity in removed {
+        let h = q_all
+            .get(entity)
+            .map_or(0, |(p, j, i, s)| entity_hash(entity, p, j, i, s));
+        hash.update_entity(entity, h);
+    }
+    for (entity, (p, j, i, s)) in q_changed.iter() {
+        hash.update_entity(entity, entity_hash(entity, p, j, i, s));
+    }
+    hash.record(time.map_or(0, |t| t.ticks));
+}
+
+/// Hash `world` from scratch, the way a fresh `WorldHash` would see it
+pub fn full_world_hash(world: &mut World) -> u64 {
+    WorldHash::from_world(world, 1).current()
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn history(hashes: &[u64]) -> WorldHash {
+        let mut hash = WorldHash::new(4);
+        for (tick, &h) in hashes.iter().enumerate() {
+            hash.entities = h;
+            hash.record(tick as u64 + 1);
+        }
+        hash
+    }
+
+    #[test]
+    fn ring_buffer_keeps_the_latest_ticks() {
+        let hash = history(&[1, 2, 3, 4, 5, 6]);
+        let ticks: Vec<u64> = hash.history().map(|e| e.0).collect();
+        assert_eq!(ticks, [3, 4, 5, 6]);
+        assert_eq!(hash.at(2), None);
+        assert_eq!(hash.at(6), Some(mix(6)));
+    }
+
+    #[test]
+    fn divergence_is_the_first_differing_tick() {
+        let a = history(&[1, 2, 3, 4, 5]);
+        let b = history(&[1, 2, 3, 9, 9]);
+        assert_eq!(a.first_divergence(&b), Some(4));
+        assert_eq!(a.first_divergence(&a.clone()), None);
+        // Only ticks held by both count
+        let c = history(&[7, 2]);
+        assert_eq!(a.first_divergence(&c), None);
+    }
+
+    #[test]
+    fn swapped_map_is_hashed_from_scratch() {
+        let mut hash = WorldHash::new(4);
+        let mut map = GameMap::new(40, 40);
+        for x in 0..10 {
+            map.set_tile(x, 5, TileKind::Wall);
+        }
+        hash.update_map(&map);
+
+        // Edited past the first map's version, in another chunk only
+        let mut loaded = GameMap::new(40, 40);
+        for x in 0..12 {
+            loaded.set_tile(x, 30, TileKind::Water);
+        }
+        hash.update_map(&loaded);
+        let mut fresh = WorldHash::new(4);
+        fresh.update_map(&loaded);
+        assert_eq!(hash.tiles, fresh.tiles);
+    }
+}
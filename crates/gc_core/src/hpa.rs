@@ -0,0 +1,570 @@
+//! Hierarchical pathfinding (HPA*) over clustered map regions
+//!
+//! The map is cut into square clusters. Wherever two neighbouring clusters
+//! share a run of walkable border tiles, one or two transition points
+//! ("entrances") are placed on that run, and the walking distance between
+//! every pair of entrances inside a cluster is precomputed. A long query then
+//! searches this small abstract graph first and only refines each abstract
+//! hop with a flat A* restricted to a single cluster.
+//!
+//! Abstract paths are near-optimal rather than optimal: the route is forced
+//! through entrance points. Whenever the abstract search cannot prove a
+//! route (or start and goal share a cluster) the flat search is used, so the
+//! hierarchical mode never reports "no path" where the flat one would find one.
+
+use crate::path::{with_thread_scratch, AstarScratch, Bounds, PathResult};
+use crate::world::{GameMap, CHUNK_SIZE};
+use std::cmp::Reverse;
+use std::collections::{BinaryHeap, HashMap, VecDeque};
+
+/// Default edge length of a cluster in tiles
+pub const DEFAULT_CLUSTER_SIZE: i32 = 16;
+
+/// Border runs at least this long get an entrance at both ends instead of a
+/// single one in the middle, which keeps abstract paths closer to optimal
+const LONG_RUN: i32 = 6;
+
+/// Marker for "no path inside the cluster" in the distance matrix
+const UNREACHABLE: i32 = -1;
+
+/// Border transition as (tile inside the cluster, tile across the border)
+type Link = ((i32, i32), (i32, i32));
+
+/// Abstract graph node: a walkable border tile and the tiles it connects to
+/// across cluster borders (a corner tile can sit on two borders)
+#[derive(Debug, Clone)]
+struct Entrance {
+    pos: (i32, i32),
+    partners: Vec<(i32, i32)>,
+}
+
+/// Per-cluster abstract data, rebuilt independently of other clusters
+#[derive(Debug, Clone, Default)]
+struct Cluster {
+    entrances: Vec<Entrance>,
+    /// Row-major `n x n` in-cluster walking distances between entrances
+    dist: Vec<i32>,
+}
+
+/// Precomputed abstract graph for one `GameMap`
+///
+/// Build once with [`Hierarchy::build`] and query with [`Hierarchy::find_path`].
+/// After tiles change through `GameMap::set_tile`, [`Hierarchy::refresh`]
+/// rebuilds only the clusters overlapping changed chunks.
+#[derive(Debug, Clone)]
+pub struct Hierarchy {
+    cluster_size: i32,
+    width: u32,
+    height: u32,
+    clusters_x: i32,
+    clusters_y: i32,
+    clusters: Vec<Cluster>,
+    /// `GameMap::epoch` of the map the clusters were built from
+    epoch: u64,
+    /// `GameMap::version` the clusters are up to date with
+    version: u64,
+}
+
+impl Hierarchy {
+    /// Build the abstract graph for every cluster of `map`
+    pub fn build(map: &GameMap, cluster_size: i32) -> Self {
+        let cluster_size = cluster_size.max(2);
+        let clusters_x = (map.width as i32 + cluster_size - 1) / cluster_size;
+        let clusters_y = (map.height as i32 + cluster_size - 1) / cluster_size;
+        let mut h = Self {
+            cluster_size,
+            width: map.width,
+            height: map.height,
+            clusters_x,
+            clusters_y,
+            clusters: vec![Cluster::default(); (clusters_x * clusters_y) as usize],
+            epoch: map.epoch(),
+            version: map.version(),
+        };
+        for cy in 0..clusters_y {
+            for cx in 0..clusters_x {
+                h.build_cluster(map, cx, cy);
+            }
+        }
+        h
+    }
+
+    /// Edge length of a cluster in tiles
+    pub fn cluster_size(&self) -> i32 {
+        self.cluster_size
+    }
+
+    /// Whether this hierarchy can follow `map` by refreshing
+    ///
+    /// Needs the map instance it was built from: a map swapped in (e.g. by
+    /// a load) has another epoch, and its chunk versions say nothing about
+    /// what differs from the old one.
+    pub fn matches(&self, map: &GameMap) -> bool {
+        self.epoch == map.epoch()
+    }
+
+    /// Total number of abstract nodes across all clusters
+    pub fn node_count(&self) -> usize {
+        self.clusters.iter().map(|c| c.entrances.len()).sum()
+    }
+
+    /// Cluster coordinates containing tile (x, y)
+    pub fn cluster_of(&self, x: i32, y: i32) -> (i32, i32) {
+        (x / self.cluster_size, y / self.cluster_size)
+    }
+
+    /// Recompute cluster (cx, cy) and its four neighbours after tile changes
+    ///
+    /// Entrances on a shared border depend on tiles of both clusters, so the
+    /// neighbours must be refreshed together with the changed cluster.
+    pub fn rebuild_cluster(&mut self, map: &GameMap, cx: i32, cy: i32) {
+        for (nx, ny) in [
+            (cx, cy),
+            (cx - 1, cy),
+            (cx + 1, cy),
+            (cx, cy - 1),
+            (cx, cy + 1),
+        ] {
+            if nx >= 0 && ny >= 0 && nx < self.clusters_x && ny < self.clusters_y {
+                self.build_cluster(map, nx, ny);
+            }
+        }
+    }
+
+    /// Bring the graph up to date with tile changes made since the last build
+    /// or refresh, rebuilding only clusters that overlap changed chunks
+    ///
+    /// A map that no longer [`matches`](Self::matches) is rebuilt in full.
+    pub fn refresh(&mut self, map: &GameMap) {
+        if !self.matches(map) {
+            *self = Self::build(map, self.cluster_size);
+            return;
+        }
+        if map.version() == self.version {
+            return;
+        }
+        let mut dirty: Vec<(i32, i32)> = Vec::new();
+        for (chx, chy) in map.changed_chunks_since(self.version) {
+            let x0 = chx * CHUNK_SIZE;
+            let y0 = chy * CHUNK_SIZE;
+            let x1 = (x0 + CHUNK_SIZE).min(self.width as i32) - 1;
+            let y1 = (y0 + CHUNK_SIZE).min(self.height as i32) - 1;
+            for cy in y0 / self.cluster_size..=y1 / self.cluster_size {
+                for cx in x0 / self.cluster_size..=x1 / self.cluster_size {
+                    dirty.push((cx, cy));
+                    dirty.extend([(cx - 1, cy), (cx + 1, cy), (cx, cy - 1), (cx, cy + 1)]);
+                }
+            }
+        }
+        dirty.sort_unstable();
+        dirty.dedup();
+        for (cx, cy) in dirty {
+            if cx >= 0 && cy >= 0 && cx < self.clusters_x && cy < self.clusters_y {
+                self.build_cluster(map, cx, cy);
+            }
+        }
+        self.version = map.version();
+    }
+
+    fn bounds(&self, cx: i32, cy: i32) -> Bounds {
+        let min_x = cx * self.cluster_size;
+        let min_y = cy * self.cluster_size;
+        let max_x = ((cx + 1) * self.cluster_size).min(self.width as i32) - 1;
+        let max_y = ((cy + 1) * self.cluster_size).min(self.height as i32) - 1;
+        (min_x, min_y, max_x, max_y)
+    }
+
+    fn cluster_index(&self, cx: i32, cy: i32) -> usize {
+        (cy * self.clusters_x + cx) as usize
+    }
+
+    fn build_cluster(&mut self, map: &GameMap, cx: i32, cy: i32) {
+        let b = self.bounds(cx, cy);
+        let (min_x, min_y, max_x, max_y) = b;
+
+        // Transitions on all four borders; the same run detection runs from
+        // both sides of a border, so neighbouring clusters always agree
+        let mut links: Vec<Link> = Vec::new();
+        for (vertical, range, inside, outside) in [
+            (true, (min_y, max_y), max_x, max_x + 1),
+            (true, (min_y, max_y), min_x, min_x - 1),
+            (false, (min_x, max_x), max_y, max_y + 1),
+            (false, (min_x, max_x), min_y, min_y - 1),
+        ] {
+            scan_border(map, range, vertical, inside, outside, &mut links);
+        }
+
+        let mut entrances: Vec<Entrance> = Vec::new();
+        for (pos, partner) in links {
+            match entrances.iter_mut().find(|e| e.pos == pos) {
+                Some(e) => e.partners.push(partner),
+                None => entrances.push(Entrance {
+                    pos,
+                    partners: vec![partner],
+                }),
+            }
+        }
+
+        // All-pairs in-cluster distances via one BFS per entrance
+        let n = entrances.len();
+        let mut dist = vec![UNREACHABLE; n * n];
+        let mut scratch = Vec::new();
+        for i in 0..n {
+            let field = bfs_within(map, entrances[i].pos, b, &mut scratch);
+            for j in 0..n {
+                dist[i * n + j] = field_at(field, b, entrances[j].pos);
+            }
+        }
+
+        let idx = self.cluster_index(cx, cy);
+        self.clusters[idx] = Cluster { entrances, dist };
+    }
+
+    /// Find a path using the abstract graph, refining each hop locally
+    ///
+    /// Falls back to the flat [`crate::path::astar_path`] when start and goal
+    /// share a cluster, lie outside the map, or the abstract search finds no route.
+    pub fn find_path(&self, map: &GameMap, start: (i32, i32), goal: (i32, i32)) -> PathResult {
+        with_thread_scratch(|scratch| self.find_path_with(map, start, goal, scratch))
+    }
+
+    /// [`Hierarchy::find_path`] running its flat searches on caller-owned scratch
+    pub fn find_path_with(
+        &self,
+        map: &GameMap,
+        start: (i32, i32),
+        goal: (i32, i32),
+        scratch: &mut AstarScratch,
+    ) -> PathResult {
+        if !map.in_bounds(start.0, start.1) || !map.in_bounds(goal.0, goal.1) {
+            return scratch.search(map, start, goal, None);
+        }
+        let cs = self.cluster_of(start.0, start.1);
+        let cg = self.cluster_of(goal.0, goal.1);
+        if cs == cg || !map.is_walkable(goal.0, goal.1) {
+            return scratch.search(map, start, goal, None);
+        }
+        self.abstract_search(map, start, goal, cs, cg)
+            .and_then(|waypoints| self.refine(map, &waypoints, scratch))
+            .or_else(|| scratch.search(map, start, goal, None))
+    }
+
+    /// A* over entrance nodes; returns the abstract waypoints start..=goal
+    fn abstract_search(
+        &self,
+        map: &GameMap,
+        start: (i32, i32),
+        goal: (i32, i32),
+        cs: (i32, i32),
+        cg: (i32, i32),
+    ) -> Option<Vec<(i32, i32)>> {
+        // Temporary edges: start -> its cluster's entrances, goal cluster's entrances -> goal
+        let mut scratch = Vec::new();
+        let start_bounds = self.bounds(cs.0, cs.1);
+        let start_field = bfs_within(map, start, start_bounds, &mut scratch).to_vec();
+        let goal_bounds = self.bounds(cg.0, cg.1);
+        let goal_field = bfs_within(map, goal, goal_bounds, &mut scratch);
+
+        let start_cluster = &self.clusters[self.cluster_index(cs.0, cs.1)];
+        let goal_cluster = &self.clusters[self.cluster_index(cg.0, cg.1)];
+        let goal_links: Vec<((i32, i32), i32)> = goal_cluster
+            .entrances
+            .iter()
+            .map(|e| (e.pos, field_at(goal_field, goal_bounds, e.pos)))
+            .filter(|&(_, d)| d != UNREACHABLE)
+            .collect();
+        if goal_links.is_empty() {
+            return None;
+        }
+
+        let h = |p: (i32, i32)| (p.0 - goal.0).abs() + (p.1 - goal.1).abs();
+        let mut best: HashMap<(i32, i32), (i32, (i32, i32))> = HashMap::new();
+        let mut open = BinaryHeap::new();
+        best.insert(start, (0, start));
+        open.push(Reverse((h(start), 0, start)));
+
+        while let Some(Reverse((_, g, pos))) = open.pop() {
+            if pos == goal {
+                let mut path = vec![goal];
+                let mut cur = goal;
+                while cur != start {
+                    cur = best[&cur].1;
+                    path.push(cur);
+                }
+                path.reverse();
+                return Some(path);
+            }
+            if best.get(&pos).is_some_and(|&(bg, _)| g > bg) {
+                continue;
+            }
+
+            let mut relax = |next: (i32, i32), cost: i32| {
+                let ng = g + cost;
+                if best.get(&next).map_or(true, |&(bg, _)| ng < bg) {
+                    best.insert(next, (ng, pos));
+                    open.push(Reverse((ng + h(next), ng, next)));
+                }
+            };
+
+            if pos == start {
+                for e in &start_cluster.entrances {
+                    let d = field_at(&start_field, start_bounds, e.pos);
+                    if d != UNREACHABLE {
+                        relax(e.pos, d);
+                    }
+                }
+            }
+
+            let (cx, cy) = self.cluster_of(pos.0, pos.1);
+            let cluster = &self.clusters[self.cluster_index(cx, cy)];
+            let Some(i) = cluster.entrances.iter().position(|e| e.pos == pos) else {
+                continue;
+            };
+            let n = cluster.entrances.len();
+            for (j, other) in cluster.entrances.iter().enumerate() {
+                let d = cluster.dist[i * n + j];
+                if j != i && d != UNREACHABLE {
+                    relax(other.pos, d);
+                }
+            }
+            for &partner in &cluster.entrances[i].partners {
+                relax(partner, 1);
+            }
+            if (cx, cy) == cg {
+                if let Some(&(_, d)) = goal_links.iter().find(|(p, _)| *p == pos) {
+                    relax(goal, d);
+                }
+            }
+        }
+        None
+    }
+
+    /// Expand abstract waypoints into a concrete tile path
+    fn refine(
+        &self,
+        map: &GameMap,
+        waypoints: &[(i32, i32)],
+        scratch: &mut AstarScratch,
+    ) -> PathResult {
+        let mut path = vec![waypoints[0]];
+        let mut segment = Vec::new();
+        for pair in waypoints.windows(2) {
+            let (a, b) = (pair[0], pair[1]);
+            let ca = self.cluster_of(a.0, a.1);
+            if ca != self.cluster_of(b.0, b.1) {
+                // Inter-cluster hop between an entrance and its partner
+                path.push(b);
+                continue;
+            }
+            scratch.search_into(map, a, b, Some(self.bounds(ca.0, ca.1)), &mut segment)?;
+            path.extend_from_slice(&segment[1..]);
+        }
+        let cost = path.len() as i32 - 1;
+        Some((path, cost))
+    }
+}
+
+/// Find maximal runs along one cluster border where both the inside tile and
+/// the outside tile are walkable, emitting (inside, outside) transition pairs
+///
+/// For a vertical border the fixed coordinates are x values and `range` spans
+/// y; for a horizontal border the roles are swapped.
+fn scan_border(
+    map: &GameMap,
+    range: (i32, i32),
+    vertical: bool,
+    inside: i32,
+    outside: i32,
+    out: &mut Vec<Link>,
+) {
+    let at = |fixed: i32, t: i32| if vertical { (fixed, t) } else { (t, fixed) };
+    let mut emit = |t: i32| out.push((at(inside, t), at(outside, t)));
+    let mut run_start: Option<i32> = None;
+    for t in range.0..=range.1 + 1 {
+        let open = t <= range.1 && {
+            let (ax, ay) = at(inside, t);
+            let (bx, by) = at(outside, t);
+            map.is_walkable(ax, ay) && map.is_walkable(bx, by)
+        };
+        match (open, run_start) {
+            (true, None) => run_start = Some(t),
+            (false, Some(s)) => {
+                let e = t - 1;
+                if e - s + 1 >= LONG_RUN {
+                    emit(s);
+                    emit(e);
+                } else {
+                    emit((s + e) / 2);
+                }
+                run_start = None;
+            }
+            _ => {}
+        }
+    }
+}
+
+/// Breadth-first walking distances from `origin` restricted to `b`
+///
+/// Returns a row-major slice over the bounds with `UNREACHABLE` for tiles that
+/// cannot be reached without leaving the rectangle. The origin itself does not
+/// need to be walkable, matching the flat search semantics.
+fn bfs_within<'a>(
+    map: &GameMap,
+    origin: (i32, i32),
+    b: Bounds,
+    buf: &'a mut Vec<i32>,
+) -> &'a [i32] {
+    let (min_x, min_y, max_x, max_y) = b;
+    let w = max_x - min_x + 1;
+    let h = max_y - min_y + 1;
+    buf.clear();
+    buf.resize((w * h) as usize, UNREACHABLE);
+    let local = |p: (i32, i32)| ((p.1 - min_y) * w + (p.0 - min_x)) as usize;
+
+    let mut queue = VecDeque::new();
+    buf[local(origin)] = 0;
+    queue.push_back(origin);
+    while let Some((x, y)) = queue.pop_front() {
+        let d = buf[local((x, y))];
+        for (dx, dy) in [(1, 0), (-1, 0), (0, 1), (0, -1)] {
+            let (nx, ny) = (x + dx, y + dy);
+            if nx < min_x || ny < min_y || nx > max_x || ny > max_y {
+                continue;
+            }
+            let i = local((nx, ny));
+            if buf[i] == UNREACHABLE && map.is_walkable(nx, ny) {
+                buf[i] = d + 1;
+                queue.push_back((nx, ny));
+            }
+        }
+    }
+    buf
+}
+
+fn field_at(field: &[i32], b: Bounds, p: (i32, i32)) -> i32 {
+    let w = b.2 - b.0 + 1;
+    field[((p.1 - b.1) * w + (p.0 - b.0)) as usize]
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::path::astar_path;
+    use crate::world::TileKind;
+
+    fn maze(width: u32, height: u32) -> GameMap {
+        let mut map = GameMap::new(width, height);
+        // Long walls with alternating gaps force detours across clusters
+        for x in (8..width as i32).step_by(8) {
+            let gap = if (x / 8) % 2 == 0 {
+                1
+            } else {
+                height as i32 - 2
+            };
+            for y in 0..height as i32 {
+                if y != gap {
+                    map.set_tile(x, y, TileKind::Wall);
+                }
+            }
+        }
+        map
+    }
+
+    #[test]
+    fn hierarchical_path_is_valid_and_near_optimal() {
+        let map = maze(64, 48);
+        let h = Hierarchy::build(&map, 16);
+        let start = (1, 1);
+        let goal = (62, 46);
+
+        let (flat, flat_cost) = astar_path(&map, start, goal).expect("flat path");
+        let (path, cost) = h.find_path(&map, start, goal).expect("hierarchical path");
+
+        assert_eq!(path.first(), Some(&start));
+        assert_eq!(path.last(), Some(&goal));
+        assert_eq!(cost as usize, path.len() - 1);
+        for w in path.windows(2) {
+            let step = (w[0].0 - w[1].0).abs() + (w[0].1 - w[1].1).abs();
+            assert_eq!(step, 1, "path must be 4-connected");
+            assert!(map.is_walkable(w[1].0, w[1].1));
+        }
+        assert!(cost >= flat_cost);
+        assert!(
+            cost <= flat_cost + flat_cost / 4,
+            "{} vs {}",
+            cost,
+            flat.len()
+        );
+    }
+
+    #[test]
+    fn hierarchical_agrees_on_unreachable_goal() {
+        let mut map = GameMap::new(40, 40);
+        for x in 0..40 {
+            map.set_tile(x, 20, TileKind::Wall);
+        }
+        let h = Hierarchy::build(&map, 8);
+        assert!(h.find_path(&map, (1, 1), (30, 35)).is_none());
+    }
+
+    #[test]
+    fn rebuild_cluster_picks_up_new_openings() {
+        let mut map = GameMap::new(32, 32);
+        for y in 0..32 {
+            map.set_tile(16, y, TileKind::Wall);
+        }
+        let mut h = Hierarchy::build(&map, 16);
+        assert!(h.find_path(&map, (2, 2), (30, 2)).is_none());
+
+        map.set_tile(16, 2, TileKind::Floor);
+        h.rebuild_cluster(&map, 1, 0);
+        let (_, cost) = h.find_path(&map, (2, 2), (30, 2)).expect("opened wall");
+        assert_eq!(cost, 28);
+    }
+
+    #[test]
+    fn refresh_follows_map_versions() {
+        let mut map = GameMap::new(48, 48);
+        let mut h = Hierarchy::build(&map, 16);
+        let before = h.node_count();
+
+        // Wall off the border between clusters (0,0) and (1,0)
+        for y in 0..16 {
+            map.set_tile(16, y, TileKind::Wall);
+        }
+        h.refresh(&map);
+        assert!(h.node_count() < before);
+        let (path, _) = h.find_path(&map, (2, 2), (30, 2)).expect("detour");
+        assert!(path.iter().all(|&(x, y)| map.is_walkable(x, y)));
+
+        // Nothing changed since the last refresh: no work, same graph
+        let nodes = h.node_count();
+        h.refresh(&map);
+        assert_eq!(h.node_count(), nodes);
+    }
+
+    #[test]
+    fn swapped_map_of_the_same_size_is_rebuilt() {
+        let mut map = GameMap::new(48, 48);
+        for y in 0..16 {
+            map.set_tile(16, y, TileKind::Wall);
+        }
+        let mut h = Hierarchy::build(&map, 16);
+
+        // A loaded map with other walls, edited past the old one's version
+        let mut swapped = GameMap::new(48, 48);
+        for x in 20..40 {
+            swapped.set_tile(x, 40, TileKind::Wall);
+        }
+        assert!(swapped.version() > map.version());
+        assert!(!h.matches(&swapped));
+        h.refresh(&swapped);
+        assert!(h.matches(&swapped));
+        let fresh = Hierarchy::build(&swapped, 16);
+        assert_eq!(h.node_count(), fresh.node_count());
+        assert_eq!(
+            h.find_path(&swapped, (2, 2), (30, 2)),
+            fresh.find_path(&swapped, (2, 2), (30, 2))
+        );
+    }
+}
@@ -1,8 +1,13 @@
-use crate::components::{AssignedJob, Item, ItemType};
+use crate::actions::{Action, ActionLog};
+use crate::assignment::{pair_workers, AssignmentConfig, AssignmentStrategy};
+use crate::components::{AssignedJob, Carriable, Inventory, Item, ItemStack, ItemType, Stone};
+use crate::spatial::SpatialIndex;
+use crate::systems::{in_entity_order, Time};
 use crate::world::{GameMap, Position, TileKind};
 use bevy_ecs::prelude::*;
-use rand::rngs::StdRng;
 use rand::Rng;
+use serde::{Deserialize, Serialize};
+use std::collections::{HashMap, HashSet, VecDeque};
 use uuid::Uuid;
 
 /// Job System for Goblin Camp
@@ -13,12 +18,12 @@ use uuid::Uuid;
 /// and then executed by specialized systems.
 /// Unique identifier for jobs using UUID
 /// Provides globally unique IDs that are deterministic when using seeded RNG
-#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash, Serialize, Deserialize)]
 pub struct JobId(pub Uuid);
 
 /// Enumeration of different job types that can be assigned to entities
 /// Each job type contains the specific parameters needed for execution
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub enum JobKind {
     /// Mining job to convert a wall tile to floor at specific coordinates
     /// Parameters: target coordinates (x, y) to mine
@@ -30,7 +35,7 @@ pub enum JobKind {
 
 /// A job with its unique identifier and specific task details
 /// Jobs are created on the job board and assigned to appropriate workers
-#[derive(Debug, Clone)]
+#[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Job {
     /// Unique identifier for this job
     pub id: JobId,
@@ -38,11 +43,183 @@ pub struct Job {
     pub kind: JobKind,
 }
 
+impl JobKind {
+    /// Queue this job waits in on the job board
+    pub fn category(&self) -> JobCategory {
+        match self {
+            JobKind::Mine { .. } => JobCategory::Mine,
+            JobKind::Haul { .. } => JobCategory::Haul,
+        }
+    }
+
+    /// Tile a worker has to get to: the mined tile or the pickup tile
+    pub fn location(&self) -> (i32, i32) {
+        match *self {
+            JobKind::Mine { x, y } => (x, y),
+            JobKind::Haul { from, .. } => from,
+        }
+    }
+}
+
+/// Job kinds without their parameters; each has its own JobBoard queue
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum JobCategory {
+    Mine,
+    Haul,
+}
+
+impl JobCategory {
+    /// Number of categories (and so of JobBoard queues)
+    pub const COUNT: usize = 2;
+
+    fn index(self) -> usize {
+        self as usize
+    }
+}
+
 /// Resource representing the global job board where unassigned jobs are stored
 /// Jobs are posted here by designation systems and taken by assignment systems
-/// Uses a Vec as a simple LIFO queue (last posted, first assigned)
+///
+/// Jobs are kept in posting order with a FIFO queue per `JobCategory`, so
+/// assignment pops the oldest job of a kind in O(1) and removal by `JobId`
+/// is O(1) through an id index. Removed jobs leave holes that are skipped
+/// lazily and compacted away once they outnumber the live jobs.
 #[derive(Resource, Default, Debug)]
-pub struct JobBoard(pub Vec<Job>);
+pub struct JobBoard {
+    /// Posted jobs in posting order; taken jobs leave a `None` hole
+    slots: VecDeque<Option<Job>>,
+    /// Posting sequence number of `slots[0]`
+    base: u64,
+    /// Sequence number of every job still on the board
+    index: HashMap<JobId, u64>,
+    /// Per-category sequence numbers in posting order; may hold taken jobs
+    queues: [VecDeque<u64>; JobCategory::COUNT],
+    /// Jobs still on the board per category
+    counts: [usize; JobCategory::COUNT],
+}
+
+impl JobBoard {
+    /// Post a job at the back of its category's queue
+    /// Re-posting an id already on the board replaces the old job
+    pub fn push(&mut self, job: Job) {
+        self.remove(job.id);
+        let seq = self.base + self.slots.len() as u64;
+        let category = job.kind.category().index();
+        self.index.insert(job.id, seq);
+        self.queues[category].push_back(seq);
+        self.counts[category] += 1;
+        self.slots.push_back(Some(job));
+    }
+
+    /// Number of jobs on the board
+    pub fn len(&self) -> usize {
+        self.index.len()
+    }
+
+    /// True if no jobs are waiting
+    pub fn is_empty(&self) -> bool {
+        self.index.is_empty()
+    }
+
+    /// Number of waiting jobs of one category
+    pub fn count(&self, category: JobCategory) -> usize {
+        self.counts[category.index()]
+    }
+
+    /// Whether a job is still waiting on the board
+    pub fn contains(&self, id: JobId) -> bool {
+        self.index.contains_key(&id)
+    }
+
+    /// Look up a waiting job by id
+    pub fn get(&self, id: JobId) -> Option<&Job> {
+        let seq = *self.index.get(&id)?;
+        self.slots[(seq - self.base) as usize].as_ref()
+    }
+
+    /// Iterate over waiting jobs in posting order
+    pub fn iter(&self) -> impl Iterator<Item = &Job> + '_ {
+        self.slots.iter().flatten()
+    }
+
+    /// Iterate over waiting jobs of one category in posting order
+    pub fn iter_category(&self, category: JobCategory) -> impl Iterator<Item = &Job> + '_ {
+        // Stale entries point at holes or at sequence numbers before `base`
+        self.queues[category.index()].iter().filter_map(|&seq| {
+            let slot = seq.checked_sub(self.base)? as usize;
+            self.slots.get(slot)?.as_ref()
+        })
+    }
+
+    /// Remove a waiting job by id
+    pub fn remove(&mut self, id: JobId) -> Option<Job> {
+        let seq = *self.index.get(&id)?;
+        self.take(seq)
+    }
+
+    /// Remove and return the oldest waiting job of a category
+    pub fn pop(&mut self, category: JobCategory) -> Option<Job> {
+        while let Some(seq) = self.queues[category.index()].pop_front() {
+            if let Some(job) = self.take(seq) {
+                return Some(job);
+            }
+        }
+        None
+    }
+
+    /// Remove and return the most recently posted job of any category
+    pub fn pop_newest(&mut self) -> Option<Job> {
+        // take() trims trailing holes, so the back slot is always live
+        let seq = (self.base + self.slots.len() as u64).checked_sub(1)?;
+        self.take(seq)
+    }
+
+    /// Take the job with sequence number `seq`, if it is still on the board
+    fn take(&mut self, seq: u64) -> Option<Job> {
+        let slot = seq.checked_sub(self.base)? as usize;
+        let job = self.slots.get_mut(slot)?.take()?;
+        self.index.remove(&job.id);
+        self.counts[job.kind.category().index()] -= 1;
+
+        while matches!(self.slots.front(), Some(None)) {
+            self.slots.pop_front();
+            self.base += 1;
+        }
+        while matches!(self.slots.back(), Some(None)) {
+            self.slots.pop_back();
+        }
+        // Sequence numbers past the end get reused, so drop their stale entries
+        let end = self.base + self.slots.len() as u64;
+        for queue in &mut self.queues {
+            while queue.back().is_some_and(|&s| s >= end) {
+                queue.pop_back();
+            }
+        }
+        if self.slots.len() > 2 * self.index.len() + 64 {
+            self.compact();
+        }
+        Some(job)
+    }
+
+    /// Drop holes and stale queue entries, keeping posting order
+    fn compact(&mut self) {
+        let slots = std::mem::take(&mut self.slots);
+        self.index.clear();
+        self.queues.iter_mut().for_each(VecDeque::clear);
+        self.counts = [0; JobCategory::COUNT];
+        for job in slots.into_iter().flatten() {
+            self.push(job);
+        }
+    }
+
+    /// Move the oldest job of a category to `active` and return its id
+    pub fn assign_next(&mut self, category: JobCategory, active: &mut ActiveJobs) -> Option<JobId> {
+        let job = self.pop(category)?;
+        let id = job.id;
+        active.jobs.insert(id, job);
+        Some(id)
+    }
+}
 
 /// Event emitted when an item should be spawned in the world
 /// Used to decouple item creation from the systems that trigger it (like mining)
@@ -67,80 +244,95 @@ pub struct ItemSpawnQueue {
 /// Add a new job to the job board with a deterministic UUID
 /// Uses the provided RNG to generate a reproducible job ID for deterministic simulation
 /// Returns the JobId for reference by other systems
-pub fn add_job(board: &mut ResMut<JobBoard>, kind: JobKind, rng: &mut StdRng) -> JobId {
+pub fn add_job(board: &mut ResMut<JobBoard>, kind: JobKind, rng: &mut impl Rng) -> JobId {
     // Generate deterministic UUID using job_rng stream
     let mut bytes = [0u8; 16];
     rng.fill(&mut bytes);
     let id = JobId(Uuid::from_bytes(bytes));
-    board.0.push(Job { id, kind });
+    board.push(Job { id, kind });
     id
 }
 
 /// Remove and return the next available job from the job board
-/// Uses LIFO ordering (last in, first out) for simplicity
+/// Uses LIFO ordering (last in, first out) across all job kinds
 /// Returns None if no jobs are available
 pub fn take_next_job(board: &mut ResMut<JobBoard>) -> Option<Job> {
-    board.0.pop()
+    board.pop_newest()
 }
 
 /// System that assigns available jobs to workers based on their capabilities
 /// Miners get mining jobs, Carriers get hauling jobs
-/// Only assigns one job per entity per system run to prevent over-assignment
+/// Every idle worker is considered in a single pass, in `Entity` order;
+/// `AssignmentConfig` picks whether jobs go out oldest-first (default) or to
+/// the nearest idle worker
 /// Jobs are moved from the JobBoard to ActiveJobs when assigned
+#[allow(clippy::type_complexity)]
 pub fn job_assignment_system(
     mut board: ResMut<JobBoard>,
     mut active_jobs: ResMut<ActiveJobs>,
+    config: Option<Res<AssignmentConfig>>,
+    map: Option<Res<GameMap>>,
     mut q_miners: Query<
-        &mut AssignedJob,
+        (Entity, (&mut AssignedJob, Option<&Position>)),
         (
             With<crate::components::Miner>,
             Without<crate::components::Carrier>,
         ),
     >,
     mut q_carriers: Query<
-        &mut AssignedJob,
+        (Entity, (&mut AssignedJob, Option<&Position>)),
         (
             With<crate::components::Carrier>,
             Without<crate::components::Miner>,
         ),
     >,
 ) {
-    // Assign mining jobs to miners
-    for mut assigned in q_miners.iter_mut() {
-        if assigned.0.is_none() {
-            // Find a mining job
-            if let Some(pos) = board
-                .0
-                .iter()
-                .position(|job| matches!(job.kind, JobKind::Mine { .. }))
-            {
-                let job = board.0.remove(pos);
-                let job_id = job.id;
-                // Store the job in active jobs for execution
-                active_jobs.jobs.insert(job_id, job);
-                assigned.0 = Some(job_id);
-                break; // Only assign one job per system run
-            }
-        }
+    if board.is_empty() {
+        return;
     }
+    let strategy = config.map(|c| c.strategy).unwrap_or_default();
+    let map = map.as_deref();
+    let (board, active_jobs) = (&mut *board, &mut *active_jobs);
+    let miners = workers(JobCategory::Mine, board, q_miners.iter_mut());
+    assign_category(board, active_jobs, JobCategory::Mine, strategy, map, miners);
+    let carriers = workers(JobCategory::Haul, board, q_carriers.iter_mut());
+    assign_category(
+        board,
+        active_jobs,
+        JobCategory::Haul,
+        strategy,
+        map,
+        carriers,
+    );
+}
 
-    // Assign hauling jobs to carriers
-    for mut assigned in q_carriers.iter_mut() {
-        if assigned.0.is_none() {
-            // Find a hauling job
-            if let Some(pos) = board
-                .0
-                .iter()
-                .position(|job| matches!(job.kind, JobKind::Haul { .. }))
-            {
-                let job = board.0.remove(pos);
-                let job_id = job.id;
-                // Store the job in active jobs for execution
-                active_jobs.jobs.insert(job_id, job);
-                assigned.0 = Some(job_id);
-                break; // Only assign one job per system run
-            }
-        }
+/// Workers in `Entity` order; none if no job of `category` is waiting, so
+/// a tick without such jobs does not sort them
+fn workers<T>(
+    category: JobCategory,
+    board: &JobBoard,
+    workers: impl Iterator<Item = (Entity, T)>,
+) -> impl Iterator<Item = T> {
+    let workers = match board.count(category) {
+        0 => Vec::new(),
+        _ => in_entity_order(workers),
+    };
+    workers.into_iter().map(|(_, worker)| worker)
+}
+
+/// Hand out jobs of one category with the configured strategy
+fn assign_category<'a>(
+    board: &mut JobBoard,
+    active_jobs: &mut ActiveJobs,
+    category: JobCategory,
+    strategy: AssignmentStrategy,
+    map: Option<&GameMap>,
+    workers: impl Iterator<Item = (Mut<'a, AssignedJob>, Option<&'a Position>)>,
+) {
+    if strategy == AssignmentStrategy::Greedy {
+        assign_idle_workers(board, active_jobs, category, workers.map(|(a, _)| a));
+    } else {
+        assign_by_distance(board, active_jobs, category, strategy, map, workers);
     }
 }
 
@@ -150,25 +342,73 @@ pub fn job_assignment_system(
 pub fn mining_job_assignment_system(
     mut board: ResMut<JobBoard>,
     mut active_jobs: ResMut<ActiveJobs>,
-    mut q_miners: Query<&mut AssignedJob, With<crate::components::Miner>>,
+    mut q_miners: Query<(Entity, &mut AssignedJob), With<crate::components::Miner>>,
 ) {
-    for mut assigned in q_miners.iter_mut() {
-        if assigned.0.is_none() {
-            // Look for a mining job specifically
-            if let Some(pos) = board
-                .0
-                .iter()
-                .position(|job| matches!(job.kind, JobKind::Mine { .. }))
-            {
-                let job = board.0.remove(pos);
-                let job_id = job.id;
-
-                // Store the job in active jobs for execution
-                active_jobs.jobs.insert(job_id, job);
-                assigned.0 = Some(job_id);
+    let miners = workers(JobCategory::Mine, &board, q_miners.iter_mut());
+    assign_idle_workers(&mut board, &mut active_jobs, JobCategory::Mine, miners);
+}
+
+/// Give each idle worker in order the oldest waiting job of `category`
+/// Stops as soon as the category's queue runs dry
+fn assign_idle_workers<'a>(
+    board: &mut JobBoard,
+    active_jobs: &mut ActiveJobs,
+    category: JobCategory,
+    workers: impl Iterator<Item = Mut<'a, AssignedJob>>,
+) {
+    if board.count(category) == 0 {
+        return;
+    }
+    for mut assigned in workers {
+        if assigned.0.is_some() {
+            continue;
+        }
+        let Some(job_id) = board.assign_next(category, active_jobs) else {
+            break;
+        };
+        assigned.0 = Some(job_id);
+    }
+}
+
+/// Match idle workers with jobs of `category` by distance to the job location
+/// Workers without a Position take whatever is left, oldest first
+fn assign_by_distance<'a>(
+    board: &mut JobBoard,
+    active_jobs: &mut ActiveJobs,
+    category: JobCategory,
+    strategy: AssignmentStrategy,
+    map: Option<&GameMap>,
+    workers: impl Iterator<Item = (Mut<'a, AssignedJob>, Option<&'a Position>)>,
+) {
+    if board.count(category) == 0 {
+        return;
+    }
+    let mut placed = Vec::new();
+    let mut positions = Vec::new();
+    let mut unplaced = Vec::new();
+    for (assigned, pos) in workers {
+        if assigned.0.is_some() {
+            continue;
+        }
+        match pos {
+            Some(pos) => {
+                placed.push(assigned);
+                positions.push((pos.0, pos.1));
             }
+            None => unplaced.push(assigned),
+        }
+    }
+    let (ids, locations): (Vec<JobId>, Vec<(i32, i32)>) = board
+        .iter_category(category)
+        .map(|job| (job.id, job.kind.location()))
+        .unzip();
+    for (w, j) in pair_workers(strategy, map, &positions, &locations) {
+        if let Some(job) = board.remove(ids[j]) {
+            active_jobs.jobs.insert(job.id, job);
+            placed[w].0 = Some(ids[j]);
         }
     }
+    assign_idle_workers(board, active_jobs, category, unplaced.into_iter());
 }
 
 /// Resource to track active jobs being executed
@@ -177,46 +417,151 @@ pub fn mining_job_assignment_system(
 #[derive(Resource, Default, Debug)]
 pub struct ActiveJobs {
     /// Map of JobId to Job for quick lookup during execution
-    pub jobs: std::collections::HashMap<JobId, Job>,
+    pub jobs: HashMap<JobId, Job>,
+}
+
+/// Components of one loose stone item
+/// Items carry no `Name`; `ItemType::name` gives the shared label
+#[derive(Bundle)]
+pub struct StoneBundle {
+    pub item: Item,
+    pub stone: Stone,
+    pub pos: Position,
+    pub carriable: Carriable,
+}
+
+impl StoneBundle {
+    pub fn at(x: i32, y: i32) -> Self {
+        Self {
+            item: Item::stone(),
+            stone: Stone,
+            pos: Position(x, y),
+            carriable: Carriable,
+        }
+    }
+}
+
+/// How `process_item_spawn_queue_system` materializes requests
+#[derive(Resource, Debug, Clone, Copy, Default)]
+pub struct ItemSpawnConfig {
+    /// Merge items of one type on one tile into a single entity with an
+    /// `ItemStack` count, including loose items already lying there
+    pub stack: bool,
 }
 
 /// System that processes ItemSpawnQueue and creates actual item entities
 /// This system runs after job execution systems to create items from queued requests
 /// Decouples item creation from the systems that trigger it for better system ordering
+/// Requests are spawned in one batch per item type, in queue order; with
+/// `ItemSpawnConfig::stack` they are first merged per tile
 pub fn process_item_spawn_queue_system(
     mut commands: Commands,
     mut spawn_queue: ResMut<ItemSpawnQueue>,
+    config: Option<Res<ItemSpawnConfig>>,
+    index: Option<Res<SpatialIndex>>,
+    mut q_items: Query<(Entity, &Item, &Position, Option<&mut ItemStack>), With<Carriable>>,
+    q_inventories: Query<&Inventory>,
 ) {
-    for request in spawn_queue.requests.drain(..) {
-        let (x, y) = request.position;
-
-        match request.item_type {
-            ItemType::Stone => {
-                // Create a complete stone item entity with all necessary components
-                commands.spawn((
-                    Item {
-                        item_type: ItemType::Stone,
-                    },
-                    crate::components::Stone,
-                    crate::world::Position(x, y),
-                    crate::components::Carriable,
-                    crate::world::Name("Stone".to_string()),
-                ));
+    if spawn_queue.requests.is_empty() {
+        return;
+    }
+    let requests = std::mem::take(&mut spawn_queue.requests);
+    if !config.is_some_and(|c| c.stack) {
+        // Only stone exists today; each further type gets its own batch
+        let stones: Vec<StoneBundle> = requests
+            .iter()
+            .map(|r| match r.item_type {
+                ItemType::Stone => StoneBundle::at(r.position.0, r.position.1),
+            })
+            .collect();
+        commands.spawn_batch(stones);
+        return;
+    }
+
+    // Requests per (type, tile), in first-seen order
+    let mut order: Vec<(ItemType, (i32, i32))> = Vec::new();
+    let mut counts: HashMap<(ItemType, (i32, i32)), u32> = HashMap::new();
+    for r in &requests {
+        *counts.entry((r.item_type, r.position)).or_insert_with(|| {
+            order.push((r.item_type, r.position));
+            0
+        }) += 1;
+    }
+
+    // A loose item to merge into: same type, same tile, not being carried;
+    // the lowest entity wins so the choice does not depend on query order
+    let carried: HashSet<Entity> = q_inventories.iter().filter_map(|i| i.0).collect();
+    let mut targets: HashMap<(ItemType, (i32, i32)), Entity> = HashMap::new();
+    let mut consider = |e: Entity, item: &Item, pos: &Position| {
+        let key = (item.item_type, (pos.0, pos.1));
+        if counts.contains_key(&key) && !carried.contains(&e) {
+            let best = targets.entry(key).or_insert(e);
+            *best = (*best).min(e);
+        }
+    };
+    match index.as_deref() {
+        Some(index) => {
+            for &(_, (x, y)) in &order {
+                for e in index.entities_at(x, y) {
+                    if let Ok((e, item, pos, _)) = q_items.get(e) {
+                        consider(e, item, pos);
+                    }
+                }
+            }
+        }
+        None => {
+            for (e, item, pos, _) in q_items.iter() {
+                consider(e, item, pos);
+            }
+        }
+    }
+
+    let mut stones: Vec<(StoneBundle, ItemStack)> = Vec::new();
+    for key in order {
+        let (item_type, (x, y)) = key;
+        let mut remaining = counts[&key];
+        if let Some(&target) = targets.get(&key) {
+            if let Ok((_, _, _, stack)) = q_items.get_mut(target) {
+                let have = stack.as_ref().map_or(1, |s| s.0 as u32);
+                let merged = (have + remaining).min(u16::MAX as u32);
+                remaining -= merged - have;
+                match stack {
+                    Some(mut stack) => stack.0 = merged as u16,
+                    None => {
+                        commands.entity(target).insert(ItemStack(merged as u16));
+                    }
+                }
+            }
+        }
+        while remaining > 0 {
+            let n = remaining.min(u16::MAX as u32);
+            remaining -= n;
+            match item_type {
+                ItemType::Stone => stones.push((StoneBundle::at(x, y), ItemStack(n as u16))),
             }
         }
     }
+    commands.spawn_batch(stones);
 }
 
 /// System that executes mining jobs by converting Wall tiles to Floor and emitting ItemSpawn events
 /// This is the core mining execution system that performs the actual work of mining
 /// Miners with assigned Mine jobs will execute them here, modifying the world and creating items
+/// Completed jobs are recorded in the `ActionLog`, if there is one
 pub fn mine_job_execution_system(
     mut map: ResMut<GameMap>,
     mut item_spawn_queue: ResMut<ItemSpawnQueue>,
     mut active_jobs: ResMut<ActiveJobs>,
-    mut q_miners: Query<(&mut AssignedJob, &Position), With<crate::components::Miner>>,
+    mut log: Option<ResMut<ActionLog>>,
+    time: Option<Res<Time>>,
+    mut q_miners: Query<
+        (Entity, &mut AssignedJob),
+        (With<crate::components::Miner>, With<Position>),
+    >,
 ) {
-    for (mut assigned_job, _miner_pos) in q_miners.iter_mut() {
+    let tick = time.map_or(0, |t| t.ticks);
+    // Entity order fixes the order of spawn requests and log entries
+    for (worker, mut assigned_job) in in_entity_order(q_miners.iter_mut()) {
         if let Some(job_id) = assigned_job.0 {
             // Look up the job details from active jobs
             if let Some(job) = active_jobs.jobs.get(&job_id) {
@@ -235,6 +580,10 @@ pub fn mine_job_execution_system(
                     }
 
                     // Job is complete, clean up active job and clear assignment
+                    if let Some(log) = log.as_mut() {
+                        let job = job_id;
+                        log.log(tick, Action::Mined { worker, job, x, y });
+                    }
                     active_jobs.jobs.remove(&job_id);
                     assigned_job.0 = None;
                 }
@@ -245,3 +594,91 @@ pub fn mine_job_execution_system(
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn job(n: u128, kind: JobKind) -> Job {
+        Job {
+            id: JobId(Uuid::from_u128(n)),
+            kind,
+        }
+    }
+
+    fn mine(n: u128) -> Job {
+        job(n, JobKind::Mine { x: n as i32, y: 0 })
+    }
+
+    fn haul(n: u128) -> Job {
+        job(
+            n,
+            JobKind::Haul {
+                from: (0, 0),
+                to: (n as i32, 0),
+            },
+        )
+    }
+
+    fn ids(jobs: impl IntoIterator<Item = Job>) -> Vec<u128> {
+        jobs.into_iter().map(|j| j.id.0.as_u128()).collect()
+    }
+
+    #[test]
+    fn per_category_fifo_with_removal_by_id() {
+        let mut board = JobBoard::default();
+        for j in [mine(1), haul(2), mine(3), haul(4), mine(5)] {
+            board.push(j);
+        }
+        assert_eq!(board.count(JobCategory::Mine), 3);
+        assert_eq!(
+            board.remove(JobId(Uuid::from_u128(3))).map(|j| j.id),
+            Some(JobId(Uuid::from_u128(3)))
+        );
+        assert!(board.remove(JobId(Uuid::from_u128(3))).is_none());
+
+        let mines = std::iter::from_fn(|| board.pop(JobCategory::Mine));
+        assert_eq!(ids(mines), [1, 5]);
+        assert_eq!(ids(board.iter().cloned()), [2, 4]);
+        assert_eq!(ids(board.pop_newest()), [4]);
+        assert_eq!(board.len(), 1);
+        assert!(board.get(JobId(Uuid::from_u128(2))).is_some());
+    }
+
+    #[test]
+    fn reused_slots_do_not_leak_between_queues() {
+        let mut board = JobBoard::default();
+        board.push(mine(1));
+        board.push(mine(2));
+        assert_eq!(ids(board.pop_newest()), [2]);
+        // Reuses the sequence number job 2 had in the Mine queue
+        board.push(haul(3));
+        assert_eq!(
+            ids(std::iter::from_fn(|| board.pop(JobCategory::Mine))),
+            [1]
+        );
+        assert_eq!(ids(board.pop(JobCategory::Haul)), [3]);
+        assert!(board.is_empty());
+    }
+
+    #[test]
+    fn holes_are_compacted_in_posting_order() {
+        let mut board = JobBoard::default();
+        board.push(haul(0));
+        for n in 1..=1000 {
+            board.push(mine(n));
+        }
+        for n in (1..=1000).filter(|n| n % 10 != 0) {
+            assert!(board.remove(JobId(Uuid::from_u128(n))).is_some());
+        }
+        assert!(board.slots.len() <= 2 * board.len() + 64);
+        assert_eq!(board.count(JobCategory::Mine), 100);
+
+        let remaining: Vec<u128> = ids(board.iter().cloned());
+        let expected: Vec<u128> = std::iter::once(0).chain((10..=1000).step_by(10)).collect();
+        assert_eq!(remaining, expected);
+        let mines = std::iter::from_fn(|| board.pop(JobCategory::Mine));
+        assert_eq!(ids(mines), expected[1..]);
+        assert_eq!(ids(board.pop(JobCategory::Haul)), [0]);
+    }
+}
@@ -0,0 +1,507 @@
+//! Stacked z-levels joined by stairs, with level-aware pathfinding
+//!
+//! `LevelMap` holds `depth` levels of one `width` x `height` footprint. Each
+//! dug level is an ordinary chunk-laid `GameMap`, so a level's tiles form
+//! one contiguous slab and every 2D tool (FOV, 2D A*, HPA*) works on it
+//! unchanged. A level nobody has dug into is not allocated at all and reads
+//! as solid wall, so memory follows the levels in use rather than
+//! width x height x depth.
+//!
+//! A stair (or ramp; they behave the same) at `(x, y, z)` links that tile to
+//! `(x, y, z + 1)` and is usable while both ends are walkable. Searches plan
+//! on the level graph first: levels are nodes and usable stairs are edges.
+//! Since stairs only join neighbouring levels, every route visits each level
+//! between start and goal, so A* runs on that band alone and only widens to
+//! the rest of the connected levels when the band has no route. Unreachable
+//! goal levels are rejected without expanding a single tile.
+
+use crate::bitgrid::BitGrid;
+use crate::world::{GameMap, TileKind, TileLayout};
+use std::cmp::Reverse;
+use std::collections::BinaryHeap;
+
+/// Tile coordinates on a `LevelMap`: (x, y, z)
+pub type LevelPos = (i32, i32, i32);
+
+/// Result of a cross-level search
+///
+/// `Some((path, cost))` with the path including start and goal; every step,
+/// stairs included, costs 1
+pub type LevelPathResult = Option<(Vec<LevelPos>, i32)>;
+
+/// Moves in parent-link order: the four planar steps, then up and down
+const DIRS: [LevelPos; 6] = [
+    (1, 0, 0),
+    (-1, 0, 0),
+    (0, 1, 0),
+    (0, -1, 0),
+    (0, 0, 1),
+    (0, 0, -1),
+];
+
+/// `LevelScratch::offsets` marker for levels outside the searched band
+const UNALLOCATED: usize = usize::MAX;
+
+/// Open-list entry `(f, h, z, y, x)`
+type OpenEntry = Reverse<(u32, u32, i32, i32, i32)>;
+
+/// One dug level
+#[derive(Debug, Clone)]
+struct Level {
+    map: GameMap,
+    /// Tiles with a stair up to the level above
+    up: BitGrid,
+}
+
+/// Stack of `depth` levels sharing one footprint; see the module docs
+#[derive(Debug, Clone)]
+pub struct LevelMap {
+    width: u32,
+    height: u32,
+    /// Indexed by z; `None` until something is dug on that level
+    levels: Vec<Option<Level>>,
+}
+
+impl LevelMap {
+    /// A `depth`-level stack of solid rock; nothing is allocated yet
+    pub fn new(width: u32, height: u32, depth: u32) -> Self {
+        Self {
+            width,
+            height,
+            levels: vec![None; depth as usize],
+        }
+    }
+
+    /// Width of every level in tiles
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    /// Height of every level in tiles
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    /// Number of levels, dug or not
+    pub fn depth(&self) -> u32 {
+        self.levels.len() as u32
+    }
+
+    /// Check if `(x, y, z)` lies inside the stack
+    pub fn in_bounds(&self, x: i32, y: i32, z: i32) -> bool {
+        x >= 0
+            && y >= 0
+            && z >= 0
+            && (x as u32) < self.width
+            && (y as u32) < self.height
+            && (z as usize) < self.levels.len()
+    }
+
+    fn level(&self, z: i32) -> Option<&Level> {
+        usize::try_from(z)
+            .ok()
+            .and_then(|z| self.levels.get(z)?.as_ref())
+    }
+
+    /// Map of level `z`, if it has been dug
+    pub fn level_map(&self, z: i32) -> Option<&GameMap> {
+        self.level(z).map(|l| &l.map)
+    }
+
+    /// Map of level `z`, allocating it as solid wall if it was never dug
+    ///
+    /// Panics if `z` is outside the stack.
+    pub fn dig_level(&mut self, z: i32) -> &mut GameMap {
+        &mut self.dig(z).map
+    }
+
+    fn dig(&mut self, z: i32) -> &mut Level {
+        let (width, height) = (self.width, self.height);
+        self.levels[z as usize].get_or_insert_with(|| Level {
+            map: GameMap::from_tiles_with_layout(
+                width,
+                height,
+                vec![TileKind::Wall; (width * height) as usize],
+                TileLayout::Chunked,
+            ),
+            up: BitGrid::new(width, height),
+        })
+    }
+
+    /// Replace level `z` with `map`, which must match the footprint
+    ///
+    /// Stairs up from that level are kept.
+    pub fn insert_level(&mut self, z: i32, map: GameMap) {
+        assert_eq!(
+            (map.width, map.height),
+            (self.width, self.height),
+            "level does not match the stack footprint"
+        );
+        self.dig(z).map = map.to_layout(TileLayout::Chunked);
+    }
+
+    /// Number of allocated levels
+    pub fn dug_levels(&self) -> usize {
+        self.levels.iter().filter(|l| l.is_some()).count()
+    }
+
+    /// Tile at `(x, y, z)`; undug levels read as wall
+    pub fn get_tile(&self, x: i32, y: i32, z: i32) -> Option<TileKind> {
+        if !self.in_bounds(x, y, z) {
+            return None;
+        }
+        Some(match self.level(z) {
+            Some(l) => l.map.get_tile(x, y)?,
+            None => TileKind::Wall,
+        })
+    }
+
+    /// Set the tile at `(x, y, z)`, allocating its level when something
+    /// other than wall is written there
+    /// Returns true if the tile was in bounds
+    pub fn set_tile(&mut self, x: i32, y: i32, z: i32, kind: TileKind) -> bool {
+        if !self.in_bounds(x, y, z) {
+            return false;
+        }
+        if kind == TileKind::Wall && self.level(z).is_none() {
+            return true;
+        }
+        self.dig_level(z).set_tile(x, y, kind)
+    }
+
+    /// Whether `(x, y, z)` can be walked on
+    pub fn is_walkable(&self, x: i32, y: i32, z: i32) -> bool {
+        self.level(z).is_some_and(|l| l.map.is_walkable(x, y))
+    }
+
+    /// Place a stair from `(x, y, z)` up to `(x, y, z + 1)`
+    /// Returns false if either end lies outside the stack
+    pub fn add_stair(&mut self, x: i32, y: i32, z: i32) -> bool {
+        if !self.in_bounds(x, y, z) || !self.in_bounds(x, y, z + 1) {
+            return false;
+        }
+        self.dig(z).up.set(x, y, true);
+        true
+    }
+
+    /// Remove the stair from `(x, y, z)` up, if any
+    pub fn remove_stair(&mut self, x: i32, y: i32, z: i32) {
+        if let Some(Some(level)) = usize::try_from(z).ok().and_then(|z| self.levels.get_mut(z)) {
+            level.up.set(x, y, false);
+        }
+    }
+
+    /// Whether a stair leads up from `(x, y, z)`, usable or not
+    pub fn has_stair(&self, x: i32, y: i32, z: i32) -> bool {
+        self.level(z).is_some_and(|l| l.up.contains(x, y))
+    }
+
+    /// Stairs leading up from level `z`, row-major
+    pub fn stairs_up(&self, z: i32) -> impl Iterator<Item = (i32, i32)> + '_ {
+        self.level(z).into_iter().flat_map(|l| l.up.iter())
+    }
+
+    /// Stair up from `(x, y, z)` with both ends walkable
+    fn stair_usable(&self, x: i32, y: i32, z: i32) -> bool {
+        self.has_stair(x, y, z) && self.is_walkable(x, y, z) && self.is_walkable(x, y, z + 1)
+    }
+
+    /// Whether levels `z` and `z + 1` share at least one usable stair
+    ///
+    /// This is the edge set of the level graph.
+    pub fn levels_linked(&self, z: i32) -> bool {
+        self.stairs_up(z).any(|(x, y)| self.stair_usable(x, y, z))
+    }
+
+    /// Path from `start` to `goal` across levels
+    ///
+    /// Shortest among routes that stay within the levels between start and
+    /// goal; a detour through other levels is only taken when none exists.
+    pub fn find_path(&self, start: LevelPos, goal: LevelPos) -> LevelPathResult {
+        self.find_path_with(start, goal, &mut LevelScratch::default())
+    }
+
+    /// Same as [`LevelMap::find_path`], reusing `scratch` between searches
+    ///
+    /// Like `astar_path`, the start tile need not be walkable and the cost
+    /// is `path.len() - 1`.
+    pub fn find_path_with(
+        &self,
+        start: LevelPos,
+        goal: LevelPos,
+        scratch: &mut LevelScratch,
+    ) -> LevelPathResult {
+        scratch.reset_touched(self.levels.len());
+        if start == goal {
+            return Some((vec![start], 0));
+        }
+        if !self.is_walkable(goal.0, goal.1, goal.2) || !self.in_bounds(start.0, start.1, start.2) {
+            return None;
+        }
+        let (lo, hi) = (start.2.min(goal.2), start.2.max(goal.2));
+        if (lo..hi).any(|z| !self.levels_linked(z)) {
+            return None;
+        }
+        if let Some(found) = scratch.search(self, start, goal, (lo, hi)) {
+            return Some(found);
+        }
+        // Detours through levels beyond the band, out to the linked run
+        let mut band = (lo, hi);
+        while band.0 > 0 && self.levels_linked(band.0 - 1) {
+            band.0 -= 1;
+        }
+        while (band.1 as usize) + 1 < self.levels.len() && self.levels_linked(band.1) {
+            band.1 += 1;
+        }
+        if band == (lo, hi) {
+            return None;
+        }
+        scratch.search(self, start, goal, band)
+    }
+}
+
+/// Reusable working memory for [`LevelMap::find_path_with`]
+///
+/// Per-tile arrays cover only the allocated levels of the band being
+/// searched and are generation-stamped like `AstarScratch`, so repeated
+/// searches neither clear nor reallocate them once grown.
+#[derive(Debug, Default)]
+pub struct LevelScratch {
+    stamp: Vec<u32>,
+    g: Vec<u32>,
+    parent: Vec<u8>,
+    generation: u32,
+    open: BinaryHeap<OpenEntry>,
+    /// Start of each level's tiles in the per-tile arrays
+    offsets: Vec<usize>,
+    /// Levels that had at least one tile expanded in the last search
+    touched: Vec<bool>,
+}
+
+impl LevelScratch {
+    /// Levels the last search expanded tiles on, in ascending order
+    pub fn touched_levels(&self) -> impl Iterator<Item = i32> + '_ {
+        self.touched
+            .iter()
+            .enumerate()
+            .filter(|(_, &t)| t)
+            .map(|(z, _)| z as i32)
+    }
+
+    fn reset_touched(&mut self, depth: usize) {
+        self.touched.clear();
+        self.touched.resize(depth, false);
+    }
+
+    /// Lay out the per-tile arrays for levels `band` and start a generation
+    fn begin(&mut self, levels: &LevelMap, band: (i32, i32)) {
+        self.offsets.clear();
+        let mut len = 0;
+        for z in 0..levels.levels.len() as i32 {
+            match levels.level(z) {
+                Some(l) if (band.0..=band.1).contains(&z) => {
+                    self.offsets.push(len);
+                    len += l.map.tiles().len();
+                }
+                _ => self.offsets.push(UNALLOCATED),
+            }
+        }
+        if self.stamp.len() < len {
+            self.stamp.resize(len, 0);
+            self.g.resize(len, 0);
+            self.parent.resize(len, 0);
+        }
+        if self.generation == u32::MAX {
+            self.stamp.fill(0);
+            self.generation = 0;
+        }
+        self.generation += 1;
+        self.open.clear();
+    }
+
+    /// Slot of `(x, y, z)` in the per-tile arrays, if its level is searched
+    fn slot(&self, levels: &LevelMap, (x, y, z): LevelPos) -> Option<usize> {
+        let offset = *self.offsets.get(usize::try_from(z).ok()?)?;
+        if offset == UNALLOCATED {
+            return None;
+        }
+        Some(offset + levels.level(z)?.map.idx(x, y)?)
+    }
+
+    fn g_at(&self, i: usize) -> u32 {
+        if self.stamp[i] == self.generation {
+            self.g[i]
+        } else {
+            u32::MAX
+        }
+    }
+
+    /// A* over the levels in `band` (inclusive)
+    fn search(
+        &mut self,
+        levels: &LevelMap,
+        start: LevelPos,
+        goal: LevelPos,
+        band: (i32, i32),
+    ) -> LevelPathResult {
+        self.begin(levels, band);
+        let generation = self.generation;
+        let h = |(x, y, z): LevelPos| {
+            (x - goal.0).unsigned_abs() + (y - goal.1).unsigned_abs() + (z - goal.2).unsigned_abs()
+        };
+        if let Some(i) = self.slot(levels, start) {
+            self.stamp[i] = generation;
+            self.g[i] = 0;
+        }
+        let h0 = h(start);
+        self.open.push(Reverse((h0, h0, start.2, start.1, start.0)));
+
+        while let Some(Reverse((f, hc, z, y, x))) = self.open.pop() {
+            let g = f - hc;
+            if let Some(i) = self.slot(levels, (x, y, z)) {
+                if g > self.g_at(i) {
+                    continue;
+                }
+            }
+            self.touched[z as usize] = true;
+            if (x, y, z) == goal {
+                return Some((self.trace(levels, start, goal), g as i32));
+            }
+            for (d, &(dx, dy, dz)) in DIRS.iter().enumerate() {
+                let next = (x + dx, y + dy, z + dz);
+                let Some(ni) = self.slot(levels, next) else {
+                    continue;
+                };
+                let ng = g + 1;
+                if ng >= self.g_at(ni) {
+                    continue;
+                }
+                let passable = match dz {
+                    0 => levels.is_walkable(next.0, next.1, next.2),
+                    1 => levels.stair_usable(x, y, z),
+                    _ => levels.stair_usable(x, y, next.2),
+                };
+                if !passable {
+                    continue;
+                }
+                self.stamp[ni] = generation;
+                self.g[ni] = ng;
+                self.parent[ni] = d as u8;
+                let nh = h(next);
+                self.open
+                    .push(Reverse((ng + nh, nh, next.2, next.1, next.0)));
+            }
+        }
+        None
+    }
+
+    fn trace(&self, levels: &LevelMap, start: LevelPos, goal: LevelPos) -> Vec<LevelPos> {
+        let mut cur = goal;
+        let mut path = vec![cur];
+        while cur != start {
+            let i = self.slot(levels, cur).expect("traced tiles were searched");
+            let (dx, dy, dz) = DIRS[self.parent[i] as usize];
+            cur = (cur.0 - dx, cur.1 - dy, cur.2 - dz);
+            path.push(cur);
+        }
+        path.reverse();
+        path
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// Three 20x20 levels; a corridor along y = 5 on each, stairs at x = 2
+    /// (0 to 1) and x = 17 (1 to 2)
+    fn tower() -> LevelMap {
+        let mut levels = LevelMap::new(20, 20, 3);
+        for z in 0..3 {
+            for x in 0..20 {
+                levels.set_tile(x, 5, z, TileKind::Floor);
+            }
+        }
+        levels.add_stair(2, 5, 0);
+        levels.add_stair(17, 5, 1);
+        levels
+    }
+
+    fn check_steps(path: &[LevelPos], levels: &LevelMap) {
+        for w in path.windows(2) {
+            let (a, b) = (w[0], w[1]);
+            let step = (b.0 - a.0).abs() + (b.1 - a.1).abs() + (b.2 - a.2).abs();
+            assert_eq!(step, 1, "{a:?} -> {b:?}");
+            assert!(levels.is_walkable(b.0, b.1, b.2));
+            if b.2 != a.2 {
+                assert!(levels.has_stair(a.0, a.1, a.2.min(b.2)));
+            }
+        }
+    }
+
+    #[test]
+    fn undug_levels_cost_nothing_and_read_as_wall() {
+        let mut levels = LevelMap::new(64, 64, 50);
+        assert_eq!(levels.dug_levels(), 0);
+        assert_eq!(levels.get_tile(3, 3, 40), Some(TileKind::Wall));
+        assert!(levels.set_tile(3, 3, 40, TileKind::Wall));
+        assert_eq!(levels.dug_levels(), 0);
+        levels.set_tile(3, 3, 40, TileKind::Floor);
+        assert_eq!(levels.dug_levels(), 1);
+        assert!(levels.is_walkable(3, 3, 40));
+        assert_eq!(levels.get_tile(3, 3, 50), None);
+        assert!(!levels.add_stair(0, 0, 49));
+    }
+
+    #[test]
+    fn path_climbs_through_every_level_in_order() {
+        let levels = tower();
+        let (path, cost) = levels.find_path((0, 5, 0), (19, 5, 2)).unwrap();
+        assert_eq!(path.first(), Some(&(0, 5, 0)));
+        assert_eq!(path.last(), Some(&(19, 5, 2)));
+        assert_eq!(cost as usize, path.len() - 1);
+        // 2 east, up, 15 east, up, 2 east
+        assert_eq!(cost, 21);
+        check_steps(&path, &levels);
+        let back = levels.find_path((19, 5, 2), (0, 5, 0)).unwrap();
+        assert_eq!(back.1, cost);
+    }
+
+    #[test]
+    fn search_stays_on_the_band_unless_it_must_detour() {
+        let mut levels = tower();
+        for z in 3..6 {
+            levels.set_tile(0, 0, z, TileKind::Floor);
+        }
+        let mut scratch = LevelScratch::default();
+        levels
+            .find_path_with((0, 5, 0), (10, 5, 1), &mut scratch)
+            .unwrap();
+        assert_eq!(scratch.touched_levels().collect::<Vec<_>>(), [0, 1]);
+
+        // Break level 1 between its stairs; the route now runs over level 2
+        levels.set_tile(10, 5, 1, TileKind::Wall);
+        levels.add_stair(4, 5, 1);
+        let (path, _) = levels
+            .find_path_with((0, 5, 0), (19, 5, 1), &mut scratch)
+            .unwrap();
+        check_steps(&path, &levels);
+        assert!(path.iter().any(|p| p.2 == 2));
+        assert_eq!(scratch.touched_levels().collect::<Vec<_>>(), [0, 1, 2]);
+    }
+
+    #[test]
+    fn unlinked_levels_fail_without_searching() {
+        let mut levels = tower();
+        levels.set_tile(17, 5, 2, TileKind::Wall);
+        let mut scratch = LevelScratch::default();
+        assert!(!levels.levels_linked(1));
+        assert_eq!(
+            levels.find_path_with((0, 5, 0), (19, 5, 2), &mut scratch),
+            None
+        );
+        assert_eq!(scratch.touched_levels().count(), 0);
+        levels.remove_stair(2, 5, 0);
+        assert_eq!(levels.find_path((0, 5, 0), (5, 5, 1)), None);
+    }
+}
@@ -20,16 +20,31 @@
 //!
 //! ## Module Organization
 //!
+//! - [`actions`]: Typed, bounded log of what systems did, with a binary sink
 //! - [`components`]: All ECS components for entities and spatial data
 //! - [`systems`]: Core simulation systems and deterministic time management
 //! - [`jobs`]: Job board, assignment, and execution systems
+//! - [`assignment`]: Distance-aware matching of idle workers to jobs
 //! - [`world`]: Spatial representation, tiles, and map management
 //! - [`designations`]: Player input system for marking mining/construction areas
 //! - [`stockpiles`]: Storage zones and item organization systems
+//! - [`spatial`]: Bucketed tile-to-entity index kept in sync with positions
 //! - [`path`]: A* pathfinding with caching and obstacle avoidance
+//! - [`flow`]: Cached per-stockpile distance fields for many-to-one hauling
+//! - [`fluids`]: Cellular water, lava and temperature with sleeping settled chunks
+//! - [`hpa`]: Hierarchical (HPA*) abstract graph for long paths on large maps
+//! - [`levels`]: Stacked z-levels, allocated per dug level, with stair-aware paths
 //! - [`fov`]: Field-of-view and line-of-sight calculations
+//! - [`bitgrid`]: Dense one-bit-per-tile grids for map-wide tile sets
+//! - [`metrics`]: Per-tick phase timings and counters with CSV/JSON export
 //! - [`mapgen`]: Procedural terrain generation
+//! - [`stream`]: Lazily generated worlds that keep only touched chunks resident
 //! - [`save`]: World serialization and persistence
+//! - [`binsave`]: Compact binary save layout that validates and reads in place
+//! - [`snapshot`]: Full simulation state (RNG positions, jobs, workers) for exact resume
+//! - [`autosave`]: Base-plus-delta autosave log written on a background thread
+//! - [`hash`]: Incremental per-tick world hash for finding where runs diverge
+//! - [`replay`]: Tick-keyed input journal and checkpointed fast-forward replay
 //! - [`inventory`]: Item carrying and storage systems
 //!
 //! ## Usage Example
@@ -67,32 +82,11 @@
 //!
 //! // Run simulation steps
 //! for _ in 0..100 {
-//!     schedule.run(&mut world);
+//!     run_tick(&mut world, &mut schedule);
 //! }
 //! ```
 
-/// Action logging for lifecycle events and debugging
-/// Provides a centralized log for tracking significant simulation events
-/// such as job assignments, mining operations, and item movements
-#[derive(bevy_ecs::prelude::Resource, Default, Debug)]
-pub struct ActionLog {
-    /// Chronological list of logged events
-    pub events: Vec<String>,
-}
-
-impl ActionLog {
-    /// Add a new event to the log with automatic timestamping
-    /// Events are stored in chronological order
-    pub fn log(&mut self, event: String) {
-        self.events.push(event);
-    }
-
-    /// Clear all logged events
-    /// Useful for resetting between simulation runs or tests
-    pub fn clear(&mut self) {
-        self.events.clear();
-    }
-}
+pub use crate::actions::ActionLog;
 
 /// Convenience prelude module that re-exports commonly used types
 /// Import this module to get access to the most frequently used
@@ -103,16 +97,28 @@ impl ActionLog {
 /// // Now you have access to Position, GameMap, JobBoard, etc.
 /// ```
 pub mod prelude {
+    pub use crate::actions::{Action, ActionRecord};
+    pub use crate::assignment::{AssignmentConfig, AssignmentStrategy};
+    pub use crate::bitgrid::BitGrid;
     pub use crate::bootstrap::*;
     pub use crate::components::*;
     pub use crate::designations::*;
+    pub use crate::flow::{flow_field_system, FlowField, FlowFieldService};
+    pub use crate::fluids::{fluid_system, FluidGrid, FluidKind, FluidSource};
     pub use crate::fov::*;
+    pub use crate::hash::{world_hash_system, WorldHash};
     pub use crate::inventory::*;
     pub use crate::jobs::*;
+    pub use crate::levels::{LevelMap, LevelPos};
     pub use crate::mapgen::*;
+    pub use crate::metrics::{TickMetrics, TickSample};
     pub use crate::path::*;
+    pub use crate::replay::{InputEvent, InputJournal, ReplayRunner};
     pub use crate::save::*;
+    pub use crate::snapshot::{load_snapshot, save_snapshot, SimSnapshot};
+    pub use crate::spatial::{spatial_index_system, SpatialIndex};
     pub use crate::stockpiles::*;
+    pub use crate::stream::{StreamStats, StreamingMap};
     pub use crate::systems::*;
     pub use crate::world::*;
     pub use crate::ActionLog;
@@ -121,24 +127,54 @@ pub mod prelude {
 // Public module declarations
 // Each module contains related functionality for specific simulation aspects
 
+/// Typed action records in a fixed-capacity ring buffer
+pub mod actions;
+/// Nearest-worker job matching by spatial or walking distance
+pub mod assignment;
+/// Incremental autosave from per-chunk and per-entity changes
+pub mod autosave;
+/// Versioned binary save codec with run-length-encoded tiles
+pub mod binsave;
+/// Dense one-bit-per-tile grids with word-wide set operations
+pub mod bitgrid;
 /// ECS components for entities, spatial data, and game state
 pub mod components;
 /// Player designation system for marking areas for mining, construction, etc.
 pub mod designations;
+/// Flow fields (Dijkstra maps) toward stockpiles, repaired as tiles change
+pub mod flow;
+/// Double-buffered fluid and temperature planes stepped by active chunk
+pub mod fluids;
 /// Field-of-view and line-of-sight calculations
 pub mod fov;
+/// Rolling world state hash recorded per tick
+pub mod hash;
+/// Hierarchical pathfinding (HPA*) over clustered map regions
+pub mod hpa;
 /// Item carrying and inventory management systems
 pub mod inventory;
 /// Job board, assignment, and execution systems  
 pub mod jobs;
+/// Stacked z-levels with stairs and cross-level pathfinding
+pub mod levels;
 /// Procedural terrain and world generation
 pub mod mapgen;
+/// Tick profiler: phase time histograms and per-tick counters
+pub mod metrics;
 /// A* pathfinding with caching and optimization
 pub mod path;
+/// Input journals and headless replay with seekable checkpoints
+pub mod replay;
 /// World serialization and save/load functionality
 pub mod save;
+/// Complete simulation snapshots for deterministic save and resume
+pub mod snapshot;
+/// Uniform-grid spatial index from tiles to entities and zones
+pub mod spatial;
 /// Storage zones and item organization systems
 pub mod stockpiles;
+/// Chunk-by-chunk lazy world generation with eviction of untouched chunks
+pub mod stream;
 /// Core simulation systems and time management
 pub mod systems;
 /// Spatial world representation and tile management
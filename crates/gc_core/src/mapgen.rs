@@ -1,7 +1,13 @@
-use crate::world::{GameMap, TileKind};
-use noise::{Fbm, NoiseFn, Seedable};
+use crate::world::{GameMap, TileKind, CHUNK_SIZE};
+use noise::{Fbm, NoiseFn, Seedable, SuperSimplex};
+use std::thread;
 
-pub struct MapGenerator;
+/// Terrain generator; every tile is a pure function of the seed, the map
+/// size and its coordinates, so rows can be generated in any order and on
+/// any number of threads with bit-identical results
+pub struct MapGenerator {
+    threads: usize,
+}
 
 impl Default for MapGenerator {
     fn default() -> Self {
@@ -10,30 +16,86 @@ impl Default for MapGenerator {
 }
 
 impl MapGenerator {
+    /// Generator using every available core
     pub fn new() -> Self {
-        Self
+        Self::with_threads(thread::available_parallelism().map_or(1, |n| n.get()))
+    }
+
+    /// Generator using up to `threads` worker threads (at least 1)
+    pub fn with_threads(threads: usize) -> Self {
+        Self {
+            threads: threads.max(1),
+        }
+    }
+
+    /// Number of worker threads `generate` may use
+    pub fn threads(&self) -> usize {
+        self.threads
     }
 
     pub fn generate(&self, width: u32, height: u32, mapgen_seed: u32) -> GameMap {
-        let mut map = GameMap::new(width, height);
-        let fbm = Fbm::<noise::SuperSimplex>::new(0).set_seed(mapgen_seed);
-        for y in 0..height as i32 {
-            for x in 0..width as i32 {
-                let nx = x as f64 / width as f64 - 0.5;
-                let ny = y as f64 / height as f64 - 0.5;
-                let e = fbm.get([nx * 3.0, ny * 3.0]);
-                let kind = if e < -0.2 {
-                    TileKind::Water
-                } else if e > 0.6 {
-                    TileKind::Wall
-                } else {
-                    TileKind::Floor
-                };
-                if let Some(i) = map.idx(x, y) {
-                    map.tiles[i] = kind;
+        let fbm = terrain_noise(mapgen_seed);
+        let mut tiles = vec![TileKind::Floor; (width * height) as usize];
+        if width == 0 {
+            return GameMap::from_tiles(width, height, tiles);
+        }
+
+        // Split the rows into bands of whole chunk rows, one band per worker
+        let chunk_rows = (height as usize).div_ceil(CHUNK_SIZE as usize);
+        let threads = self.threads.min(chunk_rows);
+        let band_rows = chunk_rows.div_ceil(threads.max(1)) * CHUNK_SIZE as usize;
+        let band_len = band_rows * width as usize;
+        if threads <= 1 {
+            fill_rows(&fbm, width, height, 0, &mut tiles);
+        } else {
+            thread::scope(|scope| {
+                for (band, rows) in tiles.chunks_mut(band_len).enumerate() {
+                    let fbm = &fbm;
+                    scope.spawn(move || fill_rows(fbm, width, height, band * band_rows, rows));
                 }
-            }
+            });
+        }
+        GameMap::from_tiles(width, height, tiles)
+    }
+}
+
+/// Noise source behind every generated tile for `mapgen_seed`
+pub(crate) fn terrain_noise(mapgen_seed: u32) -> Fbm<SuperSimplex> {
+    Fbm::<SuperSimplex>::new(0).set_seed(mapgen_seed)
+}
+
+/// Terrain of one tile of a `width` x `height` map
+pub(crate) fn tile_at(
+    fbm: &Fbm<SuperSimplex>,
+    width: u32,
+    height: u32,
+    x: u32,
+    y: u32,
+) -> TileKind {
+    let nx = x as f64 / width as f64 - 0.5;
+    let ny = y as f64 / height as f64 - 0.5;
+    let e = fbm.get([nx * 3.0, ny * 3.0]);
+    if e < -0.2 {
+        TileKind::Water
+    } else if e > 0.6 {
+        TileKind::Wall
+    } else {
+        TileKind::Floor
+    }
+}
+
+/// Fill whole rows of row-major `tiles` starting at map row `first_row`
+fn fill_rows(
+    fbm: &Fbm<SuperSimplex>,
+    width: u32,
+    height: u32,
+    first_row: usize,
+    tiles: &mut [TileKind],
+) {
+    for (r, row) in tiles.chunks_mut(width as usize).enumerate() {
+        let y = (first_row + r) as u32;
+        for (x, tile) in row.iter_mut().enumerate() {
+            *tile = tile_at(fbm, width, height, x as u32, y);
         }
-        map
     }
 }
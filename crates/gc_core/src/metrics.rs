@@ -0,0 +1,421 @@
+//! Per-tick profiling: phase wall times, world size and subsystem counters
+//!
+//! With the `metrics` feature (on by default) `build_default_schedule`
+//! brackets every `SimSet` phase with timestamp systems. They only run in
+//! worlds that have a `TickMetrics` resource, and each tick adds one
+//! `TickSample` to a ring buffer and its phase times to per-phase
+//! histograms. Phases are the timing unit because the systems inside one
+//! run in parallel, so their individual wall times overlap. Without the
+//! feature the schedule carries no metrics systems at all.
+
+#[cfg(feature = "metrics")]
+use crate::fov::Visibility;
+#[cfg(feature = "metrics")]
+use crate::jobs::{ActiveJobs, JobBoard};
+#[cfg(feature = "metrics")]
+use crate::path::PathService;
+#[cfg(feature = "metrics")]
+use crate::systems::{SimSet, Time};
+use bevy_ecs::prelude::*;
+use serde::Serialize;
+use std::collections::VecDeque;
+use std::fmt::Write as _;
+use std::time::Instant;
+
+/// Ticks of history kept by `TickMetrics::default`
+pub const DEFAULT_HISTORY: usize = 600;
+/// Number of `SimSet` phases
+pub const PHASES: usize = 6;
+/// `SimSet` phases in run order, as used in exports
+pub const PHASE_NAMES: [&str; PHASES] = [
+    "input",
+    "designations",
+    "planning",
+    "execution",
+    "perception",
+    "cleanup",
+];
+
+/// What one tick cost and what the world looked like after it
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize)]
+pub struct TickSample {
+    /// `Time::ticks` after the tick
+    pub tick: u64,
+    /// Wall time from the first phase start to the end of the last phase
+    pub total_us: u64,
+    /// Wall time of each phase, in `PHASE_NAMES` order
+    pub phase_us: [u64; PHASES],
+    pub entities: u32,
+    /// Archetypes holding at least one entity
+    pub archetypes: u32,
+    /// Jobs waiting on the `JobBoard`
+    pub job_board: u32,
+    pub active_jobs: u32,
+    /// Cumulative `PathService` counters, if the world has one
+    pub path_hits: u64,
+    pub path_misses: u64,
+    /// `Visibility::stats` of this tick, if the world has FOV
+    pub fov_recomputed: u32,
+    pub fov_skipped: u32,
+}
+
+impl TickSample {
+    /// Share of path requests served from cache, if there were any
+    pub fn path_hit_rate(&self) -> Option<f64> {
+        let total = self.path_hits + self.path_misses;
+        (total > 0).then(|| self.path_hits as f64 / total as f64)
+    }
+}
+
+const BUCKETS: usize = 32;
+
+/// Histogram of microsecond durations in power-of-two buckets
+#[derive(Debug, Clone, Copy, Default)]
+pub struct Histogram {
+    /// Bucket `b > 0` counts durations in `[2^(b-1), 2^b)`; bucket 0 counts 0
+    buckets: [u64; BUCKETS],
+    count: u64,
+    total_us: u64,
+    max_us: u64,
+}
+
+impl Histogram {
+    pub fn record(&mut self, us: u64) {
+        let bucket = (64 - us.leading_zeros() as usize).min(BUCKETS - 1);
+        self.buckets[bucket] += 1;
+        self.count += 1;
+        self.total_us += us;
+        self.max_us = self.max_us.max(us);
+    }
+
+    pub fn count(&self) -> u64 {
+        self.count
+    }
+
+    pub fn mean_us(&self) -> f64 {
+        if self.count == 0 {
+            0.0
+        } else {
+            self.total_us as f64 / self.count as f64
+        }
+    }
+
+    pub fn max_us(&self) -> u64 {
+        self.max_us
+    }
+
+    /// Upper bound of the bucket holding quantile `q` (0..=1), capped at
+    /// the largest recorded value
+    pub fn percentile_us(&self, q: f64) -> u64 {
+        let rank = ((q.clamp(0.0, 1.0) * self.count as f64).ceil() as u64).max(1);
+        let mut seen = 0;
+        for (b, &n) in self.buckets.iter().enumerate() {
+            seen += n;
+            if seen >= rank {
+                let upper = if b == 0 { 0 } else { (1u64 << b) - 1 };
+                return upper.min(self.max_us);
+            }
+        }
+        self.max_us
+    }
+}
+
+/// Histogram digest for exports and panels
+#[derive(Debug, Clone, Serialize)]
+pub struct PhaseSummary {
+    pub name: &'static str,
+    pub count: u64,
+    pub mean_us: f64,
+    pub p50_us: u64,
+    pub p95_us: u64,
+    pub max_us: u64,
+}
+
+impl PhaseSummary {
+    fn new(name: &'static str, h: &Histogram) -> Self {
+        Self {
+            name,
+            count: h.count(),
+            mean_us: h.mean_us(),
+            p50_us: h.percentile_us(0.5),
+            p95_us: h.percentile_us(0.95),
+            max_us: h.max_us(),
+        }
+    }
+}
+
+/// Tick profiler state; insert it to enable the metrics systems
+#[derive(Resource, Debug, Clone)]
+pub struct TickMetrics {
+    history: VecDeque<TickSample>,
+    capacity: usize,
+    phases: [Histogram; PHASES],
+    ticks: Histogram,
+    /// Sample of the tick in progress
+    current: TickSample,
+    started: Option<Instant>,
+    last_mark: Option<Instant>,
+}
+
+impl Default for TickMetrics {
+    fn default() -> Self {
+        Self::new(DEFAULT_HISTORY)
+    }
+}
+
+impl TickMetrics {
+    /// Keep the samples of the last `capacity` ticks (at least 1)
+    pub fn new(capacity: usize) -> Self {
+        Self {
+            history: VecDeque::new(),
+            capacity: capacity.max(1),
+            phases: [Histogram::default(); PHASES],
+            ticks: Histogram::default(),
+            current: TickSample::default(),
+            started: None,
+            last_mark: None,
+        }
+    }
+
+    /// Samples in the ring buffer, oldest first
+    pub fn history(&self) -> impl Iterator<Item = &TickSample> + '_ {
+        self.history.iter()
+    }
+
+    pub fn latest(&self) -> Option<&TickSample> {
+        self.history.back()
+    }
+
+    /// Phase time histogram over every tick since the metrics were created
+    pub fn phase(&self, phase: usize) -> &Histogram {
+        &self.phases[phase]
+    }
+
+    /// Whole-tick time histogram
+    pub fn ticks(&self) -> &Histogram {
+        &self.ticks
+    }
+
+    /// One digest per phase plus a final `tick` row for whole ticks
+    pub fn summary(&self) -> Vec<PhaseSummary> {
+        let phases = PHASE_NAMES.iter().zip(&self.phases);
+        let mut rows: Vec<PhaseSummary> = phases.map(|(n, h)| PhaseSummary::new(n, h)).collect();
+        rows.push(PhaseSummary::new("tick", &self.ticks));
+        rows
+    }
+
+    /// The ring buffer as CSV, one row per tick
+    pub fn to_csv(&self) -> String {
+        let mut out = String::from("tick,total_us");
+        for name in PHASE_NAMES {
+            let _ = write!(out, ",{name}_us");
+        }
+        out.push_str(
+            ",entities,archetypes,job_board,active_jobs,path_hits,path_misses,fov_recomputed,fov_skipped\n",
+        );
+        for s in &self.history {
+            let _ = write!(out, "{},{}", s.tick, s.total_us);
+            for us in s.phase_us {
+                let _ = write!(out, ",{us}");
+            }
+            let _ = writeln!(
+                out,
+                ",{},{},{},{},{},{},{},{}",
+                s.entities,
+                s.archetypes,
+                s.job_board,
+                s.active_jobs,
+                s.path_hits,
+                s.path_misses,
+                s.fov_recomputed,
+                s.fov_skipped
+            );
+        }
+        out
+    }
+
+    /// Phase summaries and the ring buffer as JSON
+    pub fn to_json(&self) -> serde_json::Result<String> {
+        #[derive(Serialize)]
+        struct Export<'a> {
+            phases: Vec<PhaseSummary>,
+            samples: Vec<&'a TickSample>,
+        }
+        serde_json::to_string_pretty(&Export {
+            phases: self.summary(),
+            samples: self.history.iter().collect(),
+        })
+    }
+
+    #[cfg_attr(not(feature = "metrics"), allow(dead_code))]
+    fn begin(&mut self) {
+        let now = Instant::now();
+        self.current = TickSample::default();
+        self.started = Some(now);
+        self.last_mark = Some(now);
+    }
+
+    #[cfg_attr(not(feature = "metrics"), allow(dead_code))]
+    fn end_phase(&mut self, phase: usize) {
+        let now = Instant::now();
+        if let Some(last) = self.last_mark.replace(now) {
+            let us = now.duration_since(last).as_micros() as u64;
+            self.current.phase_us[phase] = us;
+            self.phases[phase].record(us);
+        }
+    }
+
+    #[cfg_attr(not(feature = "metrics"), allow(dead_code))]
+    fn finish(&mut self) {
+        if let Some(started) = self.started.take() {
+            self.current.total_us = self
+                .last_mark
+                .unwrap_or(started)
+                .duration_since(started)
+                .as_micros() as u64;
+            self.ticks.record(self.current.total_us);
+        }
+        if self.history.len() == self.capacity {
+            self.history.pop_front();
+        }
+        self.history.push_back(self.current);
+    }
+}
+
+#[cfg(feature = "metrics")]
+fn tick_start(mut metrics: ResMut<TickMetrics>) {
+    metrics.begin();
+}
+
+#[cfg(feature = "metrics")]
+fn phase_end<const P: usize>(mut metrics: ResMut<TickMetrics>) {
+    metrics.end_phase(P);
+}
+
+/// Exclusive so it can read the archetype table
+#[cfg(feature = "metrics")]
+fn tick_end(world: &mut World) {
+    let entities = world.entities().len();
+    let archetypes = world.archetypes().iter().filter(|a| !a.is_empty()).count() as u32;
+    let job_board = world.get_resource::<JobBoard>().map_or(0, |b| b.len()) as u32;
+    let active_jobs = world
+        .get_resource::<ActiveJobs>()
+        .map_or(0, |a| a.jobs.len()) as u32;
+    let path = world
+        .get_resource::<PathService>()
+        .map(|p| p.stats())
+        .unwrap_or_default();
+    let fov = world
+        .get_resource::<Visibility>()
+        .map(|v| v.stats)
+        .unwrap_or_default();
+    let tick = world.get_resource::<Time>().map_or(0, |t| t.ticks);
+
+    let mut metrics = world.resource_mut::<TickMetrics>();
+    let sample = &mut metrics.current;
+    sample.tick = tick;
+    sample.entities = entities;
+    sample.archetypes = archetypes;
+    sample.job_board = job_board;
+    sample.active_jobs = active_jobs;
+    sample.path_hits = path.hits as u64;
+    sample.path_misses = path.misses as u64;
+    sample.fov_recomputed = fov.recomputed as u32;
+    sample.fov_skipped = fov.skipped as u32;
+    metrics.finish();
+}
+
+/// Add the timestamp systems around every `SimSet` phase of `schedule`
+#[cfg(feature = "metrics")]
+pub fn instrument(schedule: &mut Schedule) {
+    schedule.add_systems(
+        (
+            tick_start.before(SimSet::Input),
+            phase_end::<0>
+                .after(SimSet::Input)
+                .before(SimSet::Designations),
+            phase_end::<1>
+                .after(SimSet::Designations)
+                .before(SimSet::Planning),
+            phase_end::<2>
+                .after(SimSet::Planning)
+                .before(SimSet::Execution),
+            phase_end::<3>
+                .after(SimSet::Execution)
+                .before(SimSet::Perception),
+            phase_end::<4>
+                .after(SimSet::Perception)
+                .before(SimSet::Cleanup),
+            (phase_end::<5>, tick_end).chain().after(SimSet::Cleanup),
+        )
+            .run_if(resource_exists::<TickMetrics>),
+    );
+}
+
+/// Live entities per archetype, largest first, named by their component
+/// types (module paths stripped)
+pub fn archetype_counts(world: &World) -> Vec<(String, usize)> {
+    let components = world.components();
+    let mut counts: Vec<(String, usize)> = world
+        .archetypes()
+        .iter()
+        .filter(|a| !a.is_empty())
+        .map(|a| {
+            let names: Vec<&str> = a
+                .components()
+                .filter_map(|id| components.get_info(id))
+                .map(|info| info.name().rsplit("::").next().unwrap_or(info.name()))
+                .collect();
+            (names.join("+"), a.len())
+        })
+        .collect();
+    counts.sort_by(|a, b| b.1.cmp(&a.1).then_with(|| a.0.cmp(&b.0)));
+    counts
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn histogram_percentiles_use_bucket_bounds() {
+        let mut h = Histogram::default();
+        for us in [0, 1, 3, 5, 6, 7, 100, 120, 130, 900] {
+            h.record(us);
+        }
+        assert_eq!(h.count(), 10);
+        assert_eq!(h.percentile_us(0.0), 0);
+        // Fifth value (6) sits in [4, 8)
+        assert_eq!(h.percentile_us(0.5), 7);
+        // 130 sits in [128, 256)
+        assert_eq!(h.percentile_us(0.9), 255);
+        assert_eq!(h.percentile_us(1.0), 900);
+        assert!((h.mean_us() - 127.2).abs() < 1e-9);
+    }
+
+    #[test]
+    fn history_is_a_ring_buffer_and_exports_every_row() {
+        let mut m = TickMetrics::new(3);
+        for tick in 1..=5 {
+            m.begin();
+            for phase in 0..PHASES {
+                m.end_phase(phase);
+            }
+            m.current.tick = tick;
+            m.finish();
+        }
+        let ticks: Vec<u64> = m.history().map(|s| s.tick).collect();
+        assert_eq!(ticks, [3, 4, 5]);
+        assert_eq!(m.phase(2).count(), 5);
+        assert_eq!(m.ticks().count(), 5);
+
+        let csv = m.to_csv();
+        assert_eq!(csv.lines().count(), 4);
+        assert!(csv.starts_with("tick,total_us,input_us,"));
+        let columns = csv.lines().next().unwrap().split(',').count();
+        assert!(csv.lines().all(|l| l.split(',').count() == columns));
+        let json: serde_json::Value = serde_json::from_str(&m.to_json().unwrap()).unwrap();
+        assert_eq!(json["samples"].as_array().unwrap().len(), 3);
+        assert_eq!(json["phases"][6]["name"], "tick");
+    }
+}
@@ -1,7 +1,15 @@
+use crate::hpa::{Hierarchy, DEFAULT_CLUSTER_SIZE};
 use crate::world::GameMap;
+use bevy_ecs::prelude::Resource;
 use lru::LruCache;
-use pathfinding::prelude::astar;
+use std::cell::RefCell;
+use std::cmp::Reverse;
+use std::collections::hash_map::Entry;
+use std::collections::{BinaryHeap, HashMap};
+use std::fmt;
 use std::num::NonZeroUsize;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::thread;
 
 // A* Pathfinding System with LRU Caching
 //
@@ -12,47 +20,310 @@ use std::num::NonZeroUsize;
 // Features:
 // - 4-directional movement (no diagonals)
 // - LRU cache to improve performance for repeated path requests
-// - Batch processing for multiple path calculations
+// - Batch processing for multiple path calculations, optionally multi-threaded
 // - Statistics tracking for cache hit/miss analysis
+// - Chunk-version validation so map edits evict only the paths they affect
+// - Optional hierarchical (HPA*) mode for long paths on large maps
+// - Allocation-free search: per-tile buffers are generation-stamped and reused
 
 // Type aliases and structures for pathfinding
 
 /// Result type for pathfinding operations
 ///
 /// Returns `Some((path_coords, total_cost))` on success, `None` if no path exists
-type PathResult = Option<(Vec<(i32, i32)>, i32)>;
+pub type PathResult = Option<(Vec<(i32, i32)>, i32)>;
+/// Inclusive tile rectangle a search may enter: (min_x, min_y, max_x, max_y)
+pub type Bounds = (i32, i32, i32, i32);
 /// Cache key combining start and goal coordinates: (start_x, start_y, goal_x, goal_y)
 type CacheKey = (i32, i32, i32, i32);
 /// LRU cache storing pathfinding results
-type PathCache = LruCache<CacheKey, PathResult>;
-
-/// Generate neighbors for A* pathfinding with 4-directional movement
-/// Only returns walkable neighboring tiles based on the game map
-/// Each neighbor has a movement cost of 1 (uniform cost grid)
-fn neighbors(map: &GameMap, x: i32, y: i32) -> Vec<((i32, i32), i32)> {
-    let mut n = Vec::with_capacity(4);
-    // 4-directional movement: right, left, down, up
-    let dirs = [(1, 0), (-1, 0), (0, 1), (0, -1)];
-    for (dx, dy) in dirs {
-        let nx = x + dx;
-        let ny = y + dy;
-        if map.is_walkable(nx, ny) {
-            n.push(((nx, ny), 1));
-        }
-    }
-    n
+type PathCache = LruCache<CacheKey, CachedPath>;
+
+/// Cached search result together with the map state it was computed against
+#[derive(Debug, Clone)]
+struct CachedPath {
+    result: PathResult,
+    /// `GameMap::epoch` of the map the path was computed on
+    epoch: u64,
+    /// `GameMap::version` when the path was computed
+    version: u64,
+    /// Flat indices of the chunks the path crosses, deduplicated
+    chunks: Vec<usize>,
+}
+
+impl CachedPath {
+    fn new(map: &GameMap, result: PathResult) -> Self {
+        let mut chunks: Vec<usize> = Vec::new();
+        if let Some((path, _)) = &result {
+            for &(x, y) in path {
+                if map.in_bounds(x, y) {
+                    chunks.push(map.chunk_index_of(x, y));
+                }
+            }
+            chunks.sort_unstable();
+            chunks.dedup();
+        }
+        Self {
+            result,
+            epoch: map.epoch(),
+            version: map.version(),
+            chunks,
+        }
+    }
+
+    /// A found path stays valid while no chunk it crosses has changed; it may
+    /// become suboptimal if a shortcut opens elsewhere, which is accepted.
+    /// "No path" can be fixed by an edit anywhere, so it is only valid while
+    /// the map is completely unchanged. Another epoch means a different map
+    /// was swapped in, which invalidates everything.
+    fn is_valid(&self, map: &GameMap) -> bool {
+        if map.epoch() != self.epoch {
+            return false;
+        }
+        match self.result {
+            Some(_) => self
+                .chunks
+                .iter()
+                .all(|&c| map.chunk_version(c) <= self.version),
+            None => map.version() == self.version,
+        }
+    }
+}
+
+/// Cache performance counters reported by [`PathService::stats`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct PathStats {
+    /// Requests served from a still-valid cache entry
+    pub hits: usize,
+    /// Requests with no cache entry at all
+    pub misses: usize,
+    /// Requests whose cache entry was evicted because its chunks changed
+    pub invalidations: usize,
+}
+
+/// 4-directional movement: right, left, down, up (uniform cost of 1)
+const DIRS: [(i32, i32); 4] = [(1, 0), (-1, 0), (0, 1), (0, -1)];
+
+/// Open-list entry `(f, h, x, y)`; ties on `f` go to the tile nearer the goal
+type OpenEntry = Reverse<(u32, u32, i32, i32)>;
+
+/// Reusable working memory for grid A*
+///
+/// g-scores and parent links live in flat per-tile arrays indexed by
+/// `GameMap::idx`. Every search bumps `generation`, and a tile whose stamp is
+/// older counts as unvisited, so nothing is cleared between searches. Once the
+/// arrays and the open heap have grown to fit the map, [`AstarScratch::search_into`]
+/// performs no heap allocation at all.
+#[derive(Default)]
+pub struct AstarScratch {
+    /// Search generation that last wrote each tile
+    stamp: Vec<u32>,
+    /// Best known cost from the start; only meaningful where `stamp` is current
+    g: Vec<u32>,
+    /// Index into `DIRS` of the step that reached each tile
+    parent: Vec<u8>,
+    /// Current search generation
+    generation: u32,
+    /// Open list; stale entries are skipped on pop instead of being removed
+    open: BinaryHeap<OpenEntry>,
+}
+
+impl fmt::Debug for AstarScratch {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.debug_struct("AstarScratch")
+            .field("tiles", &self.stamp.len())
+            .field("generation", &self.generation)
+            .field("open_capacity", &self.open.capacity())
+            .finish()
+    }
+}
+
+impl AstarScratch {
+    /// Create empty scratch; buffers grow on the first search
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Create scratch already sized for `map`
+    pub fn for_map(map: &GameMap) -> Self {
+        let mut scratch = Self::new();
+        scratch.begin(map);
+        scratch
+    }
+
+    /// Start a new search generation, growing the buffers if `map` is larger
+    /// than anything searched before
+    fn begin(&mut self, map: &GameMap) {
+        let len = map.tiles().len();
+        if self.stamp.len() < len {
+            self.stamp.resize(len, 0);
+            self.g.resize(len, 0);
+            self.parent.resize(len, 0);
+        }
+        if self.generation == u32::MAX {
+            self.stamp.fill(0);
+            self.generation = 0;
+        }
+        self.generation += 1;
+        self.open.clear();
+    }
+
+    /// Best known cost to tile `i` in the current search
+    fn g_at(&self, i: usize) -> u32 {
+        if self.stamp[i] == self.generation {
+            self.g[i]
+        } else {
+            u32::MAX
+        }
+    }
+
+    /// Find the shortest path and return it as a fresh [`PathResult`]
+    pub fn search(
+        &mut self,
+        map: &GameMap,
+        start: (i32, i32),
+        goal: (i32, i32),
+        bounds: Option<Bounds>,
+    ) -> PathResult {
+        let mut path = Vec::new();
+        let cost = self.search_into(map, start, goal, bounds, &mut path)?;
+        Some((path, cost))
+    }
+
+    /// Find the shortest path from `start` to `goal`, writing it into `path`
+    ///
+    /// Same contract as [`astar_path`]: returns the cost (`path.len() - 1`),
+    /// or `None` with `path` left empty when the goal is unreachable. With
+    /// `bounds`, only tiles inside that inclusive rectangle are entered.
+    pub fn search_into(
+        &mut self,
+        map: &GameMap,
+        start: (i32, i32),
+        goal: (i32, i32),
+        bounds: Option<Bounds>,
+        path: &mut Vec<(i32, i32)>,
+    ) -> Option<i32> {
+        path.clear();
+        if start == goal {
+            path.push(start);
+            return Some(0);
+        }
+        // The goal is only ever entered as a walkable neighbour
+        if !map.is_walkable(goal.0, goal.1) {
+            return None;
+        }
+        self.begin(map);
+        let generation = self.generation;
+        let h = |x: i32, y: i32| (x - goal.0).unsigned_abs() + (y - goal.1).unsigned_abs();
+
+        // The start tile itself need not be walkable, or even on the map
+        if let Some(i) = map.idx(start.0, start.1) {
+            self.stamp[i] = generation;
+            self.g[i] = 0;
+        }
+        let walkable = map.walkable_plane();
+        let h0 = h(start.0, start.1);
+        self.open.push(Reverse((h0, h0, start.0, start.1)));
+
+        while let Some(Reverse((f, hc, x, y))) = self.open.pop() {
+            let g = f - hc;
+            if let Some(i) = map.idx(x, y) {
+                if g > self.g_at(i) {
+                    continue;
+                }
+            }
+            if (x, y) == goal {
+                self.trace(map, start, goal, path);
+                return Some(g as i32);
+            }
+            for (d, &(dx, dy)) in DIRS.iter().enumerate() {
+                let (nx, ny) = (x + dx, y + dy);
+                if let Some((min_x, min_y, max_x, max_y)) = bounds {
+                    if nx < min_x || ny < min_y || nx > max_x || ny > max_y {
+                        continue;
+                    }
+                }
+                let Some(ni) = map.idx(nx, ny) else {
+                    continue;
+                };
+                let ng = g + 1;
+                // `ni` exists, so the tile is on the map and `get` is in range
+                if ng >= self.g_at(ni) || !walkable.get(nx, ny) {
+                    continue;
+                }
+                self.stamp[ni] = generation;
+                self.g[ni] = ng;
+                self.parent[ni] = d as u8;
+                let nh = h(nx, ny);
+                self.open.push(Reverse((ng + nh, nh, nx, ny)));
+            }
+        }
+        None
+    }
+
+    /// Walk parent links back from `goal` and write the path start..=goal
+    fn trace(
+        &self,
+        map: &GameMap,
+        start: (i32, i32),
+        goal: (i32, i32),
+        path: &mut Vec<(i32, i32)>,
+    ) {
+        let mut cur = goal;
+        path.push(cur);
+        while cur != start {
+            let i = map.idx(cur.0, cur.1).expect("traced tiles lie on the map");
+            let (dx, dy) = DIRS[self.parent[i] as usize];
+            cur = (cur.0 - dx, cur.1 - dy);
+            path.push(cur);
+        }
+        path.reverse();
+    }
+}
+
+/// Search with `hierarchy` when given, otherwise flat A* on `scratch`
+fn search_with(
+    hierarchy: Option<&Hierarchy>,
+    scratch: &mut AstarScratch,
+    map: &GameMap,
+    start: (i32, i32),
+    goal: (i32, i32),
+) -> PathResult {
+    match hierarchy {
+        Some(h) => h.find_path_with(map, start, goal, scratch),
+        None => scratch.search(map, start, goal, None),
+    }
+}
+
+thread_local! {
+    /// Scratch behind the free search functions, so repeated calls on one
+    /// thread reuse the same buffers instead of allocating per search
+    static SCRATCH: RefCell<AstarScratch> = RefCell::new(AstarScratch::new());
 }
 
 /// Find shortest path using A* algorithm with Manhattan distance heuristic
 /// Returns None if no path exists, otherwise returns (path, total_cost)
 /// The path includes both start and goal positions
 pub fn astar_path(map: &GameMap, start: (i32, i32), goal: (i32, i32)) -> PathResult {
-    astar(
-        &start,
-        |&(x, y)| neighbors(map, x, y),
-        |&(x, y)| (x - goal.0).abs() + (y - goal.1).abs(), // Manhattan distance heuristic
-        |&p| p == goal,
-    )
+    with_thread_scratch(|s| s.search(map, start, goal, None))
+}
+
+/// Run `f` with this thread's shared scratch
+/// Lets code without its own [`AstarScratch`] (e.g. `Hierarchy::find_path`)
+/// reuse buffers across calls; `f` must not re-enter this function
+pub(crate) fn with_thread_scratch<R>(f: impl FnOnce(&mut AstarScratch) -> R) -> R {
+    SCRATCH.with(|s| f(&mut s.borrow_mut()))
+}
+
+/// Search strategy used by [`PathService`] on cache misses
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum PathMode {
+    /// Flat A* over the whole map (exact shortest paths)
+    #[default]
+    Flat,
+    /// HPA*: abstract cluster graph first, then local refinement
+    /// Near-optimal paths at a fraction of the cost on large maps
+    Hierarchical,
 }
 
 /// Request structure for batch pathfinding operations
@@ -68,7 +339,17 @@ pub struct PathRequest {
 /// Pathfinding service with LRU caching for performance optimization
 /// Caches computed paths to avoid redundant calculations for frequently requested routes
 /// Maintains statistics for cache performance analysis
-#[derive(Debug)]
+///
+/// Entries remember the map version and the chunks they cross; a lookup after
+/// `GameMap::set_tile` changed one of those chunks recomputes the path instead
+/// of serving it stale. A map with another `GameMap::epoch` counts as a
+/// different map and misses on every entry; `load_world` and
+/// `load_snapshot` also [`clear`](PathService::clear) an existing service.
+///
+/// With [`PathService::set_threads`] above one, [`PathService::batch`]
+/// computes its cache misses on scoped worker threads; results, cache
+/// contents and statistics are the same as for the single-threaded batch.
+#[derive(Resource, Debug)]
 pub struct PathService {
     /// LRU cache storing path results
     cache: PathCache,
@@ -76,18 +357,147 @@ pub struct PathService {
     hits: usize,
     /// Number of cache misses (requests requiring computation)
     misses: usize,
+    /// Number of stale entries evicted because their chunks changed
+    invalidations: usize,
+    /// Search strategy used on cache misses
+    mode: PathMode,
+    /// Abstract graph for hierarchical mode, built lazily on first use
+    hierarchy: Option<Hierarchy>,
+    /// A* buffers reused across cache misses
+    scratch: AstarScratch,
+    /// Worker threads used by `batch`; 1 keeps batches on the calling thread
+    threads: usize,
+    /// Per-worker A* buffers for parallel batches, kept between batches
+    workers: Vec<AstarScratch>,
 }
 
 impl PathService {
     /// Create a new PathService with specified cache capacity
     /// Larger capacity means more paths cached but higher memory usage
     pub fn new(capacity: usize) -> Self {
+        Self::with_mode(capacity, PathMode::Flat)
+    }
+
+    /// Create a new PathService using the given search strategy on cache misses
+    pub fn with_mode(capacity: usize, mode: PathMode) -> Self {
         let cap = NonZeroUsize::new(capacity.max(1)).unwrap();
         Self {
             cache: LruCache::new(cap),
             hits: 0,
             misses: 0,
+            invalidations: 0,
+            mode,
+            hierarchy: None,
+            scratch: AstarScratch::new(),
+            threads: 1,
+            workers: Vec::new(),
+        }
+    }
+
+    /// Current search strategy
+    pub fn mode(&self) -> PathMode {
+        self.mode
+    }
+
+    /// Switch search strategy; cached paths are dropped since the two modes
+    /// may return different (equally valid) routes
+    pub fn set_mode(&mut self, mode: PathMode) {
+        if self.mode != mode {
+            self.mode = mode;
+            self.cache.clear();
+        }
+    }
+
+    /// Number of worker threads `batch` may use
+    pub fn threads(&self) -> usize {
+        self.threads
+    }
+
+    /// Set the number of worker threads `batch` may use (at least 1)
+    pub fn set_threads(&mut self, threads: usize) {
+        self.threads = threads.max(1);
+    }
+
+    /// Discard the hierarchical graph so it is rebuilt on the next search
+    /// Tile edits made through `set_tile` are picked up automatically; this
+    /// is only needed after writing `GameMap::tiles` directly
+    pub fn invalidate_hierarchy(&mut self) {
+        self.hierarchy = None;
+    }
+
+    /// Drop all cached paths and the hierarchical graph
+    pub fn clear(&mut self) {
+        self.cache.clear();
+        self.hierarchy = None;
+    }
+
+    /// Bring the hierarchical graph up to date with `map` before searching
+    fn prepare(&mut self, map: &GameMap) {
+        if self.mode == PathMode::Hierarchical {
+            match &mut self.hierarchy {
+                // Rebuild only the clusters touched by chunk changes
+                Some(h) if h.matches(map) => h.refresh(map),
+                _ => self.hierarchy = Some(Hierarchy::build(map, DEFAULT_CLUSTER_SIZE)),
+            }
+        }
+    }
+
+    /// Run the configured search strategy without touching the cache
+    fn compute(&mut self, map: &GameMap, start: (i32, i32), goal: (i32, i32)) -> PathResult {
+        self.prepare(map);
+        let hierarchy = match self.mode {
+            PathMode::Flat => None,
+            PathMode::Hierarchical => self.hierarchy.as_ref(),
+        };
+        search_with(hierarchy, &mut self.scratch, map, start, goal)
+    }
+
+    /// Compute `reqs` on up to `threads` scoped workers, each with its own
+    /// scratch; workers pull requests from a shared counter so long and
+    /// short searches balance out, and results come back in `reqs` order
+    fn compute_parallel(&mut self, map: &GameMap, reqs: &[PathRequest]) -> Vec<PathResult> {
+        let threads = self.threads.min(reqs.len());
+        if threads <= 1 {
+            return reqs
+                .iter()
+                .map(|r| self.compute(map, r.start, r.goal))
+                .collect();
         }
+        self.prepare(map);
+        if self.workers.len() < threads {
+            self.workers.resize_with(threads, AstarScratch::new);
+        }
+        let hierarchy = match self.mode {
+            PathMode::Flat => None,
+            PathMode::Hierarchical => self.hierarchy.as_ref(),
+        };
+        let next = AtomicUsize::new(0);
+        let mut out: Vec<PathResult> = vec![None; reqs.len()];
+        thread::scope(|scope| {
+            let handles: Vec<_> = self.workers[..threads]
+                .iter_mut()
+                .map(|scratch| {
+                    let next = &next;
+                    scope.spawn(move || {
+                        let mut done = Vec::new();
+                        loop {
+                            let i = next.fetch_add(1, Ordering::Relaxed);
+                            let Some(r) = reqs.get(i) else {
+                                break;
+                            };
+                            done.push((i, search_with(hierarchy, scratch, map, r.start, r.goal)));
+                        }
+                        done
+                    })
+                })
+                .collect();
+            for handle in handles {
+                for (i, result) in handle.join().expect("path worker panicked") {
+                    out[i] = result;
+                }
+            }
+        });
+        out
     }
 
     /// Get path from start to goal, using cache if available
@@ -95,20 +505,32 @@ impl PathService {
     /// Returns None if no path exists
     pub fn get(&mut self, map: &GameMap, start: (i32, i32), goal: (i32, i32)) -> PathResult {
         let key = (start.0, start.1, goal.0, goal.1);
-        if let Some(v) = self.cache.get(&key) {
-            self.hits += 1;
-            return v.clone();
+        match self.cache.get(&key) {
+            Some(entry) if entry.is_valid(map) => {
+                self.hits += 1;
+                return entry.result.clone();
+            }
+            Some(_) => self.invalidations += 1,
+            None => self.misses += 1,
         }
-        self.misses += 1;
-        let v = astar_path(map, start, goal);
-        self.cache.put(key, v.clone());
+        let v = self.compute(map, start, goal);
+        self.cache.put(key, CachedPath::new(map, v.clone()));
         v
     }
 
     /// Process multiple pathfinding requests in batch
     /// More efficient than individual calls for multiple paths
     /// Each request is still cached independently
+    ///
+    /// With more than one thread configured, identical requests are
+    /// searched once and the misses run in parallel; cache updates are then
+    /// replayed in input order, so the outcome matches the sequential batch
+    /// (unless the cache is too small to hold the batch's distinct requests,
+    /// where the sequential path would recompute evicted duplicates).
     pub fn batch(&mut self, map: &GameMap, reqs: &[PathRequest]) -> Vec<PathResult> {
+        if self.threads > 1 {
+            return self.batch_parallel(map, reqs);
+        }
         let mut out = Vec::with_capacity(reqs.len());
         for r in reqs {
             out.push(self.get(map, r.start, r.goal));
@@ -116,10 +538,79 @@ impl PathService {
         out
     }
 
-    /// Get cache performance statistics (hits, misses)
+    /// Parallel variant of `batch`: dedup, compute misses, merge in order
+    fn batch_parallel(&mut self, map: &GameMap, reqs: &[PathRequest]) -> Vec<PathResult> {
+        // One slot per distinct request, in order of first appearance
+        let mut slots: HashMap<CacheKey, usize> = HashMap::with_capacity(reqs.len());
+        let mut results: Vec<PathResult> = Vec::new();
+        let mut fresh: Vec<bool> = Vec::new();
+        let mut order: Vec<usize> = Vec::with_capacity(reqs.len());
+        let mut pending: Vec<PathRequest> = Vec::new();
+        for r in reqs {
+            let key = (r.start.0, r.start.1, r.goal.0, r.goal.1);
+            let slot = match slots.entry(key) {
+                // A repeat is what the sequential batch would find in the cache
+                Entry::Occupied(e) => {
+                    self.hits += 1;
+                    *e.get()
+                }
+                Entry::Vacant(e) => {
+                    let cached = match self.cache.peek(&key) {
+                        Some(entry) if entry.is_valid(map) => {
+                            self.hits += 1;
+                            Some(entry.result.clone())
+                        }
+                        Some(_) => {
+                            self.invalidations += 1;
+                            None
+                        }
+                        None => {
+                            self.misses += 1;
+                            None
+                        }
+                    };
+                    fresh.push(cached.is_none());
+                    if cached.is_none() {
+                        pending.push(*r);
+                    }
+                    results.push(cached.flatten());
+                    *e.insert(results.len() - 1)
+                }
+            };
+            order.push(slot);
+        }
+
+        let mut computed = self.compute_parallel(map, &pending).into_iter();
+        for (slot, is_fresh) in fresh.iter().enumerate() {
+            if *is_fresh {
+                results[slot] = computed.next().flatten();
+            }
+        }
+
+        // Replay cache updates in input order so LRU recency matches `get`
+        let mut out = Vec::with_capacity(reqs.len());
+        for (r, &slot) in reqs.iter().zip(&order) {
+            let key = (r.start.0, r.start.1, r.goal.0, r.goal.1);
+            if fresh[slot] {
+                fresh[slot] = false;
+                self.cache
+                    .put(key, CachedPath::new(map, results[slot].clone()));
+            } else {
+                self.cache.promote(&key);
+            }
+            out.push(results[slot].clone());
+        }
+        out
+    }
+
+    /// Get cache performance statistics (hits, misses, invalidations)
     /// Useful for optimizing cache size and analyzing path request patterns
-    pub fn stats(&self) -> (usize, usize) {
-        (self.hits, self.misses)
+    pub fn stats(&self) -> PathStats {
+        PathStats {
+            hits: self.hits,
+            misses: self.misses,
+            invalidations: self.invalidations,
+        }
     }
 
     /// Reset performance statistics to zero
@@ -127,5 +618,80 @@ impl PathService {
     pub fn reset_stats(&mut self) {
         self.hits = 0;
         self.misses = 0;
+        self.invalidations = 0;
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::world::TileKind;
+
+    fn walled_map() -> GameMap {
+        let mut map = GameMap::new(12, 8);
+        for y in 0..7 {
+            map.set_tile(5, y, TileKind::Wall);
+        }
+        map
+    }
+
+    #[test]
+    fn scratch_reuse_across_maps_and_generations() {
+        let small = walled_map();
+        let large = GameMap::new(40, 30);
+        let mut scratch = AstarScratch::new();
+        let mut path = Vec::new();
+
+        for _ in 0..3 {
+            assert_eq!(
+                scratch.search_into(&small, (0, 0), (11, 0), None, &mut path),
+                Some(25)
+            );
+            assert_eq!(path.len(), 26);
+            assert_eq!(
+                scratch.search_into(&large, (0, 0), (39, 29), None, &mut path),
+                Some(68)
+            );
+        }
+
+        // A wrapped generation counter must not resurrect old g-scores
+        scratch.generation = u32::MAX - 1;
+        for _ in 0..3 {
+            assert_eq!(
+                scratch.search_into(&small, (0, 0), (11, 0), None, &mut path),
+                Some(25)
+            );
+        }
+    }
+
+    #[test]
+    fn search_respects_bounds() {
+        let map = walled_map();
+        let mut scratch = AstarScratch::for_map(&map);
+        let mut path = Vec::new();
+
+        // The only gap in the wall is on row 7, outside these bounds
+        let bounds = (0, 0, 11, 6);
+        assert_eq!(
+            scratch.search_into(&map, (0, 0), (11, 0), Some(bounds), &mut path),
+            None
+        );
+        assert!(path.is_empty());
+        assert_eq!(
+            scratch.search_into(&map, (0, 0), (4, 6), Some(bounds), &mut path),
+            Some(10)
+        );
+        assert!(path
+            .iter()
+            .all(|&(x, y)| (0..=11).contains(&x) && (0..=6).contains(&y)));
+    }
+
+    #[test]
+    fn start_need_not_be_walkable() {
+        let map = walled_map();
+        let (path, cost) = astar_path(&map, (5, 0), (6, 0)).expect("step off the wall");
+        assert_eq!(path, vec![(5, 0), (6, 0)]);
+        assert_eq!(cost, 1);
+        assert_eq!(astar_path(&map, (0, 0), (5, 0)), None);
     }
 }
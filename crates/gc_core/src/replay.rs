@@ -0,0 +1,431 @@
+//! Tick-keyed input journal and checkpointed fast-forward replay
+//!
+//! Everything the simulation does between inputs follows from the world
+//! state and `DeterministicRng`, so a run is fully described by its start
+//! state plus the player inputs and the tick each was applied at. An
+//! `InputJournal` holds those inputs in a compact varint encoding:
+//!
+//! | Field        | Encoding                                             |
+//! |--------------|------------------------------------------------------|
+//! | magic        | `GCRJ`                                               |
+//! | version      | `u8`                                                 |
+//! | entry count  | varint                                               |
+//! | per entry    | tick delta varint, input tag `u8`, zigzag varint coordinates, `u8` codes |
+//!
+//! `ReplayRunner` re-runs a journal headlessly on the simulation schedule
+//! only (no FOV or other presentation systems) and keeps a `SimSnapshot`
+//! checkpoint every `interval` ticks, so seeking to any tick it has passed
+//! restores the nearest earlier checkpoint and simulates less than one
+//! interval. The runner's world carries a `WorldHash`, so on the default
+//! schedule `ReplayRunner::state_hash` reads the hash `world_hash_system`
+//! kept up to date instead of rehashing the world.
+
+use crate::binsave::{item_code, item_from_code, tile_code, tile_from_code};
+use crate::bootstrap::{build_default_schedule, run_tick};
+use crate::components::ItemType;
+use crate::designations::DesignationBundle;
+use crate::hash::{full_world_hash, WorldHash, DEFAULT_HISTORY};
+use crate::jobs::StoneBundle;
+use crate::snapshot::{load_snapshot, save_snapshot, SimSnapshot};
+use crate::systems::Time;
+use crate::world::{GameMap, Position, TileKind};
+use bevy_ecs::prelude::*;
+
+/// File signature of an encoded journal
+pub const MAGIC: [u8; 4] = *b"GCRJ";
+/// Journal encoding version written by `encode`
+pub const VERSION: u8 = 1;
+
+const TAG_DESIGNATE: u8 = 0;
+const TAG_SPAWN_ITEM: u8 = 1;
+const TAG_SET_TILE: u8 = 2;
+
+/// Reasons a byte buffer is not a valid input journal
+#[derive(Debug, Clone, PartialEq, Eq, thiserror::Error)]
+pub enum ReplayError {
+    #[error("not an input journal (bad magic)")]
+    BadMagic,
+    #[error("unsupported input journal version {0}")]
+    UnsupportedVersion(u8),
+    #[error("input journal truncated")]
+    Truncated,
+    #[error("corrupt input journal: {0}")]
+    Corrupt(&'static str),
+}
+
+/// One player or scripted input, applied between ticks
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum InputEvent {
+    /// Spawn a mine designation
+    Designate { x: i32, y: i32 },
+    /// Spawn a loose item
+    SpawnItem { item_type: ItemType, x: i32, y: i32 },
+    /// Overwrite one map tile
+    SetTile { x: i32, y: i32, kind: TileKind },
+}
+
+/// Apply `input` to `world`; used for live play and replay alike so both
+/// take the same path
+pub fn apply_input(world: &mut World, input: InputEvent) {
+    match input {
+        InputEvent::Designate { x, y } => {
+            world.spawn(DesignationBundle {
+                pos: Position(x, y),
+                ..Default::default()
+            });
+        }
+        // Same bundle as `process_item_spawn_queue_system`
+        InputEvent::SpawnItem { item_type, x, y } => match item_type {
+            ItemType::Stone => {
+                world.spawn(StoneBundle::at(x, y));
+            }
+        },
+        InputEvent::SetTile { x, y, kind } => {
+            world.resource_mut::<GameMap>().set_tile(x, y, kind);
+        }
+    }
+}
+
+/// Inputs keyed by the tick they are applied before
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct InputJournal {
+    /// Sorted by tick; inputs of one tick keep their recording order
+    entries: Vec<(u64, InputEvent)>,
+}
+
+impl InputJournal {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    /// Record `input` to be applied before the schedule runs at `tick`
+    pub fn record(&mut self, tick: u64, input: InputEvent) {
+        let at = self.entries.partition_point(|&(t, _)| t <= tick);
+        self.entries.insert(at, (tick, input));
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// All entries in application order
+    pub fn entries(&self) -> &[(u64, InputEvent)] {
+        &self.entries
+    }
+
+    /// Index of the first entry applied at or after `tick`
+    fn first_at(&self, tick: u64) -> usize {
+        self.entries.partition_point(|&(t, _)| t < tick)
+    }
+
+    pub fn encode(&self) -> Vec<u8> {
+        let mut out = Vec::with_capacity(8 + self.entries.len() * 5);
+        out.extend_from_slice(&MAGIC);
+        out.push(VERSION);
+        put_varint(&mut out, self.entries.len() as u64);
+        let mut last = 0;
+        for &(tick, input) in &self.entries {
+            put_varint(&mut out, tick - last);
+            last = tick;
+            match input {
+                InputEvent::Designate { x, y } => {
+                    out.push(TAG_DESIGNATE);
+                    put_coords(&mut out, x, y);
+                }
+                InputEvent::SpawnItem { item_type, x, y } => {
+                    out.push(TAG_SPAWN_ITEM);
+                    out.push(item_code(item_type));
+                    put_coords(&mut out, x, y);
+                }
+                InputEvent::SetTile { x, y, kind } => {
+                    out.push(TAG_SET_TILE);
+                    out.push(tile_code(kind));
+                    put_coords(&mut out, x, y);
+                }
+            }
+        }
+        out
+    }
+
+    pub fn decode(bytes: &[u8]) -> Result<Self, ReplayError> {
+        if bytes.len() < MAGIC.len() + 1 || bytes[..MAGIC.len()] != MAGIC {
+            return Err(ReplayError::BadMagic);
+        }
+        let version = bytes[MAGIC.len()];
+        if version != VERSION {
+            return Err(ReplayError::UnsupportedVersion(version));
+        }
+        let mut r = Reader {
+            bytes,
+            at: MAGIC.len() + 1,
+        };
+        let count = r.varint()?;
+        // Every entry takes at least 4 bytes, which bounds the allocation
+        if count > (bytes.len() / 4) as u64 {
+            return Err(ReplayError::Truncated);
+        }
+        let mut entries = Vec::with_capacity(count as usize);
+        let mut tick = 0u64;
+        for _ in 0..count {
+            tick = tick
+                .checked_add(r.varint()?)
+                .ok_or(ReplayError::Corrupt("tick overflow"))?;
+            let input = match r.byte()? {
+                TAG_DESIGNATE => {
+                    let (x, y) = r.coords()?;
+                    InputEvent::Designate { x, y }
+                }
+                TAG_SPAWN_ITEM => {
+                    let item_type =
+                        item_from_code(r.byte()?).ok_or(ReplayError::Corrupt("item type"))?;
+                    let (x, y) = r.coords()?;
+                    InputEvent::SpawnItem { item_type, x, y }
+                }
+                TAG_SET_TILE => {
+                    let kind = tile_from_code(r.byte()?).ok_or(ReplayError::Corrupt("tile"))?;
+                    let (x, y) = r.coords()?;
+                    InputEvent::SetTile { x, y, kind }
+                }
+                _ => return Err(ReplayError::Corrupt("input tag")),
+            };
+            entries.push((tick, input));
+        }
+        if r.at != bytes.len() {
+            return Err(ReplayError::Corrupt("trailing bytes"));
+        }
+        Ok(Self { entries })
+    }
+}
+
+fn put_varint(out: &mut Vec<u8>, mut v: u64) {
+    while v >= 0x80 {
+        out.push(v as u8 | 0x80);
+        v >>= 7;
+    }
+    out.push(v as u8);
+}
+
+fn put_coords(out: &mut Vec<u8>, x: i32, y: i32) {
+    for v in [x, y] {
+        put_varint(out, ((v << 1) ^ (v >> 31)) as u32 as u64);
+    }
+}
+
+struct Reader<'a> {
+    bytes: &'a [u8],
+    at: usize,
+}
+
+impl Reader<'_> {
+    fn byte(&mut self) -> Result<u8, ReplayError> {
+        let b = *self.bytes.get(self.at).ok_or(ReplayError::Truncated)?;
+        self.at += 1;
+        Ok(b)
+    }
+
+    fn varint(&mut self) -> Result<u64, ReplayError> {
+        let mut v = 0u64;
+        for shift in (0..64).step_by(7) {
+            let b = self.byte()?;
+            v |= ((b & 0x7f) as u64) << shift;
+            if b < 0x80 {
+                return Ok(v);
+            }
+        }
+        Err(ReplayError::Corrupt("varint too long"))
+    }
+
+    fn coords(&mut self) -> Result<(i32, i32), ReplayError> {
+        let mut zigzag = || -> Result<i32, ReplayError> {
+            let v =
+                u32::try_from(self.varint()?).map_err(|_| ReplayError::Corrupt("coordinate"))?;
+            Ok((v >> 1) as i32 ^ -((v & 1) as i32))
+        };
+        let x = zigzag()?;
+        Ok((x, zigzag()?))
+    }
+}
+
+/// Replays an `InputJournal` from a start state with periodic checkpoints
+pub struct ReplayRunner {
+    journal: InputJournal,
+    interval: u64,
+    /// Checkpoints in tick order; the first is the start state
+    checkpoints: Vec<(u64, SimSnapshot)>,
+    make_schedule: fn() -> Schedule,
+    world: World,
+    schedule: Schedule,
+    /// Index of the next journal entry to apply
+    cursor: usize,
+}
+
+impl ReplayRunner {
+    /// Replay on `build_default_schedule`, checkpointing every `interval`
+    /// ticks (at least 1)
+    pub fn new(start: &World, journal: InputJournal, interval: u64) -> Self {
+        Self::with_schedule(start, journal, interval, build_default_schedule)
+    }
+
+    /// Replay on schedules built by `make_schedule`; a fresh one is built
+    /// whenever a checkpoint is restored
+    pub fn with_schedule(
+        start: &World,
+        journal: InputJournal,
+        interval: u64,
+        make_schedule: fn() -> Schedule,
+    ) -> Self {
+        let snapshot = save_snapshot(start);
+        let tick = snapshot.ticks;
+        let mut runner = Self {
+            journal,
+            interval: interval.max(1),
+            checkpoints: vec![(tick, snapshot)],
+            make_schedule,
+            world: World::new(),
+            schedule: make_schedule(),
+            cursor: 0,
+        };
+        runner.restore(0);
+        runner
+    }
+
+    /// Tick the next `step` will simulate
+    pub fn tick(&self) -> u64 {
+        self.world.resource::<Time>().ticks
+    }
+
+    pub fn world(&self) -> &World {
+        &self.world
+    }
+
+    pub fn journal(&self) -> &InputJournal {
+        &self.journal
+    }
+
+    /// `WorldHash` of the current state: the hash recorded for this tick,
+    /// or a full rehash if the schedule does not run `world_hash_system`
+    pub fn state_hash(&mut self) -> u64 {
+        let tick = self.tick();
+        match self.world.resource::<WorldHash>().at(tick) {
+            Some(hash) => hash,
+            None => full_world_hash(&mut self.world),
+        }
+    }
+
+    /// Number of checkpoints kept, the start state included
+    pub fn checkpoints(&self) -> usize {
+        self.checkpoints.len()
+    }
+
+    /// Apply this tick's inputs and run the schedule once
+    pub fn step(&mut self) {
+        let tick = self.tick();
+        let entries = self.journal.entries();
+        while let Some(&(t, input)) = entries.get(self.cursor) {
+            if t > tick {
+                break;
+            }
+            apply_input(&mut self.world, input);
+            self.cursor += 1;
+        }
+        run_tick(&mut self.world, &mut self.schedule);
+
+        let tick = self.tick();
+        let newest = self.checkpoints.last().map_or(0, |&(t, _)| t);
+        if tick % self.interval == 0 && tick > newest {
+            self.checkpoints.push((tick, save_snapshot(&self.world)));
+        }
+    }
+
+    /// Move to `tick` (clamped to the start), restoring the nearest earlier
+    /// checkpoint when that is closer than the current tick; returns the
+    /// number of ticks simulated
+    pub fn seek(&mut self, tick: u64) -> u64 {
+        let tick = tick.max(self.checkpoints[0].0);
+        let best = self.checkpoints.partition_point(|&(t, _)| t <= tick) - 1;
+        let current = self.tick();
+        if current > tick || self.checkpoints[best].0 > current {
+            self.restore(best);
+        }
+        let simulated = tick - self.tick();
+        while self.tick() < tick {
+            self.step();
+        }
+        simulated
+    }
+
+    fn restore(&mut self, index: usize) {
+        let (tick, snapshot) = &self.checkpoints[index];
+        self.world = World::new();
+        load_snapshot(snapshot.clone(), &mut self.world);
+        let hash = WorldHash::from_world(&mut self.world, DEFAULT_HISTORY);
+        self.world.insert_resource(hash);
+        self.schedule = (self.make_schedule)();
+        self.cursor = self.journal.first_at(*tick);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn sample() -> InputJournal {
+        let mut journal = InputJournal::new();
+        journal.record(3, InputEvent::Designate { x: 4, y: -2 });
+        journal.record(
+            0,
+            InputEvent::SetTile {
+                x: 70_000,
+                y: 1,
+                kind: TileKind::Lava,
+            },
+        );
+        journal.record(
+            3,
+            InputEvent::SpawnItem {
+                item_type: ItemType::Stone,
+                x: i32::MIN,
+                y: i32::MAX,
+            },
+        );
+        journal.record(1 << 40, InputEvent::Designate { x: 0, y: 0 });
+        journal
+    }
+
+    #[test]
+    fn record_keeps_tick_order_and_same_tick_order() {
+        let journal = sample();
+        let ticks: Vec<u64> = journal.entries().iter().map(|e| e.0).collect();
+        assert_eq!(ticks, [0, 3, 3, 1 << 40]);
+        assert!(matches!(
+            journal.entries()[1].1,
+            InputEvent::Designate { .. }
+        ));
+        assert_eq!(journal.first_at(1), 1);
+        assert_eq!(journal.first_at(4), 3);
+    }
+
+    #[test]
+    fn encoding_roundtrips_and_rejects_damage() {
+        let journal = sample();
+        let bytes = journal.encode();
+        assert_eq!(InputJournal::decode(&bytes), Ok(journal));
+
+        for len in 0..bytes.len() {
+            assert!(InputJournal::decode(&bytes[..len]).is_err(), "prefix {len}");
+        }
+        let mut bad = bytes.clone();
+        bad[4] = 9;
+        assert_eq!(
+            InputJournal::decode(&bad),
+            Err(ReplayError::UnsupportedVersion(9))
+        );
+        bad = bytes.clone();
+        bad.push(0);
+        assert!(InputJournal::decode(&bad).is_err());
+    }
+}
@@ -1,4 +1,5 @@
-use crate::components::{Carriable, Item, ItemType};
+use crate::components::{Carriable, Item, ItemStack, ItemType};
+use crate::path::PathService;
 use crate::systems;
 use crate::world::{GameMap, Name, Position, TileKind, Velocity};
 use bevy_ecs::prelude::*;
@@ -7,10 +8,12 @@ use serde::{Deserialize, Serialize};
 
 /// Sort entity records in a stable, deterministic order.
 ///
-/// Ordering key: (name, pos, vel, item_type, carriable)
-fn sort_entities_deterministically(entities: &mut [EntityData]) {
+/// Ordering key: (name, pos, vel, item_type, carriable, stack)
+/// The key covers every field, so ties are identical records and an
+/// unstable sort gives the same output
+pub(crate) fn sort_entities_deterministically(entities: &mut [EntityData]) {
     use std::cmp::Ordering;
-    entities.sort_by(|a, b| {
+    entities.sort_unstable_by(|a, b| {
         let name_ord = a.name.cmp(&b.name);
         if name_ord != Ordering::Equal {
             return name_ord;
@@ -27,7 +30,9 @@ fn sort_entities_deterministically(entities: &mut [EntityData]) {
         if item_ord != Ordering::Equal {
             return item_ord;
         }
-        a.carriable.cmp(&b.carriable)
+        a.carriable
+            .cmp(&b.carriable)
+            .then_with(|| a.stack.cmp(&b.stack))
     });
 }
 
@@ -38,8 +43,8 @@ pub struct SaveGame {
     pub tiles: Vec<TileKind>,
     pub entities: Vec<EntityData>,
     // Determinism: persist tick timing and RNG seed
-    // Note: RNG stream positions not yet persisted - reloading resets RNG to initial state
-    // TODO: Serialize per-stream RNG state for full determinism across save/load
+    // Note: RNG stream positions are not persisted here - reloading resets RNG to
+    // initial state; `snapshot::SimSnapshot` keeps them for exact resume
     #[serde(default = "default_tick_ms")]
     pub tick_ms: u64,
     #[serde(default)]
@@ -52,39 +57,68 @@ fn default_tick_ms() -> u64 {
     100
 }
 
-#[derive(Serialize, Deserialize)]
+#[derive(Serialize, Deserialize, Debug, Clone, PartialEq, Eq)]
 pub struct EntityData {
     pub name: Option<String>,
     pub pos: Option<(i32, i32)>,
     pub vel: Option<(i32, i32)>,
     pub item_type: Option<ItemType>,
     pub carriable: bool,
+    /// `ItemStack` count; absent for single items
+    #[serde(default, skip_serializing_if = "Option::is_none")]
+    pub stack: Option<u16>,
 }
 
-pub fn save_world(world: &mut World) -> SaveGame {
-    // Clone map data first to avoid overlapping borrows with query construction
-    let (width, height, tiles) = {
-        let map = world.resource::<GameMap>();
-        (map.width, map.height, map.tiles.clone())
-    };
+/// Components an `EntityData` is built from
+pub(crate) type SavedComponents = (
+    Option<&'static Name>,
+    Option<&'static Position>,
+    Option<&'static Velocity>,
+    Option<&'static Item>,
+    Option<&'static Carriable>,
+    Option<&'static ItemStack>,
+);
 
-    let mut entities = Vec::new();
-    let mut q = world.query::<(
+/// Saved form of one entity's components
+pub(crate) fn entity_data(
+    (name, pos, vel, item, carriable, stack): (
         Option<&Name>,
         Option<&Position>,
         Option<&Velocity>,
         Option<&Item>,
         Option<&Carriable>,
-    )>();
-    for (name, pos, vel, item, carriable) in q.iter(world) {
-        entities.push(EntityData {
-            name: name.map(|n| n.0.clone()),
-            pos: pos.map(|p| (p.0, p.1)),
-            vel: vel.map(|v| (v.0, v.1)),
-            item_type: item.map(|i| i.item_type),
-            carriable: carriable.is_some(),
-        });
+        Option<&ItemStack>,
+    ),
+) -> EntityData {
+    EntityData {
+        name: name.map(|n| n.0.clone()),
+        pos: pos.map(|p| (p.0, p.1)),
+        vel: vel.map(|v| (v.0, v.1)),
+        item_type: item.map(|i| i.item_type),
+        carriable: carriable.is_some(),
+        stack: stack.map(|s| s.0),
     }
+}
+
+/// Saved components of every entity, paired with its live `Entity`
+pub(crate) fn saved_entities(world: &mut World) -> Vec<(Entity, EntityData)> {
+    let mut q = world.query::<(Entity, SavedComponents)>();
+    q.iter(world)
+        .map(|(entity, saved)| (entity, entity_data(saved)))
+        .collect()
+}
+
+pub fn save_world(world: &mut World) -> SaveGame {
+    // Clone map data first to avoid overlapping borrows with query construction
+    let (width, height, tiles) = {
+        let map = world.resource::<GameMap>();
+        (map.width, map.height, map.row_major_tiles())
+    };
+
+    let mut entities: Vec<EntityData> = saved_entities(world)
+        .into_iter()
+        .map(|(_, data)| data)
+        .collect();
     // Deterministic ordering across codecs and runs
     sort_entities_deterministically(&mut entities);
     // Persist determinism metadata (fallback to defaults if resources are absent)
@@ -109,11 +143,11 @@ pub fn save_world(world: &mut World) -> SaveGame {
 }
 
 pub fn load_world(save: SaveGame, world: &mut World) {
-    world.insert_resource(GameMap {
-        width: save.width,
-        height: save.height,
-        tiles: save.tiles,
-    });
+    world.insert_resource(GameMap::from_tiles(save.width, save.height, save.tiles));
+    // Cached paths belong to the map that was just replaced
+    if let Some(mut paths) = world.get_resource_mut::<PathService>() {
+        paths.clear();
+    }
     // Restore deterministic time and RNG seed
     world.insert_resource(systems::Time {
         ticks: save.ticks,
@@ -137,6 +171,9 @@ pub fn load_world(save: SaveGame, world: &mut World) {
         if e.carriable {
             ec.insert(Carriable);
         }
+        if let Some(count) = e.stack {
+            ec.insert(ItemStack(count));
+        }
     }
 }
 
@@ -175,3 +212,14 @@ pub fn decode_cbor(bytes: &[u8]) -> Result<SaveGame, ciborium::de::Error<std::io
     let mut cur = Cursor::new(bytes);
     ciborium::de::from_reader(&mut cur)
 }
+
+/// Encode a SaveGame to the versioned binary layout (RLE tiles, fixed-size
+/// entity records); see [`crate::binsave`]
+pub fn encode_binary(save: &SaveGame) -> Vec<u8> {
+    crate::binsave::encode(save)
+}
+
+/// Decode a SaveGame from the binary layout, validating it first
+pub fn decode_binary(bytes: &[u8]) -> Result<SaveGame, crate::binsave::BinarySaveError> {
+    crate::binsave::decode(bytes)
+}
@@ -0,0 +1,353 @@
+//! Full-fidelity snapshots of the simulation state
+//!
+//! `SaveGame` keeps the player-facing world (tiles, names, positions, items)
+//! in a content-sorted, spawn-order independent form. A `SimSnapshot` keeps
+//! everything the simulation reads instead: RNG stream positions, the job
+//! board in posting order, active jobs, pending item spawns, the item
+//! stacking, auto-job and assignment settings, worker and designation
+//! state, and entity references. Loading a snapshot into an empty world and
+//! running N ticks gives the same world as running N ticks from the point
+//! it was taken.
+//!
+//! Entities are stored in `Entity` order and get their handles in that
+//! order, so handle order (which breaks ties, e.g. when several items share
+//! a tile) carries over. Query order does not: it follows archetype and
+//! table layout, which depends on how entities were built. Systems whose
+//! result depends on visiting order therefore go through
+//! `systems::in_entity_order` rather than raw query order. References between
+//! entities (`Inventory`, `Target`) are stored as indices into the entity
+//! list. Derived state — `SpatialIndex`, flow fields, path caches,
+//! visibility — is not stored and rebuilds itself from the loaded world.
+//! Snapshots are taken between ticks; items spawned by deferred commands
+//! in the last tick count as already seen by `auto_haul_system`.
+
+use crate::assignment::{AssignmentConfig, AssignmentStrategy};
+use crate::components::*;
+use crate::designations::{DesignationConfig, MineDesignation};
+use crate::flow::FlowFieldService;
+use crate::jobs::{
+    ActiveJobs, ItemSpawnConfig, ItemSpawnQueue, ItemSpawnRequest, Job, JobBoard, JobId,
+};
+use crate::path::PathService;
+use crate::spatial::SpatialIndex;
+use crate::systems::{DeterministicRng, RestoredItems, Time};
+use crate::world::{GameMap, Name, Position, TileKind, Velocity};
+use bevy_ecs::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+
+/// Entity reference that pointed at an entity outside the snapshot
+const DANGLING: u32 = u32::MAX;
+
+/// Complete simulation state; see the module docs
+#[derive(Serialize, Deserialize, Debug, Clone)]
+pub struct SimSnapshot {
+    pub width: u32,
+    pub height: u32,
+    /// Row-major, like `SaveGame::tiles`
+    pub tiles: Vec<TileKind>,
+    pub tick_ms: u64,
+    pub ticks: u64,
+    pub master_seed: u64,
+    /// `DeterministicRng::stream_positions`
+    pub rng_positions: [u64; 4],
+    /// Waiting jobs in posting order
+    pub job_board: Vec<Job>,
+    /// Assigned jobs, sorted by id
+    pub active_jobs: Vec<Job>,
+    /// Pending `ItemSpawnQueue` requests in queue order
+    pub item_spawns: Vec<(ItemType, (i32, i32))>,
+    /// `DesignationConfig::auto_jobs`, if the resource exists
+    pub auto_jobs: Option<bool>,
+    /// `AssignmentConfig::strategy`, if the resource exists
+    pub assignment: Option<AssignmentStrategy>,
+    /// `ItemSpawnConfig::stack`, if the resource exists
+    pub item_stacking: Option<bool>,
+    /// Whether the world had a `SpatialIndex` (systems behave differently
+    /// with and without one)
+    pub spatial_index: bool,
+    /// Whether the world had a `FlowFieldService`
+    pub flow_fields: bool,
+    /// Entities in `Entity` order
+    pub entities: Vec<EntitySnapshot>,
+}
+
+/// Every simulation component of one entity
+/// Entity references are indices into `SimSnapshot::entities`
+#[derive(Serialize, Deserialize, Debug, Clone, Default)]
+#[serde(default)]
+pub struct EntitySnapshot {
+    pub name: Option<String>,
+    pub pos: Option<(i32, i32)>,
+    pub vel: Option<(i32, i32)>,
+    pub goblin: bool,
+    pub miner: bool,
+    pub carrier: bool,
+    pub job_queue: bool,
+    /// Has an `AssignedJob`, holding `assigned_job`
+    pub has_assigned_job: bool,
+    pub assigned_job: Option<JobId>,
+    /// Has an `Inventory`, holding `carrying`
+    pub has_inventory: bool,
+    pub carrying: Option<u32>,
+    pub vision_radius: Option<i32>,
+    pub item_type: Option<ItemType>,
+    pub stone: bool,
+    pub carriable: bool,
+    pub stack: Option<u16>,
+    pub mine_designation: bool,
+    pub designation_state: Option<DesignationState>,
+    /// Is a `Stockpile` accepting `accepts`
+    pub stockpile: bool,
+    pub accepts: Option<Vec<ItemType>>,
+    pub zone: Option<ZoneBounds>,
+    pub faction: Option<Faction>,
+    pub health: Option<Health>,
+    pub combat_stats: Option<CombatStats>,
+    pub attack_cooldown: Option<AttackCooldown>,
+    pub combatant: bool,
+    pub dead: bool,
+    pub target: Option<u32>,
+}
+
+/// Capture the complete simulation state of `world`
+/// The world must contain a `GameMap`
+pub fn save_snapshot(world: &World) -> SimSnapshot {
+    let mut order: Vec<Entity> = world.iter_entities().map(|e| e.id()).collect();
+    order.sort_unstable();
+    let slot: HashMap<Entity, u32> = order
+        .iter()
+        .enumerate()
+        .map(|(i, &e)| (e, i as u32))
+        .collect();
+    let reference = |e: Entity| slot.get(&e).copied().unwrap_or(DANGLING);
+    let entities = order
+        .iter()
+        .map(|&id| {
+            let e = world.entity(id);
+            EntitySnapshot {
+                name: e.get::<Name>().map(|n| n.0.clone()),
+                pos: e.get::<Position>().map(|p| (p.0, p.1)),
+                vel: e.get::<Velocity>().map(|v| (v.0, v.1)),
+                goblin: e.contains::<Goblin>(),
+                miner: e.contains::<Miner>(),
+                carrier: e.contains::<Carrier>(),
+                job_queue: e.contains::<JobQueue>(),
+                has_assigned_job: e.contains::<AssignedJob>(),
+                assigned_job: e.get::<AssignedJob>().and_then(|a| a.0),
+                has_inventory: e.contains::<Inventory>(),
+                carrying: e.get::<Inventory>().and_then(|i| i.0).map(reference),
+                vision_radius: e.get::<VisionRadius>().map(|v| v.0),
+                item_type: e.get::<Item>().map(|i| i.item_type),
+                stone: e.contains::<Stone>(),
+                carriable: e.contains::<Carriable>(),
+                stack: e.get::<ItemStack>().map(|s| s.0),
+                mine_designation: e.contains::<MineDesignation>(),
+                designation_state: e.get::<DesignationLifecycle>().map(|l| l.0),
+                stockpile: e.contains::<Stockpile>(),
+                accepts: e.get::<Stockpile>().and_then(|s| s.accepts.clone()),
+                zone: e.get::<ZoneBounds>().cloned(),
+                faction: e.get::<Faction>().cloned(),
+                health: e.get::<Health>().cloned(),
+                combat_stats: e.get::<CombatStats>().cloned(),
+                attack_cooldown: e.get::<AttackCooldown>().cloned(),
+                combatant: e.contains::<Combatant>(),
+                dead: e.contains::<Dead>(),
+                target: e.get::<Target>().map(|t| reference(t.entity)),
+            }
+        })
+        .collect();
+
+    let map = world.resource::<GameMap>();
+    let (tick_ms, ticks) = match world.get_resource::<Time>() {
+        Some(time) => (time.tick_ms, time.ticks),
+        None => (100, 0),
+    };
+    let (master_seed, rng_positions) = match world.get_resource::<DeterministicRng>() {
+        Some(rng) => (rng.master_seed, rng.stream_positions()),
+        None => (0, [0; 4]),
+    };
+    let job_board = world
+        .get_resource::<JobBoard>()
+        .map(|board| board.iter().cloned().collect())
+        .unwrap_or_default();
+    let mut active_jobs: Vec<Job> = world
+        .get_resource::<ActiveJobs>()
+        .map(|active| active.jobs.values().cloned().collect())
+        .unwrap_or_default();
+    active_jobs.sort_unstable_by_key(|job| job.id);
+    let item_spawns = world
+        .get_resource::<ItemSpawnQueue>()
+        .map(|queue| {
+            let requests = queue.requests.iter();
+            requests.map(|r| (r.item_type, r.position)).collect()
+        })
+        .unwrap_or_default();
+
+    SimSnapshot {
+        width: map.width,
+        height: map.height,
+        tiles: map.row_major_tiles(),
+        tick_ms,
+        ticks,
+        master_seed,
+        rng_positions,
+        job_board,
+        active_jobs,
+        item_spawns,
+        auto_jobs: world
+            .get_resource::<DesignationConfig>()
+            .map(|c| c.auto_jobs),
+        assignment: world.get_resource::<AssignmentConfig>().map(|c| c.strategy),
+        item_stacking: world.get_resource::<ItemSpawnConfig>().map(|c| c.stack),
+        spatial_index: world.contains_resource::<SpatialIndex>(),
+        flow_fields: world.contains_resource::<FlowFieldService>(),
+        entities,
+    }
+}
+
+/// Restore a snapshot into an empty world
+/// Inserts the resources the default schedule needs plus `RestoredItems`,
+/// which keeps `auto_haul_system` from re-posting haul jobs for loaded items
+pub fn load_snapshot(snapshot: SimSnapshot, world: &mut World) {
+    world.insert_resource(GameMap::from_tiles(
+        snapshot.width,
+        snapshot.height,
+        snapshot.tiles,
+    ));
+    if let Some(mut paths) = world.get_resource_mut::<PathService>() {
+        paths.clear();
+    }
+    world.insert_resource(Time {
+        ticks: snapshot.ticks,
+        tick_ms: snapshot.tick_ms,
+    });
+    world.insert_resource(DeterministicRng::with_positions(
+        snapshot.master_seed,
+        snapshot.rng_positions,
+    ));
+    let mut board = JobBoard::default();
+    for job in snapshot.job_board {
+        board.push(job);
+    }
+    world.insert_resource(board);
+    world.insert_resource(ActiveJobs {
+        jobs: snapshot
+            .active_jobs
+            .into_iter()
+            .map(|j| (j.id, j))
+            .collect(),
+    });
+    world.insert_resource(ItemSpawnQueue {
+        requests: snapshot
+            .item_spawns
+            .into_iter()
+            .map(|(item_type, position)| ItemSpawnRequest {
+                item_type,
+                position,
+            })
+            .collect(),
+    });
+    if let Some(auto_jobs) = snapshot.auto_jobs {
+        world.insert_resource(DesignationConfig { auto_jobs });
+    }
+    if let Some(strategy) = snapshot.assignment {
+        world.insert_resource(AssignmentConfig { strategy });
+    }
+    if let Some(stack) = snapshot.item_stacking {
+        world.insert_resource(ItemSpawnConfig { stack });
+    }
+    if snapshot.spatial_index {
+        world.insert_resource(SpatialIndex::default());
+    }
+    if snapshot.flow_fields {
+        world.insert_resource(FlowFieldService::default());
+    }
+
+    // Reserve every handle first so references can point forwards
+    let ids: Vec<Entity> = (0..snapshot.entities.len())
+        .map(|_| world.spawn_empty().id())
+        .collect();
+    let resolve = |i: u32| ids.get(i as usize).copied().unwrap_or(Entity::PLACEHOLDER);
+    let mut restored = RestoredItems::default();
+    for (&id, e) in ids.iter().zip(snapshot.entities) {
+        let mut ec = world.entity_mut(id);
+        if let Some((x, y)) = e.pos {
+            ec.insert(Position(x, y));
+        }
+        if let Some(name) = e.name {
+            ec.insert(Name(name));
+        }
+        if let Some((vx, vy)) = e.vel {
+            ec.insert(Velocity(vx, vy));
+        }
+        if e.goblin {
+            ec.insert(Goblin);
+        }
+        if e.miner {
+            ec.insert(Miner);
+        }
+        if e.carrier {
+            ec.insert(Carrier);
+        }
+        if e.job_queue {
+            ec.insert(JobQueue);
+        }
+        if e.has_assigned_job {
+            ec.insert(AssignedJob(e.assigned_job));
+        }
+        if e.has_inventory {
+            ec.insert(Inventory(e.carrying.map(resolve)));
+        }
+        if let Some(radius) = e.vision_radius {
+            ec.insert(VisionRadius(radius));
+        }
+        if let Some(item_type) = e.item_type {
+            ec.insert(Item { item_type });
+            restored.0.insert(id);
+        }
+        if e.stone {
+            ec.insert(Stone);
+        }
+        if e.carriable {
+            ec.insert(Carriable);
+        }
+        if let Some(count) = e.stack {
+            ec.insert(ItemStack(count));
+        }
+        if e.mine_designation {
+            ec.insert(MineDesignation);
+        }
+        if let Some(state) = e.designation_state {
+            ec.insert(DesignationLifecycle(state));
+        }
+        if e.stockpile {
+            ec.insert(Stockpile { accepts: e.accepts });
+        }
+        if let Some(zone) = e.zone {
+            ec.insert(zone);
+        }
+        if let Some(faction) = e.faction {
+            ec.insert(faction);
+        }
+        if let Some(health) = e.health {
+            ec.insert(health);
+        }
+        if let Some(stats) = e.combat_stats {
+            ec.insert(stats);
+        }
+        if let Some(cooldown) = e.attack_cooldown {
+            ec.insert(cooldown);
+        }
+        if e.combatant {
+            ec.insert(Combatant);
+        }
+        if e.dead {
+            ec.insert(Dead);
+        }
+        if let Some(target) = e.target {
+            ec.insert(Target::new(resolve(target)));
+        }
+    }
+    world.insert_resource(restored);
+}
@@ -0,0 +1,209 @@
+//! Uniform-grid spatial index over entity positions and zones
+//!
+//! Tiles are grouped into `BUCKET` x `BUCKET` buckets. Each bucket lists the
+//! entities whose `Position` lies in it and the zones (`ZoneBounds`) that
+//! overlap it, so "what is on this tile" is a bucket lookup instead of a scan
+//! over every entity. `spatial_index_system` keeps the index in sync from
+//! `Changed` and removed components; lookups reflect the state as of its
+//! last run.
+
+use crate::components::ZoneBounds;
+use crate::world::Position;
+use bevy_ecs::prelude::*;
+use std::collections::HashMap;
+
+/// Side of a bucket in tiles
+pub const BUCKET: i32 = 8;
+
+/// Entities and zones registered in one bucket
+#[derive(Debug, Default)]
+struct Bucket {
+    points: Vec<(Entity, (i32, i32))>,
+    zones: Vec<Entity>,
+}
+
+/// Resource mapping tiles to the entities and zones on them
+#[derive(Resource, Debug, Default)]
+pub struct SpatialIndex {
+    buckets: HashMap<(i32, i32), Bucket>,
+    /// Indexed position of every point entity
+    points: HashMap<Entity, (i32, i32)>,
+    /// Indexed bounds of every zone entity
+    zones: HashMap<Entity, ZoneBounds>,
+}
+
+fn bucket_of(x: i32, y: i32) -> (i32, i32) {
+    (x.div_euclid(BUCKET), y.div_euclid(BUCKET))
+}
+
+/// Buckets overlapped by a zone
+fn zone_buckets(b: &ZoneBounds) -> impl Iterator<Item = (i32, i32)> {
+    let (bx0, by0) = bucket_of(b.min_x, b.min_y);
+    let (bx1, by1) = bucket_of(b.max_x, b.max_y);
+    (by0..=by1).flat_map(move |by| (bx0..=bx1).map(move |bx| (bx, by)))
+}
+
+impl SpatialIndex {
+    /// Record `entity` at `(x, y)`, moving it if it was indexed elsewhere
+    pub fn insert(&mut self, entity: Entity, x: i32, y: i32) {
+        if let Some(old) = self.points.insert(entity, (x, y)) {
+            if old == (x, y) {
+                return;
+            }
+            self.unlink_point(entity, old);
+        }
+        self.buckets
+            .entry(bucket_of(x, y))
+            .or_default()
+            .points
+            .push((entity, (x, y)));
+    }
+
+    /// Forget a point entity; returns its last indexed position
+    pub fn remove(&mut self, entity: Entity) -> Option<(i32, i32)> {
+        let old = self.points.remove(&entity)?;
+        self.unlink_point(entity, old);
+        Some(old)
+    }
+
+    fn unlink_point(&mut self, entity: Entity, pos: (i32, i32)) {
+        let key = bucket_of(pos.0, pos.1);
+        if let Some(bucket) = self.buckets.get_mut(&key) {
+            if let Some(k) = bucket.points.iter().position(|&(e, _)| e == entity) {
+                bucket.points.swap_remove(k);
+            }
+            if bucket.points.is_empty() && bucket.zones.is_empty() {
+                self.buckets.remove(&key);
+            }
+        }
+    }
+
+    /// Record a zone over every bucket it overlaps, replacing older bounds
+    pub fn insert_zone(&mut self, entity: Entity, bounds: &ZoneBounds) {
+        self.remove_zone(entity);
+        for key in zone_buckets(bounds) {
+            self.buckets.entry(key).or_default().zones.push(entity);
+        }
+        self.zones.insert(entity, bounds.clone());
+    }
+
+    /// Forget a zone; returns its last indexed bounds
+    pub fn remove_zone(&mut self, entity: Entity) -> Option<ZoneBounds> {
+        let old = self.zones.remove(&entity)?;
+        for key in zone_buckets(&old) {
+            if let Some(bucket) = self.buckets.get_mut(&key) {
+                bucket.zones.retain(|&e| e != entity);
+                if bucket.points.is_empty() && bucket.zones.is_empty() {
+                    self.buckets.remove(&key);
+                }
+            }
+        }
+        Some(old)
+    }
+
+    /// Indexed position of a point entity
+    pub fn position_of(&self, entity: Entity) -> Option<(i32, i32)> {
+        self.points.get(&entity).copied()
+    }
+
+    /// Number of indexed point entities
+    pub fn len(&self) -> usize {
+        self.points.len()
+    }
+
+    /// True if no point entity is indexed
+    pub fn is_empty(&self) -> bool {
+        self.points.is_empty()
+    }
+
+    /// Entities whose position is exactly `(x, y)`, in no particular order
+    pub fn entities_at(&self, x: i32, y: i32) -> impl Iterator<Item = Entity> + '_ {
+        self.buckets
+            .get(&bucket_of(x, y))
+            .into_iter()
+            .flat_map(|b| b.points.iter())
+            .filter(move |&&(_, p)| p == (x, y))
+            .map(|&(e, _)| e)
+    }
+
+    /// Entities positioned inside `bounds` (inclusive), in no particular order
+    pub fn entities_in(&self, bounds: &ZoneBounds) -> impl Iterator<Item = Entity> + '_ {
+        let bounds = bounds.clone();
+        zone_buckets(&bounds)
+            .filter_map(|key| self.buckets.get(&key))
+            .flat_map(|b| b.points.iter())
+            .filter(move |&&(_, (x, y))| bounds.contains(x, y))
+            .map(|&(e, _)| e)
+    }
+
+    /// Zones whose bounds contain `(x, y)`, in no particular order
+    pub fn zones_at(&self, x: i32, y: i32) -> impl Iterator<Item = Entity> + '_ {
+        self.buckets
+            .get(&bucket_of(x, y))
+            .into_iter()
+            .flat_map(|b| b.zones.iter())
+            .filter(move |e| self.zones.get(e).is_some_and(|b| b.contains(x, y)))
+            .copied()
+    }
+}
+
+/// Keep `SpatialIndex` in step with `Position` and `ZoneBounds` changes
+///
+/// Removals are applied before additions so a component removed and
+/// re-inserted since the last run ends up indexed.
+pub fn spatial_index_system(
+    mut index: ResMut<SpatialIndex>,
+    mut removed_points: RemovedComponents<Position>,
+    mut removed_zones: RemovedComponents<ZoneBounds>,
+    q_moved: Query<(Entity, &Position), Changed<Position>>,
+    q_zones: Query<(Entity, &ZoneBounds), Changed<ZoneBounds>>,
+) {
+    for entity in removed_points.read() {
+        index.remove(entity);
+    }
+    for entity in removed_zones.read() {
+        index.remove_zone(entity);
+    }
+    for (entity, pos) in q_moved.iter() {
+        index.insert(entity, pos.0, pos.1);
+    }
+    for (entity, bounds) in q_zones.iter() {
+        index.insert_zone(entity, bounds);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn points_and_zones_follow_updates() {
+        let (a, b, zone) = (
+            Entity::from_raw(1),
+            Entity::from_raw(2),
+            Entity::from_raw(3),
+        );
+
+        let mut index = SpatialIndex::default();
+        index.insert(a, 3, 3);
+        index.insert(b, -1, -9);
+        index.insert_zone(zone, &ZoneBounds::new(-4, -4, 20, 2));
+        assert_eq!(index.entities_at(3, 3).collect::<Vec<_>>(), [a]);
+        assert_eq!(index.entities_at(-1, -9).collect::<Vec<_>>(), [b]);
+        assert_eq!(index.zones_at(-4, 2).collect::<Vec<_>>(), [zone]);
+        assert_eq!(index.zones_at(3, 3).count(), 0);
+
+        index.insert(a, 17, 0);
+        assert_eq!(index.entities_at(3, 3).count(), 0);
+        let inside: Vec<_> = index.entities_in(&ZoneBounds::new(-4, -4, 20, 2)).collect();
+        assert_eq!(inside, [a]);
+
+        index.insert_zone(zone, &ZoneBounds::new(0, 0, 3, 3));
+        assert_eq!(index.zones_at(-4, 2).count(), 0);
+        assert_eq!(index.remove(b), Some((-1, -9)));
+        assert_eq!(index.remove_zone(zone).map(|z| z.max_x), Some(3));
+        assert_eq!(index.len(), 1);
+        // Only a's bucket is left
+        assert_eq!(index.buckets.len(), 1);
+    }
+}
@@ -1,6 +1,10 @@
-use crate::components::{Stockpile, ZoneBounds};
-use crate::world::Position;
+use crate::components::{ItemType, Stockpile, ZoneBounds};
+use crate::flow::FlowFieldService;
+use crate::jobs::JobId;
+use crate::spatial::SpatialIndex;
+use crate::world::{GameMap, Position};
 use bevy_ecs::prelude::*;
+use std::collections::{BTreeMap, BTreeSet, HashMap};
 
 /// Stockpile System for Item Storage and Organization
 ///
@@ -65,7 +69,11 @@ pub fn find_nearest_stockpile(
 /// Check if a position is within any stockpile zone
 /// Useful for determining if an item is already in a stockpile
 /// Returns true if the position overlaps with any stockpile bounds
+/// Uses the `SpatialIndex` resource when the world has one
 pub fn position_in_stockpile(world: &mut World, x: i32, y: i32) -> bool {
+    if world.contains_resource::<SpatialIndex>() {
+        return !find_stockpiles_at_position(world, x, y).is_empty();
+    }
     let mut query = world.query_filtered::<&ZoneBounds, With<Stockpile>>();
 
     for bounds in query.iter(world) {
@@ -79,7 +87,22 @@ pub fn position_in_stockpile(world: &mut World, x: i32, y: i32) -> bool {
 /// Find all stockpiles that contain a given position
 /// Returns a vector of entity IDs for all stockpiles overlapping the position
 /// Useful when stockpiles overlap or when you need to access all relevant stockpiles
+/// With a `SpatialIndex` resource only the zones indexed on that tile are checked,
+/// returned in entity order
 pub fn find_stockpiles_at_position(world: &mut World, x: i32, y: i32) -> Vec<Entity> {
+    if let Some(index) = world.get_resource::<SpatialIndex>() {
+        // Only zones on this tile's bucket are candidates; confirm against the
+        // live components in case the index has not caught up yet
+        let mut found: Vec<Entity> = index
+            .zones_at(x, y)
+            .filter(|&e| {
+                world.get::<Stockpile>(e).is_some()
+                    && world.get::<ZoneBounds>(e).is_some_and(|b| b.contains(x, y))
+            })
+            .collect();
+        found.sort_unstable();
+        return found;
+    }
     let mut query = world.query_filtered::<(Entity, &ZoneBounds), With<Stockpile>>();
 
     query
@@ -93,3 +116,323 @@ pub fn find_stockpiles_at_position(world: &mut World, x: i32, y: i32) -> Vec<Ent
         })
         .collect()
 }
+
+/// One stockpile as the planner sees it
+#[derive(Debug)]
+struct PlannedZone {
+    entity: Entity,
+    /// Drop point, and where straight-line distance is measured to
+    center: (i32, i32),
+    accepts: Option<Vec<ItemType>>,
+    /// Zone tiles, nearest to the center first; `None` for a stockpile
+    /// without `ZoneBounds`, which is a single unbounded drop point
+    slots: Option<Vec<(i32, i32)>>,
+    /// Indices into `slots` that are neither occupied nor reserved
+    free: BTreeSet<u32>,
+}
+
+impl PlannedZone {
+    fn accepts(&self, item_type: ItemType) -> bool {
+        self.accepts
+            .as_ref()
+            .map_or(true, |types| types.contains(&item_type))
+    }
+
+    /// Tile the next item should go to, or `None` if the zone is full
+    /// Walls inside the bounds are skipped rather than dropped from
+    /// `slots`, so mining one out opens it without a rebuild
+    fn open_slot(&self, map: Option<&GameMap>) -> Option<(i32, i32)> {
+        let Some(slots) = &self.slots else {
+            return Some(self.center);
+        };
+        self.free
+            .iter()
+            .map(|&i| slots[i as usize])
+            .find(|&(x, y)| map.map_or(true, |m| m.is_walkable(x, y)))
+    }
+}
+
+/// Free-slot index of every stockpile, used to send new items to concrete
+/// tiles
+///
+/// Every zone tile holds one item entity (a stack counts as one). A slot is
+/// free unless an item rests on it or a haul job still on the board or in
+/// `ActiveJobs` is headed there, so a batch of new items spreads over the
+/// zone instead of piling onto its center. Items that find no room wait in
+/// a backlog and are retried whenever a slot frees up.
+///
+/// All of it can be derived from the world (stockpiles, items and live haul
+/// jobs), which `rebuild` does. Between rebuilds `auto_haul_system` keeps it
+/// current from item moves, and `hauling_execution_system` hands back the
+/// slot of each haul job it completes, so a tick costs in proportion to
+/// what changed rather than to items times stockpiles or reservations.
+#[derive(Resource, Debug, Default)]
+pub struct StockpilePlanner {
+    /// Sorted by entity
+    zones: Vec<PlannedZone>,
+    /// Zoned tile -> (zone index, slot index); the lowest zone entity owns
+    /// tiles where zones overlap
+    slot_of: HashMap<(i32, i32), (usize, u32)>,
+    /// Item entities resting on each slot
+    occupants: HashMap<(i32, i32), u32>,
+    /// Slot each tracked item rests on
+    item_slot: HashMap<Entity, (i32, i32)>,
+    /// Slots promised to posted haul jobs
+    reserved: BTreeMap<(i32, i32), JobId>,
+    /// Items still waiting for room
+    backlog: BTreeSet<Entity>,
+    built: bool,
+    /// A slot became free since the backlog was last retried
+    freed: bool,
+}
+
+impl StockpilePlanner {
+    /// Whether `rebuild` has run
+    pub fn is_built(&self) -> bool {
+        self.built
+    }
+
+    /// Free slots of `stockpile`, walls included; `None` if it is unknown
+    /// or unbounded
+    pub fn free_slots(&self, stockpile: Entity) -> Option<usize> {
+        let i = self
+            .zones
+            .binary_search_by_key(&stockpile, |z| z.entity)
+            .ok()?;
+        self.zones[i]
+            .slots
+            .as_ref()
+            .map(|_| self.zones[i].free.len())
+    }
+
+    /// Items waiting for room
+    pub fn backlog(&self) -> impl Iterator<Item = Entity> + '_ {
+        self.backlog.iter().copied()
+    }
+
+    /// Recompute everything from the world
+    ///
+    /// `items` are all item entities with their type and tile, `haul_jobs`
+    /// the `(id, from, to)` of every haul job still waiting or active. Loose
+    /// items no job will pick up (the lowest entities on a tile go first,
+    /// as `hauling_execution_system` picks them) form the new backlog, to be
+    /// planned by the caller.
+    pub fn rebuild<'a>(
+        &mut self,
+        stockpiles: impl Iterator<Item = (Entity, &'a Stockpile, &'a Position, Option<&'a ZoneBounds>)>,
+        items: impl Iterator<Item = (Entity, ItemType, (i32, i32))>,
+        haul_jobs: impl Iterator<Item = (JobId, (i32, i32), (i32, i32))>,
+    ) {
+        self.zones = stockpiles
+            .map(|(entity, stockpile, pos, bounds)| {
+                let center = match bounds {
+                    Some(b) if !b.contains(pos.0, pos.1) => b.center(),
+                    _ => (pos.0, pos.1),
+                };
+                let slots = bounds.map(|b| {
+                    let mut tiles: Vec<(i32, i32)> = (b.min_y..=b.max_y)
+                        .flat_map(|y| (b.min_x..=b.max_x).map(move |x| (x, y)))
+                        .collect();
+                    tiles.sort_by_key(|&(x, y)| {
+                        let (dx, dy) = ((x - center.0).abs(), (y - center.1).abs());
+                        (dx.max(dy), dx + dy, y, x)
+                    });
+                    tiles
+                });
+                PlannedZone {
+                    entity,
+                    center,
+                    accepts: stockpile.accepts.clone(),
+                    slots,
+                    free: BTreeSet::new(),
+                }
+            })
+            .collect();
+        self.zones.sort_by_key(|z| z.entity);
+
+        self.slot_of.clear();
+        for (z, zone) in self.zones.iter().enumerate() {
+            for (i, &tile) in zone.slots.iter().flatten().enumerate() {
+                self.slot_of.entry(tile).or_insert((z, i as u32));
+            }
+        }
+        self.occupants.clear();
+        self.item_slot.clear();
+        let mut loose: BTreeMap<(i32, i32), Vec<Entity>> = BTreeMap::new();
+        for (item, item_type, tile) in items {
+            if self.slot_of.contains_key(&tile) {
+                *self.occupants.entry(tile).or_insert(0) += 1;
+                self.item_slot.insert(item, tile);
+            }
+            if !self.is_stored(item_type, tile) {
+                loose.entry(tile).or_default().push(item);
+            }
+        }
+        self.reserved.clear();
+        let mut picked: HashMap<(i32, i32), usize> = HashMap::new();
+        for (id, from, to) in haul_jobs {
+            if self.slot_of.contains_key(&to) {
+                self.reserved.insert(to, id);
+            }
+            *picked.entry(from).or_insert(0) += 1;
+        }
+        self.backlog.clear();
+        for (tile, mut items) in loose {
+            items.sort_unstable();
+            let skip = picked.get(&tile).copied().unwrap_or(0);
+            self.backlog.extend(items.into_iter().skip(skip));
+        }
+        for zone in &mut self.zones {
+            zone.free.clear();
+        }
+        for (&tile, &(z, i)) in &self.slot_of {
+            if !self.occupants.contains_key(&tile) && !self.reserved.contains_key(&tile) {
+                self.zones[z].free.insert(i);
+            }
+        }
+        self.built = true;
+        self.freed = true;
+    }
+
+    /// Track an item that now rests on `to`, or is gone if `None`
+    pub fn item_moved(&mut self, item: Entity, to: Option<(i32, i32)>) {
+        if to.is_none() {
+            self.backlog.remove(&item);
+        }
+        let to = to.filter(|t| self.slot_of.contains_key(t));
+        let from = self.item_slot.get(&item).copied();
+        if from == to {
+            return;
+        }
+        if let Some(from) = from {
+            self.item_slot.remove(&item);
+            let n = self.occupants.get_mut(&from).expect("tracked slot");
+            *n -= 1;
+            if *n == 0 {
+                self.occupants.remove(&from);
+                self.release(from);
+            }
+        }
+        if let Some(to) = to {
+            self.item_slot.insert(item, to);
+            *self.occupants.entry(to).or_insert(0) += 1;
+            let (z, i) = self.slot_of[&to];
+            self.zones[z].free.remove(&i);
+        }
+    }
+
+    /// Give up the slot `job` reserved on `to`; call when a haul job
+    /// completes or is dropped
+    pub fn release_job(&mut self, job: JobId, to: (i32, i32)) {
+        if self.reserved.get(&to) == Some(&job) {
+            self.reserved.remove(&to);
+            self.release(to);
+        }
+    }
+
+    /// Drop reservations whose job is neither waiting nor active any more
+    ///
+    /// Checks every reservation; only for planners that the systems ending
+    /// jobs cannot reach and so never call `release_job`
+    pub fn release_finished(&mut self, live: impl Fn(JobId) -> bool) {
+        let done: Vec<(i32, i32)> = self
+            .reserved
+            .iter()
+            .filter(|&(_, &id)| !live(id))
+            .map(|(&tile, _)| tile)
+            .collect();
+        for tile in done {
+            self.reserved.remove(&tile);
+            self.release(tile);
+        }
+    }
+
+    /// Free `tile` unless an item rests on it or a job is headed there
+    fn release(&mut self, tile: (i32, i32)) {
+        if self.occupants.contains_key(&tile) || self.reserved.contains_key(&tile) {
+            return;
+        }
+        if let Some(&(z, i)) = self.slot_of.get(&tile) {
+            self.zones[z].free.insert(i);
+            self.freed = true;
+        }
+    }
+
+    /// Whether an item of `item_type` on `tile` already sits in a
+    /// stockpile that takes it
+    pub fn is_stored(&self, item_type: ItemType, tile: (i32, i32)) -> bool {
+        if let Some(&(z, _)) = self.slot_of.get(&tile) {
+            return self.zones[z].accepts(item_type);
+        }
+        self.zones
+            .iter()
+            .any(|z| z.slots.is_none() && z.center == tile && z.accepts(item_type))
+    }
+
+    /// Target tile for an item of `item_type` on `from`: the first open
+    /// slot of the nearest stockpile that takes it and has room
+    ///
+    /// "Nearest" is by walking distance when every candidate has a flow
+    /// field and one is reachable, else by squared straight-line distance
+    /// to the stockpile center; ties go to the lowest entity.
+    pub fn plan(
+        &self,
+        item_type: ItemType,
+        from: (i32, i32),
+        map: Option<&GameMap>,
+        flow: Option<&FlowFieldService>,
+    ) -> Option<(i32, i32)> {
+        let candidates = || {
+            self.zones
+                .iter()
+                .filter(move |z| z.accepts(item_type))
+                .filter_map(move |z| z.open_slot(map).map(|slot| (z, slot)))
+        };
+        if let (Some(flow), Some(map)) = (flow, map) {
+            let mut best: Option<(u32, (i32, i32))> = None;
+            let mut complete = true;
+            for (zone, slot) in candidates() {
+                let Some(field) = flow.field(zone.entity) else {
+                    complete = false;
+                    break;
+                };
+                if let Some(d) = field.distance(map, from.0, from.1) {
+                    if best.map_or(true, |(bd, _)| d < bd) {
+                        best = Some((d, slot));
+                    }
+                }
+            }
+            if let (true, Some((_, slot))) = (complete, best) {
+                return Some(slot);
+            }
+        }
+        candidates()
+            .min_by_key(|(z, _)| {
+                let (dx, dy) = ((z.center.0 - from.0) as i64, (z.center.1 - from.1) as i64);
+                dx * dx + dy * dy
+            })
+            .map(|(_, slot)| slot)
+    }
+
+    /// Hold `tile` for `job` until the job leaves the board and `ActiveJobs`
+    pub fn reserve(&mut self, tile: (i32, i32), job: JobId) {
+        if let Some(&(z, i)) = self.slot_of.get(&tile) {
+            self.zones[z].free.remove(&i);
+            self.reserved.insert(tile, job);
+        }
+    }
+
+    /// Park `item` until a slot frees up
+    pub fn defer(&mut self, item: Entity) {
+        self.backlog.insert(item);
+    }
+
+    /// Take the backlog for another try if a slot freed up since the last
+    /// call; items that still find no room must be deferred again
+    pub fn take_retries(&mut self) -> Vec<Entity> {
+        if !std::mem::take(&mut self.freed) {
+            return Vec::new();
+        }
+        std::mem::take(&mut self.backlog).into_iter().collect()
+    }
+}
@@ -0,0 +1,238 @@
+//! Lazily generated worlds whose chunks exist only once touched
+//!
+//! `StreamingMap` yields the same terrain as `MapGenerator::generate` for the
+//! same size and seed, but generates each `CHUNK_SIZE` x `CHUNK_SIZE` chunk
+//! the first time one of its tiles is read or written. Chunks that were
+//! never modified can be evicted again because they regenerate identically,
+//! so memory follows the explored area rather than the world size.
+//!
+//! This is only the chunk store for a lazy world mode, not the mode
+//! itself. `build_standard_world` and the scheduled systems (pathing, FOV,
+//! designations) run on a fully allocated `GameMap`, whose tile array and
+//! walkable/opaque bit planes they borrow directly, so nothing in the
+//! simulation reads from a stream. Code that wants to work on one cuts a
+//! `window` of at most `MAX_WINDOW_TILES` tiles and hands its edits back
+//! with `write_back`; both copy the whole rectangle.
+
+use crate::mapgen::{terrain_noise, tile_at};
+use crate::world::{GameMap, TileKind, CHUNK_SIZE};
+use bevy_ecs::prelude::*;
+use noise::{Fbm, SuperSimplex};
+use std::collections::HashMap;
+
+/// Number of tiles in a chunk
+const CHUNK_AREA: usize = (CHUNK_SIZE * CHUNK_SIZE) as usize;
+
+/// Largest rectangle `StreamingMap::window` will copy (2048 x 2048 tiles)
+pub const MAX_WINDOW_TILES: u64 = 1 << 22;
+
+/// One resident chunk, tiles row-major within the chunk
+struct Chunk {
+    tiles: Box<[TileKind; CHUNK_AREA]>,
+    /// Access clock value of the last read or write
+    last_used: u64,
+    /// Edited since generation, so it cannot be evicted
+    modified: bool,
+}
+
+/// Counters describing chunk traffic of a `StreamingMap`
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct StreamStats {
+    /// Chunks generated from the seed, including regenerations
+    pub generated: usize,
+    /// Unmodified chunks dropped by `evict_cold`
+    pub evicted: usize,
+}
+
+/// World of `width` x `height` tiles generated chunk by chunk on demand
+#[derive(Resource)]
+pub struct StreamingMap {
+    width: u32,
+    height: u32,
+    noise: Fbm<SuperSimplex>,
+    chunks: HashMap<(i32, i32), Chunk>,
+    /// Bumped on every chunk access; orders chunks for eviction
+    clock: u64,
+    pub stats: StreamStats,
+}
+
+impl StreamingMap {
+    /// Empty stream over a world of the given size; nothing is generated yet
+    pub fn new(width: u32, height: u32, mapgen_seed: u32) -> Self {
+        Self {
+            width,
+            height,
+            noise: terrain_noise(mapgen_seed),
+            chunks: HashMap::new(),
+            clock: 0,
+            stats: StreamStats::default(),
+        }
+    }
+
+    /// Width of the world in tiles
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    /// Height of the world in tiles
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    /// Check if the given coordinates are within the world bounds
+    pub fn in_bounds(&self, x: i32, y: i32) -> bool {
+        x >= 0 && y >= 0 && (x as u32) < self.width && (y as u32) < self.height
+    }
+
+    /// Resident chunk `(cx, cy)`, generating it first if needed
+    fn chunk_mut(&mut self, cx: i32, cy: i32) -> &mut Chunk {
+        self.clock += 1;
+        let clock = self.clock;
+        let (width, height) = (self.width, self.height);
+        let noise = &self.noise;
+        let stats = &mut self.stats;
+        let chunk = self.chunks.entry((cx, cy)).or_insert_with(|| {
+            stats.generated += 1;
+            let mut tiles = Box::new([TileKind::Wall; CHUNK_AREA]);
+            for ly in 0..CHUNK_SIZE {
+                for lx in 0..CHUNK_SIZE {
+                    let (x, y) = (cx * CHUNK_SIZE + lx, cy * CHUNK_SIZE + ly);
+                    // Past the world edge stays Wall, like off-map tiles
+                    if (x as u32) < width && (y as u32) < height {
+                        tiles[(ly * CHUNK_SIZE + lx) as usize] =
+                            tile_at(noise, width, height, x as u32, y as u32);
+                    }
+                }
+            }
+            Chunk {
+                tiles,
+                last_used: 0,
+                modified: false,
+            }
+        });
+        chunk.last_used = clock;
+        chunk
+    }
+
+    /// Get the tile type at the specified coordinates, generating its chunk
+    /// Returns None if coordinates are out of bounds
+    pub fn get_tile(&mut self, x: i32, y: i32) -> Option<TileKind> {
+        if !self.in_bounds(x, y) {
+            return None;
+        }
+        let chunk = self.chunk_mut(x / CHUNK_SIZE, y / CHUNK_SIZE);
+        Some(chunk.tiles[local_index(x, y)])
+    }
+
+    /// Set the tile type at the specified coordinates
+    /// Returns true if the tile was set, false if out of bounds
+    /// A changed chunk is pinned in memory from then on
+    pub fn set_tile(&mut self, x: i32, y: i32, kind: TileKind) -> bool {
+        if !self.in_bounds(x, y) {
+            return false;
+        }
+        let chunk = self.chunk_mut(x / CHUNK_SIZE, y / CHUNK_SIZE);
+        let tile = &mut chunk.tiles[local_index(x, y)];
+        if *tile != kind {
+            *tile = kind;
+            chunk.modified = true;
+        }
+        true
+    }
+
+    /// Check if a tile can be walked through; false off the world
+    pub fn is_walkable(&mut self, x: i32, y: i32) -> bool {
+        self.get_tile(x, y).is_some_and(TileKind::is_walkable)
+    }
+
+    /// Number of chunks currently held in memory
+    pub fn resident_chunks(&self) -> usize {
+        self.chunks.len()
+    }
+
+    /// True if chunk `(cx, cy)` is held in memory
+    pub fn is_resident(&self, cx: i32, cy: i32) -> bool {
+        self.chunks.contains_key(&(cx, cy))
+    }
+
+    /// Drop least recently used unmodified chunks until at most
+    /// `max_resident` chunks remain (or only modified ones are left)
+    /// Returns the number of chunks evicted
+    pub fn evict_cold(&mut self, max_resident: usize) -> usize {
+        let excess = self.chunks.len().saturating_sub(max_resident);
+        if excess == 0 {
+            return 0;
+        }
+        let mut cold: Vec<(u64, (i32, i32))> = self
+            .chunks
+            .iter()
+            .filter(|(_, c)| !c.modified)
+            .map(|(&key, c)| (c.last_used, key))
+            .collect();
+        cold.sort_unstable();
+        cold.truncate(excess);
+        for (_, key) in &cold {
+            self.chunks.remove(key);
+        }
+        self.stats.evicted += cold.len();
+        cold.len()
+    }
+
+    /// Copy the `width` x `height` rectangle at `(x0, y0)` into a fresh
+    /// `GameMap`, generating the chunks it covers
+    /// Window tile `(x, y)` is world tile `(x0 + x, y0 + y)`; parts outside
+    /// the world are Wall
+    ///
+    /// `None` if the rectangle exceeds `MAX_WINDOW_TILES`; a window is a
+    /// full copy, so it should cover a pathing or FOV region, not the world.
+    pub fn window(&mut self, x0: i32, y0: i32, width: u32, height: u32) -> Option<GameMap> {
+        if width as u64 * height as u64 > MAX_WINDOW_TILES {
+            return None;
+        }
+        let mut tiles = vec![TileKind::Wall; (width * height) as usize];
+        let (x1, y1) = (x0 + width as i32, y0 + height as i32);
+        // Clip to the world, then copy chunk rows a run at a time
+        let (cx0, cy0) = (x0.max(0), y0.max(0));
+        let (cx1, cy1) = (x1.min(self.width as i32), y1.min(self.height as i32));
+        for y in cy0..cy1 {
+            let mut x = cx0;
+            while x < cx1 {
+                let run = (CHUNK_SIZE - x % CHUNK_SIZE).min(cx1 - x);
+                let chunk = self.chunk_mut(x / CHUNK_SIZE, y / CHUNK_SIZE);
+                let src = local_index(x, y);
+                let dst = ((y - y0) * width as i32 + (x - x0)) as usize;
+                tiles[dst..dst + run as usize]
+                    .copy_from_slice(&chunk.tiles[src..src + run as usize]);
+                x += run;
+            }
+        }
+        Some(GameMap::from_tiles(width, height, tiles))
+    }
+
+    /// Apply the edits made to a map returned by `window(x0, y0, ..)`
+    /// Only the window's changed chunks are compared; returns the number
+    /// of world tiles that changed
+    pub fn write_back(&mut self, x0: i32, y0: i32, window: &GameMap) -> usize {
+        let mut changed = 0;
+        let dirty: Vec<(i32, i32)> = window.changed_chunks_since(0).collect();
+        for (cx, cy) in dirty {
+            let (wx0, wy0) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+            for y in wy0..(wy0 + CHUNK_SIZE).min(window.height as i32) {
+                for x in wx0..(wx0 + CHUNK_SIZE).min(window.width as i32) {
+                    let kind = window.get_tile(x, y).expect("window tile");
+                    let (wx, wy) = (x0 + x, y0 + y);
+                    if self.get_tile(wx, wy).is_some_and(|t| t != kind) {
+                        self.set_tile(wx, wy, kind);
+                        changed += 1;
+                    }
+                }
+            }
+        }
+        changed
+    }
+}
+
+/// Index of an in-bounds world tile within its chunk
+fn local_index(x: i32, y: i32) -> usize {
+    ((y % CHUNK_SIZE) * CHUNK_SIZE + x % CHUNK_SIZE) as usize
+}
@@ -1,10 +1,14 @@
+use crate::actions::{Action, ActionLog};
 use crate::components::*;
+use crate::flow::FlowFieldService;
 use crate::jobs::*;
+use crate::spatial::SpatialIndex;
+use crate::stockpiles::StockpilePlanner;
 use crate::world::*;
 use bevy_ecs::prelude::*;
-use rand::rngs::StdRng;
 use rand::SeedableRng;
-use std::collections::HashMap;
+use rand_chacha::ChaCha12Rng;
+use std::collections::{HashMap, HashSet};
 
 /// Core Systems for Goblin Camp Simulation
 ///
@@ -41,13 +45,13 @@ pub struct DeterministicRng {
     /// Master seed for reproducibility - can be used to recreate entire simulation
     pub master_seed: u64,
     /// RNG stream for terrain generation and map creation
-    pub mapgen_rng: StdRng,
+    pub mapgen_rng: ChaCha12Rng,
     /// RNG stream for job selection and UUID generation
-    pub job_rng: StdRng,
+    pub job_rng: ChaCha12Rng,
     /// RNG stream for combat calculations (future use)
-    pub combat_rng: StdRng,
+    pub combat_rng: ChaCha12Rng,
     /// RNG stream for pathfinding randomization (future use)
-    pub pathfinding_rng: StdRng,
+    pub pathfinding_rng: ChaCha12Rng,
 }
 
 impl DeterministicRng {
@@ -55,24 +59,80 @@ impl DeterministicRng {
     /// Uses different offsets to ensure each stream is independent
     /// All streams derived from the same master seed for reproducibility
     pub fn new(seed: u64) -> Self {
+        // ChaCha12 is the generator behind `StdRng`, so streams match the
+        // `StdRng` ones for the same seed; unlike `StdRng` it exposes its
+        // position, which lets saves resume a stream mid-way
+        let stream = |offset: u64| {
+            ChaCha12Rng::seed_from_u64(seed.wrapping_mul(0x9e3779b9).wrapping_add(offset))
+        };
         Self {
             master_seed: seed,
             // Use different multipliers and offsets to create independent streams
-            mapgen_rng: StdRng::seed_from_u64(seed.wrapping_mul(0x9e3779b9).wrapping_add(0)),
-            job_rng: StdRng::seed_from_u64(seed.wrapping_mul(0x9e3779b9).wrapping_add(1)),
-            combat_rng: StdRng::seed_from_u64(seed.wrapping_mul(0x9e3779b9).wrapping_add(2)),
-            pathfinding_rng: StdRng::seed_from_u64(seed.wrapping_mul(0x9e3779b9).wrapping_add(3)),
+            mapgen_rng: stream(0),
+            job_rng: stream(1),
+            combat_rng: stream(2),
+            pathfinding_rng: stream(3),
         }
     }
+
+    /// Number of 32-bit words drawn from each stream, in field order
+    /// Together with `master_seed` this is the complete RNG state
+    pub fn stream_positions(&self) -> [u64; 4] {
+        [
+            &self.mapgen_rng,
+            &self.job_rng,
+            &self.combat_rng,
+            &self.pathfinding_rng,
+        ]
+        .map(|rng| rng.get_word_pos() as u64)
+    }
+
+    /// Streams for `seed` advanced to `positions` (see `stream_positions`)
+    pub fn with_positions(seed: u64, positions: [u64; 4]) -> Self {
+        let mut rng = Self::new(seed);
+        let streams = [
+            &mut rng.mapgen_rng,
+            &mut rng.job_rng,
+            &mut rng.combat_rng,
+            &mut rng.pathfinding_rng,
+        ];
+        for (stream, pos) in streams.into_iter().zip(positions) {
+            stream.set_word_pos(pos as u128);
+        }
+        rng
+    }
+}
+
+/// Phases of a tick, run in declaration order by `build_default_schedule`
+///
+/// Systems inside one phase may run in parallel, so any two that touch the
+/// same data are ordered explicitly or declared order-independent.
+#[derive(SystemSet, Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub enum SimSet {
+    /// Shell and player commands; refreshes the spatial index with
+    /// everything that changed since the last tick
+    Input,
+    /// Designation dedup and conversion to jobs
+    Designations,
+    /// Job assignment and flow field upkeep
+    Planning,
+    /// Movement and job execution
+    Execution,
+    /// Systems that observe the settled world: FOV, haul posting for new items
+    Perception,
+    /// Tick counter and world hash
+    Cleanup,
 }
 
-/// Movement system (runs early in the schedule)
+/// Movement system (runs in `SimSet::Execution`)
 /// Applies velocity to position for all entities with both components
 /// This is a basic kinematic system for entity movement
+/// Only writes positions that actually change, so `Changed<Position>` stays
+/// meaningful for downstream systems such as FOV
 pub fn movement(mut q: Query<(&mut Position, &Velocity)>) {
     for (mut pos, vel) in q.iter_mut() {
-        pos.0 += vel.0;
-        pos.1 += vel.1;
+        let next = Position(pos.0 + vel.0, pos.1 + vel.1);
+        pos.set_if_neq(next);
     }
 }
 
@@ -81,8 +141,11 @@ pub fn movement(mut q: Query<(&mut Position, &Velocity)>) {
 /// Clamps positions to the map boundaries for safety
 pub fn confine_to_map(map: Res<GameMap>, mut q: Query<&mut Position>) {
     for mut pos in q.iter_mut() {
-        pos.0 = pos.0.clamp(0, map.width as i32 - 1);
-        pos.1 = pos.1.clamp(0, map.height as i32 - 1);
+        let clamped = Position(
+            pos.0.clamp(0, map.width as i32 - 1),
+            pos.1.clamp(0, map.height as i32 - 1),
+        );
+        pos.set_if_neq(clamped);
     }
 }
 
@@ -97,13 +160,14 @@ pub fn advance_time(mut time: ResMut<Time>) {
 /// This is the core mining system that executes mining jobs assigned to Miner entities
 /// Miners must be adjacent to (or at) the target tile to successfully mine it
 /// Mining converts Wall tiles to Floor tiles and spawns Stone items at the mined location
+/// Miners go in `Entity` order, which fixes the order stones are spawned in
 pub fn mining_execution_system(
     mut commands: Commands,
     mut map: ResMut<GameMap>,
     mut active_jobs: ResMut<ActiveJobs>,
-    mut q_miners: Query<(&mut AssignedJob, &Position), With<Miner>>,
+    mut q_miners: Query<(Entity, (&mut AssignedJob, &Position)), With<Miner>>,
 ) {
-    for (mut assigned_job, miner_pos) in q_miners.iter_mut() {
+    for (_, (mut assigned_job, miner_pos)) in in_entity_order(q_miners.iter_mut()) {
         if let Some(job_id) = assigned_job.0 {
             if let Some(job) = active_jobs.jobs.get(&job_id) {
                 if let JobKind::Mine { x, y } = job.kind {
@@ -117,15 +181,7 @@ pub fn mining_execution_system(
 
                         // Spawn a stone item at the mined location
                         // Items are full entities with position and carriable properties
-                        commands.spawn((
-                            Item {
-                                item_type: crate::components::ItemType::Stone,
-                            },
-                            Stone,
-                            Position(x, y),
-                            Carriable,
-                            Name("Stone".to_string()),
-                        ));
+                        commands.spawn(StoneBundle::at(x, y));
 
                         // Complete job - remove from active jobs and clear assignment
                         active_jobs.jobs.remove(&job_id);
@@ -145,15 +201,44 @@ pub fn mining_execution_system(
 /// This is a complex system that handles item transportation from pickup to delivery
 /// Uses a multi-pass approach to avoid borrowing conflicts and ensure consistent state
 /// Supports both immediate delivery (pickup+drop in one tick) and staged hauling
+/// Pickups and deliveries are recorded in the `ActionLog`, if there is one
+/// Completed jobs release their `StockpilePlanner` slot reservations
 #[allow(clippy::type_complexity)]
 pub fn hauling_execution_system(
-    _commands: Commands,
     mut active_jobs: ResMut<ActiveJobs>,
+    mut planner: Option<ResMut<StockpilePlanner>>,
+    index: Option<Res<SpatialIndex>>,
+    mut log: Option<ResMut<ActionLog>>,
+    time: Option<Res<Time>>,
     mut param_set: ParamSet<(
-        Query<(&mut AssignedJob, &mut Inventory, &mut Position), (With<Carrier>, Without<Miner>)>,
+        Query<
+            (Entity, &mut AssignedJob, &mut Inventory, &mut Position),
+            (With<Carrier>, Without<Miner>),
+        >,
         Query<(Entity, &mut Position), (With<Item>, With<Carriable>)>,
     )>,
 ) {
+    /// Carriable item on a tile, lowest entity first: through the spatial
+    /// index when there is one, else by a full scan
+    fn item_at<'a>(
+        index: Option<&SpatialIndex>,
+        items: &Query<(Entity, &'a mut Position), (With<Item>, With<Carriable>)>,
+        (x, y): (i32, i32),
+    ) -> Option<Entity> {
+        match index {
+            Some(index) => index
+                .entities_at(x, y)
+                .filter(|&e| items.get(e).is_ok_and(|(_, pos)| pos.0 == x && pos.1 == y))
+                .min(),
+            None => items
+                .iter()
+                .filter(|(_, pos)| pos.0 == x && pos.1 == y)
+                .map(|(e, _)| e)
+                .min(),
+        }
+    }
+
+    let index = index.as_deref();
     // Internal structs for tracking planned updates
     // This approach prevents borrowing conflicts by collecting all planned changes first
 
@@ -183,7 +268,8 @@ pub fn hauling_execution_system(
     // Examines all carriers with haul jobs and determines what actions to take
     {
         let q_carriers = param_set.p0();
-        for (assigned_job, inventory, carrier_pos) in q_carriers.iter() {
+        let carriers = q_carriers.iter().map(|(e, j, i, p)| (e, (j, i, p)));
+        for (_, (assigned_job, inventory, carrier_pos)) in in_entity_order(carriers) {
             if let Some(job_id) = assigned_job.0 {
                 if let Some(job) = active_jobs.jobs.get(&job_id) {
                     if let JobKind::Haul { from, to } = job.kind {
@@ -239,27 +325,19 @@ pub fn hauling_execution_system(
         for carrier_update in &mut carrier_updates {
             if !carrier_update.dropping {
                 // Carrier needs to pick up an item
-                let pickup_pos = carrier_update.target;
-                for (item_entity, item_pos) in q_items.iter() {
-                    if item_pos.0 == pickup_pos.0 && item_pos.1 == pickup_pos.1 {
-                        // Mark that we can pick up the item this tick at pickup position
-                        carrier_update.pickup_item = Some(item_entity);
-                        break;
-                    }
+                // Mark that we can pick up the item this tick at pickup position
+                if let Some(item_entity) = item_at(index, &q_items, carrier_update.target) {
+                    carrier_update.pickup_item = Some(item_entity);
                 }
             } else if carrier_update.pickup_item.is_none() {
                 // Immediate deliver path: find item at 'from' and move it to target in the same tick.
                 // This supports single-tick hauling for simple test scenarios
-                let pickup_pos = carrier_update.from;
-                for (item_entity, item_pos) in q_items.iter() {
-                    if item_pos.0 == pickup_pos.0 && item_pos.1 == pickup_pos.1 {
-                        item_updates.push(ItemUpdate {
-                            entity: item_entity,
-                            target: carrier_update.target,
-                        });
-                        completed_jobs.push(carrier_update.job_id);
-                        break;
-                    }
+                if let Some(item_entity) = item_at(index, &q_items, carrier_update.from) {
+                    item_updates.push(ItemUpdate {
+                        entity: item_entity,
+                        target: carrier_update.target,
+                    });
+                    completed_jobs.push(carrier_update.job_id);
                 }
             }
         }
@@ -274,22 +352,30 @@ pub fn hauling_execution_system(
 
     // Third pass: apply carrier updates
     // Updates carrier positions, inventories, and job assignments
+    let tick = time.map_or(0, |t| t.ticks);
     {
         let mut q_carriers = param_set.p0();
-        for (mut assigned_job, mut inventory, mut carrier_pos) in q_carriers.iter_mut() {
+        for (worker, mut assigned_job, mut inventory, mut carrier_pos) in q_carriers.iter_mut() {
             if let Some(job_id) = assigned_job.0 {
                 if let Some(update) = update_map.get(&job_id) {
                     // Update carrier position to target location
-                    carrier_pos.0 = update.target.0;
-                    carrier_pos.1 = update.target.1;
+                    carrier_pos.set_if_neq(Position(update.target.0, update.target.1));
 
+                    let job = job_id;
                     if update.dropping {
                         // Dropping item - clear inventory and complete job
                         inventory.0 = None;
                         assigned_job.0 = None;
-                    } else if let Some(item_entity) = update.pickup_item {
+                        if let Some(log) = log.as_mut() {
+                            let (x, y) = update.target;
+                            log.log(tick, Action::Delivered { worker, job, x, y });
+                        }
+                    } else if let Some(item) = update.pickup_item {
                         // Picking up item - add to inventory
-                        inventory.0 = Some(item_entity);
+                        inventory.0 = Some(item);
+                        if let Some(log) = log.as_mut() {
+                            log.log(tick, Action::PickedUp { worker, item, job });
+                        }
                     }
                 }
             }
@@ -302,64 +388,144 @@ pub fn hauling_execution_system(
         let mut q_items = param_set.p1();
         for upd in item_updates {
             if let Ok((_, mut item_pos)) = q_items.get_mut(upd.entity) {
-                item_pos.0 = upd.target.0;
-                item_pos.1 = upd.target.1;
+                item_pos.set_if_neq(Position(upd.target.0, upd.target.1));
             }
         }
     }
 
     // Mark completed jobs as done in ActiveJobs
-    // Removes completed haul jobs from the active job tracker
+    // Removes completed haul jobs from the active job tracker and frees the
+    // stockpile slot each one had reserved
     for job_id in completed_jobs.into_iter() {
-        active_jobs.jobs.remove(&job_id);
+        let Some(job) = active_jobs.jobs.remove(&job_id) else {
+            continue;
+        };
+        if let (Some(planner), JobKind::Haul { to, .. }) = (planner.as_mut(), job.kind) {
+            planner.release_job(job_id, to);
+        }
     }
 }
 
+/// Query results sorted by `Entity`
+///
+/// Query order follows archetype and table layout, which depends on how
+/// entities were built and is not reproduced by `load_snapshot`. Systems
+/// whose outcome depends on visiting order iterate through this instead.
+pub fn in_entity_order<T>(items: impl Iterator<Item = (Entity, T)>) -> Vec<(Entity, T)> {
+    let mut items: Vec<(Entity, T)> = items.collect();
+    items.sort_unstable_by_key(|item| item.0);
+    items
+}
+
+/// Items loaded from a snapshot; they show up as `Added<Item>` in the
+/// restored world, but `auto_haul_system` already handled them before the
+/// save, so it skips them once and then clears the set
+#[derive(Resource, Debug, Default)]
+pub struct RestoredItems(pub HashSet<Entity>);
+
 /// Automatically create haul jobs when items are spawned and stockpiles exist
 /// This system creates hauling jobs for newly spawned items (like from mining)
 /// Uses the `Added<Item>` filter to only process items created this tick
-/// Finds the nearest stockpile and creates a haul job from item to stockpile
+/// Each item is sent to a free slot of the nearest stockpile that accepts it
+/// (see `StockpilePlanner`), and the slot stays reserved until
+/// `hauling_execution_system` completes the job
+/// With a `FlowFieldService` and `GameMap`, "nearest" is by walking distance
+/// Items that find no room wait for a slot to free up
+#[allow(clippy::too_many_arguments, clippy::type_complexity)]
 pub fn auto_haul_system(
     mut job_board: ResMut<JobBoard>,
     mut rng: ResMut<DeterministicRng>,
-    q_items: Query<&Position, (With<Item>, Added<Item>)>,
-    q_stockpiles: Query<&Position, With<Stockpile>>,
+    active: Option<Res<ActiveJobs>>,
+    flow: Option<Res<FlowFieldService>>,
+    map: Option<Res<GameMap>>,
+    restored: Option<ResMut<RestoredItems>>,
+    mut planner: Option<ResMut<StockpilePlanner>>,
+    mut local_planner: Local<StockpilePlanner>,
+    q_items: Query<Entity, Added<Item>>,
+    q_moved: Query<(Entity, &Position), (With<Item>, Changed<Position>)>,
+    q_all_items: Query<(Entity, &Item, &Position)>,
+    q_stockpiles: Query<(Entity, &Stockpile, &Position, Option<&ZoneBounds>)>,
+    q_stockpile_edits: Query<
+        (),
+        (
+            With<Stockpile>,
+            Or<(Changed<Stockpile>, Changed<Position>, Changed<ZoneBounds>)>,
+        ),
+    >,
+    mut removed_items: RemovedComponents<Item>,
+    mut removed_stockpiles: RemovedComponents<Stockpile>,
 ) {
-    // Find nearest stockpile for each new item
-    for item_pos in q_items.iter() {
-        if let Some(stockpile_pos) = find_nearest_stockpile(&q_stockpiles, item_pos) {
-            add_job(
-                &mut job_board,
-                JobKind::Haul {
-                    from: (item_pos.0, item_pos.1),
-                    to: (stockpile_pos.0, stockpile_pos.1),
-                },
-                &mut rng.job_rng,
-            );
+    // A private planner gets no releases from the systems that end jobs
+    let private = planner.is_none();
+    let planner = match planner.as_deref_mut() {
+        Some(planner) => planner,
+        None => &mut *local_planner,
+    };
+    let active = active.as_deref();
+
+    let stockpiles_changed = removed_stockpiles.read().count() > 0 || !q_stockpile_edits.is_empty();
+    let mut candidates: Vec<Entity> = if !planner.is_built() || stockpiles_changed {
+        removed_items.clear();
+        let mut hauls: Vec<(JobId, (i32, i32), (i32, i32))> = job_board
+            .iter_category(JobCategory::Haul)
+            .chain(active.into_iter().flat_map(|a| a.jobs.values()))
+            .filter_map(|job| match job.kind {
+                JobKind::Haul { from, to } => Some((job.id, from, to)),
+                _ => None,
+            })
+            .collect();
+        hauls.sort_unstable_by_key(|&(id, _, _)| id.0);
+        planner.rebuild(
+            q_stockpiles.iter(),
+            q_all_items
+                .iter()
+                .map(|(e, item, pos)| (e, item.item_type, (pos.0, pos.1))),
+            hauls.into_iter(),
+        );
+        planner.take_retries()
+    } else {
+        for item in removed_items.read() {
+            planner.item_moved(item, None);
+        }
+        for (item, pos) in q_moved.iter() {
+            planner.item_moved(item, Some((pos.0, pos.1)));
+        }
+        if private {
+            let board = &job_board;
+            planner.release_finished(|id| {
+                board.contains(id) || active.is_some_and(|a| a.jobs.contains_key(&id))
+            });
+        }
+        let restored = restored.as_deref().filter(|r| !r.0.is_empty());
+        let mut candidates: Vec<Entity> = q_items
+            .iter()
+            .filter(|item| !restored.is_some_and(|r| r.0.contains(item)))
+            .collect();
+        candidates.extend(planner.take_retries());
+        candidates
+    };
+    if let Some(mut restored) = restored {
+        if !restored.0.is_empty() {
+            restored.0.clear();
         }
     }
-}
-
-/// Helper function to find the nearest stockpile to an item
-/// Uses Euclidean distance to determine the closest stockpile
-/// Returns None if no stockpiles exist in the world
-fn find_nearest_stockpile(
-    stockpiles: &Query<&Position, With<Stockpile>>,
-    item_pos: &Position,
-) -> Option<Position> {
-    let mut nearest: Option<Position> = None;
-    let mut min_distance = f32::INFINITY;
-
-    for stockpile_pos in stockpiles.iter() {
-        let dx = (stockpile_pos.0 - item_pos.0) as f32;
-        let dy = (stockpile_pos.1 - item_pos.1) as f32;
-        let distance = (dx * dx + dy * dy).sqrt();
+    candidates.sort_unstable();
+    candidates.dedup();
 
-        if distance < min_distance {
-            min_distance = distance;
-            nearest = Some(*stockpile_pos);
+    for item in candidates {
+        let Ok((_, &Item { item_type }, pos)) = q_all_items.get(item) else {
+            continue;
+        };
+        let from = (pos.0, pos.1);
+        if planner.is_stored(item_type, from) {
+            continue;
+        }
+        match planner.plan(item_type, from, map.as_deref(), flow.as_deref()) {
+            Some(to) => {
+                let id = add_job(&mut job_board, JobKind::Haul { from, to }, &mut rng.job_rng);
+                planner.reserve(to, id);
+            }
+            None => planner.defer(item),
         }
     }
-
-    nearest
 }
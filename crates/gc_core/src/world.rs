@@ -1,5 +1,7 @@
+use crate::bitgrid::BitPlane;
 use bevy_ecs::prelude::*;
 use serde::{Deserialize, Serialize};
+use std::sync::atomic::{AtomicU64, Ordering};
 
 /// World Representation and Core Spatial Components
 ///
@@ -23,6 +25,18 @@ pub enum TileKind {
     Lava,
 }
 
+impl TileKind {
+    /// Whether entities can walk on this tile; only Floor for now
+    pub fn is_walkable(self) -> bool {
+        matches!(self, TileKind::Floor)
+    }
+
+    /// Whether this tile blocks line of sight
+    pub fn is_opaque(self) -> bool {
+        matches!(self, TileKind::Wall)
+    }
+}
+
 /// Configuration structure for map generation
 /// Contains parameters needed to generate new game maps
 #[derive(Clone, Debug, Serialize, Deserialize)]
@@ -50,34 +64,235 @@ pub struct Velocity(pub i32, pub i32);
 #[derive(Component, Debug)]
 pub struct Name(pub String);
 
+/// Edge length of a map chunk in tiles
+/// Tile changes are tracked per chunk so caches can invalidate locally
+pub const CHUNK_SIZE: i32 = 16;
+
+/// Number of tiles in a full chunk
+const CHUNK_AREA: usize = (CHUNK_SIZE * CHUNK_SIZE) as usize;
+
+/// Order in which `GameMap::tiles` stores the map
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub enum TileLayout {
+    /// One row after another: index = y * width + x
+    RowMajor,
+    /// `CHUNK_SIZE` x `CHUNK_SIZE` chunks one after another (row-major over
+    /// the chunk grid), each stored row-major; a tile and its vertical
+    /// neighbours usually share a chunk, so they are `CHUNK_SIZE` apart
+    /// instead of a whole map row. Edge chunks are padded to full size.
+    #[default]
+    Chunked,
+}
+
+/// Summary of one chunk, kept current by `set_tile`
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+pub struct ChunkMeta {
+    /// Map version at the last change inside the chunk; 0 means "never changed"
+    pub version: u64,
+    /// On-map tiles of each `TileKind` in the chunk, indexed by `kind as usize`
+    counts: [u16; 4],
+}
+
+impl ChunkMeta {
+    /// Number of on-map tiles of `kind` in the chunk
+    pub fn count(&self, kind: TileKind) -> usize {
+        self.counts[kind as usize] as usize
+    }
+
+    /// The single tile kind filling the chunk, if it is uniform
+    pub fn uniform(&self) -> Option<TileKind> {
+        let total: u16 = self.counts.iter().sum();
+        [
+            TileKind::Floor,
+            TileKind::Wall,
+            TileKind::Water,
+            TileKind::Lava,
+        ]
+        .into_iter()
+        .find(|&k| self.counts[k as usize] == total)
+    }
+
+    /// True if every tile of the chunk is floor
+    pub fn all_floor(&self) -> bool {
+        self.uniform() == Some(TileKind::Floor)
+    }
+
+    /// True if every tile of the chunk is wall
+    pub fn all_wall(&self) -> bool {
+        self.uniform() == Some(TileKind::Wall)
+    }
+}
+
 /// Resource representing the game world as a 2D tile-based map
 /// This is the primary spatial representation of the game world,
 /// storing all terrain and structural information
-#[derive(Resource, Debug, Clone)]
+#[derive(Resource, Debug)]
 pub struct GameMap {
     /// Width of the map in tiles
     pub width: u32,
     /// Height of the map in tiles
     pub height: u32,
-    /// Flat vector storing all tiles in row-major order
-    /// Index calculation: y * width + x
-    pub tiles: Vec<TileKind>,
+    /// Flat vector storing all tiles in the order given by `layout`
+    /// Private so every write goes through `set_tile` and keeps the
+    /// version and chunk summaries current
+    tiles: Vec<TileKind>,
+    layout: TileLayout,
+    /// Number of chunks along the x axis
+    chunks_x: i32,
+    /// Monotonic change counter, bumped by every effective `set_tile`
+    version: u64,
+    /// Identifies this map instance; see `epoch`
+    epoch: u64,
+    /// Per-chunk summaries, row-major over the chunk grid
+    chunks: Vec<ChunkMeta>,
+    /// `TileKind::is_walkable` per tile; the border is not walkable
+    walkable: BitPlane,
+    /// `TileKind::is_opaque` per tile; the border is opaque
+    opaque: BitPlane,
+}
+
+/// Source of `GameMap::epoch`; 0 is never handed out
+static NEXT_EPOCH: AtomicU64 = AtomicU64::new(1);
+
+fn next_epoch() -> u64 {
+    NEXT_EPOCH.fetch_add(1, Ordering::Relaxed)
+}
+
+/// A clone can be edited apart from the original, so it gets its own epoch
+impl Clone for GameMap {
+    fn clone(&self) -> Self {
+        Self {
+            width: self.width,
+            height: self.height,
+            tiles: self.tiles.clone(),
+            layout: self.layout,
+            chunks_x: self.chunks_x,
+            version: self.version,
+            epoch: next_epoch(),
+            chunks: self.chunks.clone(),
+            walkable: self.walkable.clone(),
+            opaque: self.opaque.clone(),
+        }
+    }
 }
 
 impl GameMap {
     /// Create a new map filled with floor tiles
     /// This is the basic constructor for an empty, walkable map
     pub fn new(width: u32, height: u32) -> Self {
-        Self {
+        Self::with_layout(width, height, TileLayout::default())
+    }
+
+    /// Create a floor-filled map stored in the given layout
+    pub fn with_layout(width: u32, height: u32, layout: TileLayout) -> Self {
+        Self::from_tiles_with_layout(
+            width,
+            height,
+            vec![TileKind::Floor; (width * height) as usize],
+            layout,
+        )
+    }
+
+    /// Create a map from existing row-major tile data (e.g. a loaded save)
+    /// `tiles.len()` must equal `width * height`
+    pub fn from_tiles(width: u32, height: u32, tiles: Vec<TileKind>) -> Self {
+        Self::from_tiles_with_layout(width, height, tiles, TileLayout::default())
+    }
+
+    /// Like `from_tiles`, storing the map in the given layout
+    pub fn from_tiles_with_layout(
+        width: u32,
+        height: u32,
+        tiles: Vec<TileKind>,
+        layout: TileLayout,
+    ) -> Self {
+        debug_assert_eq!(tiles.len(), (width * height) as usize);
+        let chunks_x = (width as i32 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        let chunks_y = (height as i32 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        let mut map = Self {
             width,
             height,
-            tiles: vec![TileKind::Floor; (width * height) as usize],
+            tiles: Vec::new(),
+            layout,
+            chunks_x,
+            version: 0,
+            epoch: next_epoch(),
+            chunks: vec![ChunkMeta::default(); (chunks_x * chunks_y) as usize],
+            walkable: BitPlane::new(width, height, false),
+            opaque: BitPlane::new(width, height, true),
+        };
+        for (i, &kind) in tiles.iter().enumerate() {
+            let (x, y) = ((i % width as usize) as i32, (i / width as usize) as i32);
+            let c = map.chunk_index_of(x, y);
+            map.chunks[c].counts[kind as usize] += 1;
+            map.walkable.set(x, y, kind.is_walkable());
+            map.opaque.set(x, y, kind.is_opaque());
+        }
+        map.tiles = match layout {
+            TileLayout::RowMajor => tiles,
+            TileLayout::Chunked => {
+                // Padding past the map edge is never indexed
+                let mut stored = vec![TileKind::Wall; map.chunks.len() * CHUNK_AREA];
+                for (i, &kind) in tiles.iter().enumerate() {
+                    let (x, y) = ((i % width as usize) as u32, (i / width as usize) as u32);
+                    stored[map.index_unchecked(x, y)] = kind;
+                }
+                stored
+            }
+        };
+        map
+    }
+
+    /// Copy of this map stored in another layout; versions are kept, the
+    /// epoch is new
+    pub fn to_layout(&self, layout: TileLayout) -> GameMap {
+        let mut map =
+            Self::from_tiles_with_layout(self.width, self.height, self.row_major_tiles(), layout);
+        map.version = self.version;
+        map.chunks = self.chunks.clone();
+        map
+    }
+
+    /// Storage order of `tiles`
+    pub fn layout(&self) -> TileLayout {
+        self.layout
+    }
+
+    /// All tiles in storage order, indexed by `idx`
+    /// Chunked storage includes padding past the map edge
+    pub fn tiles(&self) -> &[TileKind] {
+        &self.tiles
+    }
+
+    /// All tiles in row-major order, whatever the storage layout
+    pub fn row_major_tiles(&self) -> Vec<TileKind> {
+        match self.layout {
+            TileLayout::RowMajor => self.tiles.clone(),
+            TileLayout::Chunked => (0..self.height)
+                .flat_map(|y| (0..self.width).map(move |x| (x, y)))
+                .map(|(x, y)| self.tiles[self.index_unchecked(x, y)])
+                .collect(),
+        }
+    }
+
+    /// Storage index of an in-bounds tile
+    #[inline]
+    fn index_unchecked(&self, x: u32, y: u32) -> usize {
+        match self.layout {
+            TileLayout::RowMajor => (y * self.width + x) as usize,
+            TileLayout::Chunked => {
+                let size = CHUNK_SIZE as u32;
+                let chunk = (y / size) as usize * self.chunks_x as usize + (x / size) as usize;
+                chunk * CHUNK_AREA + ((y % size) * size + x % size) as usize
+            }
         }
     }
 
     /// Convert 2D coordinates to a 1D index into the tiles vector
     /// Returns None if coordinates are out of bounds
-    /// Uses row-major ordering: index = y * width + x
+    /// Indices are unique per tile and below `tiles.len()`, so callers can
+    /// also use them to index their own per-tile arrays of that length
+    #[inline]
     pub fn idx(&self, x: i32, y: i32) -> Option<usize> {
         if x < 0 || y < 0 {
             return None;
@@ -86,7 +301,26 @@ impl GameMap {
         if x >= self.width || y >= self.height {
             return None;
         }
-        Some((y * self.width + x) as usize)
+        Some(self.index_unchecked(x, y))
+    }
+
+    /// Coordinates of the tile stored at index `i`; inverse of `idx`
+    pub fn pos_of(&self, i: usize) -> (i32, i32) {
+        match self.layout {
+            TileLayout::RowMajor => {
+                let w = self.width as usize;
+                ((i % w) as i32, (i / w) as i32)
+            }
+            TileLayout::Chunked => {
+                let (chunk, local) = (i / CHUNK_AREA, i % CHUNK_AREA);
+                let (cx, cy) = (chunk as i32 % self.chunks_x, chunk as i32 / self.chunks_x);
+                let size = CHUNK_SIZE as usize;
+                (
+                    cx * CHUNK_SIZE + (local % size) as i32,
+                    cy * CHUNK_SIZE + (local / size) as i32,
+                )
+            }
+        }
     }
 
     /// Check if the given coordinates are within the map bounds
@@ -97,15 +331,28 @@ impl GameMap {
 
     /// Get the tile type at the specified coordinates
     /// Returns None if coordinates are out of bounds
+    #[inline]
     pub fn get_tile(&self, x: i32, y: i32) -> Option<TileKind> {
         self.idx(x, y).map(|i| self.tiles[i])
     }
 
     /// Set the tile type at the specified coordinates
     /// Returns true if the tile was successfully set, false if out of bounds
+    /// An actual change bumps the map version and updates the chunk summary
     pub fn set_tile(&mut self, x: i32, y: i32, kind: TileKind) -> bool {
         if let Some(i) = self.idx(x, y) {
-            self.tiles[i] = kind;
+            let old = self.tiles[i];
+            if old != kind {
+                self.tiles[i] = kind;
+                self.version += 1;
+                let c = self.chunk_index_of(x, y);
+                let meta = &mut self.chunks[c];
+                meta.version = self.version;
+                meta.counts[old as usize] -= 1;
+                meta.counts[kind as usize] += 1;
+                self.walkable.set(x, y, kind.is_walkable());
+                self.opaque.set(x, y, kind.is_opaque());
+            }
             true
         } else {
             false
@@ -115,9 +362,76 @@ impl GameMap {
     /// Check if a tile can be walked through by entities
     /// Currently only Floor tiles are walkable
     /// Returns false for out-of-bounds coordinates
+    #[inline]
     pub fn is_walkable(&self, x: i32, y: i32) -> bool {
-        self.get_tile(x, y)
-            .map(|t| matches!(t, TileKind::Floor))
-            .unwrap_or(false)
+        self.walkable.contains(x, y)
+    }
+
+    /// Check if a tile blocks line of sight
+    /// Returns true for out-of-bounds coordinates
+    #[inline]
+    pub fn is_opaque(&self, x: i32, y: i32) -> bool {
+        self.opaque.contains(x, y)
+    }
+
+    /// Walkability of every tile as a padded bit plane, kept current by
+    /// `set_tile`; reading a neighbour of an on-map tile needs no bounds check
+    pub fn walkable_plane(&self) -> &BitPlane {
+        &self.walkable
+    }
+
+    /// Opacity of every tile as a padded bit plane (border opaque)
+    pub fn opaque_plane(&self) -> &BitPlane {
+        &self.opaque
+    }
+
+    /// Current map version; increases by one with every tile change
+    pub fn version(&self) -> u64 {
+        self.version
+    }
+
+    /// Unique id of this map instance, assigned when it is built, loaded or
+    /// cloned
+    ///
+    /// Versions only compare within one epoch. Caches that follow the map
+    /// through `version` and chunk versions rebuild when the epoch changes,
+    /// e.g. because a load swapped in another map, whatever its version.
+    pub fn epoch(&self) -> u64 {
+        self.epoch
+    }
+
+    /// Number of chunks along the x axis
+    pub fn chunks_x(&self) -> i32 {
+        self.chunks_x
+    }
+
+    /// Number of chunks along the y axis
+    pub fn chunks_y(&self) -> i32 {
+        (self.height as i32 + CHUNK_SIZE - 1) / CHUNK_SIZE
+    }
+
+    /// Flat chunk index for an in-bounds tile (row-major over the chunk grid)
+    pub fn chunk_index_of(&self, x: i32, y: i32) -> usize {
+        ((y / CHUNK_SIZE) * self.chunks_x + x / CHUNK_SIZE) as usize
+    }
+
+    /// Summary of the chunk with flat index `chunk`
+    pub fn chunk_meta(&self, chunk: usize) -> Option<&ChunkMeta> {
+        self.chunks.get(chunk)
+    }
+
+    /// Map version at which the chunk with flat index `chunk` last changed
+    pub fn chunk_version(&self, chunk: usize) -> u64 {
+        self.chunks.get(chunk).map_or(0, |c| c.version)
+    }
+
+    /// Chunk coordinates of every chunk changed after `version`
+    pub fn changed_chunks_since(&self, version: u64) -> impl Iterator<Item = (i32, i32)> + '_ {
+        let chunks_x = self.chunks_x;
+        self.chunks
+            .iter()
+            .enumerate()
+            .filter(move |&(_, c)| c.version > version)
+            .map(move |(i, _)| (i as i32 % chunks_x, i as i32 / chunks_x))
     }
 }
@@ -0,0 +1,206 @@
+use bevy_ecs::prelude::*;
+use gc_core::autosave::{
+    autosave_removals_system, read_autosave, AutosaveRecord, AutosaveRemovals, AutosaveTracker,
+    AutosaveWriter,
+};
+use gc_core::prelude::*;
+use std::path::PathBuf;
+
+fn log_path(name: &str) -> PathBuf {
+    std::env::temp_dir().join(format!("gc_autosave_{}_{name}.log", std::process::id()))
+}
+
+fn sample_world() -> World {
+    let mut world = World::new();
+    world.insert_resource(MapGenerator::new().generate(80, 50, 3));
+    world.insert_resource(gc_core::systems::Time {
+        tick_ms: 100,
+        ticks: 0,
+    });
+    world.insert_resource(gc_core::systems::DeterministicRng::new(42));
+    for i in 0..10 {
+        world.spawn((Name(format!("Goblin {i}")), Position(i, 2), Velocity(0, 1)));
+    }
+    world
+}
+
+/// Number of length-prefixed records in the log at `path`
+fn frames(path: &std::path::Path) -> usize {
+    let bytes = std::fs::read(path).unwrap();
+    let (mut at, mut count) = (0, 0);
+    while let Some(len) = bytes.get(at..at + 4) {
+        at += 4 + u32::from_le_bytes(len.try_into().unwrap()) as usize;
+        count += 1;
+    }
+    count
+}
+
+#[test]
+fn deltas_hold_only_changed_chunks_and_entities() {
+    let mut world = sample_world();
+    let mut tracker = AutosaveTracker::new(8);
+    assert!(matches!(
+        tracker.capture(&mut world),
+        AutosaveRecord::Base(_)
+    ));
+
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("second capture should be a delta");
+    };
+    assert!(delta.is_empty());
+
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(70, 49, TileKind::Lava);
+    let goblin = world
+        .query::<(Entity, &Name)>()
+        .iter(&world)
+        .find(|(_, n)| n.0 == "Goblin 3")
+        .map(|(e, _)| e)
+        .unwrap();
+    world.entity_mut(goblin).insert(Position(30, 30));
+    let gone = world.spawn((Name("Temp".into()),)).id();
+    world.despawn(gone);
+    let added = world.spawn((Position(5, 5), Item::stone(), Carriable)).id();
+
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("expected a delta");
+    };
+    assert_eq!(delta.chunks.len(), 1);
+    assert_eq!((delta.chunks[0].cx, delta.chunks[0].cy), (4, 3));
+    // The partial edge chunk holds only its on-map tiles
+    assert_eq!(delta.chunks[0].tiles.len(), 16 * 2);
+    let ids: Vec<u64> = delta.upserted.iter().map(|(id, _)| *id).collect();
+    assert_eq!(ids.len(), 2);
+    assert!(ids.contains(&goblin.to_bits()) && ids.contains(&added.to_bits()));
+    assert!(delta.removed.is_empty());
+
+    world.despawn(added);
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("expected a delta");
+    };
+    assert_eq!(delta.removed, vec![added.to_bits()]);
+    assert_eq!(tracker.deltas_since_base(), 3);
+}
+
+#[test]
+fn deltas_follow_in_place_writes_and_component_removal() {
+    let mut world = sample_world();
+    let mut tracker = AutosaveTracker::new(8);
+    tracker.capture(&mut world);
+
+    let goblins: Vec<Entity> = world.query::<Entity>().iter(&world).collect();
+    let (renamed, slowed, rewritten) = (goblins[0], goblins[1], goblins[2]);
+    world.get_mut::<Name>(renamed).unwrap().0 = "Renamed".into();
+    world.entity_mut(slowed).remove::<Velocity>();
+    // Written but unchanged: not worth a record
+    let same = *world.get::<Position>(rewritten).unwrap();
+    world.entity_mut(rewritten).insert(same);
+
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("expected a delta");
+    };
+    let mut ids: Vec<u64> = delta.upserted.iter().map(|(id, _)| *id).collect();
+    ids.sort_unstable();
+    let mut expected = vec![renamed.to_bits(), slowed.to_bits()];
+    expected.sort_unstable();
+    assert_eq!(ids, expected);
+    let (_, data) = delta
+        .upserted
+        .iter()
+        .find(|(id, _)| *id == slowed.to_bits())
+        .unwrap();
+    assert_eq!(data.vel, None);
+    assert!(delta.removed.is_empty());
+
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("expected a delta");
+    };
+    assert!(delta.is_empty());
+}
+
+#[test]
+fn background_log_replays_to_a_full_save() {
+    let path = log_path("replay");
+    let mut world = sample_world();
+    let mut tracker = AutosaveTracker::new(3);
+    let writer = AutosaveWriter::spawn(&path);
+    writer.submit(tracker.capture(&mut world)).unwrap();
+    let mut compactions = 0;
+
+    for step in 1..10 {
+        world.resource_mut::<gc_core::systems::Time>().ticks = step * 10;
+        world
+            .resource_mut::<GameMap>()
+            .set_tile(step as i32 * 7, step as i32 * 4, TileKind::Wall);
+        world.spawn((
+            Name(format!("Stone {step}")),
+            Position(1, step as i32),
+            Item::stone(),
+        ));
+        let record = tracker.capture(&mut world);
+        compactions += match &record {
+            AutosaveRecord::Base(_) => panic!("only the first capture is a base"),
+            AutosaveRecord::Delta(delta) => delta.compact as usize,
+        };
+        writer.submit(record).unwrap();
+    }
+    writer.finish().unwrap();
+    // A compacting delta after every 3 plain ones
+    assert_eq!(compactions, 2);
+    // The writer rewrote the log at step 8, leaving that base and one delta
+    assert_eq!(frames(&path), 2);
+
+    let restored = read_autosave(&path).unwrap();
+    let full = save_world(&mut world);
+    assert_eq!(encode_json(&restored).unwrap(), encode_json(&full).unwrap());
+    std::fs::remove_file(&path).unwrap();
+}
+
+#[test]
+fn removals_survive_ticks_between_captures() {
+    let mut world = sample_world();
+    world.insert_resource(AutosaveRemovals::default());
+    let mut schedule = Schedule::default();
+    schedule.add_systems(autosave_removals_system);
+    let mut tracker = AutosaveTracker::new(8);
+    tracker.capture(&mut world);
+
+    let goblin = world.query::<Entity>().iter(&world).next().unwrap();
+    world.despawn(goblin);
+    // Long enough for the removal events themselves to be dropped
+    for _ in 0..5 {
+        run_tick(&mut world, &mut schedule);
+    }
+    let AutosaveRecord::Delta(delta) = tracker.capture(&mut world) else {
+        panic!("expected a delta");
+    };
+    assert_eq!(delta.removed, vec![goblin.to_bits()]);
+    assert!(world.resource::<AutosaveRemovals>().0.is_empty());
+}
+
+#[test]
+fn a_replaced_map_starts_a_new_base() {
+    let mut world = sample_world();
+    world.insert_resource(GameMap::new(80, 50));
+    let mut tracker = AutosaveTracker::new(8);
+    tracker.capture(&mut world);
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(1, 1, TileKind::Wall);
+    assert!(matches!(
+        tracker.capture(&mut world),
+        AutosaveRecord::Delta(_)
+    ));
+
+    // Same size, and edited past the old map's version
+    let mut loaded = GameMap::new(80, 50);
+    for x in 0..4 {
+        loaded.set_tile(x, 40, TileKind::Water);
+    }
+    world.insert_resource(loaded);
+    assert!(matches!(
+        tracker.capture(&mut world),
+        AutosaveRecord::Base(_)
+    ));
+}
@@ -0,0 +1,103 @@
+use bevy_ecs::prelude::*;
+use gc_core::binsave::{BinarySave, BinarySaveError, VERSION};
+use gc_core::prelude::*;
+
+fn sample_world() -> World {
+    let mut world = World::new();
+    world.insert_resource(MapGenerator::new().generate(60, 40, 9));
+    world.insert_resource(gc_core::systems::Time {
+        tick_ms: 50,
+        ticks: 1234,
+    });
+    world.insert_resource(gc_core::systems::DeterministicRng::new(777));
+    world.spawn((Name("Grukk".into()), Position(3, 4), Velocity(1, -1)));
+    world.spawn((
+        Name("Stone".into()),
+        Position(10, 2),
+        Item::stone(),
+        Carriable,
+    ));
+    world.spawn((Position(-5, 7),));
+    world
+}
+
+#[test]
+fn binary_roundtrip_matches_json() {
+    let mut world = sample_world();
+    let save = save_world(&mut world);
+    let bytes = encode_binary(&save);
+    let decoded = decode_binary(&bytes).expect("valid save");
+    assert_eq!(encode_json(&decoded).unwrap(), encode_json(&save).unwrap());
+    // Re-encoding is byte-identical
+    assert_eq!(encode_binary(&decoded), bytes);
+
+    let mut w2 = World::new();
+    load_world(decoded, &mut w2);
+    assert_eq!(w2.resource::<gc_core::systems::Time>().ticks, 1234);
+    assert_eq!(
+        w2.resource::<GameMap>().row_major_tiles(),
+        world.resource::<GameMap>().row_major_tiles()
+    );
+    // Runs compress a generated map well below CBOR's one value per tile
+    assert!(bytes.len() < encode_cbor(&save).unwrap().len());
+}
+
+#[test]
+fn view_reads_sections_in_place() {
+    let mut world = sample_world();
+    let save = save_world(&mut world);
+    let bytes = encode_binary(&save);
+    let view = BinarySave::parse(&bytes).expect("valid save");
+
+    assert_eq!((view.width(), view.height()), (60, 40));
+    assert_eq!(
+        (view.tick_ms(), view.ticks(), view.master_seed()),
+        (50, 1234, 777)
+    );
+    assert_eq!(view.tile_runs().map(|(_, n)| n).sum::<u32>(), 60 * 40);
+    assert_eq!(view.entity_count(), 3);
+    let stone = view
+        .entities()
+        .find(|e| e.name == Some("Stone"))
+        .expect("stone record");
+    assert_eq!(stone.pos, Some((10, 2)));
+    assert_eq!(stone.item_type, Some(ItemType::Stone));
+    assert!(stone.carriable);
+    assert!(view
+        .entities()
+        .any(|e| e.name.is_none() && e.pos == Some((-5, 7))));
+}
+
+#[test]
+fn damaged_buffers_are_rejected() {
+    let mut world = sample_world();
+    let bytes = encode_binary(&save_world(&mut world));
+
+    let mut bad = bytes.clone();
+    bad[0] = b'X';
+    assert_eq!(
+        BinarySave::parse(&bad).err(),
+        Some(BinarySaveError::BadMagic)
+    );
+
+    let mut bad = bytes.clone();
+    bad[8..10].copy_from_slice(&(VERSION + 1).to_le_bytes());
+    assert_eq!(
+        BinarySave::parse(&bad).err(),
+        Some(BinarySaveError::UnsupportedVersion(VERSION + 1))
+    );
+
+    assert_eq!(
+        BinarySave::parse(&bytes[..bytes.len() - 1]).err(),
+        Some(BinarySaveError::Truncated)
+    );
+    assert_eq!(
+        BinarySave::parse(&bytes[..40]).err(),
+        Some(BinarySaveError::Truncated)
+    );
+
+    let mut bad = bytes.clone();
+    let last = bad.len() - 1;
+    bad[last] ^= 0x20;
+    assert_eq!(decode_binary(&bad).err(), Some(BinarySaveError::Checksum));
+}
@@ -163,10 +163,10 @@ fn only_active_designations_create_jobs() {
 
     // Check that only one job was created
     let job_board = world.resource::<jobs::JobBoard>();
-    assert_eq!(job_board.0.len(), 1);
+    assert_eq!(job_board.len(), 1);
 
     // Verify the job is for the active designation
-    let job = &job_board.0[0];
+    let job = job_board.iter().next().unwrap();
     match &job.kind {
         jobs::JobKind::Mine { x, y } => {
             assert_eq!(*x, 5);
@@ -244,11 +244,10 @@ fn full_pipeline_dedup_then_jobs() {
 
     // Should have exactly 2 jobs (one for each unique position)
     let job_board = world.resource::<jobs::JobBoard>();
-    assert_eq!(job_board.0.len(), 2);
+    assert_eq!(job_board.len(), 2);
 
     // Verify the job positions
     let mut job_positions: Vec<(i32, i32)> = job_board
-        .0
         .iter()
         .map(|job| match &job.kind {
             jobs::JobKind::Mine { x, y } => (*x, *y),
@@ -307,3 +306,68 @@ fn ignored_designations_stay_ignored() {
     assert_eq!(lifecycle1_after_second, DesignationState::Active);
     assert_eq!(lifecycle2_after_second, DesignationState::Ignored);
 }
+
+/// A large rectangle settles in one tick, and a consumed holder frees its tile
+#[test]
+fn rectangle_designation_settles_in_one_tick() {
+    let mut world = World::new();
+    world.insert_resource(GameMap::new(128, 128));
+    world.insert_resource(designations::DesignationConfig { auto_jobs: true });
+    world.insert_resource(designations::DesignationIndex::default());
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(systems::DeterministicRng::new(42));
+    let rect = |world: &mut World| {
+        let batch: Vec<DesignationBundle> = (0..100)
+            .flat_map(|y| (0..100).map(move |x| (x, y)))
+            .map(|(x, y)| DesignationBundle {
+                pos: Position(x, y),
+                ..Default::default()
+            })
+            .collect();
+        world.spawn_batch(batch);
+    };
+    rect(&mut world);
+    rect(&mut world);
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(
+        (
+            designations::designation_dedup_system,
+            designations::designation_to_jobs_system,
+        )
+            .chain(),
+    );
+    schedule.run(&mut world);
+
+    let count = |world: &mut World, state| {
+        world
+            .query::<&DesignationLifecycle>()
+            .iter(world)
+            .filter(|l| l.0 == state)
+            .count()
+    };
+    assert_eq!(count(&mut world, DesignationState::Consumed), 10_000);
+    assert_eq!(count(&mut world, DesignationState::Ignored), 10_000);
+    assert_eq!(world.resource::<JobBoard>().len(), 10_000);
+
+    // Nothing new: nothing to do
+    schedule.run(&mut world);
+    assert_eq!(world.resource::<JobBoard>().len(), 10_000);
+    assert!(world
+        .resource::<designations::DesignationIndex>()
+        .is_empty());
+
+    // The tiles were released once their designations were consumed
+    let again = world
+        .spawn(DesignationBundle {
+            pos: Position(3, 3),
+            ..Default::default()
+        })
+        .id();
+    schedule.run(&mut world);
+    assert_eq!(
+        world.get::<DesignationLifecycle>(again).unwrap().0,
+        DesignationState::Consumed
+    );
+    assert_eq!(world.resource::<JobBoard>().len(), 10_001);
+}
@@ -1,5 +1,7 @@
 use bevy_ecs::prelude::*;
+use gc_core::hash::full_world_hash;
 use gc_core::prelude::*;
+use gc_core::replay::apply_input;
 use gc_core::{designations, jobs, systems};
 use rand::Rng;
 
@@ -39,14 +41,14 @@ fn deterministic_behavior_across_systems() {
 
         // Extract deterministic data for comparison
         let job_board = world.resource::<jobs::JobBoard>();
-        let job_id_string = if job_board.0.is_empty() {
+        let job_id_string = if job_board.is_empty() {
             "no_jobs".to_string()
         } else {
-            job_board.0[0].id.0.to_string()
+            job_board.iter().next().unwrap().id.0.to_string()
         };
 
         let map = world.resource::<GameMap>();
-        let map_tiles: Vec<u8> = map.tiles.iter().map(|t| *t as u8).collect();
+        let map_tiles: Vec<u8> = map.tiles().iter().map(|t| *t as u8).collect();
 
         (job_id_string, map_tiles)
     }
@@ -80,6 +82,23 @@ fn deterministic_behavior_across_systems() {
 }
 
 /// Save ordering is stable regardless of entity creation order
+/// Parallel map generation must produce exactly the serial map
+#[test]
+fn parallel_mapgen_matches_serial() {
+    // Heights that leave a partial last band and fewer chunk rows than threads
+    for (width, height) in [(70, 50), (33, 17), (5, 3)] {
+        let serial = MapGenerator::with_threads(1).generate(width, height, 9);
+        for threads in [2, 3, 8] {
+            let parallel = MapGenerator::with_threads(threads).generate(width, height, 9);
+            assert_eq!(
+                parallel.row_major_tiles(),
+                serial.row_major_tiles(),
+                "{width}x{height} on {threads} threads"
+            );
+        }
+    }
+}
+
 #[test]
 fn deterministic_save_entity_ordering() {
     let mut world_a = World::new();
@@ -126,3 +145,136 @@ fn deterministic_rng_consistent_sequences() {
         "Job RNG streams should also be identical"
     );
 }
+
+/// Demo colony plus a journal of designations, a spawned stone and a tile edit
+fn replay_fixture() -> (World, InputJournal) {
+    let opts = WorldOptions {
+        populate_demo_scene: true,
+        ..Default::default()
+    };
+    let world = build_standard_world(40, 30, 21, opts);
+    let map = world.resource::<GameMap>();
+    let walls = (0..map.height as i32)
+        .flat_map(|y| (0..map.width as i32).map(move |x| (x, y)))
+        .filter(|&(x, y)| map.get_tile(x, y) == Some(TileKind::Wall));
+    let mut journal = InputJournal::new();
+    for (i, (x, y)) in walls.take(8).enumerate() {
+        journal.record(i as u64 * 3, InputEvent::Designate { x, y });
+    }
+    journal.record(
+        5,
+        InputEvent::SpawnItem {
+            item_type: ItemType::Stone,
+            x: 6,
+            y: 6,
+        },
+    );
+    journal.record(
+        11,
+        InputEvent::SetTile {
+            x: 1,
+            y: 1,
+            kind: TileKind::Wall,
+        },
+    );
+    (world, journal)
+}
+
+fn apply_inputs_at(world: &mut World, journal: &InputJournal, tick: u64) {
+    for &(_, input) in journal.entries().iter().filter(|e| e.0 == tick) {
+        apply_input(world, input);
+    }
+}
+
+/// Seeking through checkpoints lands on the same world hashes as one
+/// straight run that applies the inputs by hand
+#[test]
+fn replay_seek_matches_straight_run() {
+    let (mut world, journal) = replay_fixture();
+    let mut hashes = vec![full_world_hash(&mut world)];
+    world.insert_resource(WorldHash::default());
+    let mut schedule = build_default_schedule();
+    for tick in 0..40 {
+        apply_inputs_at(&mut world, &journal, tick);
+        schedule.run(&mut world);
+        hashes.push(world.resource::<WorldHash>().at(tick + 1).unwrap());
+    }
+    assert_ne!(hashes[0], hashes[40]);
+
+    let (start, _) = replay_fixture();
+    let decoded = InputJournal::decode(&journal.encode()).unwrap();
+    let mut runner = ReplayRunner::new(&start, decoded, 8);
+    assert_eq!(runner.state_hash(), hashes[0]);
+    assert_eq!(runner.seek(40), 40);
+    assert_eq!(runner.state_hash(), hashes[40]);
+    assert_eq!(runner.checkpoints(), 6);
+
+    // Each seek costs less than one checkpoint interval
+    for (tick, simulated) in [(13, 5), (30, 6), (31, 1), (3, 3), (16, 0)] {
+        assert_eq!(runner.seek(tick), simulated, "seek to {tick}");
+        assert_eq!(runner.tick(), tick);
+        assert_eq!(runner.state_hash(), hashes[tick as usize], "tick {tick}");
+    }
+}
+
+/// The incremental hash agrees with a full rehash and pinpoints the first
+/// tick at which two runs split
+#[test]
+fn world_hash_finds_first_divergent_tick() {
+    let run = |tamper_before: Option<u64>| {
+        let (mut world, journal) = replay_fixture();
+        world.insert_resource(WorldHash::default());
+        let mut schedule = build_default_schedule();
+        for tick in 0..30 {
+            apply_inputs_at(&mut world, &journal, tick);
+            if tamper_before == Some(tick) {
+                world
+                    .resource_mut::<GameMap>()
+                    .set_tile(0, 0, TileKind::Lava);
+            }
+            schedule.run(&mut world);
+        }
+        world
+    };
+    let mut a = run(None);
+    let b = run(None);
+    let c = run(Some(17));
+
+    let incremental = a.resource::<WorldHash>().current();
+    assert_eq!(incremental, full_world_hash(&mut a));
+    let (ha, hb, hc) = (
+        a.resource::<WorldHash>(),
+        b.resource::<WorldHash>(),
+        c.resource::<WorldHash>(),
+    );
+    assert_eq!(ha.history().count(), 30);
+    assert_eq!(ha.first_divergence(hb), None);
+    // The edit lands in the hash recorded at the end of that tick
+    assert_eq!(ha.first_divergence(hc), Some(18));
+    assert_eq!(ha.at(17), hc.at(17));
+}
+
+/// Parallel phases must not change the result: single- and multi-threaded
+/// executors record the same hash for every tick
+#[test]
+fn executors_agree_tick_by_tick() {
+    use bevy_ecs::schedule::ExecutorKind;
+
+    let histories: Vec<Vec<(u64, u64)>> =
+        [ExecutorKind::SingleThreaded, ExecutorKind::MultiThreaded]
+            .into_iter()
+            .map(|kind| {
+                let (mut world, journal) = replay_fixture();
+                world.insert_resource(WorldHash::default());
+                let mut schedule = build_default_schedule();
+                schedule.set_executor_kind(kind);
+                for tick in 0..30 {
+                    apply_inputs_at(&mut world, &journal, tick);
+                    schedule.run(&mut world);
+                }
+                world.resource::<WorldHash>().history().collect()
+            })
+            .collect();
+    assert_eq!(histories[0].len(), 30);
+    assert_eq!(histories[0], histories[1]);
+}
@@ -0,0 +1,96 @@
+use bevy_ecs::prelude::*;
+use gc_core::prelude::*;
+use gc_core::systems;
+
+/// 30x12 map with a wall at x = 10 open only at the bottom row
+fn detour_map() -> GameMap {
+    let mut map = GameMap::new(30, 12);
+    for y in 0..11 {
+        map.set_tile(10, y, TileKind::Wall);
+    }
+    map
+}
+
+fn flow_schedule() -> Schedule {
+    let mut schedule = Schedule::default();
+    schedule.add_systems((flow_field_system, systems::auto_haul_system).chain());
+    schedule
+}
+
+fn haul_target(world: &World) -> (i32, i32) {
+    let board = world.resource::<JobBoard>();
+    assert_eq!(board.len(), 1);
+    match board.iter().next().unwrap().kind {
+        JobKind::Haul { to, .. } => to,
+        ref other => panic!("expected a haul job, got {other:?}"),
+    }
+}
+
+#[test]
+fn flow_field_system_tracks_stockpiles_and_map_edits() {
+    let mut world = World::new();
+    world.insert_resource(detour_map());
+    world.insert_resource(FlowFieldService::default());
+    let mut schedule = Schedule::default();
+    schedule.add_systems(flow_field_system);
+
+    let near = world.spawn(StockpileBundle::new(12, 0, 14, 2)).id();
+    let far = world.spawn(StockpileBundle::new(26, 8, 28, 10)).id();
+    schedule.run(&mut world);
+
+    let distance = |world: &World, key, x, y| {
+        let map = world.resource::<GameMap>();
+        let flow = world.resource::<FlowFieldService>();
+        flow.field(key).unwrap().distance(map, x, y)
+    };
+    assert_eq!(world.resource::<FlowFieldService>().len(), 2);
+    // Around the bottom of the wall: 9 down, 3 across, 9 back up
+    assert_eq!(distance(&world, near, 9, 2), Some(21));
+
+    // Mining through the wall is picked up on the next run
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(10, 1, TileKind::Floor);
+    schedule.run(&mut world);
+    assert_eq!(distance(&world, near, 9, 2), Some(4));
+    let astar = astar_path(world.resource::<GameMap>(), (9, 2), (12, 1)).unwrap();
+    assert_eq!(astar.1, 4);
+
+    world.despawn(far);
+    schedule.run(&mut world);
+    let flow = world.resource::<FlowFieldService>();
+    assert_eq!(flow.len(), 1);
+    assert!(flow.field(far).is_none());
+}
+
+#[test]
+fn auto_haul_picks_the_nearest_stockpile_by_walking_distance() {
+    let mut world = World::new();
+    world.insert_resource(detour_map());
+    world.insert_resource(FlowFieldService::default());
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(systems::DeterministicRng::new(1));
+
+    // Across the wall is closer in a straight line, but the walk is longer
+    world.spawn(StockpileBundle::new(11, 0, 13, 2));
+    world.spawn(StockpileBundle::new(0, 6, 2, 8));
+    world.spawn((Item::stone(), Position(8, 1)));
+    flow_schedule().run(&mut world);
+    assert_eq!(haul_target(&world), (1, 7));
+}
+
+#[test]
+fn auto_haul_falls_back_to_straight_line_without_the_service() {
+    let mut world = World::new();
+    world.insert_resource(detour_map());
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(systems::DeterministicRng::new(1));
+
+    world.spawn(StockpileBundle::new(11, 0, 13, 2));
+    world.spawn(StockpileBundle::new(0, 6, 2, 8));
+    world.spawn((Item::stone(), Position(8, 1)));
+    let mut schedule = Schedule::default();
+    schedule.add_systems(systems::auto_haul_system);
+    schedule.run(&mut world);
+    assert_eq!(haul_target(&world), (12, 1));
+}
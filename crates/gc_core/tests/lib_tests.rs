@@ -1,35 +1,48 @@
 // Tests for core library functionality - ActionLog and main exports
 
+use bevy_ecs::prelude::*;
 use gc_core::prelude::*;
 
+fn mined(worker: u32, x: i32) -> Action {
+    Action::Mined {
+        worker: Entity::from_raw(worker),
+        job: JobId(uuid::Uuid::from_u128(worker as u128)),
+        x,
+        y: 0,
+    }
+}
+
 #[test]
 fn action_log_new_log_is_empty() {
     let log = ActionLog::default();
-    assert!(log.events.is_empty());
+    assert!(log.is_empty());
 }
 
 #[test]
 fn action_log_can_log_events() {
     let mut log = ActionLog::default();
 
-    log.log("First event".to_string());
-    log.log("Second event".to_string());
+    log.log(1, mined(1, 4));
+    log.log(2, mined(2, 5));
 
-    assert_eq!(log.events.len(), 2);
-    assert_eq!(log.events[0], "First event");
-    assert_eq!(log.events[1], "Second event");
+    assert_eq!(log.len(), 2);
+    assert_eq!(log.get(0).unwrap().action, mined(1, 4));
+    assert_eq!(log.get(1).unwrap().tick, 2);
+    let lines: Vec<String> = log.lines().collect();
+    assert!(lines[0].starts_with("[1] "), "{}", lines[0]);
+    assert!(lines[0].contains("mined (4, 0)"), "{}", lines[0]);
 }
 
 #[test]
 fn action_log_clear_empties_events() {
     let mut log = ActionLog::default();
 
-    log.log("Some event".to_string());
-    log.log("Another event".to_string());
-    assert_eq!(log.events.len(), 2);
+    log.log(1, mined(1, 1));
+    log.log(1, mined(2, 2));
+    assert_eq!(log.len(), 2);
 
     log.clear();
-    assert!(log.events.is_empty());
+    assert!(log.is_empty());
 }
 
 #[test]
@@ -37,14 +50,69 @@ fn action_log_maintains_chronological_order() {
     let mut log = ActionLog::default();
 
     for i in 0..10 {
-        log.log(format!("Event {}", i));
+        log.log(i as u64, mined(i, i as i32));
     }
 
-    for (i, event) in log.events.iter().enumerate() {
-        assert_eq!(event, &format!("Event {}", i));
+    for (i, record) in log.iter().enumerate() {
+        assert_eq!(record.tick, i as u64);
+        assert_eq!(record.action, mined(i as u32, i as i32));
     }
 }
 
+#[test]
+fn action_log_is_bounded_and_drops_oldest() {
+    let mut log = ActionLog::new(3);
+
+    for i in 0..10 {
+        log.log(i as u64, mined(i, 0));
+    }
+
+    assert_eq!(log.len(), 3);
+    assert_eq!(log.dropped(), 7);
+    let ticks: Vec<u64> = log.iter().map(|r| r.tick).collect();
+    assert_eq!(ticks, [7, 8, 9]);
+}
+
+#[test]
+fn action_log_records_mining_from_the_schedule() {
+    let mut world = World::new();
+    world.insert_resource(GameMap::new(8, 8));
+    world.insert_resource(ActiveJobs::default());
+    world.insert_resource(ItemSpawnQueue::default());
+    world.insert_resource(Time::new(100));
+    world.insert_resource(ActionLog::default());
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(3, 3, TileKind::Wall);
+    let job = Job {
+        id: JobId(uuid::Uuid::from_u128(42)),
+        kind: JobKind::Mine { x: 3, y: 3 },
+    };
+    world
+        .resource_mut::<ActiveJobs>()
+        .jobs
+        .insert(job.id, job.clone());
+    let miner = world
+        .spawn((Miner, Position(3, 2), AssignedJob(Some(job.id))))
+        .id();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(mine_job_execution_system);
+    schedule.run(&mut world);
+
+    let log = world.resource::<ActionLog>();
+    assert_eq!(log.len(), 1);
+    assert_eq!(
+        log.get(0).unwrap().action,
+        Action::Mined {
+            worker: miner,
+            job: job.id,
+            x: 3,
+            y: 3
+        }
+    );
+}
+
 #[test]
 fn prelude_exports_work() {
     // Test that we can use common types from the prelude
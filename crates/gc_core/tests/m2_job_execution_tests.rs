@@ -137,7 +137,7 @@ fn mining_to_item_to_haul_pipeline() {
 
     // Verify all jobs are completed
     let job_board = world.resource::<JobBoard>();
-    assert_eq!(job_board.0.len(), 0, "All jobs should be completed");
+    assert_eq!(job_board.len(), 0, "All jobs should be completed");
 
     // Verify agents are unassigned
     let mut q_miners = world.query_filtered::<&AssignedJob, With<Miner>>();
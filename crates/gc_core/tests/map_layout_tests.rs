@@ -0,0 +1,75 @@
+use gc_core::prelude::*;
+
+/// 40x20 map (edge chunks are partial) with a few scattered walls
+fn sample_tiles() -> Vec<TileKind> {
+    (0..40 * 20)
+        .map(|i| {
+            if i % 7 == 0 {
+                TileKind::Wall
+            } else if i % 11 == 0 {
+                TileKind::Water
+            } else {
+                TileKind::Floor
+            }
+        })
+        .collect()
+}
+
+#[test]
+fn layouts_agree_through_the_tile_api() {
+    let tiles = sample_tiles();
+    let row = GameMap::from_tiles_with_layout(40, 20, tiles.clone(), TileLayout::RowMajor);
+    let chunked = GameMap::from_tiles_with_layout(40, 20, tiles.clone(), TileLayout::Chunked);
+    assert_eq!(chunked.layout(), TileLayout::Chunked);
+
+    let mut seen = vec![false; chunked.tiles().len()];
+    for y in -1..21 {
+        for x in -1..41 {
+            assert_eq!(row.get_tile(x, y), chunked.get_tile(x, y), "({x}, {y})");
+            assert_eq!(row.is_walkable(x, y), chunked.is_walkable(x, y));
+            if let Some(i) = chunked.idx(x, y) {
+                assert!(!seen[i], "index {i} used twice");
+                assert_eq!(chunked.pos_of(i), (x, y));
+                assert_eq!(row.pos_of(row.idx(x, y).unwrap()), (x, y));
+                seen[i] = true;
+            }
+        }
+    }
+    // Vertical neighbours inside a chunk are one chunk row apart
+    assert_eq!(
+        chunked.idx(3, 4).unwrap() - chunked.idx(3, 3).unwrap(),
+        CHUNK_SIZE as usize
+    );
+    assert_eq!(chunked.row_major_tiles(), tiles);
+    assert_eq!(row.to_layout(TileLayout::Chunked).tiles(), chunked.tiles());
+}
+
+#[test]
+fn chunk_summaries_follow_set_tile() {
+    for layout in [TileLayout::RowMajor, TileLayout::Chunked] {
+        let mut map = GameMap::with_layout(40, 20, layout);
+        let corner = map.chunk_index_of(39, 19);
+        assert!(map.chunk_meta(0).unwrap().all_floor());
+        // The partial corner chunk only counts its on-map tiles
+        assert_eq!(
+            map.chunk_meta(corner).unwrap().count(TileKind::Floor),
+            8 * 4
+        );
+
+        map.set_tile(3, 3, TileKind::Wall);
+        let meta = *map.chunk_meta(0).unwrap();
+        assert_eq!(meta.uniform(), None);
+        assert_eq!(meta.count(TileKind::Wall), 1);
+        assert_eq!(meta.version, map.version());
+
+        for y in 16..20 {
+            for x in 32..40 {
+                map.set_tile(x, y, TileKind::Wall);
+            }
+        }
+        assert!(map.chunk_meta(corner).unwrap().all_wall());
+        map.set_tile(3, 3, TileKind::Floor);
+        assert!(map.chunk_meta(0).unwrap().all_floor());
+        assert!(map.chunk_meta(99).is_none());
+    }
+}
@@ -246,3 +246,85 @@ fn mining_without_wall_does_nothing() {
         "Should still have no items - no wall to mine"
     );
 }
+
+fn queue_stones(world: &mut World, tiles: &[(i32, i32)]) {
+    let mut queue = world.resource_mut::<jobs::ItemSpawnQueue>();
+    for &position in tiles {
+        queue.requests.push(jobs::ItemSpawnRequest {
+            item_type: ItemType::Stone,
+            position,
+        });
+    }
+}
+
+#[test]
+fn spawn_queue_spawns_one_unnamed_entity_per_request() {
+    let mut world = World::new();
+    world.insert_resource(jobs::ItemSpawnQueue::default());
+    queue_stones(&mut world, &[(1, 1), (1, 1), (2, 3)]);
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(jobs::process_item_spawn_queue_system);
+    schedule.run(&mut world);
+
+    let mut q =
+        world.query_filtered::<(&Position, Option<&Name>), (With<Stone>, With<Carriable>)>();
+    let mut items: Vec<(i32, i32)> = q
+        .iter(&world)
+        .map(|(p, name)| {
+            assert!(name.is_none(), "items share ItemType::name instead");
+            (p.0, p.1)
+        })
+        .collect();
+    items.sort_unstable();
+    assert_eq!(items, [(1, 1), (1, 1), (2, 3)]);
+    assert!(world.resource::<jobs::ItemSpawnQueue>().requests.is_empty());
+}
+
+#[test]
+fn stacking_merges_requests_and_loose_items_per_tile() {
+    let mut world = World::new();
+    world.insert_resource(jobs::ItemSpawnQueue::default());
+    world.insert_resource(jobs::ItemSpawnConfig { stack: true });
+    let loose = world.spawn(jobs::StoneBundle::at(4, 4)).id();
+    let carried = world.spawn(jobs::StoneBundle::at(6, 6)).id();
+    world.spawn((Carrier, Position(6, 6), Inventory(Some(carried))));
+    queue_stones(
+        &mut world,
+        &[(4, 4), (5, 5), (4, 4), (5, 5), (5, 5), (6, 6)],
+    );
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(jobs::process_item_spawn_queue_system);
+    schedule.run(&mut world);
+
+    let mut q = world.query::<(Entity, &Position, Option<&ItemStack>)>();
+    let mut stacks: Vec<((i32, i32), u16, bool)> = q
+        .iter(&world)
+        .filter(|(e, ..)| world.get::<Item>(*e).is_some())
+        .map(|(e, p, s)| ((p.0, p.1), s.map_or(1, |s| s.0), e == loose))
+        .collect();
+    stacks.sort_unstable();
+    // The loose stone absorbed both requests on its tile; the carried one
+    // was left alone
+    assert_eq!(
+        stacks,
+        [
+            ((4, 4), 3, true),
+            ((5, 5), 3, false),
+            ((6, 6), 1, false),
+            ((6, 6), 1, false)
+        ]
+    );
+
+    // Stack counts survive text and binary saves
+    let save = save_world(&mut world);
+    for decoded in [
+        decode_json(&encode_json(&save).unwrap()).unwrap(),
+        decode_binary(&encode_binary(&save)).unwrap(),
+    ] {
+        let mut counts: Vec<Option<u16>> = decoded.entities.iter().map(|e| e.stack).collect();
+        counts.sort_unstable();
+        assert_eq!(counts, [None, None, Some(1), Some(3), Some(3)]);
+    }
+}
@@ -1,5 +1,6 @@
 // Comprehensive pathfinding tests to improve coverage
 
+use bevy_ecs::prelude::*;
 use gc_core::prelude::*;
 
 fn create_test_map(width: u32, height: u32) -> GameMap {
@@ -19,7 +20,7 @@ fn create_map_with_walls() -> GameMap {
 #[test]
 fn path_service_new_creates_with_capacity() {
     let service = PathService::new(100);
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 0);
     assert_eq!(misses, 0);
 }
@@ -27,7 +28,7 @@ fn path_service_new_creates_with_capacity() {
 #[test]
 fn path_service_new_with_zero_capacity_still_works() {
     let service = PathService::new(0);
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 0);
     assert_eq!(misses, 0);
 }
@@ -40,14 +41,14 @@ fn path_service_cache_hits_work() {
     // First request - should be a miss
     let path1 = service.get(&map, (0, 0), (2, 2));
     assert!(path1.is_some());
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 0);
     assert_eq!(misses, 1);
 
     // Same request - should be a hit
     let path2 = service.get(&map, (0, 0), (2, 2));
     assert!(path2.is_some());
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 1);
     assert_eq!(misses, 1);
 
@@ -84,7 +85,7 @@ fn path_service_batch_processing() {
     }
 
     // Should have 1 hit and 2 misses (third request is cached)
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 1);
     assert_eq!(misses, 2);
 }
@@ -98,13 +99,13 @@ fn path_service_reset_stats() {
     service.get(&map, (0, 0), (1, 1));
     service.get(&map, (0, 0), (1, 1)); // Cache hit
 
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 1);
     assert_eq!(misses, 1);
 
     // Reset and verify
     service.reset_stats();
-    let (hits, misses) = service.stats();
+    let PathStats { hits, misses, .. } = service.stats();
     assert_eq!(hits, 0);
     assert_eq!(misses, 0);
 }
@@ -240,7 +241,168 @@ fn path_service_cache_eviction() {
     // First entry should be evicted (LRU), so this should be a miss
     service.get(&map, (0, 0), (1, 1));
 
-    let (_hits, misses) = service.stats();
+    let PathStats { misses, .. } = service.stats();
     // Should have had cache hits for entries 2 and 3, but miss for entry 1 retrieval
     assert_eq!(misses, 4); // 3 initial + 1 re-fetch of evicted entry
 }
+
+#[test]
+fn path_service_hierarchical_mode_finds_valid_paths() {
+    let mut map = create_test_map(64, 64);
+    // Wall with a single gap forces a detour across several clusters
+    for y in 0..63 {
+        map.set_tile(32, y, TileKind::Wall);
+    }
+
+    let mut flat = PathService::new(10);
+    let mut hier = PathService::with_mode(10, PathMode::Hierarchical);
+    assert_eq!(hier.mode(), PathMode::Hierarchical);
+
+    let (_, flat_cost) = flat.get(&map, (1, 1), (62, 1)).expect("flat path");
+    let (path, cost) = hier.get(&map, (1, 1), (62, 1)).expect("hierarchical path");
+
+    assert_eq!(path.first(), Some(&(1, 1)));
+    assert_eq!(path.last(), Some(&(62, 1)));
+    assert_eq!(cost as usize, path.len() - 1);
+    assert!(path.iter().all(|&(x, y)| map.is_walkable(x, y)));
+    assert!(cost >= flat_cost);
+
+    // Unreachable goals agree with the flat search
+    assert!(hier.get(&map, (1, 1), (70, 70)).is_none());
+}
+
+#[test]
+fn path_service_invalidates_only_paths_through_changed_chunks() {
+    let mut service = PathService::new(10);
+    let mut map = create_test_map(64, 64);
+
+    // One path in the top-left chunk, one far away in the bottom-right chunk
+    let near = service.get(&map, (1, 1), (5, 1)).expect("near path");
+    let far = service.get(&map, (50, 50), (60, 60)).expect("far path");
+
+    // Mining-style edit inside the first path's chunk
+    map.set_tile(3, 1, TileKind::Wall);
+
+    let far_again = service.get(&map, (50, 50), (60, 60)).expect("far path");
+    assert_eq!(far, far_again, "untouched chunks keep their cached paths");
+
+    let rerouted = service.get(&map, (1, 1), (5, 1)).expect("rerouted path");
+    assert!(
+        !rerouted.0.contains(&(3, 1)),
+        "stale path must not be served"
+    );
+    assert!(rerouted.1 > near.1);
+
+    let stats = service.stats();
+    assert_eq!(stats.misses, 2);
+    assert_eq!(stats.hits, 1);
+    assert_eq!(stats.invalidations, 1);
+}
+
+#[test]
+fn path_service_retries_unreachable_after_any_edit() {
+    let mut service = PathService::new(10);
+    let mut map = create_test_map(10, 10);
+    for y in 0..10 {
+        map.set_tile(5, y, TileKind::Wall);
+    }
+    assert!(service.get(&map, (1, 1), (8, 1)).is_none());
+    assert!(service.get(&map, (1, 1), (8, 1)).is_none());
+
+    // Opening a gap makes the cached "no path" stale
+    map.set_tile(5, 9, TileKind::Floor);
+    assert!(service.get(&map, (1, 1), (8, 1)).is_some());
+
+    let stats = service.stats();
+    assert_eq!((stats.hits, stats.misses, stats.invalidations), (1, 1, 1));
+}
+
+#[test]
+fn path_service_misses_after_a_same_size_map_swap() {
+    let mut service = PathService::new(10);
+    let mut map = create_test_map(64, 64);
+    // Edits elsewhere push the old map's version above the new one's
+    for x in 40..50 {
+        map.set_tile(x, 40, TileKind::Wall);
+    }
+    let cached = service.get(&map, (1, 1), (5, 1)).expect("open row");
+    assert!(cached.0.contains(&(3, 1)));
+
+    // A loaded map with the path's chunk edited first and then more edits
+    // elsewhere: its version is ahead of the old map's, its chunk behind
+    let mut loaded = create_test_map(64, 64);
+    loaded.set_tile(3, 1, TileKind::Wall);
+    for x in 20..40 {
+        loaded.set_tile(x, 50, TileKind::Wall);
+    }
+    assert!(loaded.version() > map.version());
+    let rerouted = service.get(&loaded, (1, 1), (5, 1)).expect("detour");
+    assert!(!rerouted.0.contains(&(3, 1)), "old map's path served");
+    assert_eq!(service.stats().invalidations, 1);
+}
+
+#[test]
+fn load_world_clears_an_existing_path_service() {
+    let mut world = World::new();
+    world.insert_resource(create_test_map(16, 16));
+    let mut service = PathService::new(10);
+    service.get(world.resource::<GameMap>(), (1, 1), (5, 1));
+    world.insert_resource(service);
+
+    // The loaded map has a new epoch as well, but the clear drops the entry
+    let save = save_world(&mut world);
+    load_world(save, &mut world);
+    world.resource_scope(|world, mut service: Mut<PathService>| {
+        service.get(world.resource::<GameMap>(), (1, 1), (5, 1));
+        let stats = service.stats();
+        assert_eq!((stats.hits, stats.misses), (0, 2));
+    });
+}
+
+#[test]
+fn path_service_parallel_batch_matches_sequential() {
+    let mut map = create_test_map(48, 48);
+    for x in 0..44 {
+        map.set_tile(x, 16, TileKind::Wall);
+        map.set_tile(x + 4, 32, TileKind::Wall);
+    }
+
+    // Spread of near and far requests, with repeats and one unreachable goal
+    let mut requests = Vec::new();
+    for i in 0..24 {
+        requests.push(PathRequest {
+            start: (i, i % 7),
+            goal: (47 - i, 47 - (i * 3) % 11),
+        });
+    }
+    requests.push(PathRequest {
+        start: (0, 0),
+        goal: (0, 16),
+    });
+    requests.extend_from_within(0..6);
+
+    for mode in [PathMode::Flat, PathMode::Hierarchical] {
+        let mut sequential = PathService::with_mode(64, mode);
+        let mut parallel = PathService::with_mode(64, mode);
+        parallel.set_threads(4);
+
+        // Warm part of both caches, then invalidate one of the warm paths
+        for service in [&mut sequential, &mut parallel] {
+            service.batch(&map, &requests[..4]);
+        }
+        map.set_tile(2, 10, TileKind::Wall);
+
+        let expected = sequential.batch(&map, &requests);
+        let actual = parallel.batch(&map, &requests);
+        assert_eq!(actual, expected, "{:?}", mode);
+        assert_eq!(parallel.stats(), sequential.stats(), "{:?}", mode);
+        assert!(actual[24].is_none());
+
+        // Second pass is served entirely from the cache
+        parallel.reset_stats();
+        assert_eq!(parallel.batch(&map, &requests), expected);
+        assert_eq!(parallel.stats().hits, requests.len());
+
+        map.set_tile(2, 10, TileKind::Floor);
+    }
+}
@@ -0,0 +1,190 @@
+use bevy_ecs::prelude::*;
+use gc_core::prelude::*;
+use gc_core::systems::DeterministicRng;
+use rand::Rng;
+
+/// Demo colony with extra workers, loose stones and mining designations
+fn colony() -> World {
+    let opts = WorldOptions {
+        populate_demo_scene: true,
+        ..Default::default()
+    };
+    let mut world = build_standard_world(48, 32, 99, opts);
+    for i in 0..3 {
+        world.spawn((
+            Name(format!("Miner {i}")),
+            Position(4 + i, 8),
+            Velocity(0, 0),
+            Miner,
+            AssignedJob::default(),
+        ));
+        world.spawn((
+            Name(format!("Carrier {i}")),
+            Position(6, 4 + i),
+            Velocity(0, 0),
+            Carrier,
+            Inventory::default(),
+            AssignedJob::default(),
+        ));
+    }
+    for (x, y) in [(2, 2), (7, 3), (7, 3), (14, 6)] {
+        world.spawn((
+            Item::stone(),
+            Stone,
+            Position(x, y),
+            Carriable,
+            Name("Stone".into()),
+        ));
+    }
+    designate_walls(&mut world, 0, 6);
+    world
+}
+
+/// Mine designations on the first `count` walls after skipping `skip`
+fn designate_walls(world: &mut World, skip: usize, count: usize) {
+    let walls: Vec<(i32, i32)> = {
+        let map = world.resource::<GameMap>();
+        (0..map.height as i32)
+            .flat_map(|y| (0..map.width as i32).map(move |x| (x, y)))
+            .filter(|&(x, y)| map.get_tile(x, y) == Some(TileKind::Wall))
+            .skip(skip)
+            .take(count)
+            .collect()
+    };
+    for (x, y) in walls {
+        world.spawn(DesignationBundle {
+            pos: Position(x, y),
+            ..Default::default()
+        });
+    }
+}
+
+fn run(world: &mut World, schedule: &mut Schedule, ticks: usize) {
+    for _ in 0..ticks {
+        schedule.run(world);
+    }
+}
+
+fn state(world: &World) -> String {
+    serde_json::to_string(&save_snapshot(world)).unwrap()
+}
+
+#[test]
+fn rng_streams_resume_mid_sequence() {
+    let mut rng = DeterministicRng::new(7);
+    let _: [u8; 16] = rng.job_rng.gen();
+    let _: u32 = rng.mapgen_rng.gen();
+    let mut resumed = DeterministicRng::with_positions(7, rng.stream_positions());
+    for _ in 0..5 {
+        assert_eq!(rng.job_rng.gen::<u64>(), resumed.job_rng.gen::<u64>());
+        assert_eq!(rng.mapgen_rng.gen::<u32>(), resumed.mapgen_rng.gen::<u32>());
+    }
+    assert_eq!(rng.stream_positions(), resumed.stream_positions());
+}
+
+#[test]
+fn loaded_snapshot_continues_exactly() {
+    let mut original = colony();
+    let mut schedule = build_default_schedule();
+    run(&mut original, &mut schedule, 4);
+
+    let snapshot = save_snapshot(&original);
+    assert!(
+        snapshot.rng_positions[1] > 0,
+        "jobs drew from the job stream"
+    );
+    let json = serde_json::to_string(&snapshot).unwrap();
+    let mut restored = World::new();
+    load_snapshot(serde_json::from_str(&json).unwrap(), &mut restored);
+    assert_eq!(state(&restored), json);
+
+    // Same ticks on both, with fresh designations half-way
+    let mut restored_schedule = build_default_schedule();
+    for (world, schedule) in [
+        (&mut original, &mut schedule),
+        (&mut restored, &mut restored_schedule),
+    ] {
+        run(world, schedule, 3);
+        designate_walls(world, 6, 4);
+        run(world, schedule, 12);
+    }
+    assert_eq!(state(&restored), state(&original));
+    // Restored stones were not re-posted as haul jobs
+    assert_eq!(
+        restored.resource::<JobBoard>().count(JobCategory::Haul),
+        original.resource::<JobBoard>().count(JobCategory::Haul)
+    );
+}
+
+/// The demo miner and carrier have a `VisionRadius` and the colony's
+/// workers do not, so the two kinds sit in different archetypes, whose
+/// order a load does not keep
+#[test]
+fn mixed_archetype_carriers_get_the_same_hauls_after_a_load() {
+    let mut original = colony();
+    let mut schedule = build_default_schedule();
+    run(&mut original, &mut schedule, 4);
+
+    let mut restored = World::new();
+    load_snapshot(save_snapshot(&original), &mut restored);
+    let mut restored_schedule = build_default_schedule();
+    for (world, schedule) in [
+        (&mut original, &mut schedule),
+        (&mut restored, &mut restored_schedule),
+    ] {
+        // Fresh loose stones far apart, so who hauls which matters
+        for (x, y) in [(1, 1), (20, 3), (3, 25), (40, 20)] {
+            world.spawn((Name("Stone".into()), StoneBundle::at(x, y)));
+        }
+        run(world, schedule, 10);
+    }
+    assert_eq!(state(&restored), state(&original));
+}
+
+#[test]
+fn item_stacking_survives_a_snapshot() {
+    let mut original = colony();
+    original.insert_resource(ItemSpawnConfig { stack: true });
+    let mut schedule = build_default_schedule();
+    run(&mut original, &mut schedule, 4);
+
+    let mut restored = World::new();
+    load_snapshot(save_snapshot(&original), &mut restored);
+    let mut restored_schedule = build_default_schedule();
+
+    // A loose stone that nobody carries takes the new arrivals
+    let tile = {
+        let carried: Vec<Entity> = original
+            .query::<&Inventory>()
+            .iter(&original)
+            .filter_map(|i| i.0)
+            .collect();
+        let mut stones = original.query_filtered::<(Entity, &Position), With<Stone>>();
+        let (_, pos) = stones
+            .iter(&original)
+            .find(|(e, _)| !carried.contains(e))
+            .expect("a loose stone");
+        (pos.0, pos.1)
+    };
+    for (world, schedule) in [
+        (&mut original, &mut schedule),
+        (&mut restored, &mut restored_schedule),
+    ] {
+        for _ in 0..2 {
+            world
+                .resource_mut::<ItemSpawnQueue>()
+                .requests
+                .push(ItemSpawnRequest {
+                    item_type: ItemType::Stone,
+                    position: tile,
+                });
+        }
+        run(world, schedule, 6);
+    }
+    let stacked = original
+        .query::<&ItemStack>()
+        .iter(&original)
+        .any(|s| s.0 >= 2);
+    assert!(stacked, "the spawns were stacked");
+    assert_eq!(state(&restored), state(&original));
+}
@@ -0,0 +1,136 @@
+use bevy_ecs::prelude::*;
+use gc_core::prelude::*;
+use gc_core::{designations, jobs, systems};
+
+fn index_schedule() -> Schedule {
+    let mut schedule = Schedule::default();
+    schedule.add_systems(spatial_index_system);
+    schedule
+}
+
+#[test]
+fn spatial_index_tracks_spawns_moves_and_despawns() {
+    let mut world = World::new();
+    world.insert_resource(SpatialIndex::default());
+    let mut schedule = index_schedule();
+
+    let a = world.spawn(Position(3, 4)).id();
+    let b = world.spawn(Position(3, 4)).id();
+    let zone = world.spawn(StockpileBundle::new(0, 0, 9, 9)).id();
+    schedule.run(&mut world);
+
+    let at = |world: &World, x, y| {
+        let index = world.resource::<SpatialIndex>();
+        let mut found: Vec<Entity> = index.entities_at(x, y).collect();
+        found.sort();
+        found
+    };
+    assert_eq!(at(&world, 3, 4), [a, b]);
+    assert_eq!(
+        world
+            .resource::<SpatialIndex>()
+            .zones_at(9, 9)
+            .collect::<Vec<_>>(),
+        [zone]
+    );
+
+    world.get_mut::<Position>(a).unwrap().0 = 20;
+    world.despawn(b);
+    schedule.run(&mut world);
+    assert!(at(&world, 3, 4).is_empty());
+    assert_eq!(at(&world, 20, 4), [a]);
+
+    world.entity_mut(zone).remove::<ZoneBounds>();
+    schedule.run(&mut world);
+    let index = world.resource::<SpatialIndex>();
+    assert_eq!(index.zones_at(9, 9).count(), 0);
+    // The stockpile's own Position is still indexed at its center
+    assert_eq!(index.position_of(zone), Some((4, 4)));
+}
+
+#[test]
+fn stockpile_lookups_use_the_index() {
+    let mut world = World::new();
+    world.insert_resource(SpatialIndex::default());
+    let s1 = world.spawn(StockpileBundle::new(0, 0, 10, 10)).id();
+    let s2 = world.spawn(StockpileBundle::new(5, 5, 15, 15)).id();
+    index_schedule().run(&mut world);
+
+    assert_eq!(find_stockpiles_at_position(&mut world, 7, 7), [s1, s2]);
+    assert_eq!(find_stockpiles_at_position(&mut world, 14, 14), [s2]);
+    assert!(position_in_stockpile(&mut world, 0, 0));
+    assert!(!position_in_stockpile(&mut world, 16, 16));
+}
+
+#[test]
+fn indexed_dedup_keeps_the_designation_already_on_a_tile() {
+    let mut world = World::new();
+    world.insert_resource(SpatialIndex::default());
+    let mut schedule = Schedule::default();
+    schedule.add_systems((spatial_index_system, designations::designation_dedup_system).chain());
+
+    let spawn = |world: &mut World, x, y| {
+        world
+            .spawn((
+                MineDesignation,
+                Position(x, y),
+                DesignationLifecycle::default(),
+            ))
+            .id()
+    };
+    let first = spawn(&mut world, 5, 5);
+    let dup = spawn(&mut world, 5, 5);
+    let other = spawn(&mut world, 6, 5);
+    schedule.run(&mut world);
+
+    let state = |world: &World, e| world.get::<DesignationLifecycle>(e).unwrap().0;
+    assert_eq!(state(&world, first), DesignationState::Active);
+    assert_eq!(state(&world, dup), DesignationState::Ignored);
+    assert_eq!(state(&world, other), DesignationState::Active);
+
+    // A designation added later on an occupied tile is ignored too
+    let late = spawn(&mut world, 6, 5);
+    schedule.run(&mut world);
+    assert_eq!(state(&world, late), DesignationState::Ignored);
+    assert_eq!(state(&world, other), DesignationState::Active);
+}
+
+#[test]
+fn indexed_hauling_picks_up_item_on_the_pickup_tile() {
+    let mut world = World::new();
+    world.insert_resource(SpatialIndex::default());
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(jobs::ActiveJobs::default());
+
+    let job_id = JobId(uuid::Uuid::from_u128(1));
+    world.resource_mut::<jobs::ActiveJobs>().jobs.insert(
+        job_id,
+        Job {
+            id: job_id,
+            kind: JobKind::Haul {
+                from: (2, 2),
+                to: (8, 8),
+            },
+        },
+    );
+    let carrier = world
+        .spawn((
+            Carrier,
+            Position(2, 2),
+            Inventory::default(),
+            AssignedJob(Some(job_id)),
+        ))
+        .id();
+    // A decoy item elsewhere and the real one on the pickup tile
+    world.spawn((Item::stone(), Carriable, Position(3, 2)));
+    let stone = world.spawn((Item::stone(), Carriable, Position(2, 2))).id();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems((spatial_index_system, systems::hauling_execution_system).chain());
+    schedule.run(&mut world);
+    assert_eq!(world.get::<Inventory>(carrier).unwrap().0, Some(stone));
+
+    schedule.run(&mut world);
+    assert_eq!(*world.get::<Position>(stone).unwrap(), Position(8, 8));
+    assert!(world.resource::<jobs::ActiveJobs>().jobs.is_empty());
+}
@@ -159,3 +159,118 @@ fn stockpile_integration_with_ecs() {
     let stockpile = world.get::<Stockpile>(entity).unwrap();
     assert!(stockpile.accepts.is_none());
 }
+
+fn haul_targets(world: &World) -> Vec<(i32, i32)> {
+    let mut targets: Vec<(i32, i32)> = world
+        .resource::<JobBoard>()
+        .iter()
+        .filter_map(|job| match job.kind {
+            JobKind::Haul { to, .. } => Some(to),
+            _ => None,
+        })
+        .collect();
+    targets.sort_unstable();
+    targets
+}
+
+fn planner_world() -> World {
+    let mut world = World::new();
+    world.insert_resource(GameMap::new(20, 20));
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(ActiveJobs::default());
+    world.insert_resource(StockpilePlanner::default());
+    world.insert_resource(DeterministicRng::new(3));
+    world
+}
+
+#[test]
+fn auto_haul_spreads_a_batch_over_free_slots() {
+    let mut world = planner_world();
+    let zone = world.spawn(StockpileBundle::new(9, 9, 11, 11)).id();
+    for i in 0..4 {
+        world.spawn((Item::stone(), Position(i, 0)));
+    }
+    let mut schedule = Schedule::default();
+    schedule.add_systems(auto_haul_system);
+    schedule.run(&mut world);
+
+    // Center first, then its edge neighbours; no tile is targeted twice
+    assert_eq!(haul_targets(&world), [(9, 10), (10, 9), (10, 10), (11, 10)]);
+    let planner = world.resource::<StockpilePlanner>();
+    assert_eq!(planner.free_slots(zone), Some(5));
+}
+
+#[test]
+fn auto_haul_skips_stockpiles_that_refuse_the_item() {
+    let mut world = planner_world();
+    world.spawn((
+        Stockpile {
+            accepts: Some(vec![]),
+        },
+        Position(2, 2),
+        ZoneBounds::new(2, 2, 2, 2),
+    ));
+    world.spawn(StockpileBundle::new(15, 15, 15, 15));
+    world.spawn((Item::stone(), Position(1, 1)));
+    let mut schedule = Schedule::default();
+    schedule.add_systems(auto_haul_system);
+    schedule.run(&mut world);
+
+    assert_eq!(haul_targets(&world), [(15, 15)]);
+}
+
+#[test]
+fn full_stockpile_defers_items_until_a_slot_frees() {
+    let mut world = planner_world();
+    world.spawn(StockpileBundle::new(5, 5, 5, 5));
+    let stored = world.spawn((Item::stone(), Position(5, 5))).id();
+    let waiting = world.spawn((Item::stone(), Position(0, 0))).id();
+    let mut schedule = Schedule::default();
+    schedule.add_systems(auto_haul_system);
+    schedule.run(&mut world);
+
+    assert!(haul_targets(&world).is_empty());
+    let backlog: Vec<Entity> = world.resource::<StockpilePlanner>().backlog().collect();
+    assert_eq!(backlog, [waiting]);
+
+    // Taking the stored stone away opens the slot for the waiting one
+    world.despawn(stored);
+    schedule.run(&mut world);
+    assert_eq!(haul_targets(&world), [(5, 5)]);
+    assert_eq!(world.resource::<StockpilePlanner>().backlog().count(), 0);
+}
+
+#[test]
+fn completed_haul_hands_back_its_slot() {
+    let mut world = planner_world();
+    world.spawn(StockpileBundle::new(5, 5, 5, 5));
+    let hauled = world.spawn((Item::stone(), Position(1, 1), Carriable)).id();
+    let waiting = world.spawn((Item::stone(), Position(0, 0), Carriable)).id();
+    let mut schedule = Schedule::default();
+    schedule.add_systems((hauling_execution_system, auto_haul_system).chain());
+    schedule.run(&mut world);
+    assert_eq!(haul_targets(&world), [(5, 5)]);
+    let backlog: Vec<Entity> = world.resource::<StockpilePlanner>().backlog().collect();
+    assert_eq!(backlog, [waiting]);
+
+    // Hand the job to a carrier, as job assignment would
+    let id = world.resource::<JobBoard>().iter().next().unwrap().id;
+    let job = world.resource_mut::<JobBoard>().remove(id).unwrap();
+    world.resource_mut::<ActiveJobs>().jobs.insert(id, job);
+    world.spawn((
+        Carrier,
+        Position(3, 3),
+        Inventory::default(),
+        AssignedJob(Some(id)),
+    ));
+    schedule.run(&mut world);
+    assert_eq!(world.get::<Position>(hauled), Some(&Position(5, 5)));
+    assert!(world.resource::<ActiveJobs>().jobs.is_empty());
+
+    // The finished job no longer holds the slot, so clearing the delivered
+    // stone away lets the waiting one in
+    world.despawn(hauled);
+    schedule.run(&mut world);
+    assert_eq!(haul_targets(&world), [(5, 5)]);
+    assert_eq!(world.resource::<StockpilePlanner>().backlog().count(), 0);
+}
@@ -0,0 +1,77 @@
+use gc_core::prelude::*;
+
+#[test]
+fn streamed_tiles_match_eager_generation() {
+    let eager = MapGenerator::new().generate(100, 70, 5);
+    let mut stream = StreamingMap::new(100, 70, 5);
+    assert_eq!(stream.resident_chunks(), 0);
+
+    // Reading one tile only generates its chunk
+    assert_eq!(stream.get_tile(40, 20), eager.get_tile(40, 20));
+    assert_eq!(stream.resident_chunks(), 1);
+    assert!(stream.is_resident(2, 1));
+
+    for y in -1..71 {
+        for x in -1..101 {
+            assert_eq!(stream.get_tile(x, y), eager.get_tile(x, y), "({x}, {y})");
+        }
+    }
+    // 7 x 5 chunks, the last column and row partial
+    assert_eq!(stream.stats.generated, 35);
+
+    let window = stream.window(-3, 60, 20, 20).unwrap();
+    assert_eq!(window.get_tile(0, 0), Some(TileKind::Wall));
+    for y in 0..10 {
+        for x in 3..20 {
+            assert_eq!(window.get_tile(x, y), eager.get_tile(x - 3, y + 60));
+        }
+    }
+}
+
+#[test]
+fn eviction_drops_only_cold_unmodified_chunks() {
+    let mut stream = StreamingMap::new(64, 64, 1);
+    for cx in 0..4 {
+        stream.get_tile(cx * CHUNK_SIZE, 0);
+    }
+    stream.set_tile(0, 0, TileKind::Lava);
+    // Touch chunk (1, 0) again so (2, 0) is now the coldest unmodified one
+    stream.get_tile(CHUNK_SIZE, 0);
+
+    assert_eq!(stream.evict_cold(3), 1);
+    assert!(!stream.is_resident(2, 0));
+    assert_eq!(stream.evict_cold(0), 2);
+    assert_eq!(stream.resident_chunks(), 1);
+    assert_eq!(stream.stats.evicted, 3);
+
+    // The edit survives; evicted chunks regenerate identically
+    assert_eq!(stream.get_tile(0, 0), Some(TileKind::Lava));
+    let eager = MapGenerator::new().generate(64, 64, 1);
+    assert_eq!(stream.get_tile(40, 3), eager.get_tile(40, 3));
+}
+
+#[test]
+fn window_edits_write_back_into_the_stream() {
+    let mut stream = StreamingMap::new(200, 200, 3);
+    let mut window = stream.window(90, 90, 40, 40).unwrap();
+    for x in 0..40 {
+        window.set_tile(x, 10, TileKind::Floor);
+    }
+    let path = astar_path(&window, (0, 10), (39, 10)).expect("cleared corridor");
+    assert_eq!(path.1, 39);
+
+    let expected = (0..40)
+        .filter(|&x| stream.get_tile(90 + x, 100) != Some(TileKind::Floor))
+        .count();
+    assert_eq!(stream.write_back(90, 90, &window), expected);
+    assert!((90..130).all(|x| stream.is_walkable(x, 100)));
+    // Only the chunks the window covers were ever generated
+    assert!(stream.resident_chunks() <= 16);
+}
+
+#[test]
+fn oversized_window_is_refused() {
+    let mut stream = StreamingMap::new(8192, 8192, 1);
+    assert!(stream.window(0, 0, 4096, 4096).is_none());
+    assert_eq!(stream.resident_chunks(), 0);
+}
@@ -149,7 +149,7 @@ fn designation_to_jobs_system_basic() {
 
     // Check that a job was created on the job board
     let job_board = world.get_resource::<JobBoard>().unwrap();
-    assert!(!job_board.0.is_empty());
+    assert!(!job_board.is_empty());
 }
 
 #[test]
@@ -166,7 +166,7 @@ fn job_assignment_system_basic() {
         let mut bytes = [0u8; 16];
         rng.job_rng.fill(&mut bytes);
         let job_id = JobId(uuid::Uuid::from_bytes(bytes));
-        job_board.0.push(Job {
+        job_board.push(Job {
             id: job_id,
             kind: JobKind::Mine { x: 10, y: 10 },
         });
@@ -188,6 +188,104 @@ fn job_assignment_system_basic() {
     assert!(assigned_job.0.is_some());
 }
 
+#[test]
+fn job_assignment_system_assigns_every_idle_worker_in_one_run() {
+    let mut world = World::new();
+    world.insert_resource(JobBoard::default());
+    world.insert_resource(jobs::ActiveJobs::default());
+
+    let mine_a = JobId(uuid::Uuid::from_u128(1));
+    let haul = JobId(uuid::Uuid::from_u128(2));
+    let mine_b = JobId(uuid::Uuid::from_u128(3));
+    {
+        let mut board = world.resource_mut::<JobBoard>();
+        for (id, kind) in [
+            (mine_a, JobKind::Mine { x: 1, y: 1 }),
+            (
+                haul,
+                JobKind::Haul {
+                    from: (0, 0),
+                    to: (5, 5),
+                },
+            ),
+            (mine_b, JobKind::Mine { x: 2, y: 2 }),
+        ] {
+            board.push(Job { id, kind });
+        }
+    }
+
+    let busy_id = JobId(uuid::Uuid::nil());
+    let busy = world.spawn((Miner, AssignedJob(Some(busy_id)))).id();
+    let miner_1 = world.spawn((Miner, AssignedJob::default())).id();
+    let miner_2 = world.spawn((Miner, AssignedJob::default())).id();
+    let miner_3 = world.spawn((Miner, AssignedJob::default())).id();
+    let carrier_1 = world.spawn((Carrier, AssignedJob::default())).id();
+    let carrier_2 = world.spawn((Carrier, AssignedJob::default())).id();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(jobs::job_assignment_system);
+    schedule.run(&mut world);
+
+    // Idle workers take the oldest job of their kind, in query order
+    let job_of = |e: Entity| world.get::<AssignedJob>(e).unwrap().0;
+    assert_eq!(job_of(busy), Some(busy_id));
+    assert_eq!(job_of(miner_1), Some(mine_a));
+    assert_eq!(job_of(miner_2), Some(mine_b));
+    assert_eq!(job_of(miner_3), None);
+    assert_eq!(job_of(carrier_1), Some(haul));
+    assert_eq!(job_of(carrier_2), None);
+
+    assert!(world.resource::<JobBoard>().is_empty());
+    assert_eq!(world.resource::<jobs::ActiveJobs>().jobs.len(), 3);
+}
+
+#[test]
+fn job_assignment_system_distance_strategies_pick_closest_worker() {
+    for strategy in [
+        AssignmentStrategy::Nearest,
+        AssignmentStrategy::WalkDistance,
+    ] {
+        let mut world = World::new();
+        world.insert_resource(GameMap::new(40, 10));
+        world.insert_resource(JobBoard::default());
+        world.insert_resource(jobs::ActiveJobs::default());
+        world.insert_resource(AssignmentConfig { strategy });
+
+        let far_job = JobId(uuid::Uuid::from_u128(1));
+        let near_job = JobId(uuid::Uuid::from_u128(2));
+        {
+            let mut board = world.resource_mut::<JobBoard>();
+            board.push(Job {
+                id: far_job,
+                kind: JobKind::Mine { x: 35, y: 5 },
+            });
+            board.push(Job {
+                id: near_job,
+                kind: JobKind::Mine { x: 3, y: 5 },
+            });
+        }
+
+        // Query order is left-to-right, so greedy would send the left miner
+        // to the far right job
+        let left = world
+            .spawn((Miner, Position(2, 5), AssignedJob::default()))
+            .id();
+        let right = world
+            .spawn((Miner, Position(30, 5), AssignedJob::default()))
+            .id();
+        let unplaced = world.spawn((Miner, AssignedJob::default())).id();
+
+        let mut schedule = Schedule::default();
+        schedule.add_systems(jobs::job_assignment_system);
+        schedule.run(&mut world);
+
+        let job_of = |e: Entity| world.get::<AssignedJob>(e).unwrap().0;
+        assert_eq!(job_of(left), Some(near_job), "{strategy:?}");
+        assert_eq!(job_of(right), Some(far_job), "{strategy:?}");
+        assert_eq!(job_of(unplaced), None, "{strategy:?}");
+    }
+}
+
 #[test]
 fn mining_execution_system_basic() {
     let mut world = World::new();
@@ -322,7 +420,7 @@ fn mining_job_assignment_system() {
         let mut bytes = [0u8; 16];
         rng.job_rng.fill(&mut bytes);
         let job_id = JobId(uuid::Uuid::from_bytes(bytes));
-        job_board.0.push(Job {
+        job_board.push(Job {
             id: job_id,
             kind: JobKind::Mine { x: 5, y: 5 },
         });
@@ -343,3 +441,29 @@ fn mining_job_assignment_system() {
     let active_jobs = world.get_resource::<jobs::ActiveJobs>().unwrap();
     assert!(!active_jobs.jobs.is_empty());
 }
+
+#[cfg(feature = "metrics")]
+#[test]
+fn tick_metrics_record_one_sample_per_tick() {
+    let opts = gc_core::bootstrap::WorldOptions {
+        populate_demo_scene: true,
+        ..Default::default()
+    };
+    let mut world = gc_core::bootstrap::build_standard_world(40, 30, 5, opts);
+    let mut schedule = gc_core::bootstrap::build_default_schedule();
+    // Without the resource the timers stay idle
+    schedule.run(&mut world);
+    world.insert_resource(TickMetrics::new(4));
+    for _ in 0..6 {
+        schedule.run(&mut world);
+    }
+
+    let metrics = world.resource::<TickMetrics>();
+    let ticks: Vec<u64> = metrics.history().map(|s| s.tick).collect();
+    assert_eq!(ticks, [4, 5, 6, 7]);
+    assert_eq!(metrics.phase(0).count(), 6);
+    let latest = metrics.latest().unwrap();
+    assert_eq!(latest.entities, world.entities().len());
+    assert!(latest.archetypes > 0);
+    assert!(latest.phase_us.iter().sum::<u64>() <= latest.total_us);
+}
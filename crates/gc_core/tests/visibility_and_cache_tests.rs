@@ -11,7 +11,7 @@ fn path_cache_hits_on_repeat_requests() {
     let g = (30, 14);
     let _ = svc.get(&map, s, g);
     let _ = svc.get(&map, s, g);
-    let (hits, misses) = svc.stats();
+    let PathStats { hits, misses, .. } = svc.stats();
     assert!(hits >= 1, "expected at least one cache hit");
     assert!(misses >= 1, "expected at least one cache miss");
 }
@@ -31,3 +31,190 @@ fn visibility_resource_contains_entity_tiles() {
     let tiles = vis.per_entity.get(&e).expect("entity visibility missing");
     assert!(tiles.contains(&(2, 2)));
 }
+
+fn fov_set(
+    map: &GameMap,
+    origin: (i32, i32),
+    radius: i32,
+    algorithm: FovAlgorithm,
+) -> std::collections::HashSet<(i32, i32)> {
+    let mut tiles = std::collections::HashSet::new();
+    visible_tiles(map, origin, radius, algorithm, |x, y| {
+        tiles.insert((x, y));
+    });
+    tiles
+}
+
+#[test]
+fn shadowcast_matches_bresenham_disk_on_open_map() {
+    let map = GameMap::new(40, 24);
+    for radius in [0, 1, 8, 16, 32] {
+        for origin in [(0, 0), (20, 12), (39, 5)] {
+            assert_eq!(
+                fov_set(&map, origin, radius, FovAlgorithm::Shadowcast),
+                fov_set(&map, origin, radius, FovAlgorithm::Bresenham),
+                "radius {} from {:?}",
+                radius,
+                origin
+            );
+        }
+    }
+}
+
+#[test]
+fn shadowcast_walls_cast_symmetric_shadows() {
+    let mut map = GameMap::new(24, 24);
+    for y in 4..20 {
+        map.set_tile(12, y, TileKind::Wall);
+    }
+    map.set_tile(6, 3, TileKind::Wall);
+
+    let a = (8, 10);
+    let seen = fov_set(&map, a, 16, FovAlgorithm::Shadowcast);
+    assert!(seen.contains(&(12, 10)), "the wall itself is visible");
+    assert!(
+        !seen.contains(&(13, 10)),
+        "tiles behind the wall are hidden"
+    );
+
+    for b in [(20, 2), (16, 10), (3, 1), (5, 20)] {
+        let back = fov_set(&map, b, 16, FovAlgorithm::Shadowcast);
+        assert_eq!(seen.contains(&b), back.contains(&a), "{:?} <-> {:?}", a, b);
+    }
+}
+
+#[test]
+fn visibility_system_uses_configured_algorithm() {
+    let mut map = GameMap::new(16, 16);
+    for (x, y) in [(5, 4), (6, 6), (4, 7)] {
+        map.set_tile(x, y, TileKind::Wall);
+    }
+    let expected = fov_set(&map, (3, 3), 10, FovAlgorithm::Bresenham);
+
+    let mut world = World::new();
+    world.insert_resource(map);
+    world.insert_resource(gc_core::fov::Visibility::default());
+    world.insert_resource(FovConfig {
+        algorithm: FovAlgorithm::Bresenham,
+    });
+    let e = world.spawn((Position(3, 3), VisionRadius(10))).id();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(gc_core::fov::compute_visibility_system);
+    schedule.run(&mut world);
+
+    let vis = world.resource::<gc_core::fov::Visibility>();
+    let window = vis.per_entity.get(&e).expect("entity visibility missing");
+    assert_eq!(
+        window.iter().collect::<std::collections::HashSet<_>>(),
+        expected
+    );
+}
+
+#[test]
+fn visibility_tracks_visible_and_explored_bitsets() {
+    let mut world = World::new();
+    world.insert_resource(GameMap::new(40, 20));
+    world.insert_resource(gc_core::fov::Visibility::default());
+    let a = world.spawn((Position(5, 5), VisionRadius(4))).id();
+    let b = world.spawn((Position(30, 10), VisionRadius(6))).id();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(gc_core::fov::compute_visibility_system);
+    schedule.run(&mut world);
+
+    {
+        let vis = world.resource::<gc_core::fov::Visibility>();
+        let union: std::collections::HashSet<(i32, i32)> =
+            vis.per_entity.values().flat_map(|w| w.iter()).collect();
+        assert_eq!(
+            vis.visible.iter().collect::<std::collections::HashSet<_>>(),
+            union
+        );
+        assert_eq!(vis.visible.count(), union.len());
+        assert!(vis.per_entity[&a].contains(&(5, 1)));
+        assert!(!vis.per_entity[&a].contains(&(5, 0)));
+        assert_eq!(vis.explored, vis.visible);
+    }
+
+    // Move one viewer and despawn the other: visible follows, explored remembers
+    world.get_mut::<Position>(a).unwrap().0 = 15;
+    world.despawn(b);
+    schedule.run(&mut world);
+
+    let vis = world.resource::<gc_core::fov::Visibility>();
+    assert_eq!(vis.per_entity.len(), 1);
+    assert!(vis.visible.contains(15, 5) && !vis.visible.contains(5, 5));
+    assert!(!vis.visible.contains(30, 10));
+    assert!(vis.explored.contains(5, 5) && vis.explored.contains(30, 10));
+    assert!(vis.explored.contains(15, 5));
+}
+
+#[test]
+fn visibility_recomputes_only_moved_or_affected_viewers() {
+    let mut world = World::new();
+    world.insert_resource(GameMap::new(96, 48));
+    world.insert_resource(gc_core::fov::Visibility::default());
+    // Ten viewers in a row; every window lies in chunk row 1 (y 16..32)
+    let viewers: Vec<Entity> = (0..10)
+        .map(|i| world.spawn((Position(4 + 9 * i, 24), VisionRadius(4))).id())
+        .collect();
+
+    let mut schedule = Schedule::default();
+    schedule.add_systems(gc_core::fov::compute_visibility_system);
+    let mut run = |world: &mut World| {
+        schedule.run(world);
+        world.resource::<gc_core::fov::Visibility>().stats
+    };
+    let counts = |recomputed, skipped| FovStats {
+        recomputed,
+        skipped,
+    };
+
+    assert_eq!(run(&mut world), counts(10, 0));
+    let visible_before = world.resource::<gc_core::fov::Visibility>().visible.clone();
+
+    // Idle colony: nothing to do
+    assert_eq!(run(&mut world), counts(0, 10));
+    assert_eq!(
+        world.resource::<gc_core::fov::Visibility>().visible,
+        visible_before
+    );
+
+    // One viewer moves
+    world.get_mut::<Position>(viewers[0]).unwrap().0 += 1;
+    assert_eq!(run(&mut world), counts(1, 9));
+
+    // A wall appears in chunk (5, 1): the windows at x=76 and x=85 touch it
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(87, 24, TileKind::Wall);
+    assert_eq!(run(&mut world), counts(2, 8));
+    let vis = world.resource::<gc_core::fov::Visibility>();
+    assert!(vis.per_entity[&viewers[9]].contains(&(87, 24)));
+    assert!(!vis.per_entity[&viewers[9]].contains(&(88, 24)));
+
+    // Edits far from every window are ignored
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(40, 40, TileKind::Wall);
+    assert_eq!(run(&mut world), counts(0, 10));
+
+    world.get_mut::<VisionRadius>(viewers[3]).unwrap().0 = 6;
+    assert_eq!(run(&mut world), counts(1, 9));
+
+    // Switching algorithm recomputes everybody
+    world.insert_resource(FovConfig {
+        algorithm: FovAlgorithm::Bresenham,
+    });
+    assert_eq!(run(&mut world), counts(10, 0));
+
+    // A loaded map edited past this one's version, away from every window
+    let mut loaded = GameMap::new(96, 48);
+    for x in 0..10 {
+        loaded.set_tile(x, 40, TileKind::Wall);
+    }
+    assert!(loaded.version() > world.resource::<GameMap>().version());
+    world.insert_resource(loaded);
+    assert_eq!(run(&mut world), counts(10, 0));
+}
@@ -9,20 +9,23 @@ use gc_core::fov;
 use gc_core::prelude::*;
 use ratatui::{
     backend::CrosstermBackend,
-    layout::{Constraint, Direction, Layout},
-    style::Style,
+    buffer::Buffer,
+    layout::{Constraint, Direction, Layout, Rect},
     text::Text,
-    widgets::Paragraph,
+    widgets::{Paragraph, Widget},
     Terminal,
 };
-use std::collections::HashSet;
 use std::io::{stdout, Stdout};
 use std::time::{Duration, Instant};
 
+/// Longest sleep while paused; input and resizes still wake the loop
+const IDLE_WAIT: Duration = Duration::from_millis(500);
+
 pub struct AppState {
     pub paused: bool,
     pub steps_per_frame: u32,
     pub show_vis: bool,
+    pub show_metrics: bool,
 }
 
 impl Default for AppState {
@@ -31,6 +34,7 @@ impl Default for AppState {
             paused: false,
             steps_per_frame: 1,
             show_vis: false,
+            show_metrics: false,
         }
     }
 }
@@ -48,6 +52,8 @@ pub fn build_world(width: u32, height: u32, seed: u64) -> World {
     // Field of view and overlay cache are TUI responsibilities
     world.insert_resource(fov::Visibility::default());
     world.insert_resource(OverlayCache::default());
+    // Profile every tick so the metrics panel has data when it is opened
+    world.insert_resource(TickMetrics::default());
     // Track a player agent for camera center; bootstrap guarantees a Miner exists
     let player = {
         let mut q = world.query_filtered::<Entity, With<Miner>>();
@@ -61,22 +67,23 @@ pub fn build_world(width: u32, height: u32, seed: u64) -> World {
 
 pub fn build_schedule() -> Schedule {
     let mut schedule = core_build_default_schedule();
-    // Keep visibility up-to-date as entities move
-    schedule.add_systems(fov::compute_visibility_system);
+    // Keep visibility up-to-date as entities move; runs beside haul posting
+    schedule.add_systems(fov::compute_visibility_system.in_set(SimSet::Perception));
     schedule
 }
 
 /// Cache for the visibility overlay.
 ///
-/// Holds the union of all entities' visible tiles so rendering can check
-/// visibility in O(1) per tile without recomputing per frame. The `dirty`
+/// Holds a copy of the map-wide "visible by anyone" bitset so rendering can
+/// check visibility in O(1) per tile; refreshing it copies O(tiles/64) words
+/// instead of unioning per-entity sets. The `dirty`
 /// flag indicates the cache must be recomputed (e.g., after sim updates or
 /// when the overlay toggle changes).
 #[derive(Resource, Default)]
 struct OverlayCache {
     /// Union of all currently visible tiles across entities. Used by the
     /// renderer for constant-time visibility checks per tile.
-    union_vis: HashSet<(i32, i32)>,
+    union_vis: BitGrid,
     /// Marks that `union_vis` is stale and must be rebuilt before the next
     /// render when the visibility overlay is enabled.
     dirty: bool,
@@ -94,50 +101,238 @@ fn entity_position(world: &World, entity: Entity) -> Option<(i32, i32)> {
         .map(|pos| (pos.0, pos.1))
 }
 
-fn render_ascii_map(world: &World, show_vis: bool) -> String {
-    let map = world.resource::<GameMap>();
-    let cache = world.get_resource::<OverlayCache>();
-
-    // Query the actual agent position if present; fallback to center
+/// Where the agent marker is drawn: the player agent, or the map center
+fn agent_position(world: &World, map: &GameMap) -> (i32, i32) {
     let center = ((map.width as i32) / 2, (map.height as i32) / 2);
-    let agent_pos = world
+    world
         .get_resource::<PlayerAgent>()
         .and_then(|pa| entity_position(world, pa.0))
-        .unwrap_or(center);
+        .unwrap_or(center)
+}
 
-    // If overlay enabled, check cached union of visible tiles
-    let union_vis = if show_vis {
-        cache.map(|c| &c.union_vis)
+/// Cached overlay bits when the overlay is on
+fn overlay(world: &World, show_vis: bool) -> Option<&BitGrid> {
+    if show_vis {
+        world.get_resource::<OverlayCache>().map(|c| &c.union_vis)
     } else {
         None
-    };
+    }
+}
+
+/// Character drawn for one map tile
+fn tile_glyph(
+    map: &GameMap,
+    union_vis: Option<&BitGrid>,
+    agent_pos: (i32, i32),
+    x: i32,
+    y: i32,
+) -> char {
+    if (x, y) == agent_pos {
+        return '@';
+    }
+    // If visibility overlay enabled and this tile is visible by any entity, draw '*'
+    if union_vis.is_some_and(|u| u.contains(x, y)) {
+        return '*';
+    }
+    match map.get_tile(x, y).unwrap_or(TileKind::Wall) {
+        TileKind::Floor => '.',
+        TileKind::Wall => '#',
+        TileKind::Water => '~',
+        TileKind::Lava => '^',
+    }
+}
+
+fn render_ascii_map(world: &World, show_vis: bool) -> String {
+    let map = world.resource::<GameMap>();
+    let agent_pos = agent_position(world, map);
+    let union_vis = overlay(world, show_vis);
 
     let mut out = String::with_capacity((map.width * (map.height + 1)) as usize);
     for y in 0..map.height as i32 {
         for x in 0..map.width as i32 {
-            if (x, y) == agent_pos {
-                out.push('@');
-            } else {
-                // If visibility overlay enabled and this tile is visible by any entity, draw '*'
-                let visible = union_vis.map(|u| u.contains(&(x, y))).unwrap_or(false);
-                let ch = if visible {
-                    '*'
-                } else {
-                    match map.get_tile(x, y).unwrap_or(TileKind::Wall) {
-                        TileKind::Floor => '.',
-                        TileKind::Wall => '#',
-                        TileKind::Water => '~',
-                        TileKind::Lava => '^',
-                    }
-                };
-                out.push(ch);
-            }
+            out.push(tile_glyph(map, union_vis, agent_pos, x, y));
         }
         out.push('\n');
     }
     out
 }
 
+/// Viewport onto the map that keeps the glyphs of the previous frame.
+///
+/// `update` re-derives only tiles that can have changed since the last
+/// frame: tiles in map chunks edited since then, the agent's old and new
+/// tile, and tiles whose overlay bit flipped. Moving or resizing the
+/// viewport, or a replaced map (another `GameMap::epoch`), redraws it
+/// whole. The cost of a frame follows the viewport and
+/// the edits, not the map size, and ratatui's buffer diff then sends only
+/// changed cells to the terminal.
+#[derive(Default)]
+pub struct MapView {
+    /// Map tile shown in the top-left cell
+    origin: (i32, i32),
+    width: u16,
+    height: u16,
+    /// Row-major glyphs of the viewport as last drawn
+    cells: Vec<char>,
+    /// Map epoch and version the cells were drawn against
+    map: (u64, u64),
+    agent: (i32, i32),
+    /// Overlay bits as last drawn; `None` while the overlay is off
+    vis: Option<BitGrid>,
+    drawn: bool,
+    /// Scratch list of tiles to re-derive
+    dirty: Vec<(i32, i32)>,
+}
+
+impl MapView {
+    /// Map tile shown in the top-left cell
+    pub fn origin(&self) -> (i32, i32) {
+        self.origin
+    }
+
+    /// Viewport size in cells; never larger than the map
+    pub fn size(&self) -> (u16, u16) {
+        (self.width, self.height)
+    }
+
+    /// Viewport rows as last drawn
+    pub fn lines(&self) -> impl Iterator<Item = String> + '_ {
+        self.cells
+            .chunks(self.width.max(1) as usize)
+            .map(|row| row.iter().collect())
+    }
+
+    /// Top-left tile for a viewport following `agent`
+    ///
+    /// The view stays put while the agent is inside its middle half and
+    /// recenters once it walks out, so most moves redraw two tiles rather
+    /// than scrolling the whole viewport.
+    fn camera(&self, map: &GameMap, agent: (i32, i32), width: u16, height: u16) -> (i32, i32) {
+        let (w, h) = (width as i32, height as i32);
+        let (ox, oy) = self.origin;
+        let inside = agent.0 >= ox + w / 4
+            && agent.0 < ox + w - w / 4
+            && agent.1 >= oy + h / 4
+            && agent.1 < oy + h - h / 4;
+        let (x, y) = if self.drawn && inside && (width, height) == (self.width, self.height) {
+            (ox, oy)
+        } else {
+            (agent.0 - w / 2, agent.1 - h / 2)
+        };
+        (
+            x.clamp(0, map.width as i32 - w),
+            y.clamp(0, map.height as i32 - h),
+        )
+    }
+
+    /// Bring the viewport up to date for a `width` x `height` cell area
+    /// centered on the agent, returning how many cells changed
+    pub fn update(&mut self, world: &World, show_vis: bool, width: u16, height: u16) -> usize {
+        let map = world.resource::<GameMap>();
+        let agent = agent_position(world, map);
+        let union_vis = overlay(world, show_vis);
+        let width = width.min(map.width.min(u16::MAX as u32) as u16);
+        let height = height.min(map.height.min(u16::MAX as u32) as u16);
+        let origin = self.camera(map, agent, width, height);
+        let full = !self.drawn
+            || origin != self.origin
+            || (width, height) != (self.width, self.height)
+            || map.epoch() != self.map.0
+            || union_vis.is_some() != self.vis.is_some();
+
+        let (x0, y0) = origin;
+        let (x1, y1) = (x0 + width as i32, y0 + height as i32);
+        let changed = if full {
+            self.origin = origin;
+            (self.width, self.height) = (width, height);
+            self.cells.clear();
+            for y in y0..y1 {
+                for x in x0..x1 {
+                    self.cells.push(tile_glyph(map, union_vis, agent, x, y));
+                }
+            }
+            match (union_vis, &mut self.vis) {
+                (Some(new), Some(old)) => old.copy_from(new),
+                (new, old) => *old = new.cloned(),
+            }
+            self.cells.len()
+        } else {
+            let mut dirty = std::mem::take(&mut self.dirty);
+            dirty.clear();
+            if map.version() != self.map.1 {
+                for (cx, cy) in map.changed_chunks_since(self.map.1) {
+                    let (tx, ty) = (cx * CHUNK_SIZE, cy * CHUNK_SIZE);
+                    for y in ty.max(y0)..(ty + CHUNK_SIZE).min(y1) {
+                        for x in tx.max(x0)..(tx + CHUNK_SIZE).min(x1) {
+                            dirty.push((x, y));
+                        }
+                    }
+                }
+            }
+            if agent != self.agent {
+                dirty.extend([self.agent, agent]);
+            }
+            if let (Some(new), Some(old), true) = (union_vis, self.vis.as_mut(), width > 0) {
+                let before = dirty.len();
+                let w = map.width as usize;
+                // Compare only the words covering viewport rows
+                for y in y0..y1 {
+                    let row = y as usize * w;
+                    let (first, last) = ((row + x0 as usize) / 64, (row + x1 as usize - 1) / 64);
+                    for i in first..=last {
+                        let mut diff = new.words()[i] ^ old.words()[i];
+                        while diff != 0 {
+                            let b = i * 64 + diff.trailing_zeros() as usize;
+                            diff &= diff - 1;
+                            let (x, y) = ((b % w) as i32, (b / w) as i32);
+                            if (x0..x1).contains(&x) && (y0..y1).contains(&y) {
+                                dirty.push((x, y));
+                            }
+                        }
+                    }
+                }
+                for &(x, y) in &dirty[before..] {
+                    old.set(x, y, new.contains(x, y));
+                }
+            }
+            let mut changed = 0;
+            for &(x, y) in &dirty {
+                if !(x0..x1).contains(&x) || !(y0..y1).contains(&y) {
+                    continue;
+                }
+                let i = (y - y0) as usize * width as usize + (x - x0) as usize;
+                let glyph = tile_glyph(map, union_vis, agent, x, y);
+                if self.cells[i] != glyph {
+                    self.cells[i] = glyph;
+                    changed += 1;
+                }
+            }
+            self.dirty = dirty;
+            changed
+        };
+        self.map = (map.epoch(), map.version());
+        self.agent = agent;
+        self.drawn = true;
+        changed
+    }
+}
+
+impl Widget for &MapView {
+    fn render(self, area: Rect, buf: &mut Buffer) {
+        for (row, line) in self
+            .cells
+            .chunks(self.width.max(1) as usize)
+            .take(area.height as usize)
+            .enumerate()
+        {
+            for (col, &glyph) in line.iter().take(area.width as usize).enumerate() {
+                buf.get_mut(area.x + col as u16, area.y + row as u16)
+                    .set_char(glyph);
+            }
+        }
+    }
+}
+
 /// Render the current world state to a deterministic ASCII map string.
 ///
 /// This is a thin public wrapper around the internal renderer, intended for
@@ -149,12 +344,44 @@ pub fn render_ascii_snapshot(world: &mut World, show_vis: bool) -> String {
     render_ascii_map(world, show_vis)
 }
 
+/// Render the tick profiler panel: per-phase times over the recorded ticks
+/// and the latest tick's counters. The rows stay at zero when gc_core is
+/// built without its `metrics` feature.
+pub fn render_metrics_panel(world: &World) -> String {
+    let Some(metrics) = world.get_resource::<TickMetrics>() else {
+        return "metrics off".to_string();
+    };
+    let mut out = String::from("phase        mean   p95   max\n");
+    for row in metrics.summary() {
+        out.push_str(&format!(
+            "{:<12}{:>5.0}{:>6}{:>6}\n",
+            row.name, row.mean_us, row.p95_us, row.max_us
+        ));
+    }
+    if let Some(s) = metrics.latest() {
+        let hit_rate = s
+            .path_hit_rate()
+            .map_or("n/a".to_string(), |r| format!("{:.0}%", r * 100.0));
+        out.push_str(&format!(
+            "\ntick {}\nentities {} ({} archetypes)\njobs {} waiting, {} active\npath hits {hit_rate}\nfov {} recomputed, {} skipped\n",
+            s.tick,
+            s.entities,
+            s.archetypes,
+            s.job_board,
+            s.active_jobs,
+            s.fov_recomputed,
+            s.fov_skipped
+        ));
+    }
+    out
+}
+
 fn draw(
     terminal: &mut Terminal<CrosstermBackend<Stdout>>,
     world: &World,
     app: &AppState,
+    view: &mut MapView,
 ) -> Result<()> {
-    let text = render_ascii_map(world, app.show_vis);
     terminal.draw(|f| {
         let chunks = Layout::default()
             .direction(Direction::Vertical)
@@ -166,16 +393,27 @@ fn draw(
             .split(f.size());
 
         let header = Paragraph::new(Text::raw(
-            "Goblin Camp — TUI (q:quit, space:pause, .:step, v:vis)",
+            "Goblin Camp — TUI (q:quit, space:pause, .:step, v:vis, m:metrics)",
         ));
-        let body = Paragraph::new(Text::raw(text)).style(Style::default());
         let footer = Paragraph::new(Text::raw(format!(
             "paused={}, steps/frame={}, vis={}",
             app.paused, app.steps_per_frame, app.show_vis
         )));
 
         f.render_widget(header, chunks[0]);
-        f.render_widget(body, chunks[1]);
+        let body = if app.show_metrics {
+            let split = Layout::default()
+                .direction(Direction::Horizontal)
+                .constraints([Constraint::Min(0), Constraint::Length(32)])
+                .split(chunks[1]);
+            let panel = Paragraph::new(Text::raw(render_metrics_panel(world)));
+            f.render_widget(panel, split[1]);
+            split[0]
+        } else {
+            chunks[1]
+        };
+        view.update(world, app.show_vis, body.width, body.height);
+        f.render_widget(&*view, body);
         f.render_widget(footer, chunks[2]);
     })?;
     Ok(())
@@ -184,7 +422,7 @@ fn draw(
 fn run_frame(world: &mut World, schedule: &mut Schedule, app: &AppState) {
     if !app.paused {
         for _ in 0..app.steps_per_frame {
-            schedule.run(world);
+            run_tick(world, schedule);
             mark_overlay_dirty(world);
         }
     }
@@ -203,20 +441,33 @@ pub fn run(width: u32, height: u32, seed: u64) -> Result<()> {
     let mut world = build_world(width, height, seed);
     let mut schedule = build_schedule();
     // Ensure initial visibility buffer is computed before first draw
-    schedule.run(&mut world);
+    run_tick(&mut world, &mut schedule);
     mark_overlay_dirty(&mut world);
 
     // Main loop
     let tick = Duration::from_millis(16);
     let mut last = Instant::now();
+    let mut view = MapView::default();
+    let mut redraw = true;
     loop {
-        // Prepare overlay cache before drawing
-        prepare_overlay_cache(&mut world, app.show_vis);
-        // Draw
-        draw(&mut terminal, &world, &app)?;
+        // Draw only after something changed
+        if redraw {
+            // Prepare overlay cache before drawing
+            prepare_overlay_cache(&mut world, app.show_vis);
+            draw(&mut terminal, &world, &app, &mut view)?;
+            redraw = false;
+        }
 
-        // Input
-        while event::poll(Duration::from_millis(0))? {
+        // Input: sleep until the next tick is due or a key arrives, then
+        // drain whatever else is queued
+        let mut wait = if app.paused {
+            IDLE_WAIT
+        } else {
+            tick.saturating_sub(last.elapsed())
+        };
+        while event::poll(wait)? {
+            wait = Duration::ZERO;
+            redraw = true;
             match event::read()? {
                 Event::Key(key) if key.kind == KeyEventKind::Press => match key.code {
                     KeyCode::Char('q') | KeyCode::Esc => {
@@ -227,7 +478,7 @@ pub fn run(width: u32, height: u32, seed: u64) -> Result<()> {
                     KeyCode::Char(' ') => app.paused = !app.paused,
                     KeyCode::Char('.') => {
                         // Single step: run the schedule once without changing paused state
-                        schedule.run(&mut world);
+                        run_tick(&mut world, &mut schedule);
                         mark_overlay_dirty(&mut world);
                     }
                     KeyCode::Char('v') => {
@@ -235,6 +486,7 @@ pub fn run(width: u32, height: u32, seed: u64) -> Result<()> {
                         app.show_vis = !app.show_vis;
                         mark_overlay_dirty(&mut world);
                     }
+                    KeyCode::Char('m') => app.show_metrics = !app.show_metrics,
                     KeyCode::Char(d @ '1'..='9') => {
                         let n = (d as u8 - b'0') as u32;
                         app.steps_per_frame = n.max(1);
@@ -249,9 +501,10 @@ pub fn run(width: u32, height: u32, seed: u64) -> Result<()> {
         }
 
         // Tick
-        if last.elapsed() >= tick {
+        if !app.paused && last.elapsed() >= tick {
             run_frame(&mut world, &mut schedule, &app);
             last = Instant::now();
+            redraw = true;
         }
     }
 }
@@ -269,26 +522,15 @@ fn prepare_overlay_cache(world: &mut World, show_vis: bool) {
         }
     }
 
-    // Build the union in a local buffer first
-    let mut union: HashSet<(i32, i32)> = HashSet::new();
-    if let Some(vis) = world.get_resource::<fov::Visibility>() {
-        for set in vis.per_entity.values() {
-            // Extend the union with all points from this entity's visibility set
-            union.extend(set.iter().copied());
+    // The FOV system already maintains the union as a bitset; copy its words
+    world.init_resource::<OverlayCache>();
+    world.resource_scope(|world, mut cache: Mut<OverlayCache>| {
+        match world.get_resource::<fov::Visibility>() {
+            Some(vis) => cache.union_vis.copy_from(&vis.visible),
+            None => cache.union_vis.clear(),
         }
-    }
-
-    // Now update the cache
-    if let Some(mut cache) = world.get_resource_mut::<OverlayCache>() {
-        cache.union_vis = union;
         cache.dirty = false;
-    } else {
-        // Handle the missing-cache case gracefully by inserting a fresh cache.
-        world.insert_resource(OverlayCache {
-            union_vis: union,
-            dirty: false,
-        });
-    }
+    });
 }
 
 /// Mark the overlay cache as needing recomputation on the next draw.
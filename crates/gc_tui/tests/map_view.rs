@@ -0,0 +1,71 @@
+use gc_core::prelude::*;
+use gc_tui::{build_schedule, build_world, render_ascii_snapshot, MapView};
+
+/// The slice of the full-map render that `view` covers
+fn expected_viewport(world: &mut bevy_ecs::world::World, view: &MapView) -> Vec<String> {
+    let full = render_ascii_snapshot(world, false);
+    let (ox, oy) = view.origin();
+    let (w, h) = view.size();
+    full.lines()
+        .skip(oy as usize)
+        .take(h as usize)
+        .map(|row| row[ox as usize..ox as usize + w as usize].to_string())
+        .collect()
+}
+
+#[test]
+fn incremental_view_matches_full_render() {
+    let mut world = build_world(96, 64, 7);
+    let mut schedule = build_schedule();
+    let mut view = MapView::default();
+    assert_eq!(view.update(&world, false, 40, 20), 40 * 20);
+    assert_eq!(view.size(), (40, 20));
+    // Nothing changed, nothing redrawn
+    assert_eq!(view.update(&world, false, 40, 20), 0);
+
+    for _ in 0..60 {
+        schedule.run(&mut world);
+        view.update(&world, false, 40, 20);
+        let expected = expected_viewport(&mut world, &view);
+        assert_eq!(view.lines().collect::<Vec<_>>(), expected);
+    }
+
+    // One tile edit inside the viewport redraws one cell
+    let (ox, oy) = view.origin();
+    let (row, col) = view
+        .lines()
+        .enumerate()
+        .find_map(|(row, line)| line.find(['.', '#']).map(|col| (row, col)))
+        .expect("viewport shows some terrain");
+    let (x, y) = (ox + col as i32, oy + row as i32);
+    world
+        .resource_mut::<GameMap>()
+        .set_tile(x, y, TileKind::Water);
+    assert_eq!(view.update(&world, false, 40, 20), 1);
+    assert_eq!(view.lines().nth(row).unwrap().as_bytes()[col], b'~');
+}
+
+#[test]
+fn a_swapped_map_redraws_the_whole_view() {
+    let mut world = build_world(96, 64, 7);
+    let mut view = MapView::default();
+    view.update(&world, false, 40, 20);
+
+    // A copy is another map, even one edited past the original's version
+    let mut loaded = world.resource::<GameMap>().clone();
+    let (ox, oy) = view.origin();
+    loaded.set_tile(ox + 3, oy + 3, TileKind::Lava);
+    world.insert_resource(loaded);
+    assert_eq!(view.update(&world, false, 40, 20), 40 * 20);
+    let expected = expected_viewport(&mut world, &view);
+    assert_eq!(view.lines().collect::<Vec<_>>(), expected);
+}
+
+#[test]
+fn viewport_never_exceeds_the_map() {
+    let world = build_world(30, 12, 3);
+    let mut view = MapView::default();
+    view.update(&world, false, 200, 100);
+    assert_eq!(view.size(), (30, 12));
+    assert_eq!(view.origin(), (0, 0));
+}